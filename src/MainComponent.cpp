@@ -4,8 +4,319 @@
 
 #include "MainComponent.h"
 #include "ui/Mach1LookAndFeel.h"
+#include "audio/ChannelAnalyzer.h"
+#include "audio/LoudnessMeter.h"
+#include "audio/ParallelFor.h"
+#include "audio/WavFileWriter.h"
+#include "audio/FlacFileWriter.h"
+#include "audio/GrowingWavFile.h"
+#include "audio/StreamChecksum.h"
+#include "async/SpawnedProcess.h"
+#include <cstring>
+#include <set>
 #include "BinaryData.h"
 
+namespace
+{
+    // "file.wav:stream:channel" for the export manifest's channel map
+    juce::String channelSource(const Lane& lane)
+    {
+        return lane.sourceFile.getFileName() + ":" + juce::String(lane.streamIndex) + ":" + juce::String(lane.channelIndex);
+    }
+
+    // Dither seed of one native output. Files made in the same export get
+    // uncorrelated noise, so summing them later adds +3 dB of dither, not
+    // +6; the same file and channels always get the same noise.
+    uint32_t ditherSeedFor(const juce::File& outputFile, const juce::StringArray& channelMap)
+    {
+        const auto hash = static_cast<uint64_t>((outputFile.getFileName() + "\n" + channelMap.joinIntoString("\n")).hashCode64());
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    // The part of a source an export input needs. Input seeking skips to the
+    // earliest in-point of the lanes reading it and -t stops after the latest
+    // out-point, so trimmed heads and tails are never decoded.
+    struct InputRange
+    {
+        double seek = 0.0;
+        double length = 0.0;      // 0 = to the end
+    };
+
+    InputRange inputRangeFor(const std::vector<Lane*>& lanes)
+    {
+        InputRange range;
+        range.seek = lanes.front()->inPoint;
+        double end = 0.0;
+        bool bounded = true;
+        for (auto* lane : lanes)
+        {
+            range.seek = std::min(range.seek, lane->inPoint);
+            if (lane->outPoint > 0.0)
+                end = std::max(end, lane->outPoint);
+            else
+                bounded = false;
+        }
+
+        // The exact cut is atrim's; this only has to reach past it
+        if (bounded)
+            range.length = end - range.seek + 0.1;
+        return range;
+    }
+
+    void addInputArgs(juce::StringArray& args, const juce::File& file, const InputRange& range)
+    {
+        if (range.seek > 0.0)
+        {
+            args.add("-ss");
+            args.add(juce::String(range.seek, 6));
+        }
+        if (range.length > 0.0)
+        {
+            args.add("-t");
+            args.add(juce::String(range.length, 6));
+        }
+        args.add("-i");
+        args.add(file.getFullPathName());
+    }
+
+    // Sample-exact atrim/adelay applying a lane's edit to its source channel,
+    // which starts 'seekSeconds' into the source. Empty for an unedited lane.
+    juce::String editFilter(const Lane& lane, double seekSeconds)
+    {
+        if (!lane.hasEdit())
+            return {};
+
+        auto samples = [&lane](double seconds) { return juce::String(static_cast<juce::int64>(std::llround(seconds * lane.sampleRate))); };
+
+        juce::StringArray trim;
+        if (lane.inPoint > seekSeconds)
+            trim.add("start_sample=" + samples(lane.inPoint - seekSeconds));
+        if (lane.outPoint > 0.0)
+            trim.add("end_sample=" + samples(lane.outPoint - seekSeconds));
+
+        juce::StringArray filters;
+        if (!trim.isEmpty())
+            filters.add("atrim=" + trim.joinIntoString(":") + ",asetpts=PTS-STARTPTS");
+        if (lane.offset > 0.0)
+            filters.add("adelay=delays=" + samples(lane.offset) + "S:all=1");
+        return filters.joinIntoString(",");
+    }
+
+    // Export graph step for one lane: pick its channel, then apply its edit
+    juce::String laneFilter(const Lane& lane, double seekSeconds)
+    {
+        auto filter = "pan=mono|c0=c" + juce::String(lane.channelIndex);
+        auto edit = editFilter(lane, seekSeconds);
+        return edit.isEmpty() ? filter : filter + "," + edit;
+    }
+
+    // amerge takes at most 64 inputs and slows down well before that
+    constexpr int kMaxMergeInputs = 32;
+
+    // Wider native WAV exports render this many channels per filter graph,
+    // run in parallel and gathered into the file
+    constexpr int kMaxChannelsPerGraph = 32;
+
+    // Filter joining labelled streams in order, followed by 'tail' (further
+    // filters and the output label). More than kMaxMergeInputs are merged in
+    // groups, and the groups merged again, through labels named from
+    // 'labelPrefix'.
+    juce::String mergeFilter(juce::StringArray inputs, const juce::String& tail, const juce::String& labelPrefix = "g")
+    {
+        juce::StringArray steps;
+        for (int level = 0; inputs.size() > kMaxMergeInputs; ++level)
+        {
+            juce::StringArray merged;
+            for (int start = 0; start < inputs.size(); start += kMaxMergeInputs)
+            {
+                const int count = std::min(kMaxMergeInputs, inputs.size() - start);
+                if (count == 1)
+                {
+                    merged.add(inputs[start]);
+                    continue;
+                }
+
+                auto label = "[" + labelPrefix + juce::String(level) + "_" + juce::String(merged.size()) + "]";
+                juce::String step;
+                for (int i = start; i < start + count; ++i)
+                    step += inputs[i];
+                steps.add(step + "amerge=inputs=" + juce::String(count) + label);
+                merged.add(label);
+            }
+            inputs = merged;
+        }
+
+        steps.add(inputs.joinIntoString("") + "amerge=inputs=" + juce::String(inputs.size()) + tail);
+        return steps.joinIntoString(";");
+    }
+
+    // Graph output carrying the k-th group of channels of a split command
+    juce::String splitOutputLabel(int k)
+    {
+        return "[out" + juce::String(k) + "]";
+    }
+
+    juce::String sourceKey(const Lane& lane)
+    {
+        return lane.sourceFile.getFullPathName() + ":" + juce::String(lane.streamIndex);
+    }
+
+    // Filter steps rendering one channel per lane of lanes[begin, end), in
+    // order, from the numbered inputs; their labels are added to
+    // monoOutputs. Steps in separate graphs of one command get their labels
+    // apart through 'labelPrefix'.
+    juce::String laneGraph(const std::vector<Lane*>& lanes, size_t begin, size_t end,
+                           const std::map<juce::String, int>& sourceToIndex,
+                           const std::map<juce::String, InputRange>& sourceRanges,
+                           const juce::String& labelPrefix, juce::StringArray& monoOutputs)
+    {
+        juce::String filterComplex;
+
+        // Count how many times each source is used
+        std::map<juce::String, int> sourceUsageCount;
+        for (size_t i = begin; i < end; ++i)
+            sourceUsageCount[sourceKey(*lanes[i])]++;
+
+        // Create asplit filters for sources used multiple times
+        std::map<juce::String, juce::StringArray> sourceSplitLabels;
+        for (const auto& [key, count] : sourceUsageCount)
+        {
+            int idx = sourceToIndex.at(key);
+            if (count > 1)
+            {
+                juce::String asplitFilter = "[" + juce::String(idx) + ":a]asplit=" + juce::String(count);
+                juce::StringArray labels;
+                for (int i = 0; i < count; ++i)
+                {
+                    juce::String label = "[" + labelPrefix + "s" + juce::String(idx) + "_" + juce::String(i) + "]";
+                    labels.add(label);
+                    asplitFilter += label;
+                }
+                sourceSplitLabels[key] = labels;
+
+                if (!filterComplex.isEmpty())
+                    filterComplex += ";";
+                filterComplex += asplitFilter;
+            }
+        }
+
+        // Track which split index we're on for each source
+        std::map<juce::String, int> sourceSplitIndex;
+        for (const auto& [key, _] : sourceUsageCount)
+            sourceSplitIndex[key] = 0;
+
+        // Create pan=mono filter for each lane
+        for (size_t i = begin; i < end; ++i)
+        {
+            auto* lane = lanes[i];
+            auto key = sourceKey(*lane);
+            int idx = sourceToIndex.at(key);
+
+            juce::String inputLabel;
+            if (sourceUsageCount[key] > 1)
+            {
+                int splitIdx = sourceSplitIndex[key]++;
+                inputLabel = sourceSplitLabels[key][splitIdx];
+            }
+            else
+            {
+                inputLabel = "[" + juce::String(idx) + ":a]";
+            }
+
+            juce::String monoLabel = "[" + labelPrefix + "m" + juce::String(static_cast<int>(i)) + "]";
+            juce::String panFilter = inputLabel + laneFilter(*lane, sourceRanges.at(key).seek) + monoLabel;
+
+            if (!filterComplex.isEmpty())
+                filterComplex += ";";
+            filterComplex += panFilter;
+
+            monoOutputs.add(monoLabel);
+        }
+
+        return filterComplex;
+    }
+
+    // ffmpeg arguments up to the first -map: decodes each source once and
+    // renders one channel per lane, in order, into [out] followed by
+    // 'postFilter' (may be empty). With channelsPerOutput set, consecutive
+    // runs of that many lanes go to separate outputs (splitOutputLabel) -
+    // from one filter graph, or with graphPerOutput from a graph each, which
+    // ffmpeg (7 and later) runs on threads of their own.
+    juce::StringArray mergeCommand(const juce::String& ffmpegPath, const std::vector<Lane*>& lanes,
+                                   const juce::String& postFilter, int channelsPerOutput = 0,
+                                   bool graphPerOutput = false)
+    {
+        juce::StringArray args;
+        args.add(ffmpegPath);
+        args.add("-y");  // Overwrite output
+
+        // Build a map of unique source file+stream combinations
+        std::map<juce::String, int> sourceToIndex;
+        std::map<juce::String, std::vector<Lane*>> sourceLanes;
+        std::map<juce::String, InputRange> sourceRanges;
+        int inputIndex = 0;
+
+        for (auto* lane : lanes)
+            sourceLanes[sourceKey(*lane)].push_back(lane);
+
+        for (auto* lane : lanes)
+        {
+            auto key = sourceKey(*lane);
+            if (sourceToIndex.find(key) == sourceToIndex.end())
+            {
+                sourceToIndex[key] = inputIndex++;
+                sourceRanges[key] = inputRangeFor(sourceLanes[key]);
+                addInputArgs(args, lane->sourceFile, sourceRanges[key]);
+            }
+        }
+
+        // Build filter_complex using asplit + pan=mono + amerge approach
+        const auto tail = postFilter.isNotEmpty() ? "," + postFilter : juce::String();
+        if (channelsPerOutput <= 0)
+        {
+            juce::StringArray monoOutputs;
+            auto filterComplex = laneGraph(lanes, 0, lanes.size(), sourceToIndex, sourceRanges, {}, monoOutputs);
+            args.add("-filter_complex");
+            args.add(filterComplex + ";" + mergeFilter(monoOutputs, tail + "[out]"));
+            return args;
+        }
+
+        juce::StringArray monoOutputs;
+        juce::String filterComplex;
+        if (!graphPerOutput)
+            filterComplex = laneGraph(lanes, 0, lanes.size(), sourceToIndex, sourceRanges, {}, monoOutputs);
+
+        const auto runLength = static_cast<size_t>(channelsPerOutput);
+        for (size_t start = 0; start < lanes.size(); start += runLength)
+        {
+            const size_t end = std::min(lanes.size(), start + runLength);
+            const int k = static_cast<int>(start / runLength);
+            const auto graphPrefix = "o" + juce::String(k);
+
+            juce::StringArray outputChannels;
+            if (graphPerOutput)
+            {
+                auto graph = laneGraph(lanes, start, end, sourceToIndex, sourceRanges, graphPrefix, outputChannels);
+                args.add("-filter_complex");
+                args.add(graph + ";" + mergeFilter(outputChannels, tail + splitOutputLabel(k), graphPrefix + "g"));
+                continue;
+            }
+
+            for (size_t i = start; i < end; ++i)
+                outputChannels.add(monoOutputs[static_cast<int>(i)]);
+
+            filterComplex += ";" + mergeFilter(outputChannels, tail + splitOutputLabel(k), graphPrefix + "g");
+        }
+
+        if (!graphPerOutput)
+        {
+            args.add("-filter_complex");
+            args.add(filterComplex);
+        }
+        return args;
+    }
+}
+
 //==============================================================================
 // ExportSettings implementation
 //==============================================================================
@@ -28,6 +339,8 @@ juce::String ExportSettings::getCodecArgs() const
             return "libvorbis -q:a 6";  // Quality 6 is ~192kbps VBR
         case Codec::OPUS:
             return "libopus -b:a 128k";
+        case Codec::FLAC:
+            return "flac";
     }
     return "pcm_s24le";
 }
@@ -53,10 +366,62 @@ juce::String ExportSettings::getFileExtension() const
         case Codec::AAC:      return "m4a";
         case Codec::VORBIS:   return "ogg";
         case Codec::OPUS:     return "opus";
+        case Codec::FLAC:     return "flac";
     }
     return "wav";
 }
 
+int ExportSettings::getBitsPerSample() const
+{
+    // FLAC has no float samples
+    if (codec == Codec::FLAC && bitDepth == BitDepth::Bit32Float)
+        return 24;
+
+    switch (bitDepth)
+    {
+        case BitDepth::Bit16:      return 16;
+        case BitDepth::Bit24:      return 24;
+        case BitDepth::Bit32Float: return 32;
+    }
+    return 24;
+}
+
+double ExportSettings::getOutputSampleRate(double sourceSampleRate) const
+{
+    auto rate = getSampleRateArgs();
+    return rate.isNotEmpty() ? rate.getDoubleValue() : sourceSampleRate;
+}
+
+juce::String ExportSettings::getNormalisationFilter(const LoudnessSummary& measured) const
+{
+    if (normalisation == Normalisation::None || !measured.isValid)
+        return {};
+
+    double current = normalisation == Normalisation::Loudness ? measured.integratedLufs
+                                                              : measured.truePeakDbtp;
+
+    // Silent (fully gated) outputs are left alone rather than boosted without limit
+    if (!std::isfinite(current))
+        return {};
+
+    double gainDb = normalisationTarget - current;
+
+    // A loudness target can push the peaks of dynamic material past full
+    // scale, where the integer writers would hard-clip
+    if (normalisation == Normalisation::Loudness && std::isfinite(measured.truePeakDbtp)
+        && measured.truePeakDbtp + gainDb > kTruePeakCeilingDbtp)
+    {
+        const double limitedDb = kTruePeakCeilingDbtp - measured.truePeakDbtp;
+        juce::Logger::writeToLog("Normalisation limited by true peak: " + juce::String(gainDb, 2) + " dB would reach "
+                                 + juce::String(measured.truePeakDbtp + gainDb, 1) + " dBTP, applying "
+                                 + juce::String(limitedDb, 2) + " dB (I " + juce::String(measured.integratedLufs + limitedDb, 1)
+                                 + " LUFS instead of " + juce::String(normalisationTarget, 1) + ")");
+        gainDb = limitedDb;
+    }
+
+    return "volume=" + juce::String(gainDb, 2) + "dB";
+}
+
 //==============================================================================
 // MainComponent implementation
 //==============================================================================
@@ -65,10 +430,20 @@ MainComponent::MainComponent()
 {
     // Initialize FFmpeg tools
     ffprobe = std::make_unique<FFProbe>(ffmpegLocator);
-    waveformExtractor = std::make_unique<WaveformExtractor>(ffmpegLocator);
+    waveformExtractor = std::make_unique<WaveformExtractor>(ffmpegLocator, &progressTracker);
+    exportVerifier = std::make_unique<ExportVerifier>(ffmpegLocator, &progressTracker);
+
+    progressTracker.onJobsStarted = [this]()
+    {
+        if (!progressPoller.isTimerRunning())
+            progressPoller.startTimer(kProgressRefreshMs);
+    };
 
     // Initialize audio player
-    audioPlayer = std::make_unique<AudioPlayer>(ffmpegLocator);
+    proxyCache = std::make_unique<ProxyCache>(ffmpegLocator, &progressTracker);
+    prerollCache = std::make_unique<PrerollCache>(ffmpegLocator);
+    prerollCache->onSegmentAdded = [this]() { updatePlaybackUI(); };
+    audioPlayer = std::make_unique<AudioPlayer>(ffmpegLocator, proxyCache.get(), prerollCache.get(), &progressTracker);
     audioPlayer->addListener(this);
     audioPlayer->initialize();
 
@@ -77,6 +452,21 @@ MainComponent::MainComponent()
 
     // Setup lane list
     laneListComponent = std::make_unique<LaneListComponent>(projectModel);
+    laneListComponent->onShuttle = [this](double rate)
+    {
+        audioPlayer->setShuttleRate(rate);
+        if (audioPlayer->isShuttling())
+            updateStatus("Shuttle " + juce::String(rate, 1) + "x");
+    };
+    laneListComponent->onShuttleEnded = [this]()
+    {
+        if (!audioPlayer->isShuttling())
+            return;
+
+        audioPlayer->endShuttle();
+        updateStatus("Position " + juce::String(audioPlayer->getPositionSeconds(), 2) + "s");
+        updatePlaybackUI();
+    };
     addAndMakeVisible(*laneListComponent);
 
     // Setup play button
@@ -85,7 +475,7 @@ MainComponent::MainComponent()
     playButton.onClick = [this]()
     {
         if (audioPlayer->isPlaying())
-            audioPlayer->stop();
+            audioPlayer->pause();
         else
             audioPlayer->play();
     };
@@ -97,6 +487,46 @@ MainComponent::MainComponent()
     stopButton.onClick = [this]() { audioPlayer->stop(); };
     addAndMakeVisible(stopButton);
 
+    // Setup loop markers and toggle
+    for (auto* button : { &loopInButton, &loopOutButton, &loopButton })
+    {
+        button->setColour(juce::TextButton::buttonColourId, Mach1LookAndFeel::Colors::buttonOff);
+        button->setColour(juce::TextButton::textColourOffId, Mach1LookAndFeel::Colors::textPrimary);
+        addAndMakeVisible(*button);
+    }
+    loopInButton.setTooltip("Set the loop start at the play position");
+    loopInButton.onClick = [this]() { setLoopMarker(true); };
+    loopOutButton.setTooltip("Set the loop end at the play position");
+    loopOutButton.onClick = [this]() { setLoopMarker(false); };
+    loopButton.setClickingTogglesState(true);
+    loopButton.setColour(juce::TextButton::textColourOnId, Mach1LookAndFeel::Colors::statusActive);
+    loopButton.onClick = [this]()
+    {
+        audioPlayer->setLooping(loopButton.getToggleState());
+        updatePlaybackUI();
+    };
+
+    // Setup sync button
+    syncButton.setColour(juce::TextButton::buttonColourId, Mach1LookAndFeel::Colors::buttonOff);
+    syncButton.setColour(juce::TextButton::textColourOffId, Mach1LookAndFeel::Colors::textPrimary);
+    syncButton.setTooltip("Line sources up by their audio");
+    syncButton.onClick = [this]() { runSyncAnalysis(); };
+    addAndMakeVisible(syncButton);
+
+    // Setup follow toggle: imports keep reading files that are still growing
+    followButton.setColour(juce::TextButton::buttonColourId, Mach1LookAndFeel::Colors::buttonOff);
+    followButton.setColour(juce::TextButton::textColourOffId, Mach1LookAndFeel::Colors::textPrimary);
+    followButton.setColour(juce::TextButton::textColourOnId, Mach1LookAndFeel::Colors::statusActive);
+    followButton.setClickingTogglesState(true);
+    followButton.setTooltip("Keep importing WAV files that are still being recorded");
+    followButton.onClick = [this]()
+    {
+        // Followed files keep what has been read so far
+        if (!followButton.getToggleState())
+            waveformExtractor->stopFollowing();
+    };
+    addAndMakeVisible(followButton);
+
     // Setup export button with Mach1 style
     exportButton.setColour(juce::TextButton::buttonColourId, Mach1LookAndFeel::Colors::buttonOff);
     exportButton.setColour(juce::TextButton::textColourOffId, Mach1LookAndFeel::Colors::textPrimary);
@@ -135,6 +565,10 @@ MainComponent::MainComponent()
 
 MainComponent::~MainComponent()
 {
+    // Suspended imports and analyses check this before touching the component
+    lifetimeCancellation.cancel();
+    progressTracker.onJobsStarted = nullptr;
+    progressPoller.stopTimer();
     audioPlayer->removeListener(this);
     audioPlayer->shutdown();
     projectModel.removeListener(this);
@@ -207,7 +641,17 @@ void MainComponent::resized()
     playButton.setBounds(toolbar.removeFromLeft(60));
     toolbar.removeFromLeft(5);
     stopButton.setBounds(toolbar.removeFromLeft(60));
+    toolbar.removeFromLeft(10);
+    loopInButton.setBounds(toolbar.removeFromLeft(40));
+    toolbar.removeFromLeft(5);
+    loopOutButton.setBounds(toolbar.removeFromLeft(40));
+    toolbar.removeFromLeft(5);
+    loopButton.setBounds(toolbar.removeFromLeft(50));
     toolbar.removeFromLeft(15);
+    syncButton.setBounds(toolbar.removeFromLeft(60));
+    toolbar.removeFromLeft(5);
+    followButton.setBounds(toolbar.removeFromLeft(60));
+    toolbar.removeFromLeft(10);
 
     // Export/Clear buttons
     exportButton.setBounds(toolbar.removeFromLeft(100));
@@ -255,65 +699,152 @@ void MainComponent::fileDragExit(const juce::StringArray& /*files*/)
 
 void MainComponent::handleDroppedFile(const juce::File& file)
 {
-    updateStatus("Analyzing: " + file.getFileName());
+    spawn(importFile(file, lifetimeCancellation.getToken()));
+}
+
+Task<> MainComponent::importFile(juce::File file, CancellationToken token)
+{
+    // Bound how many sources decode at once; the rest queue here
+    co_await importSlots.acquire();
+    if (token.isCancelled())
+        co_return;
 
-    // Run ffprobe in a background thread
-    auto* probe = ffprobe.get();
-    auto* extractor = waveformExtractor.get();
-    auto* model = &projectModel;
+    co_await probeAndExtract(file, token);
+
+    // After cancellation this component may be gone - touch nothing
+    if (!token.isCancelled())
+        importSlots.release();
+}
+
+Task<> MainComponent::probeAndExtract(juce::File file, CancellationToken token)
+{
+    auto probeJob = progressTracker.startJob(ProgressTracker::JobKind::Probe, file.getFileName(), 0.0);
 
-    juce::Thread::launch([this, file, probe, extractor, model]()
+    auto result = co_await ffprobe->probeAsync(file, token);
+    if (token.isCancelled())
     {
-        auto result = probe->getAudioStreams(file);
+        probeJob->finish(false);
+        co_return;
+    }
 
-        juce::MessageManager::callAsync([this, file, result, extractor, model]()
-        {
-            if (!result.success)
-            {
-                updateStatus("Error: " + result.errorMessage);
-                return;
-            }
+    if (!result.success)
+    {
+        probeJob->finish(false, "Error: " + result.errorMessage);
+        co_return;
+    }
 
-            if (result.streams.empty())
-            {
-                updateStatus("No audio streams found in: " + file.getFileName());
-                return;
-            }
+    if (result.streams.empty())
+    {
+        probeJob->finish(false, "No audio streams found in: " + file.getFileName());
+        co_return;
+    }
+
+    // Use first audio stream (structured for future stream selection dialog)
+    const auto stream = result.streams[0];
+
+    probeJob->finish(true, juce::String::formatted(
+        "Found %d channel(s) in stream %d of %s",
+        stream.channels, stream.streamIndex, file.getFileName().toRawUTF8()));
+
+    // Create a lane for each channel
+    std::vector<Lane*> streamLanes;
+    for (int ch = 0; ch < stream.channels; ++ch)
+    {
+        auto lane = std::make_unique<Lane>();
+        lane->sourceFile = file;
+        lane->streamIndex = stream.streamIndex;
+        lane->channelIndex = ch;
+        lane->totalChannels = stream.channels;
+        lane->sampleRate = stream.sampleRate;
+        lane->duration = stream.duration;
+        lane->sampleFormat = stream.sampleFormat;
+        lane->bitsPerRawSample = stream.bitsPerRawSample;
+        lane->displayName = file.getFileNameWithoutExtension()
+            + " [" + juce::String(stream.streamIndex)
+            + ":" + juce::String(ch) + "]";
+
+        streamLanes.push_back(lane.get());
+        projectModel.addLane(std::move(lane));
+    }
+
+    // A growing file is read as it lands rather than decoded once; a proxy
+    // made now would only cover the start
+    const bool follow = followButton.getToggleState() && GrowingWavFile::canFollow(file);
 
-            // Use first audio stream (structured for future stream selection dialog)
-            const auto& stream = result.streams[0];
+    // Made in the background once this import and its extraction are done
+    if (!follow)
+        proxyCache->request(file, stream.streamIndex, stream.channels);
 
-            updateStatus(juce::String::formatted(
-                "Found %d channel(s) in stream %d of %s",
-                stream.channels, stream.streamIndex, file.getFileName().toRawUTF8()));
+    // First seconds decoded now, so play can start before the full decode
+    prerollCache->prefetchHead({ file, stream.streamIndex, stream.channels, stream.sampleRate,
+                                 stream.sampleFormat, stream.bitsPerRawSample });
 
-            // Create a lane for each channel
-            for (int ch = 0; ch < stream.channels; ++ch)
+    // Following runs until the recording ends, so it doesn't hold an import slot
+    if (follow && waveformExtractor->followWaveforms(streamLanes,
+            [safeThis = juce::Component::SafePointer<MainComponent>(this), file](WaveformExtractor::FollowUpdate update)
             {
-                auto lane = std::make_unique<Lane>();
-                lane->sourceFile = file;
-                lane->streamIndex = stream.streamIndex;
-                lane->channelIndex = ch;
-                lane->totalChannels = stream.channels;
-                lane->sampleRate = stream.sampleRate;
-                lane->displayName = file.getFileNameWithoutExtension()
-                    + " [" + juce::String(stream.streamIndex)
-                    + ":" + juce::String(ch) + "]";
-
-                Lane* lanePtr = lane.get();
-                model->addLane(std::move(lane));
-
-                // Start waveform extraction
-                extractor->extractWaveform(lanePtr, [model](Lane* l)
+                juce::MessageManager::callAsync([safeThis, file, update = std::move(update)]()
                 {
-                    juce::MessageManager::callAsync([model, l]()
-                    {
-                        model->notifyWaveformUpdated(l);
-                    });
+                    if (safeThis != nullptr)
+                        safeThis->applyFollowUpdate(update, file);
                 });
-            }
-        });
-    });
+            }))
+    {
+        updateStatus("Following " + file.getFileName());
+        co_return;
+    }
+
+    // One shared decode for all channels
+    auto extraction = co_await waveformExtractor->extractAsync(streamLanes, token);
+    if (token.isCancelled() || !extraction.completed)
+        co_return;
+
+    // Publish only lanes that weren't removed while decoding
+    for (const auto& extracted : extraction.lanes)
+    {
+        if (Lane* lane = projectModel.findLane(extracted.laneId))
+        {
+            lane->waveform = extracted.waveform;
+            lane->analysisSignal = extracted.analysisSignal;
+            lane->loudness = extracted.loudness;
+            projectModel.notifyWaveformUpdated(lane);
+        }
+    }
+
+    // Playback's gain comes from the lanes' peaks
+    audioPlayer->updateMixGain(projectModel.getLanes());
+}
+
+void MainComponent::applyFollowUpdate(const WaveformExtractor::FollowUpdate& update, const juce::File& file)
+{
+    // Publish only lanes that are still there
+    int numLive = 0;
+    for (const auto& followed : update.lanes)
+    {
+        Lane* lane = projectModel.findLane(followed.laneId);
+        if (lane == nullptr)
+            continue;
+
+        lane->waveform = followed.waveform;
+        lane->analysisSignal = followed.analysisSignal;
+        lane->loudness = followed.loudness;
+        lane->duration = update.duration;
+        projectModel.notifyWaveformUpdated(lane);
+        ++numLive;
+    }
+
+    // Every lane was removed (which also cancelled the follow job)
+    if (numLive == 0)
+        return;
+
+    audioPlayer->updateMixGain(projectModel.getLanes());
+
+    // Playback picks up the new stretch if it's playing this file
+    audioPlayer->extendLoadedSource();
+
+    const auto length = juce::String(update.duration, 1) + "s";
+    updateStatus(update.finished ? "Finished following " + file.getFileName() + " (" + length + ")"
+                                 : "Following " + file.getFileName() + ": " + length);
 }
 
 void MainComponent::showExportDialog()
@@ -326,7 +857,7 @@ void MainComponent::showExportDialog()
 
     // Create a custom dialog component with Mach1 styling
     auto* dialogContent = new juce::Component();
-    dialogContent->setSize(360, 230);
+    dialogContent->setSize(360, 355);
 
     // Helper to style labels
     auto styleLabel = [](juce::Label* label) {
@@ -358,14 +889,38 @@ void MainComponent::showExportDialog()
     modeCombo->addItem("Single Multichannel File", 1);
     modeCombo->addItem("Multiple Mono Files", 2);
     modeCombo->addItem("Stereo Pairs", 3);
+    modeCombo->addItem("Stereo Pairs (Detected" + (detectedLayout.isNotEmpty() ? ": " + detectedLayout : juce::String()) + ")", 4);
+    modeCombo->setItemEnabled(4, !detectedPairs.empty());
+    modeCombo->addItem("Grouped Files", 5);
     modeCombo->setSelectedId(1);
     modeCombo->setBounds(125, 15, 220, 24);
     styleCombo(modeCombo);
     dialogContent->addAndMakeVisible(modeCombo);
 
+    // Lanes per file for grouped files
+    auto* channelsPerFileLabel = new juce::Label("channelsPerFileLabel", "Channels/File:");
+    channelsPerFileLabel->setBounds(15, 50, 100, 24);
+    styleLabel(channelsPerFileLabel);
+    dialogContent->addAndMakeVisible(channelsPerFileLabel);
+
+    auto* channelsPerFileEditor = new juce::TextEditor("channelsPerFileEditor");
+    channelsPerFileEditor->setInputRestrictions(4, "0123456789");
+    channelsPerFileEditor->setText(juce::String(ExportSettings().channelsPerFile), false);
+    channelsPerFileEditor->setBounds(125, 50, 60, 24);
+    channelsPerFileEditor->setColour(juce::TextEditor::backgroundColourId, Mach1LookAndFeel::Colors::buttonOff);
+    channelsPerFileEditor->setColour(juce::TextEditor::textColourId, Mach1LookAndFeel::Colors::textPrimary);
+    channelsPerFileEditor->setColour(juce::TextEditor::outlineColourId, Mach1LookAndFeel::Colors::border);
+    channelsPerFileEditor->setEnabled(false);
+    dialogContent->addAndMakeVisible(channelsPerFileEditor);
+
+    modeCombo->onChange = [modeCombo, channelsPerFileEditor]()
+    {
+        channelsPerFileEditor->setEnabled(modeCombo->getSelectedId() == 5);
+    };
+
     // Codec combo
     auto* codecLabel = new juce::Label("codecLabel", "Format:");
-    codecLabel->setBounds(15, 50, 100, 24);
+    codecLabel->setBounds(15, 85, 100, 24);
     styleLabel(codecLabel);
     dialogContent->addAndMakeVisible(codecLabel);
 
@@ -374,14 +929,15 @@ void MainComponent::showExportDialog()
     codecCombo->addItem("AAC", 2);
     codecCombo->addItem("Vorbis (OGG)", 3);
     codecCombo->addItem("Opus", 4);
+    codecCombo->addItem("FLAC", 5);
     codecCombo->setSelectedId(1);
-    codecCombo->setBounds(125, 50, 220, 24);
+    codecCombo->setBounds(125, 85, 220, 24);
     styleCombo(codecCombo);
     dialogContent->addAndMakeVisible(codecCombo);
 
     // Bit depth combo
     auto* bitDepthLabel = new juce::Label("bitDepthLabel", "Bit Depth:");
-    bitDepthLabel->setBounds(15, 85, 100, 24);
+    bitDepthLabel->setBounds(15, 120, 100, 24);
     styleLabel(bitDepthLabel);
     dialogContent->addAndMakeVisible(bitDepthLabel);
 
@@ -390,13 +946,13 @@ void MainComponent::showExportDialog()
     bitDepthCombo->addItem("24-bit", 2);
     bitDepthCombo->addItem("32-bit Float", 3);
     bitDepthCombo->setSelectedId(2);  // Default to 24-bit
-    bitDepthCombo->setBounds(125, 85, 220, 24);
+    bitDepthCombo->setBounds(125, 120, 220, 24);
     styleCombo(bitDepthCombo);
     dialogContent->addAndMakeVisible(bitDepthCombo);
 
     // Sample rate combo
     auto* sampleRateLabel = new juce::Label("sampleRateLabel", "Sample Rate:");
-    sampleRateLabel->setBounds(15, 120, 100, 24);
+    sampleRateLabel->setBounds(15, 155, 100, 24);
     styleLabel(sampleRateLabel);
     dialogContent->addAndMakeVisible(sampleRateLabel);
 
@@ -407,31 +963,82 @@ void MainComponent::showExportDialog()
     sampleRateCombo->addItem("96 kHz", 4);
     sampleRateCombo->addItem("192 kHz", 5);
     sampleRateCombo->setSelectedId(1);  // Default to original
-    sampleRateCombo->setBounds(125, 120, 220, 24);
+    sampleRateCombo->setBounds(125, 155, 220, 24);
     styleCombo(sampleRateCombo);
     dialogContent->addAndMakeVisible(sampleRateCombo);
 
+    // Normalisation combo
+    auto* normaliseLabel = new juce::Label("normaliseLabel", "Normalise:");
+    normaliseLabel->setBounds(15, 190, 100, 24);
+    styleLabel(normaliseLabel);
+    dialogContent->addAndMakeVisible(normaliseLabel);
+
+    auto* normaliseCombo = new juce::ComboBox("normaliseCombo");
+    normaliseCombo->addItem("Off", 1);
+    normaliseCombo->addItem("-23 LUFS (EBU R128)", 2);
+    normaliseCombo->addItem("-16 LUFS", 3);
+    normaliseCombo->addItem("-14 LUFS (Streaming)", 4);
+    normaliseCombo->addItem("Peak -1 dBTP", 5);
+    normaliseCombo->setSelectedId(1);
+    normaliseCombo->setBounds(125, 190, 220, 24);
+    styleCombo(normaliseCombo);
+    dialogContent->addAndMakeVisible(normaliseCombo);
+
+    // Dither combo
+    auto* ditherLabel = new juce::Label("ditherLabel", "Dither:");
+    ditherLabel->setBounds(15, 225, 100, 24);
+    styleLabel(ditherLabel);
+    dialogContent->addAndMakeVisible(ditherLabel);
+
+    auto* ditherCombo = new juce::ComboBox("ditherCombo");
+    ditherCombo->addItem("TPDF", 1);
+    ditherCombo->addItem("Noise Shaped", 2);
+    ditherCombo->addItem("None", 3);
+    ditherCombo->setSelectedId(1);
+    ditherCombo->setBounds(125, 225, 220, 24);
+    styleCombo(ditherCombo);
+    dialogContent->addAndMakeVisible(ditherCombo);
+
+    // Null test (WAV only: lossy codecs can't match their sources)
+    auto* verifyToggle = new juce::ToggleButton("Verify against sources (null test)");
+    verifyToggle->setBounds(125, 257, 220, 24);
+    verifyToggle->setColour(juce::ToggleButton::textColourId, Mach1LookAndFeel::Colors::textPrimary);
+    verifyToggle->setColour(juce::ToggleButton::tickColourId, Mach1LookAndFeel::Colors::statusActive);
+    dialogContent->addAndMakeVisible(verifyToggle);
+
+    // Dither only applies when reducing to 16/24-bit WAV or FLAC
+    auto updateDitherEnablement = [codecCombo, bitDepthCombo, ditherCombo]()
+    {
+        const int codecId = codecCombo->getSelectedId();
+        ditherCombo->setEnabled((codecId == 1 || codecId == 5) && bitDepthCombo->getSelectedId() != 3);
+    };
+    bitDepthCombo->onChange = updateDitherEnablement;
+
     // Update bit depth options based on codec selection
-    // WAV supports bit depth, lossy codecs don't
-    codecCombo->onChange = [codecCombo, bitDepthCombo]()
+    // WAV and FLAC support bit depth, lossy codecs don't
+    codecCombo->onChange = [codecCombo, bitDepthCombo, verifyToggle, updateDitherEnablement]()
     {
         int codecId = codecCombo->getSelectedId();
-        bool isWav = (codecId == 1);  // Only WAV supports bit depth selection
-        bitDepthCombo->setEnabled(isWav);
-        if (!isWav)
+        bool isWav = (codecId == 1);
+        bool isFlac = (codecId == 5);
+        bitDepthCombo->setEnabled(isWav || isFlac);
+        bitDepthCombo->setItemEnabled(3, !isFlac);  // FLAC is integer only
+        verifyToggle->setEnabled(isWav);
+        if (!isWav && (!isFlac || bitDepthCombo->getSelectedId() == 3))
             bitDepthCombo->setSelectedId(2);  // Default to 24-bit equivalent
+        updateDitherEnablement();
     };
 
     // Export button
     auto* exportBtn = new juce::TextButton("Export");
-    exportBtn->setBounds(175, 170, 80, 28);
+    exportBtn->setBounds(175, 295, 80, 28);
     styleButton(exportBtn);
     exportBtn->setColour(juce::TextButton::textColourOffId, Mach1LookAndFeel::Colors::statusActive);
     dialogContent->addAndMakeVisible(exportBtn);
 
     // Cancel button
     auto* cancelBtn = new juce::TextButton("Cancel");
-    cancelBtn->setBounds(265, 170, 80, 28);
+    cancelBtn->setBounds(265, 295, 80, 28);
     styleButton(cancelBtn);
     dialogContent->addAndMakeVisible(cancelBtn);
 
@@ -448,7 +1055,8 @@ void MainComponent::showExportDialog()
     dialog->setColour(juce::DocumentWindow::backgroundColourId, Mach1LookAndFeel::Colors::panelBackground);
     
     // Set button callbacks after dialog is created
-    exportBtn->onClick = [this, dialog, modeCombo, codecCombo, bitDepthCombo, sampleRateCombo]()
+    exportBtn->onClick = [this, dialog, modeCombo, channelsPerFileEditor, codecCombo, bitDepthCombo, sampleRateCombo,
+                          normaliseCombo, ditherCombo, verifyToggle]()
     {
         ExportSettings settings;
         
@@ -458,6 +1066,11 @@ void MainComponent::showExportDialog()
             case 1: settings.mode = ExportSettings::ExportMode::Multichannel; break;
             case 2: settings.mode = ExportSettings::ExportMode::MonoFiles; break;
             case 3: settings.mode = ExportSettings::ExportMode::StereoPairs; break;
+            case 4: settings.mode = ExportSettings::ExportMode::DetectedStereoPairs; break;
+            case 5:
+                settings.mode = ExportSettings::ExportMode::GroupedFiles;
+                settings.channelsPerFile = std::max(1, channelsPerFileEditor->getText().getIntValue());
+                break;
         }
         
         // Set codec
@@ -467,6 +1080,7 @@ void MainComponent::showExportDialog()
             case 2: settings.codec = ExportSettings::Codec::AAC; break;
             case 3: settings.codec = ExportSettings::Codec::VORBIS; break;
             case 4: settings.codec = ExportSettings::Codec::OPUS; break;
+            case 5: settings.codec = ExportSettings::Codec::FLAC; break;
         }
         
         // Set bit depth
@@ -486,6 +1100,26 @@ void MainComponent::showExportDialog()
             case 4: settings.sampleRate = ExportSettings::SampleRate::SR96000; break;
             case 5: settings.sampleRate = ExportSettings::SampleRate::SR192000; break;
         }
+
+        // Set normalisation
+        switch (normaliseCombo->getSelectedId())
+        {
+            case 2: settings.normalisation = ExportSettings::Normalisation::Loudness; settings.normalisationTarget = -23.0; break;
+            case 3: settings.normalisation = ExportSettings::Normalisation::Loudness; settings.normalisationTarget = -16.0; break;
+            case 4: settings.normalisation = ExportSettings::Normalisation::Loudness; settings.normalisationTarget = -14.0; break;
+            case 5: settings.normalisation = ExportSettings::Normalisation::TruePeak; settings.normalisationTarget = -1.0; break;
+            default: settings.normalisation = ExportSettings::Normalisation::None; break;
+        }
+
+        // Set dither
+        switch (ditherCombo->getSelectedId())
+        {
+            case 1: settings.dither = DitherConverter::Dither::Tpdf; break;
+            case 2: settings.dither = DitherConverter::Dither::NoiseShaped; break;
+            case 3: settings.dither = DitherConverter::Dither::None; break;
+        }
+
+        settings.verify = settings.codec == ExportSettings::Codec::PCM_WAV && verifyToggle->getToggleState();
         
         dialog->exitModalState(0);
         delete dialog;
@@ -505,6 +1139,23 @@ void MainComponent::showExportDialog()
 void MainComponent::performExport(const ExportSettings& settings)
 {
     juce::String extension = settings.getFileExtension();
+
+    if (settings.codec == ExportSettings::Codec::FLAC)
+    {
+        const int numLanes = static_cast<int>(projectModel.getLanes().size());
+        int channelsPerOutput = 2;
+        if (settings.mode == ExportSettings::ExportMode::Multichannel)
+            channelsPerOutput = numLanes;
+        else if (settings.mode == ExportSettings::ExportMode::GroupedFiles)
+            channelsPerOutput = std::min(numLanes, settings.channelsPerFile);
+
+        if (channelsPerOutput > FlacFileWriter::kMaxChannels)
+        {
+            updateStatus("FLAC holds at most " + juce::String(FlacFileWriter::kMaxChannels)
+                         + " channels per file - export grouped files of at most that many instead");
+            return;
+        }
+    }
     
     if (settings.mode == ExportSettings::ExportMode::Multichannel)
     {
@@ -521,13 +1172,16 @@ void MainComponent::performExport(const ExportSettings& settings)
                 auto file = fc.getResult();
                 if (file != juce::File())
                 {
-                    exportMultichannelWav(file.withFileExtension(extension), settings);
+                    ensureLoudnessStats(settings, [this, file, settings, extension]()
+                    {
+                        exportMultichannelWav(file.withFileExtension(extension), settings);
+                    });
                 }
             });
     }
     else
     {
-        // Mono files or stereo pairs - select output directory
+        // Mono files, stereo pairs or channel groups - select output directory
         auto chooser = std::make_shared<juce::FileChooser>(
             "Select Output Directory",
             juce::File::getSpecialLocation(juce::File::userDocumentsDirectory));
@@ -539,10 +1193,15 @@ void MainComponent::performExport(const ExportSettings& settings)
                 auto dir = fc.getResult();
                 if (dir != juce::File() && dir.isDirectory())
                 {
-                    if (settings.mode == ExportSettings::ExportMode::MonoFiles)
-                        exportMonoWavFiles(dir, settings);
-                    else
-                        exportStereoPairs(dir, settings);
+                    ensureLoudnessStats(settings, [this, dir, settings]()
+                    {
+                        if (settings.mode == ExportSettings::ExportMode::MonoFiles)
+                            exportMonoWavFiles(dir, settings);
+                        else if (settings.mode == ExportSettings::ExportMode::GroupedFiles)
+                            exportGroupedFiles(dir, settings);
+                        else
+                            exportStereoPairs(dir, settings);
+                    });
                 }
             });
     }
@@ -561,163 +1220,111 @@ void MainComponent::exportMultichannelWav(const juce::File& outputFile, const Ex
     juce::Logger::writeToLog("exportMultichannelWav: " + juce::String(numChannels) + 
                              " channels to " + outputFile.getFullPathName());
 
-    juce::StringArray args;
-    args.add(ffmpegLocator.getFFmpegPath().getFullPathName());
-    args.add("-y");  // Overwrite output
-
-    // Build a map of unique source file+stream combinations
-    std::map<juce::String, int> sourceToIndex;
-    int inputIndex = 0;
+    // One gain for the whole file keeps the balance between channels
+    auto measured = measureOutputLoudness(lanes);
+    auto normaliseFilter = settings.getNormalisationFilter(measured);
+    const auto ffmpegPath = ffmpegLocator.getFFmpegPath().getFullPathName();
 
-    for (auto* lane : lanes)
+    // WAV: rendered in one or more filter graphs and gathered here. args
+    // then holds every group's command, for the log and fingerprint.
+    juce::StringArray args;
+    std::vector<ChannelGatherer::Group> groups;
+    if (settings.usesNativeWriter())
     {
-        auto key = lane->sourceFile.getFullPathName() + ":" + juce::String(lane->streamIndex);
-        if (sourceToIndex.find(key) == sourceToIndex.end())
-        {
-            sourceToIndex[key] = inputIndex++;
-            args.add("-i");
-            args.add(lane->sourceFile.getFullPathName());
-        }
+        groups = makeGatherGroups(lanes, settings, normaliseFilter, ffmpegPath);
+        for (const auto& group : groups)
+            args.addArray(group.args);
+    }
+    else
+    {
+        args = mergeCommand(ffmpegPath, lanes, normaliseFilter);
+        args.add("-map");
+        args.add("[out]");
+        addOutputArgs(args, settings, outputFile, lanes.front()->sampleRate);
     }
+    
+    // Debug: print the full command
+    juce::String cmdStr = "FFmpeg command:\n";
+    for (const auto& arg : args)
+        cmdStr += "  " + arg + "\n";
+    juce::Logger::writeToLog(cmdStr);
 
-    // Build filter_complex using asplit + pan=mono + amerge approach
-    juce::String filterComplex;
-    juce::StringArray monoOutputs;
+    auto loudness = LoudnessMeter::describe(measured);
+    juce::Logger::writeToLog("Output loudness: " + loudness
+                             + (normaliseFilter.isNotEmpty() ? " -> " + normaliseFilter : juce::String()));
 
-    // Count how many times each source is used
-    std::map<juce::String, int> sourceUsageCount;
+    // Run ffmpeg. amerge stops at the shortest input.
+    double sourceSampleRate = lanes.front()->sampleRate;
+    double duration = lanes.front()->getEditedDuration();
+    juce::Array<juce::File> sources;
+    juce::StringArray channelMap;
     for (auto* lane : lanes)
     {
-        auto key = lane->sourceFile.getFullPathName() + ":" + juce::String(lane->streamIndex);
-        sourceUsageCount[key]++;
+        duration = std::min(duration, lane->getEditedDuration());
+        sources.addIfNotAlreadyThere(lane->sourceFile);
+        channelMap.add(channelSource(*lane));
     }
 
-    // Create asplit filters for sources used multiple times
-    std::map<juce::String, juce::StringArray> sourceSplitLabels;
-    for (const auto& [key, count] : sourceUsageCount)
+    auto manifest = std::make_shared<ExportManifest>(outputFile.getParentDirectory());
+    auto fingerprint = fingerprintOutput(args, settings, sources);
+    if (manifest->isUpToDate(outputFile, fingerprint))
     {
-        int idx = sourceToIndex[key];
-        if (count > 1)
-        {
-            juce::String asplitFilter = "[" + juce::String(idx) + ":a]asplit=" + juce::String(count);
-            juce::StringArray labels;
-            for (int i = 0; i < count; ++i)
-            {
-                juce::String label = "[s" + juce::String(idx) + "_" + juce::String(i) + "]";
-                labels.add(label);
-                asplitFilter += label;
-            }
-            sourceSplitLabels[key] = labels;
-            
-            if (!filterComplex.isEmpty())
-                filterComplex += ";";
-            filterComplex += asplitFilter;
-        }
+        juce::Logger::writeToLog("Up to date, skipping: " + outputFile.getFullPathName());
+        updateStatus("Up to date: " + outputFile.getFullPathName() + " (" + loudness + ")");
+        return;
     }
 
-    // Track which split index we're on for each source
-    std::map<juce::String, int> sourceSplitIndex;
-    for (const auto& [key, _] : sourceUsageCount)
-        sourceSplitIndex[key] = 0;
+    auto job = progressTracker.startJob(ProgressTracker::JobKind::Export, outputFile.getFileName(), duration);
+    auto verifyRequest = makeVerifyRequest(outputFile, lanes, normaliseFilter, settings);
 
-    // Create pan=mono filter for each lane
-    for (size_t i = 0; i < lanes.size(); ++i)
+    juce::Thread::launch([args, groups, outputFile, loudness, settings, numChannels, sourceSampleRate, duration,
+                          job, manifest, fingerprint, channelMap, verifyRequest, safeThis = juce::Component::SafePointer<MainComponent>(this)]()
     {
-        auto* lane = lanes[i];
-        auto key = lane->sourceFile.getFullPathName() + ":" + juce::String(lane->streamIndex);
-        int idx = sourceToIndex[key];
-
-        juce::String inputLabel;
-        if (sourceUsageCount[key] > 1)
+        ExportRun run;
+        std::vector<ExportRun> runs;
+        bool ran = false;
+        if (groups.empty())
         {
-            int splitIdx = sourceSplitIndex[key]++;
-            inputLabel = sourceSplitLabels[key][splitIdx];
+            ran = runExportProcess(args, settings, outputFile, numChannels, sourceSampleRate, duration, 120000, *job, run);
         }
         else
         {
-            inputLabel = "[" + juce::String(idx) + ":a]";
+            ran = runGatheredExport(groups, settings, { { outputFile, numChannels, ditherSeedFor(outputFile, channelMap) } }, sourceSampleRate, duration, 120000, *job, runs);
+            if (ran)
+                run = runs.front();
         }
 
-        juce::String monoLabel = "[m" + juce::String(static_cast<int>(i)) + "]";
-        juce::String panFilter = inputLabel + "pan=mono|c0=c" + juce::String(lane->channelIndex) + monoLabel;
-
-        if (!filterComplex.isEmpty())
-            filterComplex += ";";
-        filterComplex += panFilter;
+        if (ran)
+        {
+            juce::Logger::writeToLog("FFmpeg exit code: " + juce::String(run.exitCode));
+            if (run.output.isNotEmpty())
+                juce::Logger::writeToLog("FFmpeg output: " + run.output);
 
-        monoOutputs.add(monoLabel);
-    }
-
-    // Combine all mono channels using amerge
-    filterComplex += ";";
-    for (const auto& out : monoOutputs)
-        filterComplex += out;
-    filterComplex += "amerge=inputs=" + juce::String(numChannels) + "[out]";
-
-    args.add("-filter_complex");
-    args.add(filterComplex);
-    args.add("-map");
-    args.add("[out]");
-    
-    // Add sample rate conversion if requested
-    juce::String sampleRateStr = settings.getSampleRateArgs();
-    if (sampleRateStr.isNotEmpty())
-    {
-        args.add("-ar");
-        args.add(sampleRateStr);
-    }
-    
-    // Add codec settings
-    juce::String codecArgs = settings.getCodecArgs();
-    juce::StringArray codecParts;
-    codecParts.addTokens(codecArgs, " ", "");
-    args.add("-c:a");
-    args.add(codecParts[0]);
-    for (int i = 1; i < codecParts.size(); ++i)
-        args.add(codecParts[i]);
-    
-    args.add(outputFile.getFullPathName());
-    
-    // Debug: print the full command
-    juce::String cmdStr = "FFmpeg command:\n";
-    for (const auto& arg : args)
-        cmdStr += "  " + arg + "\n";
-    juce::Logger::writeToLog(cmdStr);
-
-    // Run ffmpeg
-    juce::Thread::launch([this, args, outputFile]()
-    {
-        juce::ChildProcess process;
-        if (process.start(args, juce::ChildProcess::wantStdOut | juce::ChildProcess::wantStdErr))
-        {
-            juce::String output = process.readAllProcessOutput();
-            process.waitForProcessToFinish(120000);
-            auto exitCode = process.getExitCode();
-            
-            juce::Logger::writeToLog("FFmpeg exit code: " + juce::String(exitCode));
-            if (output.isNotEmpty())
-                juce::Logger::writeToLog("FFmpeg output: " + output);
-
-            juce::MessageManager::callAsync([this, exitCode, outputFile, output]()
-            {
-                if (exitCode == 0)
-                    updateStatus("Exported: " + outputFile.getFullPathName());
-                else
-                {
-                    updateStatus("Export failed (exit code " + juce::String(exitCode) + ")");
-                    juce::Logger::writeToLog("Export error: " + output);
-                }
-            });
-        }
-        else
-        {
-            juce::MessageManager::callAsync([this]()
-            {
-                updateStatus("Failed to start ffmpeg process");
-            });
-        }
-    });
-}
+            if (run.exitCode == 0)
+            {
+                juce::Logger::writeToLog("Export throughput: " + juce::String(numChannels) + " channels via "
+                                         + juce::String(std::max<int>(1, static_cast<int>(groups.size()))) + " process(es), "
+                                         + juce::String(run.durationSeconds, 1) + " s in " + juce::String(run.wallSeconds, 2)
+                                         + " s (" + juce::String(run.durationSeconds / std::max(run.wallSeconds, 1.0e-3), 1)
+                                         + "x real time)");
+                manifest->record(outputFile, run.toRecord(fingerprint, channelMap));
+                if (settings.verify)
+                    queueVerification(safeThis, verifyRequest);
+                job->finish(true, "Exported: " + outputFile.getFullPathName() + " (" + loudness + ")");
+            }
+            else
+            {
+                manifest->remove(outputFile);
+                juce::Logger::writeToLog("Export error: " + run.output);
+                job->finish(false, "Export failed (exit code " + juce::String(run.exitCode) + ")");
+            }
+        }
+        else
+        {
+            job->finish(false, "Failed to start ffmpeg process");
+        }
+    });
+}
 
 void MainComponent::exportMonoWavFiles(const juce::File& outputDir, const ExportSettings& settings)
 {
@@ -725,6 +1332,8 @@ void MainComponent::exportMonoWavFiles(const juce::File& outputDir, const Export
 
     auto lanes = projectModel.getLanes();
     juce::String extension = settings.getFileExtension();
+    auto manifest = std::make_shared<ExportManifest>(outputDir);
+    int numUpToDate = 0;
 
     // Export each lane as a separate mono file
     for (size_t i = 0; i < lanes.size(); ++i)
@@ -739,66 +1348,72 @@ void MainComponent::exportMonoWavFiles(const juce::File& outputDir, const Export
         args.add("-v");
         args.add("error");
         args.add("-y");
-        args.add("-i");
-        args.add(lane->sourceFile.getFullPathName());
+        auto range = inputRangeFor({ lane });
+        addInputArgs(args, lane->sourceFile, range);
         
+        auto measured = measureOutputLoudness({ lane });
+        auto normaliseFilter = settings.getNormalisationFilter(measured);
+
         // Use filter_complex with proper input stream reference
         juce::String filterComplex = "[0:a:" + juce::String(lane->streamIndex) + "]";
-        filterComplex += "pan=mono|c0=c" + juce::String(lane->channelIndex) + "[out]";
+        filterComplex += laneFilter(*lane, range.seek);
+        if (normaliseFilter.isNotEmpty())
+            filterComplex += "," + normaliseFilter;
+        filterComplex += "[out]";
         
         args.add("-filter_complex");
         args.add(filterComplex);
         args.add("-map");
         args.add("[out]");
         
-        // Add sample rate conversion if requested
-        juce::String sampleRateStr = settings.getSampleRateArgs();
-        if (sampleRateStr.isNotEmpty())
+        addOutputArgs(args, settings, outputFile, lane->sampleRate);
+
+        juce::Logger::writeToLog(outputFile.getFileName() + " loudness: " + LoudnessMeter::describe(measured)
+                                 + (normaliseFilter.isNotEmpty() ? " -> " + normaliseFilter : juce::String()));
+
+        auto fingerprint = fingerprintOutput(args, settings, { lane->sourceFile });
+        if (manifest->isUpToDate(outputFile, fingerprint))
         {
-            args.add("-ar");
-            args.add(sampleRateStr);
+            juce::Logger::writeToLog("Up to date, skipping: " + outputFile.getFileName());
+            ++numUpToDate;
+            continue;
         }
-        
-        // Add codec settings
-        juce::String codecArgs = settings.getCodecArgs();
-        juce::StringArray codecParts;
-        codecParts.addTokens(codecArgs, " ", "");
-        args.add("-c:a");
-        args.add(codecParts[0]);
-        for (int j = 1; j < codecParts.size(); ++j)
-            args.add(codecParts[j]);
-        
-        args.add(outputFile.getFullPathName());
 
-        size_t laneIndex = i;
-        size_t totalLanes = lanes.size();
-        juce::Thread::launch([this, args, outputFile, laneIndex, totalLanes]()
+        double sourceSampleRate = lane->sampleRate;
+        double duration = lane->getEditedDuration();
+        juce::StringArray channelMap;
+        channelMap.add(channelSource(*lane));
+        auto job = progressTracker.startJob(ProgressTracker::JobKind::Export, outputFile.getFileName(), duration);
+        auto verifyRequest = makeVerifyRequest(outputFile, { lane }, normaliseFilter, settings);
+
+        juce::Thread::launch([args, outputFile, settings, sourceSampleRate, duration, job, manifest, fingerprint, channelMap,
+                              verifyRequest, safeThis = juce::Component::SafePointer<MainComponent>(this)]()
         {
-            juce::ChildProcess process;
-            if (process.start(args, juce::ChildProcess::wantStdOut | juce::ChildProcess::wantStdErr))
+            ExportRun run;
+            if (!runExportProcess(args, settings, outputFile, 1, sourceSampleRate, duration, 60000, *job, run))
             {
-                juce::String output = process.readAllProcessOutput();
-                process.waitForProcessToFinish(60000);
-                auto exitCode = process.getExitCode();
-                
-                if (exitCode != 0)
-                    juce::Logger::writeToLog("Mono export error: " + output);
-
-                juce::MessageManager::callAsync([this, exitCode, outputFile, laneIndex, totalLanes]()
-                {
-                    if (exitCode == 0)
-                    {
-                        if (laneIndex == totalLanes - 1)
-                            updateStatus("Exported " + juce::String(static_cast<int>(totalLanes)) + " mono files");
-                    }
-                    else
-                    {
-                        updateStatus("Export failed for " + outputFile.getFileName());
-                    }
-                });
+                job->finish(false, "Failed to start ffmpeg process");
+                return;
+            }
+
+            if (run.exitCode == 0)
+            {
+                manifest->record(outputFile, run.toRecord(fingerprint, channelMap));
+                if (settings.verify)
+                    queueVerification(safeThis, verifyRequest);
+            }
+            else
+            {
+                manifest->remove(outputFile);
+                juce::Logger::writeToLog("Mono export error: " + run.output);
             }
+
+            job->finish(run.exitCode == 0, run.exitCode == 0 ? "Exported " + outputFile.getFileName()
+                                                             : "Export failed for " + outputFile.getFileName());
         });
     }
+
+    reportUpToDateOutputs(numUpToDate, static_cast<int>(lanes.size()));
 }
 
 void MainComponent::exportStereoPairs(const juce::File& outputDir, const ExportSettings& settings)
@@ -806,14 +1421,55 @@ void MainComponent::exportStereoPairs(const juce::File& outputDir, const ExportS
     updateStatus("Exporting stereo pairs...");
 
     auto lanes = projectModel.getLanes();
-    int numPairs = (static_cast<int>(lanes.size()) + 1) / 2;
     juce::String extension = settings.getFileExtension();
 
-    for (int pair = 0; pair < numPairs; ++pair)
+    // Work out the pairing: adjacent lanes, or the correlation-detected pairs
+    // with any remaining lanes exported on their own
+    std::vector<std::pair<Lane*, Lane*>> lanePairs;
+    if (settings.mode == ExportSettings::ExportMode::DetectedStereoPairs)
     {
-        size_t leftIdx = static_cast<size_t>(pair * 2);
-        size_t rightIdx = static_cast<size_t>(pair * 2 + 1);
+        auto findLane = [&lanes](const juce::Uuid& id) -> Lane*
+        {
+            for (auto* lane : lanes)
+                if (lane->uuid == id)
+                    return lane;
+            return nullptr;
+        };
+
+        std::vector<Lane*> paired;
+        for (const auto& [leftId, rightId] : detectedPairs)
+        {
+            auto* left = findLane(leftId);
+            auto* right = findLane(rightId);
+            if (left == nullptr || right == nullptr)
+                continue;
+            lanePairs.emplace_back(left, right);
+            paired.push_back(left);
+            paired.push_back(right);
+        }
+
+        for (auto* lane : lanes)
+            if (std::find(paired.begin(), paired.end(), lane) == paired.end())
+                lanePairs.emplace_back(lane, nullptr);
+
+        // Number outputs in lane order
+        std::sort(lanePairs.begin(), lanePairs.end(), [this](const auto& a, const auto& b)
+        {
+            return projectModel.indexOfLane(a.first) < projectModel.indexOfLane(b.first);
+        });
+    }
+    else
+    {
+        for (size_t i = 0; i < lanes.size(); i += 2)
+            lanePairs.emplace_back(lanes[i], i + 1 < lanes.size() ? lanes[i + 1] : nullptr);
+    }
+
+    int numPairs = static_cast<int>(lanePairs.size());
+    auto manifest = std::make_shared<ExportManifest>(outputDir);
+    int numUpToDate = 0;
 
+    for (int pair = 0; pair < numPairs; ++pair)
+    {
         auto outputFile = outputDir.getChildFile(
             "stereo_" + juce::String(pair + 1).paddedLeft('0', 2) + "." + extension);
 
@@ -824,30 +1480,24 @@ void MainComponent::exportStereoPairs(const juce::File& outputDir, const ExportS
         args.add("-y");
 
         // Add inputs
-        auto* leftLane = lanes[leftIdx];
-        args.add("-i");
-        args.add(leftLane->sourceFile.getFullPathName());
-
-        Lane* rightLane = nullptr;
-        bool separateInputs = false;
-        if (rightIdx < lanes.size())
-        {
-            rightLane = lanes[rightIdx];
-            if (rightLane->sourceFile != leftLane->sourceFile ||
-                rightLane->streamIndex != leftLane->streamIndex)
-            {
-                separateInputs = true;
-                args.add("-i");
-                args.add(rightLane->sourceFile.getFullPathName());
-            }
-        }
+        auto* leftLane = lanePairs[static_cast<size_t>(pair)].first;
+        Lane* rightLane = lanePairs[static_cast<size_t>(pair)].second;
+        bool separateInputs = rightLane != nullptr
+                           && (rightLane->sourceFile != leftLane->sourceFile || rightLane->streamIndex != leftLane->streamIndex);
+
+        auto leftRange = separateInputs || rightLane == nullptr ? inputRangeFor({ leftLane })
+                                                                : inputRangeFor({ leftLane, rightLane });
+        auto rightRange = separateInputs ? inputRangeFor({ rightLane }) : leftRange;
+        addInputArgs(args, leftLane->sourceFile, leftRange);
+        if (separateInputs)
+            addInputArgs(args, rightLane->sourceFile, rightRange);
 
         // Build filter
         juce::String filterComplex;
 
         // Left channel
         filterComplex = "[0:a:" + juce::String(leftLane->streamIndex) + "]";
-        filterComplex += "pan=mono|c0=c" + juce::String(leftLane->channelIndex) + "[left];";
+        filterComplex += laneFilter(*leftLane, leftRange.seek) + "[left];";
 
         // Right channel (or duplicate left if no right)
         if (rightLane != nullptr)
@@ -855,67 +1505,784 @@ void MainComponent::exportStereoPairs(const juce::File& outputDir, const ExportS
             int rightInput = separateInputs ? 1 : 0;
             filterComplex += "[" + juce::String(rightInput) + ":a:" +
                              juce::String(rightLane->streamIndex) + "]";
-            filterComplex += "pan=mono|c0=c" + juce::String(rightLane->channelIndex) + "[right];";
+            filterComplex += laneFilter(*rightLane, rightRange.seek) + "[right];";
         }
         else
         {
             filterComplex += "[0:a:" + juce::String(leftLane->streamIndex) + "]";
-            filterComplex += "pan=mono|c0=c" + juce::String(leftLane->channelIndex) + "[right];";
+            filterComplex += laneFilter(*leftLane, leftRange.seek) + "[right];";
         }
 
-        filterComplex += "[left][right]amerge=inputs=2[out]";
+        // A missing right lane duplicates the left, so it counts twice
+        auto measured = measureOutputLoudness({ leftLane, rightLane != nullptr ? rightLane : leftLane });
+        auto normaliseFilter = settings.getNormalisationFilter(measured);
+
+        filterComplex += "[left][right]amerge=inputs=2";
+        if (normaliseFilter.isNotEmpty())
+            filterComplex += "," + normaliseFilter;
+        filterComplex += "[out]";
 
         args.add("-filter_complex");
         args.add(filterComplex);
         args.add("-map");
         args.add("[out]");
         
-        // Add sample rate conversion if requested
-        juce::String sampleRateStr = settings.getSampleRateArgs();
-        if (sampleRateStr.isNotEmpty())
+        addOutputArgs(args, settings, outputFile, leftLane->sampleRate);
+
+        juce::Logger::writeToLog(outputFile.getFileName() + " loudness: " + LoudnessMeter::describe(measured)
+                                 + (normaliseFilter.isNotEmpty() ? " -> " + normaliseFilter : juce::String()));
+
+        juce::Array<juce::File> sources{ leftLane->sourceFile };
+        if (rightLane != nullptr)
+            sources.addIfNotAlreadyThere(rightLane->sourceFile);
+
+        auto fingerprint = fingerprintOutput(args, settings, sources);
+        if (manifest->isUpToDate(outputFile, fingerprint))
         {
-            args.add("-ar");
-            args.add(sampleRateStr);
+            juce::Logger::writeToLog("Up to date, skipping: " + outputFile.getFileName());
+            ++numUpToDate;
+            continue;
         }
-        
-        // Add codec settings
-        juce::String codecArgs = settings.getCodecArgs();
-        juce::StringArray codecParts;
-        codecParts.addTokens(codecArgs, " ", "");
-        args.add("-c:a");
-        args.add(codecParts[0]);
-        for (int j = 1; j < codecParts.size(); ++j)
-            args.add(codecParts[j]);
-        
-        args.add(outputFile.getFullPathName());
 
-        juce::Thread::launch([this, args, outputFile, pair, numPairs]()
+        // amerge stops at the shorter side
+        double sourceSampleRate = leftLane->sampleRate;
+        double duration = std::min(leftLane->getEditedDuration(),
+                                   rightLane != nullptr ? rightLane->getEditedDuration() : leftLane->getEditedDuration());
+        juce::StringArray channelMap;
+        channelMap.add(channelSource(*leftLane));
+        channelMap.add(channelSource(rightLane != nullptr ? *rightLane : *leftLane));
+        auto job = progressTracker.startJob(ProgressTracker::JobKind::Export, outputFile.getFileName(), duration);
+        auto verifyRequest = makeVerifyRequest(outputFile, { leftLane, rightLane != nullptr ? rightLane : leftLane },
+                                               normaliseFilter, settings);
+
+        juce::Thread::launch([args, outputFile, settings, sourceSampleRate, duration, job, manifest, fingerprint, channelMap,
+                              verifyRequest, safeThis = juce::Component::SafePointer<MainComponent>(this)]()
         {
-            juce::ChildProcess process;
-            if (process.start(args, juce::ChildProcess::wantStdOut | juce::ChildProcess::wantStdErr))
+            ExportRun run;
+            if (!runExportProcess(args, settings, outputFile, 2, sourceSampleRate, duration, 60000, *job, run))
             {
-                juce::String output = process.readAllProcessOutput();
-                process.waitForProcessToFinish(60000);
-                auto exitCode = process.getExitCode();
-                
-                if (exitCode != 0)
-                    juce::Logger::writeToLog("Stereo export error: " + output);
-
-                juce::MessageManager::callAsync([this, exitCode, outputFile, pair, numPairs]()
-                {
-                    if (exitCode == 0)
-                    {
-                        if (pair == numPairs - 1)
-                            updateStatus("Exported " + juce::String(numPairs) + " stereo pairs");
-                    }
-                    else
-                    {
-                        updateStatus("Export failed for " + outputFile.getFileName());
-                    }
-                });
+                job->finish(false, "Failed to start ffmpeg process");
+                return;
             }
+
+            if (run.exitCode == 0)
+            {
+                manifest->record(outputFile, run.toRecord(fingerprint, channelMap));
+                if (settings.verify)
+                    queueVerification(safeThis, verifyRequest);
+            }
+            else
+            {
+                manifest->remove(outputFile);
+                juce::Logger::writeToLog("Stereo export error: " + run.output);
+            }
+
+            job->finish(run.exitCode == 0, run.exitCode == 0 ? "Exported " + outputFile.getFileName()
+                                                             : "Export failed for " + outputFile.getFileName());
         });
     }
+
+    reportUpToDateOutputs(numUpToDate, numPairs);
+}
+
+void MainComponent::exportGroupedFiles(const juce::File& outputDir, const ExportSettings& settings)
+{
+    auto lanes = projectModel.getLanes();
+    if (lanes.empty())
+        return;
+
+    updateStatus("Exporting " + juce::String(settings.channelsPerFile) + "-channel files...");
+
+    // Consecutive runs of lanes, numbered by the channels they hold
+    const auto perFile = static_cast<size_t>(std::max(1, settings.channelsPerFile));
+    const juce::String extension = settings.getFileExtension();
+    std::vector<std::vector<Lane*>> fileLanes;
+    std::vector<GatheredOutput> outputs;
+    for (size_t start = 0; start < lanes.size(); start += perFile)
+    {
+        const size_t end = std::min(lanes.size(), start + perFile);
+        fileLanes.emplace_back(lanes.begin() + static_cast<std::ptrdiff_t>(start), lanes.begin() + static_cast<std::ptrdiff_t>(end));
+        outputs.push_back({ outputDir.getChildFile("channels_" + juce::String(static_cast<int>(start) + 1).paddedLeft('0', 2)
+                                                   + "-" + juce::String(static_cast<int>(end)).paddedLeft('0', 2) + "." + extension),
+                            static_cast<int>(end - start) });
+    }
+
+    // The files are parts of one stack, so they share one gain
+    auto measured = measureOutputLoudness(lanes);
+    auto normaliseFilter = settings.getNormalisationFilter(measured);
+    const auto ffmpegPath = ffmpegLocator.getFFmpegPath().getFullPathName();
+    const double sourceSampleRate = lanes.front()->sampleRate;
+
+    // Every file comes out of one pass: each source is decoded once, and
+    // either the gathered WAV frames are split between the writers, or a
+    // filter graph per file feeds its encoder
+    juce::StringArray args;
+    std::vector<ChannelGatherer::Group> groups;
+    if (settings.usesNativeWriter())
+    {
+        groups = makeGatherGroups(lanes, settings, normaliseFilter, ffmpegPath, settings.channelsPerFile);
+        for (const auto& group : groups)
+            args.addArray(group.args);
+    }
+    else
+    {
+        args = mergeCommand(ffmpegPath, lanes, normaliseFilter, settings.channelsPerFile, true);
+        for (size_t k = 0; k < outputs.size(); ++k)
+        {
+            args.add("-map");
+            args.add(splitOutputLabel(static_cast<int>(k)));
+            addOutputArgs(args, settings, outputs[k].file, sourceSampleRate);
+        }
+    }
+
+    juce::Logger::writeToLog("exportGroupedFiles: " + juce::String(static_cast<int>(outputs.size())) + " files, loudness "
+                             + LoudnessMeter::describe(measured)
+                             + (normaliseFilter.isNotEmpty() ? " -> " + normaliseFilter : juce::String()));
+
+    juce::Array<juce::File> sources;
+    double duration = lanes.front()->getEditedDuration();
+    for (auto* lane : lanes)
+    {
+        duration = std::min(duration, lane->getEditedDuration());
+        sources.addIfNotAlreadyThere(lane->sourceFile);
+    }
+
+    // The pass makes every file, so it only runs when one of them is stale
+    auto manifest = std::make_shared<ExportManifest>(outputDir);
+    std::vector<juce::String> fingerprints;
+    std::vector<juce::StringArray> channelMaps;
+    std::vector<ExportVerifier::Request> verifyRequests;
+    int numUpToDate = 0;
+    for (size_t k = 0; k < outputs.size(); ++k)
+    {
+        juce::StringArray recipe(args);
+        recipe.add("output=" + outputs[k].file.getFileName());
+        fingerprints.push_back(fingerprintOutput(recipe, settings, sources));
+        if (manifest->isUpToDate(outputs[k].file, fingerprints.back()))
+            ++numUpToDate;
+
+        juce::StringArray channelMap;
+        for (auto* lane : fileLanes[k])
+            channelMap.add(channelSource(*lane));
+        outputs[k].ditherSeed = ditherSeedFor(outputs[k].file, channelMap);
+        channelMaps.push_back(channelMap);
+        verifyRequests.push_back(makeVerifyRequest(outputs[k].file, fileLanes[k], normaliseFilter, settings));
+    }
+
+    const int numOutputs = static_cast<int>(outputs.size());
+    if (numUpToDate == numOutputs)
+    {
+        reportUpToDateOutputs(numUpToDate, numOutputs);
+        return;
+    }
+
+    const int numChannels = static_cast<int>(lanes.size());
+    auto job = progressTracker.startJob(ProgressTracker::JobKind::Export, outputDir.getFileName(), duration);
+
+    juce::Thread::launch([args, groups, outputs, settings, numChannels, sourceSampleRate, duration, job, manifest,
+                          fingerprints, channelMaps, verifyRequests, safeThis = juce::Component::SafePointer<MainComponent>(this)]()
+    {
+        std::vector<ExportRun> runs;
+        bool ran = false;
+        if (!groups.empty())
+        {
+            ran = runGatheredExport(groups, settings, outputs, sourceSampleRate, duration, 120000, *job, runs);
+        }
+        else
+        {
+            // One command wrote every file; it checksums the first
+            ExportRun run;
+            ran = runExportProcess(args, settings, outputs.front().file, numChannels, sourceSampleRate, duration,
+                                   120000, *job, run);
+            for (size_t k = 0; ran && k < outputs.size(); ++k)
+            {
+                runs.push_back(run);
+                if (k > 0 && run.exitCode == 0)
+                {
+                    auto digest = StreamChecksum::ofFile(outputs[k].file);
+                    runs.back().xxh64 = digest.xxh64;
+                    runs.back().md5 = digest.md5;
+                }
+            }
+        }
+
+        if (!ran)
+        {
+            job->finish(false, "Failed to start ffmpeg process");
+            return;
+        }
+
+        int numFailed = 0;
+        for (size_t k = 0; k < outputs.size(); ++k)
+        {
+            if (runs[k].exitCode == 0)
+            {
+                manifest->record(outputs[k].file, runs[k].toRecord(fingerprints[k], channelMaps[k]));
+                if (settings.verify)
+                    queueVerification(safeThis, verifyRequests[k]);
+            }
+            else
+            {
+                manifest->remove(outputs[k].file);
+                juce::Logger::writeToLog("Grouped export error: " + runs[k].output);
+                ++numFailed;
+            }
+        }
+
+        job->finish(numFailed == 0, numFailed == 0 ? "Exported " + juce::String(static_cast<int>(outputs.size())) + " files"
+                                                   : "Export failed for " + juce::String(numFailed) + " file(s)");
+    });
+}
+
+juce::String MainComponent::fingerprintOutput(const juce::StringArray& args, const ExportSettings& settings,
+                                              const juce::Array<juce::File>& sources) const
+{
+    // The native writer's quantisation happens after ffmpeg, so it isn't in the arguments
+    juce::StringArray recipe(args);
+    if (settings.usesNativeWriter())
+    {
+        recipe.add("bits=" + juce::String(settings.getBitsPerSample()));
+        recipe.add("dither=" + juce::String(static_cast<int>(settings.dither)));
+        if (settings.codec == ExportSettings::Codec::FLAC)
+            recipe.add("codec=flac");
+    }
+
+    // The ffmpeg binary is identified by path, size and date rather than by
+    // running it for a version string
+    auto ffmpeg = ffmpegLocator.getFFmpegPath();
+    juce::String toolVersion = juce::String(JUCE_APPLICATION_VERSION_STRING) + ";" + ffmpeg.getFullPathName()
+                             + ":" + juce::String(ffmpeg.getSize())
+                             + ":" + juce::String(ffmpeg.getLastModificationTime().toMilliseconds());
+
+    return ExportManifest::fingerprint(recipe, sources, toolVersion);
+}
+
+void MainComponent::reportUpToDateOutputs(int numUpToDate, int numOutputs)
+{
+    if (numUpToDate == 0)
+        return;
+
+    juce::Logger::writeToLog(juce::String(numUpToDate) + " of " + juce::String(numOutputs)
+                             + " output(s) already up to date");
+
+    // Otherwise the progress summary takes over once the rest are written
+    if (numUpToDate == numOutputs)
+        updateStatus("All " + juce::String(numOutputs) + " output(s) are up to date");
+}
+
+ExportVerifier::Request MainComponent::makeVerifyRequest(const juce::File& outputFile, const std::vector<Lane*>& outputLanes,
+                                                         const juce::String& gainFilter, const ExportSettings& settings)
+{
+    ExportVerifier::Request request;
+    request.output = outputFile;
+    request.gainFilter = gainFilter;
+    request.dither = settings.dither;
+
+    for (auto* lane : outputLanes)
+        request.channels.push_back({ lane->sourceFile, lane->streamIndex, lane->channelIndex, editFilter(*lane, 0.0) });
+
+    return request;
+}
+
+void MainComponent::queueVerification(juce::Component::SafePointer<MainComponent> component, ExportVerifier::Request request)
+{
+    // The verifier belongs to the component, which may be gone by the time
+    // a long export finishes
+    juce::MessageManager::callAsync([component, request = std::move(request)]() mutable
+    {
+        if (component != nullptr)
+            component->exportVerifier->enqueue(std::move(request));
+    });
+}
+
+void MainComponent::addOutputArgs(juce::StringArray& args, const ExportSettings& settings,
+                                  const juce::File& outputFile, double sourceSampleRate, int outputPipe)
+{
+    if (settings.usesNativeWriter())
+    {
+        // ffmpeg hands float frames back over stdout and the WAV file is
+        // written here, so the rate must be pinned for the header
+        args.add("-ar");
+        args.add(juce::String(juce::roundToInt(settings.getOutputSampleRate(sourceSampleRate))));
+        args.add("-f");
+        args.add("f32le");
+        args.add("-c:a");
+        args.add("pcm_f32le");
+        args.add(outputPipe > 0 ? "pipe:" + juce::String(outputPipe) : juce::String("-"));
+        return;
+    }
+
+    // Add sample rate conversion if requested
+    juce::String sampleRateStr = settings.getSampleRateArgs();
+    if (sampleRateStr.isNotEmpty())
+    {
+        args.add("-ar");
+        args.add(sampleRateStr);
+    }
+
+    // Add codec settings
+    juce::String codecArgs = settings.getCodecArgs();
+    juce::StringArray codecParts;
+    codecParts.addTokens(codecArgs, " ", "");
+    args.add("-c:a");
+    args.add(codecParts[0]);
+    for (int i = 1; i < codecParts.size(); ++i)
+        args.add(codecParts[i]);
+
+    args.add(outputFile.getFullPathName());
+}
+
+bool MainComponent::runExportProcess(const juce::StringArray& args, const ExportSettings& settings,
+                                     const juce::File& outputFile, int numChannels, double sourceSampleRate,
+                                     double expectedDuration, int timeoutMs, ProgressTracker::Job& progressJob,
+                                     ExportRun& run)
+{
+    if (settings.usesNativeWriter())
+    {
+        std::vector<ExportRun> runs;
+        if (!runGatheredExport({ { args, numChannels, {} } }, settings, { { outputFile, numChannels } }, sourceSampleRate,
+                               expectedDuration, timeoutMs, progressJob, runs))
+            return false;
+
+        run = runs.front();
+        return true;
+    }
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    const double startCpu = ProgressTracker::getThreadCpuSeconds();
+
+    SpawnedProcess process;
+
+    // ffmpeg's time, plus the read-back on this thread
+    auto finishTiming = [&]()
+    {
+        run.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+        run.cpuSeconds = process.getCpuSeconds() + ProgressTracker::getThreadCpuSeconds() - startCpu;
+    };
+
+    if (!process.start(args, SpawnedProcess::wantStdOut | SpawnedProcess::wantStdErr))
+        return false;
+
+    run.output = process.readAllProcessOutput();
+    process.waitForProcessToFinish(timeoutMs);
+    run.exitCode = static_cast<int>(process.getExitCode());
+    run.durationSeconds = expectedDuration;
+
+    // ffmpeg wrote the file itself, so it has to be read back - but
+    // encoded outputs are a fraction of the PCM size
+    if (run.exitCode == 0)
+    {
+        auto digest = StreamChecksum::ofFile(outputFile);
+        run.xxh64 = digest.xxh64;
+        run.md5 = digest.md5;
+    }
+
+    finishTiming();
+    return true;
+}
+
+std::vector<ChannelGatherer::Group> MainComponent::makeGatherGroups(const std::vector<Lane*>& lanes, const ExportSettings& settings,
+                                                                   const juce::String& postFilter, const juce::String& ffmpegPath,
+                                                                   int channelsPerFile)
+{
+    // Whole files per graph where they fit
+    const int channelsPerGraph = channelsPerFile > 0 && channelsPerFile < kMaxChannelsPerGraph
+                                   ? kMaxChannelsPerGraph / channelsPerFile * channelsPerFile
+                                   : kMaxChannelsPerGraph;
+
+    const double sourceSampleRate = lanes.front()->sampleRate;
+    std::vector<ChannelGatherer::Group> groups;
+    if (lanes.size() <= static_cast<size_t>(channelsPerGraph))
+    {
+        auto args = mergeCommand(ffmpegPath, lanes, postFilter);
+        args.add("-map");
+        args.add("[out]");
+        addOutputArgs(args, settings, juce::File(), sourceSampleRate);
+        groups.push_back({ args, static_cast<int>(lanes.size()), {} });
+        return groups;
+    }
+
+   #if JUCE_WINDOWS
+    // No extra output pipes here: one process per group, each decoding the
+    // sources its lanes use
+    for (size_t start = 0; start < lanes.size(); start += static_cast<size_t>(channelsPerGraph))
+    {
+        const size_t end = std::min(lanes.size(), start + static_cast<size_t>(channelsPerGraph));
+        std::vector<Lane*> groupLanes(lanes.begin() + static_cast<std::ptrdiff_t>(start),
+                                      lanes.begin() + static_cast<std::ptrdiff_t>(end));
+        auto args = mergeCommand(ffmpegPath, groupLanes, postFilter);
+        args.add("-map");
+        args.add("[out]");
+        addOutputArgs(args, settings, juce::File(), sourceSampleRate);
+        groups.push_back({ args, static_cast<int>(groupLanes.size()), {} });
+    }
+   #else
+    // One process decodes each source once and fans it out to a graph per
+    // group, each writing to a pipe of its own
+    ChannelGatherer::Group group;
+    group.args = mergeCommand(ffmpegPath, lanes, postFilter, channelsPerGraph, true);
+    group.numChannels = static_cast<int>(lanes.size());
+    for (int start = 0; start < group.numChannels; start += channelsPerGraph)
+    {
+        const int k = static_cast<int>(group.outputChannels.size());
+        group.args.add("-map");
+        group.args.add(splitOutputLabel(k));
+        addOutputArgs(group.args, settings, juce::File(), sourceSampleRate, 3 + k);
+        group.outputChannels.push_back(std::min(channelsPerGraph, group.numChannels - start));
+    }
+    groups.push_back(std::move(group));
+   #endif
+    return groups;
+}
+
+bool MainComponent::runGatheredExport(const std::vector<ChannelGatherer::Group>& groups, const ExportSettings& settings,
+                                      const std::vector<GatheredOutput>& outputs, double sourceSampleRate,
+                                      double expectedDuration, int timeoutMs, ProgressTracker::Job& progressJob,
+                                      std::vector<ExportRun>& runs)
+{
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    auto ownCpuSeconds = []() { return ProgressTracker::getThreadCpuSeconds() + ParallelForPool::getHelperCpuSeconds(); };
+    const double startCpu = ownCpuSeconds();
+
+    ChannelGatherer gatherer(groups);
+    if (!gatherer.start())
+        return false;
+
+    // The processes' and readers' time plus the writers' (here and on the
+    // pool's threads), shared out between the files by channel count
+    runs.assign(outputs.size(), {});
+    auto finishTiming = [&]()
+    {
+        const double cpuSeconds = gatherer.getCpuSeconds() + ownCpuSeconds() - startCpu;
+        int totalChannels = 0;
+        for (const auto& output : outputs)
+            totalChannels += output.numChannels;
+
+        for (size_t i = 0; i < runs.size(); ++i)
+        {
+            runs[i].wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+            runs[i].cpuSeconds = cpuSeconds * outputs[i].numChannels / std::max(1, totalChannels);
+        }
+    };
+
+    const int numChannels = gatherer.getNumChannels();
+    const double outputSampleRate = settings.getOutputSampleRate(sourceSampleRate);
+    const auto expectedFrames = static_cast<uint64_t>(std::max(0.0, std::round(expectedDuration * outputSampleRate)));
+
+    // Each output takes the next run of gathered channels
+    const bool isFlac = settings.codec == ExportSettings::Codec::FLAC;
+    std::vector<std::unique_ptr<AudioFileWriter>> writers;
+    std::vector<int> firstChannels;
+    int nextChannel = 0;
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        if (isFlac)
+            writers.push_back(std::make_unique<FlacFileWriter>(outputs[i].file, outputs[i].numChannels, outputSampleRate,
+                                                               settings.getBitsPerSample(), settings.dither, outputs[i].ditherSeed));
+        else
+            writers.push_back(std::make_unique<WavFileWriter>(outputs[i].file, outputs[i].numChannels, outputSampleRate,
+                                                              settings.getBitsPerSample(), settings.dither, outputs[i].ditherSeed,
+                                                              expectedFrames));
+        firstChannels.push_back(nextChannel);
+        nextChannel += outputs[i].numChannels;
+
+        if (!writers.back()->openedOk() || nextChannel > numChannels)
+        {
+            gatherer.finish(0);
+            for (auto& run : runs)
+            {
+                run.exitCode = -1;
+                run.output = "Could not open " + outputs[i].file.getFullPathName() + " for writing";
+            }
+            finishTiming();
+            return true;
+        }
+    }
+
+    juce::HeapBlock<float> buffer(ChannelGatherer::kBlockFrames * static_cast<size_t>(numChannels));
+    std::vector<std::vector<float>> slices(outputs.size() > 1 ? outputs.size() : 0);
+    for (size_t i = 0; i < slices.size(); ++i)
+        slices[i].resize(ChannelGatherer::kBlockFrames * static_cast<size_t>(outputs[i].numChannels));
+    std::vector<char> writeOk(outputs.size(), 1);
+
+    for (;;)
+    {
+        const size_t numFrames = gatherer.read(buffer.getData());
+        if (numFrames == 0)
+            break;
+
+        if (outputs.size() == 1)
+        {
+            if (writeOk[0])
+                writeOk[0] = writers[0]->write(buffer.getData(), numFrames);
+        }
+        else
+        {
+            // Dithering, packing and checksumming run per file, in parallel
+            parallelFor(static_cast<int>(outputs.size()), [&](int i)
+            {
+                const auto index = static_cast<size_t>(i);
+                const auto channels = static_cast<size_t>(outputs[index].numChannels);
+                const float* in = buffer.getData() + firstChannels[index];
+                float* out = slices[index].data();
+                for (size_t frame = 0; frame < numFrames; ++frame)
+                    std::memcpy(out + frame * channels, in + frame * static_cast<size_t>(numChannels), channels * sizeof(float));
+
+                if (writeOk[index])
+                    writeOk[index] = writers[index]->write(out, numFrames);
+            });
+        }
+
+        progressJob.addProgress(static_cast<double>(numFrames) / outputSampleRate);
+    }
+
+    const int exitCode = gatherer.finish(timeoutMs);
+    for (size_t i = 0; i < outputs.size(); ++i)
+    {
+        auto& run = runs[i];
+        auto& writer = *writers[i];
+        const bool ok = writer.finish() && writeOk[i];
+        run.exitCode = exitCode;
+        run.durationSeconds = static_cast<double>(writer.getFramesWritten()) / outputSampleRate;
+
+        if (run.exitCode == 0 && !ok)
+        {
+            run.exitCode = -1;
+            run.output = "Error writing " + outputs[i].file.getFullPathName();
+        }
+
+        if (run.exitCode == 0)
+        {
+            auto digest = writer.getChecksums();
+            if (!digest.isValid)
+            {
+                // FLAC always patches its header once closed; WAV only when
+                // the length differed from the probed duration
+                if (!isFlac)
+                    juce::Logger::writeToLog(outputs[i].file.getFileName() + ": " + juce::String(writer.getFramesWritten())
+                                             + " frames written, " + juce::String(static_cast<juce::int64>(expectedFrames))
+                                             + " expected - re-reading for checksums");
+                digest = StreamChecksum::ofFile(outputs[i].file);
+            }
+
+            run.xxh64 = digest.xxh64;
+            run.md5 = digest.md5;
+
+            if (isFlac)
+            {
+                const double seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+                const double pcmBytes = static_cast<double>(writer.getFramesWritten()) * outputs[i].numChannels
+                                      * settings.getBitsPerSample() / 8.0;
+                const auto fileBytes = static_cast<double>(static_cast<const FlacFileWriter&>(writer).getBytesWritten());
+                juce::Logger::writeToLog(outputs[i].file.getFileName() + ": "
+                                         + juce::String(pcmBytes / (1024.0 * 1024.0), 1) + " MB PCM to "
+                                         + juce::String(fileBytes / (1024.0 * 1024.0), 1) + " MB FLAC (ratio "
+                                         + juce::String(pcmBytes > 0.0 ? fileBytes / pcmBytes : 0.0, 3) + "), "
+                                         + juce::String(seconds > 0.0 ? pcmBytes / (1024.0 * 1024.0) / seconds : 0.0, 1)
+                                         + " MB/s");
+            }
+        }
+    }
+
+    finishTiming();
+    return true;
+}
+
+juce::String MainComponent::runGatherBenchmark(const juce::File& ffmpeg, const juce::Array<int>& channelCounts, double seconds)
+{
+    if (!ffmpeg.existsAsFile())
+        return "ffmpeg not found - nothing to benchmark\n";
+
+    constexpr int kSourceChannels = 8;
+    constexpr double kSampleRate = 48000.0;
+    constexpr int kTimeoutMs = 600000;
+    const auto ffmpegPath = ffmpeg.getFullPathName();
+
+    // Lanes are usually many channels of a few files: here, one file of tones
+    juce::TemporaryFile source(".wav");
+    {
+        juce::StringArray tones;
+        for (int c = 0; c < kSourceChannels; ++c)
+            tones.add("0.25*sin(2*PI*" + juce::String(220 * (c + 1)) + "*t)");
+
+        juce::StringArray args;
+        args.add(ffmpegPath);
+        args.add("-y");
+        args.add("-f");
+        args.add("lavfi");
+        args.add("-i");
+        args.add("aevalsrc=" + tones.joinIntoString("|") + ":s=" + juce::String(juce::roundToInt(kSampleRate))
+                 + ":d=" + juce::String(seconds));
+        args.add("-c:a");
+        args.add("pcm_s24le");
+        args.add(source.getFile().getFullPathName());
+
+        SpawnedProcess process;
+        if (!process.start(args, SpawnedProcess::wantStdOut | SpawnedProcess::wantStdErr))
+            return "Could not start " + ffmpegPath + "\n";
+
+        const auto output = process.readAllProcessOutput();
+        process.waitForProcessToFinish(kTimeoutMs);
+        if (process.getExitCode() != 0)
+            return "Could not generate the benchmark source:\n" + output;
+    }
+
+    ExportSettings settings;   // 24-bit WAV at the source rate, TPDF dither
+    juce::TemporaryFile output(".wav");
+
+    juce::String report = "Multichannel export, " + juce::String(seconds, 1) + " s at 48 kHz to 24-bit WAV"
+                          " (x realtime, MB/s written)\n"
+                          "  channels    one graph             gathered\n";
+
+    for (int numChannels : channelCounts)
+    {
+        std::vector<std::unique_ptr<Lane>> ownedLanes;
+        std::vector<Lane*> lanes;
+        for (int i = 0; i < numChannels; ++i)
+        {
+            auto lane = std::make_unique<Lane>();
+            lane->sourceFile = source.getFile();
+            lane->channelIndex = i % kSourceChannels;
+            lane->totalChannels = kSourceChannels;
+            lane->sampleRate = kSampleRate;
+            lane->duration = seconds;
+            lane->sampleFormat = "s32";
+            lane->bitsPerRawSample = 24;
+            lanes.push_back(lane.get());
+            ownedLanes.push_back(std::move(lane));
+        }
+
+        // The whole export as the app runs it, checksums included
+        auto timeExport = [&](const std::vector<ChannelGatherer::Group>& groups)
+        {
+            ProgressTracker tracker;
+            auto job = tracker.startJob(ProgressTracker::JobKind::Export, output.getFile().getFileName(), seconds);
+            std::vector<ExportRun> runs;
+            const bool ran = runGatheredExport(groups, settings, { { output.getFile(), numChannels } },
+                                               kSampleRate, seconds, kTimeoutMs, *job, runs);
+            const bool ok = ran && runs.front().exitCode == 0 && runs.front().wallSeconds > 0.0;
+            job->finish(ok);
+
+            if (!ok)
+                return juce::String("failed");
+
+            const double wallSeconds = runs.front().wallSeconds;
+            const double bytes = runs.front().durationSeconds * kSampleRate * numChannels * settings.getBitsPerSample() / 8.0;
+            return juce::String(runs.front().durationSeconds / wallSeconds, 1) + "x  "
+                 + juce::String(bytes / (1024.0 * 1024.0) / wallSeconds, 1) + " MB/s";
+        };
+
+        // Every channel through one filter graph, merged hierarchically
+        auto args = mergeCommand(ffmpegPath, lanes, {});
+        args.add("-map");
+        args.add("[out]");
+        addOutputArgs(args, settings, juce::File(), kSampleRate);
+        const auto single = timeExport({ { args, numChannels, {} } });
+
+        const auto groups = makeGatherGroups(lanes, settings, {}, ffmpegPath);
+        const auto gathered = timeExport(groups);
+
+        size_t numGraphs = 0;
+        for (const auto& group : groups)
+            numGraphs += std::max<size_t>(1, group.outputChannels.size());
+
+        report += "  " + juce::String(numChannels).paddedRight(' ', 12) + single.paddedRight(' ', 22) + gathered
+                + " (" + juce::String(static_cast<int>(numGraphs)) + " graphs)\n";
+    }
+
+    return report;
+}
+
+ExportManifest::OutputRecord MainComponent::ExportRun::toRecord(const juce::String& fingerprint,
+                                                                const juce::StringArray& channelMap) const
+{
+    ExportManifest::OutputRecord record;
+    record.fingerprint = fingerprint;
+    record.xxh64 = xxh64;
+    record.md5 = md5;
+    record.channelMap = channelMap;
+    record.durationSeconds = durationSeconds;
+    record.wallSeconds = wallSeconds;
+    record.cpuSeconds = cpuSeconds;
+    return record;
+}
+
+LoudnessSummary MainComponent::measureOutputLoudness(const std::vector<Lane*>& outputLanes)
+{
+    // The output stops at its shortest edited lane, like amerge
+    double outputLength = 0.0;
+    for (auto* lane : outputLanes)
+    {
+        // Every channel must have been measured for the figure to mean anything
+        if (lane == nullptr || lane->loudness == nullptr)
+            return {};
+
+        const double length = lane->getEditedDuration();
+        if (length > 0.0)
+            outputLength = outputLength > 0.0 ? std::min(outputLength, length) : length;
+    }
+
+    // The measurements cover whole sources; cut them to what each lane renders
+    std::vector<std::shared_ptr<const LoudnessData>> held;
+    std::vector<const LoudnessData*> channels;
+    for (auto* lane : outputLanes)
+    {
+        held.push_back(LoudnessMeter::edit(*lane->loudness, lane->inPoint, lane->outPoint, lane->offset, outputLength));
+        channels.push_back(held.back().get());
+    }
+
+    return LoudnessMeter::summarise(channels);
+}
+
+void MainComponent::ensureLoudnessStats(const ExportSettings& settings, std::function<void()> then)
+{
+    if (settings.normalisation == ExportSettings::Normalisation::None)
+    {
+        then();
+        return;
+    }
+
+    // Lanes still missing statistics; the extractor decodes each of their
+    // streams once, or waits for the extraction already decoding it
+    std::vector<Lane*> missing;
+    std::set<juce::String> streams;
+    for (auto* lane : projectModel.getLanes())
+    {
+        if (lane->loudness == nullptr)
+        {
+            missing.push_back(lane);
+            streams.insert(sourceKeyFor(*lane));
+        }
+    }
+
+    if (missing.empty())
+    {
+        then();
+        return;
+    }
+
+    updateStatus("Measuring loudness of " + juce::String(static_cast<int>(streams.size())) + " stream(s)...");
+    spawn(measureMissingLoudness(std::move(missing), std::move(then), lifetimeCancellation.getToken()));
+}
+
+Task<> MainComponent::measureMissingLoudness(std::vector<Lane*> lanes, std::function<void()> then,
+                                             CancellationToken token)
+{
+    juce::Component::SafePointer<MainComponent> safeThis(this);
+    auto measured = co_await waveformExtractor->measureLoudnessAsync(std::move(lanes), token);
+    if (token.isCancelled() || safeThis == nullptr)
+        co_return;
+
+    // A stream that failed to decode is exported without normalisation
+    for (const auto& result : measured.lanes)
+    {
+        if (Lane* lane = projectModel.findLane(result.laneId))
+            lane->loudness = result.loudness;
+    }
+
+    audioPlayer->updateMixGain(projectModel.getLanes());
+
+    then();
 }
 
 void MainComponent::updateStatus(const juce::String& message)
@@ -923,6 +2290,16 @@ void MainComponent::updateStatus(const juce::String& message)
     statusLabel.setText(message, juce::dontSendNotification);
 }
 
+void MainComponent::updateProgressStatus()
+{
+    auto snapshot = progressTracker.sample();
+    updateStatus(ProgressTracker::describe(snapshot));
+
+    // The batch summary stays up until something else replaces it
+    if (!snapshot.isActive())
+        progressPoller.stopTimer();
+}
+
 void MainComponent::timerCallback()
 {
     stopTimer();
@@ -932,6 +2309,12 @@ void MainComponent::timerCallback()
         audioReloadPending = false;
         reloadAudioNow();
     }
+
+    if (channelAnalysisPending)
+    {
+        channelAnalysisPending = false;
+        runChannelAnalysis();
+    }
 }
 
 void MainComponent::scheduleAudioReload()
@@ -941,16 +2324,234 @@ void MainComponent::scheduleAudioReload()
     startTimer(kAudioReloadDebounceMs);
 }
 
+void MainComponent::scheduleChannelAnalysis()
+{
+    // Debounce with the same timer - waveforms for a source land together
+    channelAnalysisPending = true;
+    startTimer(kAudioReloadDebounceMs);
+}
+
+void MainComponent::invalidateChannelAnalysis()
+{
+    ++channelAnalysisGeneration;
+    detectedPairs.clear();
+    detectedLayout.clear();
+}
+
+void MainComponent::runChannelAnalysis()
+{
+    auto lanes = projectModel.getLanes();
+    if (lanes.size() < 2)
+        return;
+
+    // Wait until every lane has been through the extraction pass; the last
+    // one to finish schedules another run
+    std::vector<ChannelAnalysisInput> inputs;
+    std::vector<juce::Uuid> laneIds;
+    for (auto* lane : lanes)
+    {
+        if (lane->analysisSignal == nullptr)
+            return;
+
+        ChannelAnalysisInput input;
+        input.signal = lane->analysisSignal;
+        input.sourceKey = lane->sourceFile.getFullPathName() + ":" + juce::String(lane->streamIndex);
+        input.channelIndex = lane->channelIndex;
+        inputs.push_back(std::move(input));
+        laneIds.push_back(lane->uuid);
+    }
+
+    int generation = ++channelAnalysisGeneration;
+    spawn(analyseChannels(std::move(inputs), std::move(laneIds), generation, lifetimeCancellation.getToken()));
+}
+
+Task<> MainComponent::analyseChannels(std::vector<ChannelAnalysisInput> inputs, std::vector<juce::Uuid> laneIds,
+                                      int generation, CancellationToken token)
+{
+    co_await analysisWorkers.schedule();
+    auto result = ChannelAnalyzer::analyze(inputs);
+
+    co_await resumeOnMessageThread();
+    if (token.isCancelled() || generation != channelAnalysisGeneration)
+        co_return;
+
+    detectedPairs.clear();
+    for (const auto& [left, right] : result.suggestedPairs)
+        detectedPairs.emplace_back(laneIds[static_cast<size_t>(left)], laneIds[static_cast<size_t>(right)]);
+    detectedLayout = result.suggestedLayout;
+
+    juce::Logger::writeToLog("Channel analysis: " + juce::String(static_cast<int>(detectedPairs.size()))
+                             + " pair(s), layout " + detectedLayout);
+
+    if (!detectedPairs.empty())
+        updateStatus("Detected " + juce::String(static_cast<int>(detectedPairs.size()))
+                     + " stereo pair(s) - suggested layout: " + detectedLayout);
+}
+
+juce::String MainComponent::sourceKeyFor(const Lane& lane)
+{
+    return lane.sourceFile.getFullPathName() + ":" + juce::String(lane.streamIndex);
+}
+
+void MainComponent::runSyncAnalysis()
+{
+    if (syncRunning)
+        return;
+
+    // One entry per source stream; the first lane's source is the reference
+    std::vector<SyncSource> sources;
+    for (auto* lane : projectModel.getLanes())
+    {
+        if (lane->analysisSignal == nullptr)
+        {
+            updateStatus("Sync needs every lane's waveform - wait for extraction to finish");
+            return;
+        }
+
+        const auto key = sourceKeyFor(*lane);
+        auto source = std::find_if(sources.begin(), sources.end(), [&key](const SyncSource& s) { return s.sourceKey == key; });
+        if (source == sources.end())
+        {
+            SyncSource added;
+            added.sourceKey = key;
+            added.stream = { lane->sourceFile, lane->streamIndex, lane->totalChannels, lane->sampleRate,
+                             lane->sampleFormat, lane->bitsPerRawSample };
+            sources.push_back(std::move(added));
+            source = std::prev(sources.end());
+        }
+
+        source->signals.push_back(lane->analysisSignal);
+        source->channels.push_back(lane->channelIndex);
+    }
+
+    if (sources.size() < 2)
+    {
+        updateStatus("Sync needs lanes from at least two sources");
+        return;
+    }
+
+    syncRunning = true;
+    syncButton.setEnabled(false);
+    updateStatus("Finding offsets between " + juce::String(static_cast<int>(sources.size())) + " sources...");
+    spawn(analyseSync(std::move(sources), lifetimeCancellation.getToken()));
+}
+
+Task<> MainComponent::analyseSync(std::vector<SyncSource> sources, CancellationToken token)
+{
+    const auto referenceKey = sources.front().sourceKey;
+    const auto ffmpegPath = ffmpegLocator.getFFmpegPath().getFullPathName();
+
+    co_await analysisWorkers.schedule();
+    auto offsets = SyncAnalyzer::analyze(sources, ffmpegPath, token);
+
+    co_await resumeOnMessageThread();
+    if (token.isCancelled())
+        co_return;
+
+    syncRunning = false;
+    syncButton.setEnabled(true);
+    showSyncResults(offsets, referenceKey);
+}
+
+void MainComponent::showSyncResults(const std::vector<SyncOffset>& offsets, const juce::String& referenceKey)
+{
+    auto findLanes = [this](const juce::String& key)
+    {
+        std::vector<Lane*> found;
+        for (auto* lane : projectModel.getLanes())
+            if (sourceKeyFor(*lane) == key)
+                found.push_back(lane);
+        return found;
+    };
+
+    auto referenceLanes = findLanes(referenceKey);
+    if (referenceLanes.empty())
+        return;
+
+    juce::String message = "Against " + referenceLanes.front()->sourceFile.getFileName() + ":\n";
+    std::vector<std::pair<juce::String, double>> usable;
+    for (const auto& offset : offsets)
+    {
+        auto lanes = findLanes(offset.sourceKey);
+        if (lanes.empty())
+            continue;
+
+        message << "\n" << lanes.front()->sourceFile.getFileName() << "  ";
+        if (offset.confidence < SyncAnalyzer::kMinConfidence)
+        {
+            message << "no reliable match";
+            continue;
+        }
+
+        message << (offset.lagSeconds >= 0.0 ? "+" : "") << juce::String(offset.lagSeconds, 6) << " s, "
+                << juce::String(juce::roundToInt(offset.confidence * 100.0f)) << "% confidence"
+                << (offset.refined ? "" : " (approximate)");
+        usable.emplace_back(offset.sourceKey, offset.lagSeconds);
+    }
+
+    updateStatus("Sync analysis finished");
+    if (usable.empty())
+    {
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::InfoIcon, "Sync", message);
+        return;
+    }
+
+    syncWindow = std::make_unique<juce::AlertWindow>("Sync", message, juce::MessageBoxIconType::QuestionIcon);
+    syncWindow->addButton("Apply", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    syncWindow->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    syncWindow->enterModalState(true, juce::ModalCallbackFunction::create([this, usable, referenceKey, findLanes](int result)
+    {
+        syncWindow.reset();
+        auto currentReference = findLanes(referenceKey);
+        if (result != 1 || currentReference.empty())
+            return;
+
+        // Source time t of the reference sits at offset - inPoint + t in the
+        // output; move each source so its matching audio lands there too.
+        // The lane keeps its edit: the move goes into its offset, and into
+        // its head only once the offset runs out.
+        const auto* reference = currentReference.front();
+        for (const auto& [key, lagSeconds] : usable)
+        {
+            const double target = reference->offset - reference->inPoint - lagSeconds;
+            for (auto* lane : findLanes(key))
+            {
+                const double move = target - (lane->offset - lane->inPoint);
+                const double offset = lane->offset + move;
+                double inPoint = lane->inPoint - std::min(0.0, offset);
+
+                // Keep at least a sample rather than lose the out-point
+                if (lane->outPoint > 0.0 && inPoint >= lane->outPoint)
+                    inPoint = std::max(0.0, lane->outPoint - 1.0 / std::max(1.0, lane->sampleRate));
+
+                projectModel.setLaneEdit(lane, std::max(0.0, offset), inPoint, lane->outPoint);
+            }
+        }
+
+        updateStatus("Applied sync offsets to " + juce::String(static_cast<int>(usable.size())) + " source(s)");
+    }));
+}
+
 void MainComponent::laneAdded(Lane* /*lane*/, int /*index*/)
 {
     repaint();
     scheduleAudioReload();  // Debounced
+    invalidateChannelAnalysis();
+}
+
+void MainComponent::laneAboutToBeRemoved(Lane* lane)
+{
+    // Its decode must not outlive it, nor keep going just for it
+    waveformExtractor->releaseLane(lane);
 }
 
 void MainComponent::laneRemoved(int /*index*/)
 {
     repaint();
     scheduleAudioReload();  // Debounced
+    invalidateChannelAnalysis();
+    scheduleChannelAnalysis();
     if (projectModel.getLaneCount() == 0)
         updateStatus("Drop audio/video files here to add channels");
 }
@@ -963,7 +2564,15 @@ void MainComponent::lanesReordered()
 
 void MainComponent::laneWaveformUpdated(Lane* /*lane*/)
 {
-    // Lane components will be notified via the model
+    // Lane components will be notified via the model; once every lane has
+    // its analysis signal the channel analysis runs
+    scheduleChannelAnalysis();
+}
+
+void MainComponent::laneEdited(Lane* /*lane*/)
+{
+    // Playback applies edits when mixing, so a reload picks them up
+    scheduleAudioReload();
 }
 
 void MainComponent::playbackStarted()
@@ -993,7 +2602,7 @@ void MainComponent::loadStateChanged(AudioPlayer::LoadState newState)
             updateStatus("Loading audio for preview...");
             break;
         case AudioPlayer::LoadState::Ready:
-            updateStatus("Ready to play");
+            updateStatus(audioPlayer->isUsingProxy() ? "Ready to play (proxy - loading full quality...)" : "Ready to play");
             break;
         case AudioPlayer::LoadState::Error:
             updateStatus("Failed to load audio for preview");
@@ -1001,27 +2610,55 @@ void MainComponent::loadStateChanged(AudioPlayer::LoadState newState)
     }
 }
 
+void MainComponent::loopRegionChanged()
+{
+    updatePlaybackUI();
+
+    if (loopOutSeconds - loopInSeconds >= AudioPlayer::kMinLoopSeconds && loopInSeconds >= 0.0)
+    {
+        const auto region = juce::String(loopInSeconds, 2) + "s - " + juce::String(loopOutSeconds, 2) + "s";
+        updateStatus(audioPlayer->isLoopReady() ? "Loop " + region : "Loop " + region + " (decoding...)");
+    }
+}
+
+void MainComponent::setLoopMarker(bool isIn)
+{
+    const double seconds = audioPlayer->getPositionSeconds();
+    (isIn ? loopInSeconds : loopOutSeconds) = seconds;
+
+    if (loopInSeconds >= 0.0 && loopOutSeconds - loopInSeconds >= AudioPlayer::kMinLoopSeconds)
+    {
+        audioPlayer->setLoopRegion(loopInSeconds, loopOutSeconds);
+    }
+    else
+    {
+        audioPlayer->clearLoopRegion();
+        updateStatus(juce::String("Loop ") + (isIn ? "in" : "out") + " set at " + juce::String(seconds, 2)
+                     + "s - set the " + (isIn ? "out point after" : "in point before") + " it");
+    }
+}
+
 void MainComponent::updatePlaybackUI()
 {
     bool playing = audioPlayer->isPlaying();
-    bool ready = audioPlayer->isReady();
+    bool ready = audioPlayer->canPlay();
     bool loading = audioPlayer->isLoading();
     
-    // Update play button state
-    if (loading)
-    {
-        playButton.setButtonText("Loading...");
-        playButton.setEnabled(false);
-        playButton.setColour(juce::TextButton::textColourOffId,
-                             Mach1LookAndFeel::Colors::textSecondary);
-    }
-    else if (playing)
+    // Update play button state; pre-roll can make it playable while loading
+    if (playing)
     {
         playButton.setButtonText("Pause");
         playButton.setEnabled(true);
         playButton.setColour(juce::TextButton::textColourOffId,
                              Mach1LookAndFeel::Colors::statusWarning);
     }
+    else if (loading && !ready)
+    {
+        playButton.setButtonText("Loading...");
+        playButton.setEnabled(false);
+        playButton.setColour(juce::TextButton::textColourOffId,
+                             Mach1LookAndFeel::Colors::textSecondary);
+    }
     else
     {
         playButton.setButtonText("Play");
@@ -1031,8 +2668,12 @@ void MainComponent::updatePlaybackUI()
                                    : Mach1LookAndFeel::Colors::textSecondary);
     }
     
-    // Stop button always enabled if playing
-    stopButton.setEnabled(playing);
+    // Stop button enabled while playing or paused part way
+    stopButton.setEnabled(playing || audioPlayer->isPaused());
+
+    // Markers follow the play position, so need something loaded
+    loopInButton.setEnabled(audioPlayer->getLoadState() != AudioPlayer::LoadState::Empty);
+    loopOutButton.setEnabled(audioPlayer->getLoadState() != AudioPlayer::LoadState::Empty);
 }
 
 void MainComponent::reloadAudioNow()
@@ -1118,7 +2759,7 @@ void MainComponent::checkFFmpegAvailability()
             // Open Terminal with homebrew install command
             juce::URL("x-apple.systempreferences:").launchInDefaultBrowser();
             // Actually run the brew command in Terminal
-            juce::ChildProcess terminal;
+            SpawnedProcess terminal;
             terminal.start("open -a Terminal");
             // Show instructions since we can't easily run the command
             juce::AlertWindow::showMessageBoxAsync(
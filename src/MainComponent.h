@@ -8,28 +8,55 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_gui_extra/juce_gui_extra.h>
 #include "model/ProjectModel.h"
+#include "model/ProgressTracker.h"
+#include "model/ExportManifest.h"
 #include "ui/LaneListComponent.h"
 #include "ffmpeg/FFmpegLocator.h"
 #include "ffmpeg/FFProbe.h"
 #include "audio/WaveformExtractor.h"
 #include "audio/AudioPlayer.h"
+#include "audio/DitherConverter.h"
+#include "audio/ChannelAnalyzer.h"
+#include "audio/SyncAnalyzer.h"
+#include "audio/ExportVerifier.h"
+#include "audio/ChannelGatherer.h"
+#include "async/AsyncPrimitives.h"
 
 // Export settings structure
 struct ExportSettings
 {
-    enum class ExportMode { Multichannel, MonoFiles, StereoPairs };
+    enum class ExportMode { Multichannel, MonoFiles, StereoPairs, DetectedStereoPairs, GroupedFiles };
     enum class BitDepth { Bit16, Bit24, Bit32Float };
     enum class SampleRate { SR44100, SR48000, SR96000, SR192000, SROriginal };
-    enum class Codec { PCM_WAV, AAC, VORBIS, OPUS };
+    enum class Codec { PCM_WAV, AAC, VORBIS, OPUS, FLAC };
+    enum class Normalisation { None, Loudness, TruePeak };
 
     ExportMode mode = ExportMode::Multichannel;
     BitDepth bitDepth = BitDepth::Bit24;
     SampleRate sampleRate = SampleRate::SROriginal;
     Codec codec = Codec::PCM_WAV;
+    Normalisation normalisation = Normalisation::None;
+    double normalisationTarget = -23.0;   // LUFS for Loudness, dBTP for TruePeak
+    DitherConverter::Dither dither = DitherConverter::Dither::Tpdf;   // 16/24-bit WAV and FLAC only
+    bool verify = false;   // Null-test WAV outputs against their sources once written
+    int channelsPerFile = 8;   // GroupedFiles: lanes in order, this many per file
 
     juce::String getCodecArgs() const;
     juce::String getSampleRateArgs() const;
     juce::String getFileExtension() const;
+    int getBitsPerSample() const;
+    double getOutputSampleRate(double sourceSampleRate) const;
+
+    // WAV and FLAC are written in-process (with our own dither) from ffmpeg's float output
+    bool usesNativeWriter() const { return codec == Codec::PCM_WAV || codec == Codec::FLAC; }
+
+    // Loudness normalisation never raises the true peak above this
+    static constexpr double kTruePeakCeilingDbtp = -1.0;
+
+    // ffmpeg filter applying the gain that brings an output with the given
+    // measurement to the target, or to kTruePeakCeilingDbtp if that comes
+    // first (empty when not normalising or unmeasurable)
+    juce::String getNormalisationFilter(const LoudnessSummary& measured) const;
 };
 
 class MainComponent : public juce::Component,
@@ -54,44 +81,157 @@ public:
 
     // ProjectModel::Listener overrides
     void laneAdded(Lane* lane, int index) override;
+    void laneAboutToBeRemoved(Lane* lane) override;
     void laneRemoved(int index) override;
     void lanesReordered() override;
     void laneWaveformUpdated(Lane* lane) override;
+    void laneEdited(Lane* lane) override;
 
     // AudioPlayer::Listener overrides
     void playbackStarted() override;
     void playbackStopped() override;
     void playbackPositionChanged(double positionSeconds) override;
     void loadStateChanged(AudioPlayer::LoadState newState) override;
+    void loopRegionChanged() override;
+
+    // Headless export benchmark: a generated source stacked to each channel
+    // count and written to 24-bit WAV, by one ffmpeg process and gathered
+    // from several. Blocks while ffmpeg runs.
+    static juce::String runGatherBenchmark(const juce::File& ffmpeg, const juce::Array<int>& channelCounts, double seconds);
 
 private:
     // Timer callback for debounced audio reload
     void timerCallback() override;
     
     void handleDroppedFile(const juce::File& file);
+
+    // Import pipeline: probe, create lanes, extract, publish. Runs on the
+    // message thread between awaits; nothing blocks while ffprobe/ffmpeg run.
+    Task<> importFile(juce::File file, CancellationToken token);
+    Task<> probeAndExtract(juce::File file, CancellationToken token);
+
+    // Follow imports (the Follow toggle): lanes of a file still being
+    // recorded grow as updates from the extractor arrive
+    void applyFollowUpdate(const WaveformExtractor::FollowUpdate& update, const juce::File& file);
+
     void showExportDialog();
     void performExport(const ExportSettings& settings);
     void updateStatus(const juce::String& message);
+    void updateProgressStatus();     // Sampled by progressPoller while jobs run
     void updatePlaybackUI();
+    void setLoopMarker(bool isIn);   // At the play position
     void scheduleAudioReload();  // Debounced reload
     void reloadAudioNow();       // Immediate reload
     void checkFFmpegAvailability();  // First-launch check
+    void scheduleChannelAnalysis();  // Debounced
+    void runChannelAnalysis();       // Correlation-based pairing suggestions
+    Task<> analyseChannels(std::vector<ChannelAnalysisInput> inputs, std::vector<juce::Uuid> laneIds,
+                           int generation, CancellationToken token);
+    void invalidateChannelAnalysis();
+    void runSyncAnalysis();          // Offsets between sources, offered for applying
+    Task<> analyseSync(std::vector<SyncSource> sources, CancellationToken token);
+    void showSyncResults(const std::vector<SyncOffset>& offsets, const juce::String& referenceKey);
+    static juce::String sourceKeyFor(const Lane& lane);
 
     // Export helpers
     void exportMultichannelWav(const juce::File& outputFile, const ExportSettings& settings);
     void exportMonoWavFiles(const juce::File& outputDir, const ExportSettings& settings);
     void exportStereoPairs(const juce::File& outputDir, const ExportSettings& settings);
+    void exportGroupedFiles(const juce::File& outputDir, const ExportSettings& settings);
+
+    // Output options for an export command: either the codec and file, or a
+    // float stream for the native WAV writer, on stdout or outputPipe
+    static void addOutputArgs(juce::StringArray& args, const ExportSettings& settings,
+                              const juce::File& outputFile, double sourceSampleRate, int outputPipe = 0);
+
+    // Outcome of one export command
+    struct ExportRun
+    {
+        int exitCode = 0;
+        juce::String output;
+        juce::String xxh64;
+        juce::String md5;
+        double durationSeconds = 0.0;
+        double wallSeconds = 0.0;
+        double cpuSeconds = 0.0;
+
+        ExportManifest::OutputRecord toRecord(const juce::String& fingerprint,
+                                              const juce::StringArray& channelMap) const;
+    };
+
+    // Run one export command (blocking) and checksum what it wrote - while
+    // writing for native WAV, by reading back otherwise. expectedDuration
+    // sizes the WAV header up front. Returns false if ffmpeg didn't start.
+    static bool runExportProcess(const juce::StringArray& args, const ExportSettings& settings,
+                                 const juce::File& outputFile, int numChannels, double sourceSampleRate,
+                                 double expectedDuration, int timeoutMs, ProgressTracker::Job& progressJob,
+                                 ExportRun& run);
+
+    // A WAV file written from gathered channels: the next numChannels of them
+    struct GatheredOutput
+    {
+        juce::File file;
+        int numChannels = 0;
+        uint32_t ditherSeed = 0;
+    };
+
+    // Native WAV export from several commands, each rendering the next
+    // group of channels. The outputs are written, in parallel, as the
+    // commands' frames are gathered; one run per output.
+    static bool runGatheredExport(const std::vector<ChannelGatherer::Group>& groups, const ExportSettings& settings,
+                                  const std::vector<GatheredOutput>& outputs, double sourceSampleRate,
+                                  double expectedDuration, int timeoutMs, ProgressTracker::Job& progressJob,
+                                  std::vector<ExportRun>& runs);
+
+    // Commands for runGatheredExport rendering these lanes in order, a few
+    // dozen channels per filter graph (whole files of channelsPerFile where
+    // they fit), each followed by postFilter. Each source is decoded once,
+    // except on Windows.
+    static std::vector<ChannelGatherer::Group> makeGatherGroups(const std::vector<Lane*>& lanes, const ExportSettings& settings,
+                                                               const juce::String& postFilter, const juce::String& ffmpegPath,
+                                                               int channelsPerFile = 0);
+
+    // Fingerprint of everything that shapes one output, for the sidecar
+    // manifest that lets a re-export skip outputs that haven't changed
+    juce::String fingerprintOutput(const juce::StringArray& args, const ExportSettings& settings,
+                                   const juce::Array<juce::File>& sources) const;
+    void reportUpToDateOutputs(int numUpToDate, int numOutputs);
+
+    // Null test of an output made of these lanes (in channel order), queued
+    // from the export thread as soon as the file is finished
+    static ExportVerifier::Request makeVerifyRequest(const juce::File& outputFile, const std::vector<Lane*>& outputLanes,
+                                                     const juce::String& gainFilter, const ExportSettings& settings);
+    static void queueVerification(juce::Component::SafePointer<MainComponent> component, ExportVerifier::Request request);
+
+    // Loudness of an output made of these lanes (in channel order), from the
+    // measurements cached by the extraction pass cut to each lane's edit -
+    // no decode needed
+    static LoudnessSummary measureOutputLoudness(const std::vector<Lane*>& outputLanes);
+
+    // Run 'then' once every lane has loudness statistics, decoding any
+    // missing ones first (in parallel per source stream) when normalising
+    void ensureLoudnessStats(const ExportSettings& settings, std::function<void()> then);
+    Task<> measureMissingLoudness(std::vector<Lane*> lanes, std::function<void()> then, CancellationToken token);
 
     ProjectModel projectModel;
     FFmpegLocator ffmpegLocator;
+    ProgressTracker progressTracker;
     std::unique_ptr<FFProbe> ffprobe;
     std::unique_ptr<WaveformExtractor> waveformExtractor;
+    std::unique_ptr<ProxyCache> proxyCache;
+    std::unique_ptr<PrerollCache> prerollCache;
+    std::unique_ptr<ExportVerifier> exportVerifier;
     std::unique_ptr<AudioPlayer> audioPlayer;
 
     // UI Components
     std::unique_ptr<LaneListComponent> laneListComponent;
     juce::TextButton playButton{ "Play" };
     juce::TextButton stopButton{ "Stop" };
+    juce::TextButton loopInButton{ "In" };
+    juce::TextButton loopOutButton{ "Out" };
+    juce::TextButton loopButton{ "Loop" };
+    juce::TextButton syncButton{ "Sync" };
+    juce::TextButton followButton{ "Follow" };
     juce::TextButton exportButton{ "Export..." };
     juce::TextButton clearButton{ "Clear All" };
     juce::Label statusLabel;
@@ -105,11 +245,48 @@ private:
     // Debounce state for audio reload
     bool audioReloadPending = false;
 
+    // Loop markers in source seconds, negative until set
+    double loopInSeconds = -1.0;
+    double loopOutSeconds = -1.0;
+
+    // Samples progressTracker at a fixed rate while jobs run - workers never
+    // post status messages themselves
+    class ProgressPoller : public juce::Timer
+    {
+    public:
+        explicit ProgressPoller(MainComponent& o) : owner(o) {}
+        void timerCallback() override { owner.updateProgressStatus(); }
+
+    private:
+        MainComponent& owner;
+    };
+
+    ProgressPoller progressPoller{ *this };
+
+    // Channel analysis state - pairs are stored by lane UUID so they
+    // survive reordering
+    bool channelAnalysisPending = false;
+    int channelAnalysisGeneration = 0;
+    std::vector<std::pair<juce::Uuid, juce::Uuid>> detectedPairs;
+    juce::String detectedLayout;
+
+    // Sync analysis in flight, and the offsets it proposes
+    bool syncRunning = false;
+    std::unique_ptr<juce::AlertWindow> syncWindow;
+
+    // Async work. Cancelled first on destruction; coroutines resumed after
+    // that return without touching the component.
+    CancellationSource lifetimeCancellation;
+    AsyncSemaphore importSlots{ kMaxConcurrentImports };
+    WorkerPool analysisWorkers{ 1 };
+
     // Constants
+    static constexpr int kMaxConcurrentImports = 2;
     static constexpr int kToolbarHeight = 50;
     static constexpr int kFooterHeight = 20;
     static constexpr int kDropZoneMinHeight = 100;
     static constexpr int kAudioReloadDebounceMs = 200;
+    static constexpr int kProgressRefreshMs = 100;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
@@ -0,0 +1,212 @@
+/*
+    ChannelStacker - Async Primitives Implementation
+*/
+
+#include "AsyncPrimitives.h"
+#include "SpawnedProcess.h"
+
+//==============================================================================
+// CancellationToken / CancellationSource
+//==============================================================================
+
+int CancellationToken::addCallback(std::function<void()> callback) const
+{
+    if (state == nullptr)
+        return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->cancelled)
+        {
+            int id = state->nextId++;
+            state->callbacks.emplace_back(id, std::move(callback));
+            return id;
+        }
+    }
+
+    callback();
+    return 0;
+}
+
+void CancellationToken::removeCallback(int id) const
+{
+    if (state == nullptr || id == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    auto& callbacks = state->callbacks;
+    callbacks.erase(std::remove_if(callbacks.begin(), callbacks.end(),
+                                   [id](const auto& entry) { return entry.first == id; }),
+                    callbacks.end());
+}
+
+void CancellationSource::cancel()
+{
+    std::vector<std::pair<int, std::function<void()>>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->cancelled.exchange(true))
+            return;
+        callbacks.swap(state->callbacks);
+    }
+
+    // Outside the lock - callbacks may cancel work that touches the token
+    for (auto& entry : callbacks)
+        entry.second();
+}
+
+//==============================================================================
+// Executors
+//==============================================================================
+
+bool MessageThreadAwaiter::await_ready() const
+{
+    return juce::MessageManager::existsAndIsCurrentThread();
+}
+
+void MessageThreadAwaiter::await_suspend(std::coroutine_handle<> handle) const
+{
+    juce::MessageManager::callAsync([handle]() { handle.resume(); });
+}
+
+WorkerPool::WorkerPool(int numThreads)
+    : pool(std::max(1, numThreads))
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    pool.removeAllJobs(true, 5000);
+}
+
+void WorkerPool::post(std::function<void()> job)
+{
+    pool.addJob(std::move(job));
+}
+
+void AsyncSemaphore::release()
+{
+    if (waiters.empty())
+    {
+        ++available;
+        return;
+    }
+
+    // The slot passes straight to the next waiter; resume it from the
+    // message loop rather than inside the releasing coroutine
+    auto next = waiters.front();
+    waiters.pop_front();
+    juce::MessageManager::callAsync([next]() { next.resume(); });
+}
+
+//==============================================================================
+// Child process polling
+//==============================================================================
+
+namespace
+{
+    // Message-thread timer that watches running processes for exit
+    class ProcessPoller : private juce::Timer,
+                          public juce::DeletedAtShutdown
+    {
+    public:
+        struct Entry
+        {
+            std::unique_ptr<SpawnedProcess> process;
+            std::coroutine_handle<> handle;
+            ProcessResult* result = nullptr;      // Lives in the suspended coroutine frame
+            CancellationToken token;
+        };
+
+        static ProcessPoller& getInstance()
+        {
+            if (instance == nullptr)
+                instance = new ProcessPoller();
+            return *instance;
+        }
+
+        ~ProcessPoller() override
+        {
+            stopTimer();
+            instance = nullptr;
+        }
+
+        void add(Entry entry)
+        {
+            entries.push_back(std::move(entry));
+            if (!isTimerRunning())
+                startTimer(kPollIntervalMs);
+        }
+
+    private:
+        static constexpr int kPollIntervalMs = 10;
+
+        void timerCallback() override
+        {
+            std::vector<std::coroutine_handle<>> finished;
+
+            for (auto it = entries.begin(); it != entries.end();)
+            {
+                if (it->token.isCancelled())
+                {
+                    it->process->kill();
+                    it->result->cancelled = true;
+                }
+                else if (it->process->isRunning())
+                {
+                    ++it;
+                    continue;
+                }
+                else
+                {
+                    it->result->exitCode = static_cast<int>(it->process->getExitCode());
+                }
+
+                finished.push_back(it->handle);
+                it = entries.erase(it);
+            }
+
+            if (entries.empty())
+                stopTimer();
+
+            // Resume after the list is consistent - the coroutines may start
+            // new processes
+            for (auto handle : finished)
+                handle.resume();
+        }
+
+        std::vector<Entry> entries;
+        static inline ProcessPoller* instance = nullptr;
+    };
+}
+
+ChildProcessAwaiter::ChildProcessAwaiter(juce::StringArray args, CancellationToken token)
+    : arguments(std::move(args)), cancellation(std::move(token))
+{
+}
+
+bool ChildProcessAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    if (cancellation.isCancelled())
+    {
+        result.cancelled = true;
+        return false;
+    }
+
+    // No pipes: output goes wherever the arguments send it
+    auto process = std::make_unique<SpawnedProcess>();
+    if (!process->start(arguments, 0))
+        return false;
+
+    result.started = true;
+
+    ProcessPoller::Entry entry;
+    entry.process = std::move(process);
+    entry.handle = handle;
+    entry.result = &result;
+    entry.token = cancellation;
+    ProcessPoller::getInstance().add(std::move(entry));
+    return true;
+}
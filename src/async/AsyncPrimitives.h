@@ -0,0 +1,176 @@
+/*
+    ChannelStacker - Async Primitives Header
+    Awaiters and helpers for Task coroutines: hopping to the message thread
+    or a worker pool, cooperative cancellation, bounding concurrency, and
+    waiting for a child process without parking a thread on it.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "Task.h"
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//==============================================================================
+// Cancellation. Sources hand out tokens; awaiters register callbacks on the
+// token (kill a process, cancel a decode) and coroutines check it after
+// every suspension.
+//==============================================================================
+
+class CancellationToken
+{
+public:
+    CancellationToken() = default;
+
+    bool isCancelled() const noexcept { return state != nullptr && state->cancelled.load(); }
+
+    // Run callback once on cancellation (immediately if already cancelled).
+    // Returns an id for removeCallback(), or 0 if it ran immediately.
+    int addCallback(std::function<void()> callback) const;
+    void removeCallback(int id) const;
+
+private:
+    friend class CancellationSource;
+
+    struct State
+    {
+        std::atomic<bool> cancelled{ false };
+        std::mutex mutex;
+        std::vector<std::pair<int, std::function<void()>>> callbacks;
+        int nextId = 1;
+    };
+
+    explicit CancellationToken(std::shared_ptr<State> s) : state(std::move(s)) {}
+
+    std::shared_ptr<State> state;
+};
+
+class CancellationSource
+{
+public:
+    CancellationSource() : state(std::make_shared<CancellationToken::State>()) {}
+
+    CancellationToken getToken() const { return CancellationToken(state); }
+    void cancel();
+
+private:
+    std::shared_ptr<CancellationToken::State> state;
+};
+
+//==============================================================================
+// Executors
+//==============================================================================
+
+// co_await resumeOnMessageThread() - continue on the JUCE message thread
+struct MessageThreadAwaiter
+{
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume() const noexcept {}
+};
+
+inline MessageThreadAwaiter resumeOnMessageThread() { return {}; }
+
+// Fixed-size pool for CPU work; co_await pool.schedule() continues on one of
+// its threads. The thread count bounds how much runs at once.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(int numThreads);
+    ~WorkerPool();
+
+    void post(std::function<void()> job);
+
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            WorkerPool& pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) const { pool.post([handle]() { handle.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+
+private:
+    juce::ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WorkerPool)
+};
+
+//==============================================================================
+// Message-thread counting semaphore: co_await acquire() suspends while all
+// slots are taken; release() hands the slot to the next waiter.
+//==============================================================================
+
+class AsyncSemaphore
+{
+public:
+    explicit AsyncSemaphore(int slots) : available(slots) {}
+
+    auto acquire()
+    {
+        struct Awaiter
+        {
+            AsyncSemaphore& semaphore;
+
+            bool await_ready() const noexcept
+            {
+                if (semaphore.available > 0)
+                {
+                    --semaphore.available;
+                    return true;
+                }
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) const { semaphore.waiters.push_back(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+
+    void release();
+
+private:
+    int available;
+    std::deque<std::coroutine_handle<>> waiters;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AsyncSemaphore)
+};
+
+//==============================================================================
+// Child processes. The process writes its output to a file (ffmpeg tools all
+// take an output path), and a message-thread timer polls for exit, so no
+// thread sits in waitForProcessToFinish() or a blocking pipe read.
+//==============================================================================
+
+struct ProcessResult
+{
+    bool started = false;
+    bool cancelled = false;
+    int exitCode = -1;
+};
+
+class ChildProcessAwaiter
+{
+public:
+    ChildProcessAwaiter(juce::StringArray args, CancellationToken token);
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle);     // false if never started
+    ProcessResult await_resume() const noexcept { return result; }
+
+private:
+    juce::StringArray arguments;
+    CancellationToken cancellation;
+    ProcessResult result;
+};
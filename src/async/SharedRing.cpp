@@ -0,0 +1,157 @@
+/*
+    ChannelStacker - Shared Ring Implementation
+*/
+
+#include "SharedRing.h"
+
+#if JUCE_LINUX
+ #include <cerrno>
+ #include <poll.h>
+ #include <sys/eventfd.h>
+ #include <sys/mman.h>
+ #include <unistd.h>
+
+namespace
+{
+    constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool SharedRing::isSupported()
+{
+    return true;
+}
+
+SharedRing::SharedRing(int memory, int signal, void* map, size_t capacityBytes)
+    : memoryFd(memory), signalFd(signal), mapping(map), capacity(capacityBytes),
+      header(static_cast<Header*>(map)), data(static_cast<uint8_t*>(map) + kDataOffset)
+{
+}
+
+SharedRing::~SharedRing()
+{
+    munmap(mapping, kDataOffset + capacity);
+    close(memoryFd);
+    close(signalFd);
+}
+
+std::unique_ptr<SharedRing> SharedRing::create(size_t capacityBytes)
+{
+    capacityBytes = static_cast<size_t>(alignUp(capacityBytes, kDataOffset));
+
+    const int memory = memfd_create("ChannelStackerRing", MFD_CLOEXEC);
+    if (memory < 0)
+        return nullptr;
+
+    const int signal = eventfd(0, EFD_CLOEXEC);
+    if (signal < 0 || ftruncate(memory, static_cast<off_t>(kDataOffset + capacityBytes)) != 0)
+    {
+        close(memory);
+        if (signal >= 0)
+            close(signal);
+        return nullptr;
+    }
+
+    void* map = mmap(nullptr, kDataOffset + capacityBytes, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    if (map == MAP_FAILED)
+    {
+        close(memory);
+        close(signal);
+        return nullptr;
+    }
+
+    // A fresh memfd reads as zeros, which is already a valid empty header
+    auto* header = static_cast<Header*>(map);
+    header->capacity = capacityBytes;
+    return std::unique_ptr<SharedRing>(new SharedRing(memory, signal, map, capacityBytes));
+}
+
+std::unique_ptr<SharedRing> SharedRing::attach(int memory, int signal)
+{
+    void* headerMap = mmap(nullptr, kDataOffset, PROT_READ, MAP_SHARED, memory, 0);
+    if (headerMap == MAP_FAILED)
+        return nullptr;
+    const auto capacityBytes = static_cast<size_t>(static_cast<const Header*>(headerMap)->capacity);
+    munmap(headerMap, kDataOffset);
+
+    if (capacityBytes == 0)
+        return nullptr;
+
+    void* map = mmap(nullptr, kDataOffset + capacityBytes, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    if (map == MAP_FAILED)
+        return nullptr;
+
+    return std::unique_ptr<SharedRing>(new SharedRing(memory, signal, map, capacityBytes));
+}
+
+void* SharedRing::reserve(size_t numBytes, int peerFd)
+{
+    if (numBytes == 0 || numBytes > capacity / 2)
+        return nullptr;
+
+    // Start at the next aligned position, or back at the beginning if the
+    // span would run past the end
+    uint64_t start = alignUp(written, kSpanAlignment);
+    if (start % capacity + numBytes > capacity)
+        start = alignUp(start, capacity);
+
+    while (start + numBytes - header->released.load(std::memory_order_acquire) > capacity)
+    {
+        pollfd fds[2] = { { signalFd, POLLIN, 0 }, { peerFd, 0, 0 } };
+        const int numReady = poll(fds, peerFd >= 0 ? 2 : 1, 1000);
+        if (numReady < 0 && errno != EINTR)
+            return nullptr;
+
+        if (peerFd >= 0 && (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+            return nullptr;
+
+        // Resets the counter; the loop re-checks the position either way
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            uint64_t count = 0;
+            [[maybe_unused]] const auto numRead = ::read(signalFd, &count, sizeof(count));
+        }
+    }
+
+    reservedAt = start;
+    return data + start % capacity;
+}
+
+uint64_t SharedRing::commit(size_t numBytes)
+{
+    // The consumer learns of the span through a syscall on another channel;
+    // make sure the data is visible before that
+    std::atomic_thread_fence(std::memory_order_release);
+    written = reservedAt + numBytes;
+    return written;
+}
+
+const void* SharedRing::read(uint64_t endPosition, size_t numBytes) const
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return data + (endPosition - numBytes) % capacity;
+}
+
+void SharedRing::release(uint64_t endPosition)
+{
+    header->released.store(endPosition, std::memory_order_release);
+
+    const uint64_t one = 1;
+    [[maybe_unused]] const auto numWritten = ::write(signalFd, &one, sizeof(one));
+}
+
+#else
+
+bool SharedRing::isSupported()                                 { return false; }
+SharedRing::SharedRing(int, int, void*, size_t)                {}
+SharedRing::~SharedRing() = default;
+std::unique_ptr<SharedRing> SharedRing::create(size_t)         { return nullptr; }
+std::unique_ptr<SharedRing> SharedRing::attach(int, int)       { return nullptr; }
+void* SharedRing::reserve(size_t, int)                         { return nullptr; }
+uint64_t SharedRing::commit(size_t)                            { return 0; }
+const void* SharedRing::read(uint64_t, size_t) const           { return nullptr; }
+void SharedRing::release(uint64_t)                             {}
+
+#endif
@@ -0,0 +1,92 @@
+/*
+    ChannelStacker - Shared Ring Header
+    Single-producer, single-consumer byte ring in shared memory between two
+    processes (Linux: memfd for the memory, eventfd for signalling). The
+    producer writes each batch into a contiguous span of the ring and tells
+    the consumer where it is by some ordered channel of its own (for the
+    decode worker, its stdout pipe); the consumer reads the span in place,
+    with no copy through the kernel, and releases it. Releases are signalled
+    on the eventfd so a producer waiting for room wakes up.
+
+    Spans never wrap: one that won't fit before the end starts again at the
+    beginning, so the consumer can always hand out a plain pointer.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+class SharedRing
+{
+public:
+    // False where there is no memfd/eventfd; callers keep to pipes there
+    static bool isSupported();
+
+    // Consumer side: new ring with capacityBytes of data space, or null
+    static std::unique_ptr<SharedRing> create(size_t capacityBytes);
+
+    // Producer side: map a ring from descriptors inherited from the consumer
+    static std::unique_ptr<SharedRing> attach(int memoryFd, int signalFd);
+
+    ~SharedRing();
+
+    // Descriptors to pass to the producer process
+    int getMemoryDescriptor() const noexcept { return memoryFd; }
+    int getSignalDescriptor() const noexcept { return signalFd; }
+
+    //==========================================================================
+    // Producer
+
+    // Contiguous space for numBytes (at most half the capacity), waiting
+    // until the consumer has released enough. Gives up and returns null if
+    // peerFd, when given, reports an error while waiting - e.g. the write
+    // end of a pipe whose reader has gone.
+    void* reserve(size_t numBytes, int peerFd = -1);
+
+    // Publish numBytes written at the last reserve(). Returns the span's end
+    // position, which the consumer needs to find it.
+    uint64_t commit(size_t numBytes);
+
+    //==========================================================================
+    // Consumer
+
+    // The span of numBytes ending at endPosition
+    const void* read(uint64_t endPosition, size_t numBytes) const;
+
+    // Everything up to endPosition has been consumed; wakes the producer
+    void release(uint64_t endPosition);
+
+    size_t getCapacity() const noexcept { return capacity; }
+
+private:
+    struct Header
+    {
+        std::atomic<uint64_t> released;    // Consumer position
+        uint64_t capacity;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring position is shared between processes");
+
+    // Data starts a page in, after the header
+    static constexpr size_t kDataOffset = 4096;
+    static constexpr size_t kSpanAlignment = 64;
+
+    SharedRing(int memoryFd, int signalFd, void* mapping, size_t capacity);
+
+    int memoryFd = -1;
+    int signalFd = -1;
+    void* mapping = nullptr;
+    size_t capacity = 0;
+
+    Header* header = nullptr;
+    uint8_t* data = nullptr;
+
+    // Producer-only state
+    uint64_t written = 0;
+    uint64_t reservedAt = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedRing)
+};
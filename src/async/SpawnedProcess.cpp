@@ -0,0 +1,463 @@
+/*
+    ChannelStacker - Spawned Process Implementation
+*/
+
+#include "SpawnedProcess.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+#if ! JUCE_WINDOWS
+ #include <cerrno>
+ #include <csignal>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #include <spawn.h>
+ #include <sys/resource.h>
+ #include <sys/wait.h>
+ #include <unistd.h>
+
+extern char** environ;
+#endif
+
+#if JUCE_WINDOWS
+
+SpawnedProcess::~SpawnedProcess() = default;
+
+bool SpawnedProcess::start(const juce::StringArray& args, int streamFlags,
+                           const std::vector<int>& inheritedFds)   { return (streamFlags & wantStdIn) == 0 && inheritedFds.empty() && process.start(args, streamFlags); }
+bool SpawnedProcess::start(const juce::String& command, int streamFlags)   { return (streamFlags & wantStdIn) == 0 && process.start(command, streamFlags); }
+bool SpawnedProcess::startWithOutputPipes(const juce::StringArray&, int, int) { return false; }
+bool SpawnedProcess::isRunning()                                           { return process.isRunning(); }
+int SpawnedProcess::readProcessOutput(void* dest, int numBytes)            { return process.readProcessOutput(dest, numBytes); }
+juce::String SpawnedProcess::readAllProcessOutput()                        { return process.readAllProcessOutput(); }
+int SpawnedProcess::readOutputPipe(int, void*, int)                        { return 0; }
+bool SpawnedProcess::writeProcessInput(const void*, size_t)                { return false; }
+void SpawnedProcess::closeProcessInput()                                   {}
+bool SpawnedProcess::waitForProcessToFinish(int timeoutMs)                 { return process.waitForProcessToFinish(timeoutMs); }
+uint32_t SpawnedProcess::getExitCode()                                     { return process.getExitCode(); }
+bool SpawnedProcess::kill()                                                { return process.kill(); }
+double SpawnedProcess::getCpuSeconds()                                     { return 0.0; }
+
+juce::String SpawnedProcess::runSpawnBenchmark(const juce::Array<int>&, int)
+{
+    return "Processes are launched with CreateProcess on Windows - nothing to compare";
+}
+
+#else
+
+namespace
+{
+    bool makePipe(int fds[2])
+    {
+       #if JUCE_LINUX || JUCE_BSD
+        return pipe2(fds, O_CLOEXEC) == 0;
+       #else
+        if (pipe(fds) != 0)
+            return false;
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+       #endif
+    }
+}
+
+SpawnedProcess::~SpawnedProcess()
+{
+    closePipe();
+
+    // Reap it if it has exited, or was killed and is about to; like
+    // juce::ChildProcess, one still running is left to finish on its own
+    std::lock_guard<std::mutex> guard(stateLock);
+    if (pid != 0 && !finished)
+        pollLocked(killed);
+}
+
+void SpawnedProcess::closePipe()
+{
+    if (readFd >= 0)
+    {
+        close(readFd);
+        readFd = -1;
+    }
+
+    for (int fd : outputPipeFds)
+        close(fd);
+    outputPipeFds.clear();
+
+    closeProcessInput();
+}
+
+void SpawnedProcess::closeProcessInput()
+{
+    if (writeFd >= 0)
+    {
+        close(writeFd);
+        writeFd = -1;
+    }
+}
+
+bool SpawnedProcess::start(const juce::String& command, int streamFlags)
+{
+    juce::StringArray tokens;
+    tokens.addTokens(command, true);
+    for (auto& token : tokens)
+        token = token.unquoted();
+    return start(tokens, streamFlags);
+}
+
+bool SpawnedProcess::start(const juce::StringArray& args, int streamFlags, const std::vector<int>& inheritedFds)
+{
+    {
+        // A finished (or killed) process object can be reused
+        std::lock_guard<std::mutex> guard(stateLock);
+        if (pid != 0 && !finished)
+        {
+            if (!killed)
+                return false;
+            pollLocked(true);
+        }
+
+        pid = 0;
+        exitCode = 0;
+        cpuSeconds = 0.0;
+        finished = false;
+        killed = false;
+    }
+
+    closePipe();
+
+    std::vector<std::string> strings;
+    for (const auto& arg : args)
+        if (arg.isNotEmpty())
+            strings.push_back(arg.toStdString());
+    if (strings.empty())
+        return false;
+
+    std::vector<char*> argv;
+    for (auto& s : strings)
+        argv.push_back(s.data());
+    argv.push_back(nullptr);
+
+    int fds[2] = { -1, -1 };
+    int inputFds[2] = { -1, -1 };
+    if ((streamFlags & (wantStdOut | wantStdErr)) != 0 && !makePipe(fds))
+        return false;
+
+    if ((streamFlags & wantStdIn) != 0 && !makePipe(inputFds))
+    {
+        for (int fd : fds)
+            if (fd >= 0)
+                close(fd);
+        return false;
+    }
+
+    // Copied above the target range first, so no dup2 below overwrites a
+    // descriptor that is still to be passed on
+    const int firstInheritedFd = STDERR_FILENO + 1;
+    std::vector<int> inheritedCopies;
+    for (int fd : inheritedFds)
+        inheritedCopies.push_back(fcntl(fd, F_DUPFD_CLOEXEC, firstInheritedFd + static_cast<int>(inheritedFds.size())));
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for (size_t i = 0; i < inheritedCopies.size(); ++i)
+        posix_spawn_file_actions_adddup2(&actions, inheritedCopies[i], firstInheritedFd + static_cast<int>(i));
+    if (inputFds[0] >= 0)
+        posix_spawn_file_actions_adddup2(&actions, inputFds[0], STDIN_FILENO);
+    else
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    for (auto [flag, target] : { std::pair{ wantStdOut, STDOUT_FILENO }, std::pair{ wantStdErr, STDERR_FILENO } })
+    {
+        if ((streamFlags & flag) != 0)
+            posix_spawn_file_actions_adddup2(&actions, fds[1], target);
+        else
+            posix_spawn_file_actions_addopen(&actions, target, "/dev/null", O_WRONLY, 0);
+    }
+
+    // The app may block or ignore SIGPIPE; ffmpeg should see the defaults
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t noSignals, defaultSignals;
+    sigemptyset(&noSignals);
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    posix_spawnattr_setsigmask(&attributes, &noSignals);
+    posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+    posix_spawnattr_setflags(&attributes, static_cast<short>(POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF));
+
+    pid_t child = 0;
+    const int error = posix_spawnp(&child, argv[0], &actions, &attributes, argv.data(), environ);
+
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+
+    for (int fd : inheritedCopies)
+        if (fd >= 0)
+            close(fd);
+
+    // The child's ends are closed here, so each side sees EOF when the
+    // other closes
+    if (fds[1] >= 0)
+        close(fds[1]);
+    if (inputFds[0] >= 0)
+        close(inputFds[0]);
+
+    if (error != 0)
+    {
+        if (fds[0] >= 0)
+            close(fds[0]);
+        if (inputFds[1] >= 0)
+            close(inputFds[1]);
+        return false;
+    }
+
+    readFd = fds[0];
+    writeFd = inputFds[1];
+
+    std::lock_guard<std::mutex> guard(stateLock);
+    pid = child;
+    return true;
+}
+
+bool SpawnedProcess::isRunning()
+{
+    std::lock_guard<std::mutex> guard(stateLock);
+    return pollLocked(false);
+}
+
+bool SpawnedProcess::pollLocked(bool block)
+{
+    if (pid == 0 || finished)
+        return false;
+
+    int status = 0;
+    rusage usage{};
+    pid_t result;
+    do
+        result = wait4(pid, &status, block ? 0 : WNOHANG, &usage);
+    while (result < 0 && errno == EINTR);
+
+    if (result == 0)
+        return true;
+
+    finished = true;
+    if (result == pid)
+    {
+        if (WIFEXITED(status))
+            exitCode = WEXITSTATUS(status);
+        else if (WIFSIGNALED(status))
+            exitCode = 128 + WTERMSIG(status);
+
+        auto toSeconds = [](const timeval& t) { return static_cast<double>(t.tv_sec) + static_cast<double>(t.tv_usec) * 1.0e-6; };
+        cpuSeconds = toSeconds(usage.ru_utime) + toSeconds(usage.ru_stime);
+    }
+    return false;
+}
+
+bool SpawnedProcess::startWithOutputPipes(const juce::StringArray& args, int streamFlags, int numOutputPipes)
+{
+    std::vector<int> readEnds, writeEnds;
+    auto closeAll = [](std::vector<int>& fds)
+    {
+        for (int fd : fds)
+            close(fd);
+        fds.clear();
+    };
+
+    for (int i = 0; i < numOutputPipes; ++i)
+    {
+        int fds[2] = { -1, -1 };
+        if (!makePipe(fds))
+        {
+            closeAll(readEnds);
+            closeAll(writeEnds);
+            return false;
+        }
+        readEnds.push_back(fds[0]);
+        writeEnds.push_back(fds[1]);
+    }
+
+    const bool started = start(args, streamFlags, writeEnds);
+
+    // Only the child holds the write ends now, so each pipe ends with it
+    closeAll(writeEnds);
+    if (!started)
+    {
+        closeAll(readEnds);
+        return false;
+    }
+
+    outputPipeFds = std::move(readEnds);
+    return true;
+}
+
+int SpawnedProcess::readOutputPipe(int pipe, void* destBuffer, int numBytesToRead)
+{
+    if (pipe < 0 || pipe >= static_cast<int>(outputPipeFds.size()) || numBytesToRead <= 0)
+        return 0;
+
+    for (;;)
+    {
+        const auto numRead = read(outputPipeFds[static_cast<size_t>(pipe)], destBuffer, static_cast<size_t>(numBytesToRead));
+        if (numRead < 0 && errno == EINTR)
+            continue;
+        return numRead > 0 ? static_cast<int>(numRead) : 0;
+    }
+}
+
+int SpawnedProcess::readProcessOutput(void* destBuffer, int numBytesToRead)
+{
+    if (readFd < 0 || numBytesToRead <= 0)
+        return 0;
+
+    for (;;)
+    {
+        const auto numRead = read(readFd, destBuffer, static_cast<size_t>(numBytesToRead));
+        if (numRead < 0 && errno == EINTR)
+            continue;
+        return numRead > 0 ? static_cast<int>(numRead) : 0;
+    }
+}
+
+juce::String SpawnedProcess::readAllProcessOutput()
+{
+    juce::MemoryOutputStream result;
+    char buffer[4096];
+    for (;;)
+    {
+        const int numRead = readProcessOutput(buffer, static_cast<int>(sizeof(buffer)));
+        if (numRead <= 0)
+            break;
+        result.write(buffer, static_cast<size_t>(numRead));
+    }
+    return result.toString();
+}
+
+bool SpawnedProcess::writeProcessInput(const void* data, size_t numBytes)
+{
+    // A reader that has gone raises SIGPIPE on this thread; hold it off so
+    // the write fails with EPIPE instead of taking the app down
+    sigset_t pipeSignal, previousMask;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, &previousMask);
+
+    const auto* bytes = static_cast<const char*>(data);
+    while (numBytes > 0 && writeFd >= 0)
+    {
+        const auto numWritten = write(writeFd, bytes, numBytes);
+        if (numWritten < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EPIPE)
+            {
+                sigset_t pending;
+                sigpending(&pending);
+                if (sigismember(&pending, SIGPIPE))
+                {
+                    int signal = 0;
+                    sigwait(&pipeSignal, &signal);
+                }
+            }
+
+            closeProcessInput();
+            break;
+        }
+
+        bytes += numWritten;
+        numBytes -= static_cast<size_t>(numWritten);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+    return numBytes == 0;
+}
+
+bool SpawnedProcess::waitForProcessToFinish(int timeoutMs)
+{
+    const auto timeoutTime = juce::Time::getMillisecondCounter() + static_cast<uint32_t>(timeoutMs);
+    do
+    {
+        if (!isRunning())
+            return true;
+        juce::Thread::sleep(2);
+    }
+    while (timeoutMs < 0 || juce::Time::getMillisecondCounter() < timeoutTime);
+
+    return false;
+}
+
+uint32_t SpawnedProcess::getExitCode()
+{
+    // SIGKILL can't be caught, so a killed process is waited for: it
+    // reports 128 + SIGKILL rather than "still running"
+    std::lock_guard<std::mutex> guard(stateLock);
+    pollLocked(killed);
+    return finished ? static_cast<uint32_t>(exitCode) : 0;
+}
+
+double SpawnedProcess::getCpuSeconds()
+{
+    std::lock_guard<std::mutex> guard(stateLock);
+    pollLocked(killed);
+    return finished ? cpuSeconds : 0.0;
+}
+
+bool SpawnedProcess::kill()
+{
+    std::lock_guard<std::mutex> guard(stateLock);
+    if (pid == 0 || finished)
+        return true;
+
+    // Not yet reaped, so the pid is still this child's (a zombie at worst)
+    if (::kill(pid, SIGKILL) != 0)
+        return false;
+
+    killed = true;
+    return true;
+}
+
+juce::String SpawnedProcess::runSpawnBenchmark(const juce::Array<int>& residentSizesMb, int launchesPerSize)
+{
+    launchesPerSize = std::max(1, launchesPerSize);
+
+    juce::String report = "Spawn latency, ms per start() of 'true' (mean of " + juce::String(launchesPerSize) + ")\n"
+                          "  resident MB    fork (juce::ChildProcess)    posix_spawn\n";
+
+    // Only the launch is timed: waiting polls, which would swamp it
+    auto timeLaunches = [launchesPerSize](auto makeProcess)
+    {
+        double total = 0.0;
+        for (int i = 0; i < launchesPerSize; ++i)
+        {
+            auto process = makeProcess();
+            const double start = juce::Time::getMillisecondCounterHiRes();
+            const bool started = process->start("true", 0);
+            total += juce::Time::getMillisecondCounterHiRes() - start;
+            if (started)
+                process->waitForProcessToFinish(-1);
+        }
+        return total / launchesPerSize;
+    };
+
+    for (int sizeMb : residentSizesMb)
+    {
+        // Written to, so every page is really resident and mapped
+        std::vector<uint8_t> ballast(static_cast<size_t>(std::max(0, sizeMb)) << 20);
+        for (size_t i = 0; i < ballast.size(); i += 4096)
+            ballast[i] = static_cast<uint8_t>(i);
+
+        const double forked = timeLaunches([]() { return std::make_unique<juce::ChildProcess>(); });
+        const double spawned = timeLaunches([]() { return std::make_unique<SpawnedProcess>(); });
+
+        report += "  " + juce::String(sizeMb).paddedLeft(' ', 11)
+                + "    " + juce::String(forked, 3).paddedLeft(' ', 25)
+                + "    " + juce::String(spawned, 3).paddedLeft(' ', 11) + "\n";
+    }
+
+    return report;
+}
+
+#endif
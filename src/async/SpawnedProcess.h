@@ -0,0 +1,107 @@
+/*
+    ChannelStacker - Spawned Process Header
+    Drop-in replacement for juce::ChildProcess that launches with
+    posix_spawn instead of fork. Forking has to copy the page tables of the
+    whole app, so with gigabytes of decoded audio resident every ffmpeg
+    launch got slower; posix_spawn (vfork semantics on Linux, native on
+    macOS) costs the same whatever the app's size. The pipes are created
+    close-on-exec, so processes started concurrently from other threads
+    never inherit each other's pipe ends. Windows has no fork, so there it
+    wraps juce::ChildProcess (which has no stdin pipe).
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class SpawnedProcess
+{
+public:
+    // Same values as juce::ChildProcess's flags, plus a pipe to stdin
+    enum StreamFlags
+    {
+        wantStdOut = 1,
+        wantStdErr = 2,
+        wantStdIn = 4
+    };
+
+    SpawnedProcess() = default;
+    ~SpawnedProcess();
+
+    // Launch args[0] (searched on the PATH) with the remaining arguments.
+    // Streams not wanted go to /dev/null. Descriptors in inheritedFds are
+    // passed on as the child's fds 3, 4, ... (not on Windows).
+    bool start(const juce::StringArray& args, int streamFlags = wantStdOut | wantStdErr,
+               const std::vector<int>& inheritedFds = {});
+
+    // Command line split on spaces, honouring quotes
+    bool start(const juce::String& command, int streamFlags = wantStdOut | wantStdErr);
+
+    // start() with numOutputPipes more output pipes, on the child's fds 3,
+    // 4, ... (ffmpeg's "pipe:3", ...). Not on Windows.
+    bool startWithOutputPipes(const juce::StringArray& args, int streamFlags, int numOutputPipes);
+
+    bool isRunning();
+
+    // Blocking read of the piped output: bytes read, 0 once it has ended
+    int readProcessOutput(void* destBuffer, int numBytesToRead);
+
+    // Everything until the output ends
+    juce::String readAllProcessOutput();
+
+    // Blocking read of one of startWithOutputPipes()'s pipes; each may be
+    // read on its own thread
+    int readOutputPipe(int pipe, void* destBuffer, int numBytesToRead);
+
+    // With wantStdIn: blocking write to the process's stdin, false once it
+    // has gone. Closing the pipe signals end of input.
+    bool writeProcessInput(const void* data, size_t numBytes);
+    void closeProcessInput();
+
+    // False if still running after timeoutMs (-1 = wait forever)
+    bool waitForProcessToFinish(int timeoutMs);
+
+    // Exit status once finished (128 + signal number if killed), else 0
+    uint32_t getExitCode();
+
+    // User plus system CPU time the process used, once finished, else 0.
+    // Always 0 on Windows, where juce::ChildProcess doesn't expose it.
+    double getCpuSeconds();
+
+    // SIGKILL. Safe from another thread while this one waits on the
+    // process: kill() only signals, and the exit is collected by the next
+    // isRunning(), wait or getExitCode() (or the destructor).
+    bool kill();
+
+    // Spawn latency of juce::ChildProcess (fork) against posix_spawn with
+    // this much memory resident, for each size in MB. Blocking.
+    static juce::String runSpawnBenchmark(const juce::Array<int>& residentSizesMb, int launchesPerSize);
+
+private:
+#if JUCE_WINDOWS
+    juce::ChildProcess process;
+#else
+    void closePipe();
+
+    // wait4() for the child (stateLock held); false once it has exited.
+    // The exit is collected exactly once, so kill() can never signal a
+    // reaped - and possibly reused - pid.
+    bool pollLocked(bool block);
+
+    int readFd = -1;
+    int writeFd = -1;
+    std::vector<int> outputPipeFds;
+
+    std::mutex stateLock;       // Guards the fields below
+    int pid = 0;
+    int exitCode = 0;
+    double cpuSeconds = 0.0;
+    bool finished = false;
+    bool killed = false;
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpawnedProcess)
+};
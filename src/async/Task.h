@@ -0,0 +1,161 @@
+/*
+    ChannelStacker - Coroutine Task Header
+    Minimal C++20 coroutine task. A Task is lazy: it starts when awaited
+    (or when handed to spawn()) and resumes its awaiter when it finishes.
+    Where it runs is decided by the awaiters inside it (see AsyncPrimitives.h).
+*/
+
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+    struct TaskFinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            // Symmetric transfer back to whoever awaited us
+            if (auto continuation = handle.promise().continuation)
+                return continuation;
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct TaskPromiseBase
+    {
+        std::coroutine_handle<> continuation;
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        TaskFinalAwaiter final_suspend() const noexcept { return {}; }
+
+        // Errors travel as values in this codebase; an escaping exception is a bug
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+
+    template <typename T>
+    struct TaskPromise : TaskPromiseBase
+    {
+        std::optional<T> value;
+
+        Task<T> get_return_object() noexcept;
+        void return_value(T result) { value = std::move(result); }
+    };
+
+    template <>
+    struct TaskPromise<void> : TaskPromiseBase
+    {
+        Task<void> get_return_object() noexcept;
+        void return_void() const noexcept {}
+    };
+}
+
+template <typename T>
+class [[nodiscard]] Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle h) noexcept : handle(h) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+                handle.destroy();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    auto operator co_await() noexcept
+    {
+        struct Awaiter
+        {
+            Handle handle;
+
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume()
+            {
+                if constexpr (!std::is_void_v<T>)
+                    return std::move(*handle.promise().value);
+            }
+        };
+
+        return Awaiter{ handle };
+    }
+
+private:
+    Handle handle;
+};
+
+namespace detail
+{
+    template <typename T>
+    Task<T> TaskPromise<T>::get_return_object() noexcept
+    {
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> TaskPromise<void>::get_return_object() noexcept
+    {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+
+    // Self-destroying coroutine that owns a spawned Task
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+
+    inline DetachedTask runDetached(Task<void> task)
+    {
+        co_await task;
+    }
+}
+
+// Start a task without awaiting it. It runs on the calling thread until
+// its first suspension and cleans itself up when it finishes.
+inline void spawn(Task<void> task)
+{
+    detail::runDetached(std::move(task));
+}
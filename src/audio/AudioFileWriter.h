@@ -0,0 +1,32 @@
+/*
+    ChannelStacker - Audio File Writer Header
+    Common interface of the in-process writers that turn the gathered float
+    frames into a file (WAV, FLAC)
+*/
+
+#pragma once
+
+#include "StreamChecksum.h"
+#include <cstddef>
+#include <cstdint>
+
+class AudioFileWriter
+{
+public:
+    virtual ~AudioFileWriter() = default;
+
+    virtual bool openedOk() const = 0;
+
+    // Append interleaved float frames
+    virtual bool write(const float* interleaved, size_t numFrames) = 0;
+
+    // Complete the file and close it. Called by the destructor if not
+    // called explicitly.
+    virtual bool finish() = 0;
+
+    virtual uint64_t getFramesWritten() const = 0;
+
+    // Checksums of the finished file, when they could be taken as it was
+    // written (isValid false means the file must be hashed again)
+    virtual const StreamChecksum::Digest& getChecksums() const = 0;
+};
@@ -5,9 +5,121 @@
 */
 
 #include "AudioPlayer.h"
+#include "SampleKernels.h"
+#include "GrowingWavFile.h"
+#include "LoudnessMeter.h"
+#include "../async/SpawnedProcess.h"
 
-AudioPlayer::AudioPlayer(FFmpegLocator& locator)
-    : ffmpegLocator(locator)
+namespace
+{
+    // Equal-power left and right gains of lane i of numLanes, spread left
+    // to right in lane order
+    std::pair<float, float> panGains(int i, int numLanes)
+    {
+        const float pan = numLanes > 1 ? static_cast<float>(i) / static_cast<float>(numLanes - 1) : 0.5f;
+        return { std::cos(pan * juce::MathConstants<float>::halfPi), std::sin(pan * juce::MathConstants<float>::halfPi) };
+    }
+
+    // 4-point Hermite interpolation at index + frac, clamped at the ends or
+    // wrapped around them
+    inline float interpolate(const float* data, int numSamples, int index, float frac, bool wrap)
+    {
+        auto at = [data, numSamples, wrap](int i)
+        {
+            return data[wrap ? (i + numSamples) % numSamples : juce::jlimit(0, numSamples - 1, i)];
+        };
+        const float y0 = at(index - 1), y1 = at(index), y2 = at(index + 1), y3 = at(index + 2);
+
+        const float c1 = 0.5f * (y2 - y0);
+        const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+        const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+        return ((c3 * frac + c2) * frac + c1) * frac + y1;
+    }
+
+    // Play source into dest from position, step source samples per output
+    // sample. With wrap the source repeats, otherwise writing stops at its
+    // end. Returns the number of samples written.
+    int render(const juce::AudioBuffer<float>& source, double& position, double step, bool wrap,
+               juce::AudioBuffer<float>& dest, int startSample, int numSamples, int numChannels)
+    {
+        const int length = source.getNumSamples();
+        int written = 0;
+
+        if (step == 1.0)
+        {
+            // Same rate: straight copies, split at the wrap
+            while (written < numSamples && position < length)
+            {
+                const auto start = static_cast<int>(position);
+                const int count = std::min(numSamples - written, length - start);
+                for (int ch = 0; ch < numChannels; ++ch)
+                    dest.copyFrom(ch, startSample + written, source, ch, start, count);
+
+                written += count;
+                position += count;
+                if (wrap && position >= length)
+                    position -= length;
+            }
+        }
+        else
+        {
+            // Proxies and sources at other rates are resampled on the fly
+            for (; written < numSamples && position < length; ++written)
+            {
+                const auto index = static_cast<int>(position);
+                const auto frac = static_cast<float>(position - index);
+                for (int ch = 0; ch < numChannels; ++ch)
+                    dest.setSample(ch, startSample + written,
+                                   interpolate(source.getReadPointer(ch), length, index, frac, wrap));
+
+                position += step;
+                if (wrap && position >= length)
+                    position -= length;
+            }
+        }
+
+        return written;
+    }
+
+    // Loop body of a stereo mix whose first leadIn samples come before the
+    // loop start. The tail fades into the lead-in, so wrapping round to the
+    // first sample continues the audio that originally led into it.
+    juce::AudioBuffer<float> makeLoopBuffer(const juce::AudioBuffer<float>& mix, int leadIn)
+    {
+        const int length = mix.getNumSamples() - leadIn;
+        juce::AudioBuffer<float> loop(mix.getNumChannels(), length);
+        for (int ch = 0; ch < mix.getNumChannels(); ++ch)
+            loop.copyFrom(ch, 0, mix, ch, leadIn, length);
+
+        const int fade = std::min(leadIn, length / 2);
+        if (fade > 0)
+        {
+            // Equal-power, the two sides are unrelated audio
+            for (int ch = 0; ch < loop.getNumChannels(); ++ch)
+            {
+                float* tail = loop.getWritePointer(ch, length - fade);
+                const float* lead = mix.getReadPointer(ch, leadIn - fade);
+                for (int i = 0; i < fade; ++i)
+                {
+                    const float t = (static_cast<float>(i) + 0.5f) / static_cast<float>(fade) * juce::MathConstants<float>::halfPi;
+                    tail[i] = tail[i] * std::cos(t) + lead[i] * std::sin(t);
+                }
+            }
+        }
+        else
+        {
+            // Loop from the very start: nothing leads in, so short fades at both ends
+            const int ramp = std::min(64, length / 2);
+            loop.applyGainRamp(0, ramp, 0.0f, 1.0f);
+            loop.applyGainRamp(length - ramp, ramp, 1.0f, 0.0f);
+        }
+
+        return loop;
+    }
+}
+
+AudioPlayer::AudioPlayer(FFmpegLocator& locator, ProxyCache* proxies, PrerollCache* preroll, ProgressTracker* progressTracker)
+    : ffmpegLocator(locator), proxyCache(proxies), prerollCache(preroll), progress(progressTracker)
 {
 }
 
@@ -54,7 +166,10 @@ void AudioPlayer::shutdown()
 
 void AudioPlayer::loadLanes(const std::vector<Lane*>& lanes)
 {
-    stop();
+    // Keeps a paused position, so play resumes there after the reload
+    halt();
+    usingPreroll = false;
+    shuttling = false;
     
     // Increment generation to cancel any in-progress decode
     // Old threads will check this and exit gracefully
@@ -64,11 +179,23 @@ void AudioPlayer::loadLanes(const std::vector<Lane*>& lanes)
     {
         juce::ScopedLock sl(lock);
         audioBuffer.setSize(2, 0);
-        readPosition = 0;
+        readPosition = 0.0;
+        usingProxy = false;
+        usingPreroll = false;
+        currentInfos.clear();
+        loadedSourceFrames = 0;
+        resumeSeconds = 0.0;
+        ++loopGeneration;
+        loopSource.reset();
+        loopBuffer.setSize(2, 0);
         setLoadState(LoadState::Empty);
         return;
     }
 
+    // One gain for the whole mix, however it arrives (proxy, pre-roll,
+    // loop, extensions, the full decode)
+    updateMixGain(lanes);
+
     // Copy lane info to avoid accessing Lane pointers from background thread
     std::vector<DecodeInfo> decodeInfos;
     decodeInfos.reserve(lanes.size());
@@ -81,10 +208,27 @@ void AudioPlayer::loadLanes(const std::vector<Lane*>& lanes)
         info.channelIndex = lane->channelIndex;
         info.totalChannels = lane->totalChannels;
         info.sampleRate = lane->sampleRate;
+        info.sampleFormat = lane->sampleFormat;
+        info.bitsPerRawSample = lane->bitsPerRawSample;
+        info.offset = lane->offset;
+        info.inPoint = lane->inPoint;
+        info.outPoint = lane->outPoint;
         decodeInfos.push_back(info);
     }
 
+    currentInfos = decodeInfos;
+    loadedSourceFrames = 0;
     setLoadState(LoadState::Loading);
+
+    // Same source and still covered: the loop region only needs re-mixing
+    // for the new lanes
+    if (loopSource != nullptr && loopSource->sourceFilePath == currentInfos.front().sourceFilePath
+        && loopSource->streamIndex == currentInfos.front().streamIndex
+        && loopSource->sourceRange.contains(getSourceRange(currentInfos, loopSource->startSeconds - loopSource->leadInSeconds,
+                                                           loopSource->endSeconds)))
+        remixLoop();
+    else
+        reloadLoop();
     
     // Get ffmpeg path as string before starting thread
     juce::String ffmpegPath = ffmpegLocator.getFFmpegPath().getFullPathName();
@@ -116,7 +260,30 @@ void AudioPlayer::decodeAudioAsync(std::vector<DecodeInfo> infos, juce::String f
         int numSourceChannels = firstInfo.totalChannels;
         double sampleRate = firstInfo.sampleRate > 0 ? firstInfo.sampleRate : 48000.0;
 
-        // Build ffmpeg command to decode to raw float32
+        std::vector<int> laneChannels;
+        for (const auto& info : decodeInfos)
+            laneChannels.push_back(info.channelIndex);
+
+        // A cached proxy makes the lanes playable now; the decode below
+        // replaces it with full quality when it finishes
+        if (proxyCache != nullptr)
+        {
+            juce::AudioBuffer<float> proxy;
+            if (proxyCache->read(juce::File(firstInfo.sourceFilePath), firstInfo.streamIndex, laneChannels, proxy))
+            {
+                if (shuttingDown || loadGeneration != myGeneration)
+                    return;
+
+                const int length = getEditedLength(decodeInfos, proxy.getNumSamples(), ProxyCache::kSampleRate);
+                onDecodeComplete(mixLanes(proxy, decodeInfos, true, ProxyCache::kSampleRate, 0.0, 0.0, length),
+                                 ProxyCache::kSampleRate, myGeneration, true);
+            }
+        }
+
+        // Decode in the source's own sample width (less to pipe), converted below
+        const SampleFormat pipeFormat = SampleKernels::pipeFormatFor(firstInfo.sampleFormat, firstInfo.bitsPerRawSample);
+        const auto& kernels = SampleKernels::get(pipeFormat, numSourceChannels);
+
         juce::StringArray args;
         args.add(ffmpegPath);
         args.add("-v");
@@ -127,15 +294,30 @@ void AudioPlayer::decodeAudioAsync(std::vector<DecodeInfo> infos, juce::String f
         args.add("-map");
         args.add("0:a:" + juce::String(firstInfo.streamIndex));
         args.add("-f");
-        args.add("f32le");
+        args.add(SampleKernels::ffmpegFormatName(pipeFormat));
         args.add("-acodec");
-        args.add("pcm_f32le");
+        args.add(SampleKernels::ffmpegCodecName(pipeFormat));
         args.add("-ar");
         args.add(juce::String(static_cast<int>(sampleRate)));
         args.add("-");
 
-        juce::ChildProcess process;
-        if (!process.start(args, juce::ChildProcess::wantStdOut))
+        // Ends with the decode, whichever way it does; superseded ones fail
+        struct FinishOnExit
+        {
+            ProgressTracker::JobHandle job;
+            bool succeeded = false;
+            ~FinishOnExit()
+            {
+                if (job != nullptr)
+                    job->finish(succeeded, "Decoded for playback: " + job->getName());
+            }
+        } progressJob;
+        if (progress != nullptr)
+            progressJob.job = progress->startJob(ProgressTracker::JobKind::Playback,
+                                                 juce::File(firstInfo.sourceFilePath).getFileName(), 0.0);
+
+        SpawnedProcess process;
+        if (!process.start(args, SpawnedProcess::wantStdOut))
         {
             DBG("AudioPlayer: Failed to start ffmpeg decode");
             if (!shuttingDown)
@@ -147,6 +329,12 @@ void AudioPlayer::decodeAudioAsync(std::vector<DecodeInfo> infos, juce::String f
         juce::MemoryBlock rawData;
         const int chunkSize = 65536;
         juce::HeapBlock<char> buffer(chunkSize);
+        const size_t frameBytes = static_cast<size_t>(SampleKernels::bytesPerSample(pipeFormat) * numSourceChannels);
+        auto addProgress = [&](int numBytes)
+        {
+            if (progressJob.job != nullptr)
+                progressJob.job->addProgress(static_cast<double>(numBytes) / static_cast<double>(frameBytes) / sampleRate);
+        };
 
         while (process.isRunning())
         {
@@ -160,7 +348,10 @@ void AudioPlayer::decodeAudioAsync(std::vector<DecodeInfo> infos, juce::String f
             
             int bytesRead = process.readProcessOutput(buffer, chunkSize);
             if (bytesRead > 0)
+            {
                 rawData.append(buffer, static_cast<size_t>(bytesRead));
+                addProgress(bytesRead);
+            }
             else
                 juce::Thread::sleep(1);
         }
@@ -170,7 +361,8 @@ void AudioPlayer::decodeAudioAsync(std::vector<DecodeInfo> infos, juce::String f
         while ((bytesRead = process.readProcessOutput(buffer, chunkSize)) > 0)
         {
             rawData.append(buffer, static_cast<size_t>(bytesRead));
-            
+            addProgress(bytesRead);
+
             if (shuttingDown || loadGeneration != myGeneration)
                 return;
         }
@@ -193,62 +385,25 @@ void AudioPlayer::decodeAudioAsync(std::vector<DecodeInfo> infos, juce::String f
         }
 
         // Convert raw data to audio buffer
-        int numSamples = static_cast<int>(rawData.getSize() / (sizeof(float) * static_cast<size_t>(numSourceChannels)));
+        int numSamples = static_cast<int>(rawData.getSize() / frameBytes);
         
         DBG("AudioPlayer: Decoded " + juce::String(numSamples) + " samples, " + 
             juce::String(numSourceChannels) + " channels");
 
         // Create stereo mix based on lane order
         juce::AudioBuffer<float> tempBuffer(numSourceChannels, numSamples);
-        const float* rawPtr = static_cast<const float*>(rawData.getData());
 
-        // De-interleave
-        for (int s = 0; s < numSamples; ++s)
-        {
-            if (shuttingDown || loadGeneration != myGeneration)
-                return;
-                
-            for (int ch = 0; ch < numSourceChannels; ++ch)
-            {
-                tempBuffer.setSample(ch, s, rawPtr[s * numSourceChannels + ch]);
-            }
-        }
+        // De-interleave and convert in one pass with the kernel specialised
+        // for this format and channel count
+        kernels.deinterleave(rawData.getData(), static_cast<size_t>(numSamples), numSourceChannels,
+                             tempBuffer.getArrayOfWritePointers());
 
-        // Mix to stereo based on lane configuration
-        juce::AudioBuffer<float> stereoBuffer(2, numSamples);
-        stereoBuffer.clear();
-
-        int numLanes = static_cast<int>(decodeInfos.size());
-        
-        for (int i = 0; i < numLanes; ++i)
-        {
-            if (shuttingDown || loadGeneration != myGeneration)
-                return;
-                
-            int srcChannel = decodeInfos[static_cast<size_t>(i)].channelIndex;
-            if (srcChannel >= numSourceChannels)
-                continue;
-
-            // Calculate stereo pan position based on lane index
-            float pan = (numLanes > 1) ? static_cast<float>(i) / static_cast<float>(numLanes - 1) : 0.5f;
-            float leftGain = std::cos(pan * juce::MathConstants<float>::halfPi);
-            float rightGain = std::sin(pan * juce::MathConstants<float>::halfPi);
-
-            // Mix this channel into stereo output
-            for (int s = 0; s < numSamples; ++s)
-            {
-                float sample = tempBuffer.getSample(srcChannel, s);
-                stereoBuffer.addSample(0, s, sample * leftGain);
-                stereoBuffer.addSample(1, s, sample * rightGain);
-            }
-        }
+        if (shuttingDown || loadGeneration != myGeneration)
+            return;
 
-        // Normalize if needed
-        float maxLevel = stereoBuffer.getMagnitude(0, numSamples);
-        if (maxLevel > 1.0f)
-        {
-            stereoBuffer.applyGain(0.9f / maxLevel);
-        }
+        // Mix to stereo based on lane configuration
+        auto stereoBuffer = mixLanes(tempBuffer, decodeInfos, false, sampleRate, 0.0, 0.0,
+                                     getEditedLength(decodeInfos, numSamples, sampleRate));
 
         // Final cancellation check before updating shared state
         if (shuttingDown || loadGeneration != myGeneration)
@@ -258,7 +413,8 @@ void AudioPlayer::decodeAudioAsync(std::vector<DecodeInfo> infos, juce::String f
         }
 
         // Send result to main thread
-        onDecodeComplete(std::move(stereoBuffer), sampleRate, myGeneration);
+        progressJob.succeeded = true;
+        onDecodeComplete(std::move(stereoBuffer), sampleRate, myGeneration, false, numSamples);
     });
 }
 
@@ -277,13 +433,15 @@ void AudioPlayer::setLoadState(LoadState newState)
     });
 }
 
-void AudioPlayer::onDecodeComplete(juce::AudioBuffer<float> decodedBuffer, double decodedSampleRate, int generation)
+void AudioPlayer::onDecodeComplete(juce::AudioBuffer<float> decodedBuffer, double decodedSampleRate, int generation,
+                                   bool isProxy, juce::int64 numSourceFrames)
 {
     if (shuttingDown)
         return;
         
     // Post to message thread
-    juce::MessageManager::callAsync([this, buf = std::move(decodedBuffer), sr = decodedSampleRate, gen = generation]() mutable
+    juce::MessageManager::callAsync([this, buf = std::move(decodedBuffer), sr = decodedSampleRate, gen = generation, isProxy,
+                                     numSourceFrames]() mutable
     {
         if (shuttingDown || loadGeneration != gen)
         {
@@ -293,13 +451,23 @@ void AudioPlayer::onDecodeComplete(juce::AudioBuffer<float> decodedBuffer, doubl
         
         {
             juce::ScopedLock sl(lock);
+
+            // Audio replacing a proxy or pre-roll carries on from the same time
+            const bool keepPlace = usingProxy || usingPreroll;
+            readPosition = keepPlace ? (bufferStartSeconds + readPosition / currentSampleRate) * sr : 0.0;
             audioBuffer = std::move(buf);
             currentSampleRate = sr;
-            readPosition = 0;
+            bufferStartSeconds = 0.0;
+            usingProxy = isProxy;
+            usingPreroll = false;
         }
+        loadedSourceFrames = isProxy ? 0 : numSourceFrames;
         
         setLoadState(LoadState::Ready);
-        DBG("AudioPlayer: Audio loaded and ready for playback");
+        if (isProxy)
+            DBG("AudioPlayer: Proxy loaded, full quality still decoding");
+        else
+            DBG("AudioPlayer: Audio loaded and ready for playback");
     });
 }
 
@@ -311,18 +479,157 @@ void AudioPlayer::onDecodeError(int generation)
     juce::MessageManager::callAsync([this, generation]()
     {
         if (!shuttingDown && loadGeneration == generation)
+        {
+            // Pre-roll has nothing to hand over to
+            if (usingPreroll)
+            {
+                usingPreroll = false;
+                halt();
+            }
             setLoadState(LoadState::Error);
+        }
     });
 }
 
-void AudioPlayer::play()
+void AudioPlayer::extendLoadedSource()
 {
-    if (loadState != LoadState::Ready)
+    // A full quality decode can be extended, and so can a load that failed
+    // because the file had no audio in it yet
+    const auto state = loadState.load();
+    if (currentInfos.empty() || extending || usingProxy || usingPreroll
+        || (state != LoadState::Ready && state != LoadState::Error))
+        return;
+
+    const bool replace = state == LoadState::Error;
+    const juce::int64 fromFrame = replace ? 0 : loadedSourceFrames;
+    const double rate = replace ? currentInfos.front().sampleRate : currentSampleRate;
+
+    extending = true;
+    juce::Thread::launch([this, infos = currentInfos, fromFrame, rate, replace, generation = loadGeneration.load()]()
     {
-        DBG("AudioPlayer: Cannot play - audio not ready");
+        const auto& first = infos.front();
+        GrowingWavFile wav{ juce::File(first.sourceFilePath) };
+        if (shuttingDown || loadGeneration != generation || !wav.refresh() || wav.getNumChannels() != first.totalChannels
+            || wav.getSampleRate() != rate || wav.getNumFrames() <= fromFrame)
+        {
+            extending = false;
+            return;
+        }
+
+        // Re-mix from where the first lane ran out of loaded source; lanes
+        // still playing past that point come out the same as before
+        const juce::int64 toFrame = wav.getNumFrames();
+        const double loadedEnd = static_cast<double>(fromFrame) / rate;
+        double outputStart = -1.0;
+        for (const auto& info : infos)
+        {
+            if (info.outPoint > 0.0 && info.outPoint <= loadedEnd)
+                continue;
+            const double laneEnd = info.offset + std::max(0.0, loadedEnd - info.inPoint);
+            outputStart = outputStart < 0.0 ? laneEnd : std::min(outputStart, laneEnd);
+        }
+
+        const int outputStartFrame = juce::roundToInt(std::max(0.0, outputStart) * rate);
+        const int outputEndFrame = getEditedLength(infos, static_cast<int>(toFrame), rate);
+        const auto sourceRange = getSourceRange(infos, outputStartFrame / rate, outputEndFrame / rate);
+        if (outputStart < 0.0 || outputEndFrame <= outputStartFrame || sourceRange.isEmpty())
+        {
+            extending = false;
+            return;
+        }
+
+        // Only the source frames the new stretch plays from
+        const auto firstFrame = std::max<juce::int64>(0, static_cast<juce::int64>(std::floor(sourceRange.getStart() * rate)));
+        const auto endFrame = std::min(toFrame, static_cast<juce::int64>(std::ceil(sourceRange.getEnd() * rate)));
+        const int numFrames = static_cast<int>(std::max<juce::int64>(0, endFrame - firstFrame));
+        const int numChannels = first.totalChannels;
+
+        std::vector<float> interleaved(static_cast<size_t>(numFrames) * static_cast<size_t>(numChannels));
+        juce::AudioBuffer<float> channels(numChannels, numFrames);
+        if (numFrames == 0 || !wav.read(firstFrame, static_cast<size_t>(numFrames), interleaved.data()))
+        {
+            extending = false;
+            return;
+        }
+        SampleKernels::get(SampleFormat::F32, numChannels).deinterleave(interleaved.data(), static_cast<size_t>(numFrames),
+                                                                       numChannels, channels.getArrayOfWritePointers());
+
+        auto mix = mixLanes(channels, infos, false, rate, static_cast<double>(firstFrame) / rate, outputStartFrame / rate,
+                            outputEndFrame - outputStartFrame);
+        onExtended(std::move(mix), outputStartFrame, toFrame, rate, replace, generation);
+    });
+}
+
+void AudioPlayer::onExtended(juce::AudioBuffer<float> mix, int outputStart, juce::int64 numSourceFrames, double sampleRate,
+                             bool replace, int generation)
+{
+    if (shuttingDown)
+    {
+        extending = false;
         return;
     }
-    
+
+    juce::MessageManager::callAsync([this, mix = std::move(mix), outputStart, numSourceFrames, sampleRate, replace, generation]()
+    {
+        extending = false;
+        if (shuttingDown || loadGeneration != generation || usingProxy || usingPreroll)
+            return;
+
+        const int newLength = outputStart + mix.getNumSamples();
+        const int keep = replace ? 0 : std::min(outputStart, audioBuffer.getNumSamples());
+        const bool inStorage = !replace && audioBuffer.getNumChannels() == 2 && extensionStorage.getNumChannels() == 2
+                            && audioBuffer.getReadPointer(0) == extensionStorage.getReadPointer(0);
+
+        if (inStorage && extensionStorage.getNumSamples() >= newLength)
+        {
+            // Room to spare: the re-mixed overlap is being played, so it's
+            // written under the lock along with the new stretch
+            juce::ScopedLock sl(lock);
+            for (int ch = 0; ch < 2; ++ch)
+                extensionStorage.copyFrom(ch, outputStart, mix, ch, 0, mix.getNumSamples());
+            audioBuffer.setDataToReferTo(extensionStorage.getArrayOfWritePointers(), 2, newLength);
+        }
+        else
+        {
+            // Only this thread writes audioBuffer, so it can be copied from
+            // without the lock; the old storage goes once nothing refers to it
+            juce::AudioBuffer<float> storage(2, newLength + newLength / 2);
+            storage.clear();
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                if (keep > 0)
+                    storage.copyFrom(ch, 0, audioBuffer, ch, 0, keep);
+                storage.copyFrom(ch, outputStart, mix, ch, 0, mix.getNumSamples());
+            }
+
+            juce::ScopedLock sl(lock);
+            std::swap(extensionStorage, storage);
+            audioBuffer.setDataToReferTo(extensionStorage.getArrayOfWritePointers(), 2, newLength);
+            if (replace)
+            {
+                readPosition = 0.0;
+                currentSampleRate = sampleRate;
+                bufferStartSeconds = 0.0;
+            }
+        }
+
+        loadedSourceFrames = numSourceFrames;
+        if (replace)
+            setLoadState(LoadState::Ready);
+    });
+}
+
+void AudioPlayer::play()
+{
+    if (looping && isLoopReady())
+    {
+        // From the paused position if it's inside the region, else its start
+        juce::ScopedLock sl(lock);
+        loopPosition = (resumeSeconds - loopBufferStartSeconds) * loopSampleRate;
+        if (loopPosition < 0.0 || loopPosition >= loopBuffer.getNumSamples())
+            loopPosition = 0.0;
+    }
+    else if (loadState == LoadState::Ready && !usingPreroll)
     {
         juce::ScopedLock sl(lock);
         if (audioBuffer.getNumSamples() == 0)
@@ -330,7 +637,15 @@ void AudioPlayer::play()
             DBG("AudioPlayer: Cannot play - buffer empty");
             return;
         }
-        readPosition = 0;
+
+        readPosition = (resumeSeconds - bufferStartSeconds) * currentSampleRate;
+        if (readPosition < 0.0 || readPosition >= audioBuffer.getNumSamples())
+            readPosition = 0.0;
+    }
+    else if (!(loadState == LoadState::Loading && startFromPreroll()))
+    {
+        DBG("AudioPlayer: Cannot play - audio not ready");
+        return;
     }
     
     playing = true;
@@ -339,7 +654,36 @@ void AudioPlayer::play()
     DBG("AudioPlayer: Playback started");
 }
 
+void AudioPlayer::pause()
+{
+    if (!playing)
+        return;
+
+    {
+        juce::ScopedLock sl(lock);
+        resumeSeconds = getPositionSecondsLocked();
+    }
+
+    halt();
+
+    // Decode around the new position so playing again after a reload
+    // doesn't have to wait either
+    if (prerollCache != nullptr && !currentInfos.empty())
+    {
+        const auto& info = currentInfos.front();
+        prerollCache->prefetchAround({ juce::File(info.sourceFilePath), info.streamIndex, info.totalChannels,
+                                       info.sampleRate, info.sampleFormat, info.bitsPerRawSample },
+                                     resumeSeconds);
+    }
+}
+
 void AudioPlayer::stop()
+{
+    resumeSeconds = 0.0;
+    halt();
+}
+
+void AudioPlayer::halt()
 {
     if (playing)
     {
@@ -349,61 +693,430 @@ void AudioPlayer::stop()
     }
 }
 
-void AudioPlayer::prepareToPlay(int /*samplesPerBlockExpected*/, double /*sampleRate*/)
+bool AudioPlayer::canPlay() const
 {
-    // Audio is pre-decoded, nothing to prepare
+    return (isReady() && !usingPreroll) || (looping && isLoopReady()) || (isLoading() && findPreroll() != nullptr);
 }
 
-void AudioPlayer::releaseResources()
+double AudioPlayer::getPositionSeconds() const
 {
-    // Nothing to release
+    juce::ScopedLock sl(lock);
+    return playing || shuttling ? getPositionSecondsLocked() : resumeSeconds;
 }
 
-void AudioPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+void AudioPlayer::setShuttleRate(double rate)
 {
-    bufferToFill.clearActiveBufferRegion();
+    if (!shuttling)
+    {
+        // Needs the whole stream: pre-roll only covers a few seconds
+        if (!isReady() || usingPreroll)
+            return;
+
+        playAfterShuttle = playing;
+        const double start = getPositionSeconds();
+        halt();
+
+        juce::ScopedLock sl(lock);
+        readPosition = juce::jlimit(0.0, static_cast<double>(std::max(0, audioBuffer.getNumSamples() - 1)),
+                                    (start - bufferStartSeconds) * currentSampleRate);
+        shuttleRate = 0.0;
+        shuttling = true;
+    }
+
+    shuttleTarget = juce::jlimit(-kMaxShuttleRate, kMaxShuttleRate, rate);
+}
+
+void AudioPlayer::endShuttle()
+{
+    if (!shuttling)
+        return;
+
+    {
+        juce::ScopedLock sl(lock);
+        shuttling = false;
+        resumeSeconds = bufferStartSeconds + readPosition / currentSampleRate;
+    }
+
+    if (playAfterShuttle)
+        play();
+}
+
+void AudioPlayer::setLoopRegion(double startSeconds, double endSeconds)
+{
+    startSeconds = std::max(0.0, startSeconds);
+    if (endSeconds - startSeconds < kMinLoopSeconds)
+    {
+        clearLoopRegion();
+        return;
+    }
 
-    if (!playing || loadState != LoadState::Ready)
+    if (startSeconds == loopStartSeconds && endSeconds == loopEndSeconds)
         return;
 
+    loopStartSeconds = startSeconds;
+    loopEndSeconds = endSeconds;
+    reloadLoop();
+}
+
+void AudioPlayer::clearLoopRegion()
+{
+    loopStartSeconds = loopEndSeconds = 0.0;
+    reloadLoop();
+}
+
+void AudioPlayer::setLooping(bool shouldLoop)
+{
     juce::ScopedLock sl(lock);
-    
-    if (audioBuffer.getNumSamples() == 0)
+    if (shouldLoop == looping)
         return;
-    
-    int numSamples = bufferToFill.numSamples;
-    int availableSamples = audioBuffer.getNumSamples() - readPosition;
-    int samplesToRead = std::min(numSamples, availableSamples);
 
-    if (samplesToRead <= 0)
+    // Carry on from the same time in whichever buffer takes over
+    const double seconds = getPositionSecondsLocked();
+    looping = shouldLoop;
+
+    if (shouldLoop)
+    {
+        loopPosition = (seconds - loopBufferStartSeconds) * loopSampleRate;
+        if (loopPosition < 0.0 || loopPosition >= loopBuffer.getNumSamples())
+            loopPosition = 0.0;
+    }
+    else
+    {
+        readPosition = std::max(0.0, (seconds - bufferStartSeconds) * currentSampleRate);
+    }
+}
+
+void AudioPlayer::reloadLoop()
+{
+    const int generation = ++loopGeneration;
+
+    loopSource.reset();
+    {
+        juce::ScopedLock sl(lock);
+        loopBuffer.setSize(2, 0);
+    }
+
+    if (loopEndSeconds > loopStartSeconds && !currentInfos.empty())
+        decodeLoopAsync(currentInfos, loopStartSeconds, loopEndSeconds, generation);
+
+    listeners.call([](Listener& l) { l.loopRegionChanged(); });
+}
+
+void AudioPlayer::decodeLoopAsync(std::vector<DecodeInfo> infos, double startSeconds, double endSeconds, int generation)
+{
+    juce::String ffmpegPath = ffmpegLocator.getFFmpegPath().getFullPathName();
+
+    juce::Thread::launch([this, infos = std::move(infos), ffmpegPath, startSeconds, endSeconds, generation]()
     {
-        // End of audio
-        juce::MessageManager::callAsync([this]()
+        const auto& info = infos.front();
+        const double leadIn = std::min(startSeconds, kLoopCrossfadeSeconds);
+        const auto range = getSourceRange(infos, startSeconds - leadIn, endSeconds);
+        if (range.isEmpty())
+            return;
+
+        const PrerollCache::Stream stream{ juce::File(info.sourceFilePath), info.streamIndex, info.totalChannels,
+                                           info.sampleRate, info.sampleFormat, info.bitsPerRawSample };
+
+        auto segment = PrerollCache::decodeSegment(ffmpegPath, stream, range.getStart(), range.getLength(), shuttingDown);
+        if (segment == nullptr || shuttingDown || loopGeneration != generation)
+            return;
+
+        auto source = std::make_shared<LoopSource>();
+        source->sourceFilePath = info.sourceFilePath;
+        source->streamIndex = info.streamIndex;
+        source->startSeconds = startSeconds;
+        source->endSeconds = endSeconds;
+        source->leadInSeconds = leadIn;
+        source->sourceRange = range;
+        source->sampleRate = segment->sampleRate;
+        source->channels = std::move(segment->audio);
+
+        juce::MessageManager::callAsync([this, source = std::move(source), generation]() mutable
         {
-            stop();
+            if (shuttingDown || loopGeneration != generation)
+                return;
+
+            loopSource = std::move(source);
+            remixLoop();
+            listeners.call([](Listener& l) { l.loopRegionChanged(); });
         });
+    });
+}
+
+void AudioPlayer::remixLoop()
+{
+    if (loopSource == nullptr)
         return;
+
+    const double rate = loopSource->sampleRate;
+    const int leadInFrames = juce::roundToInt(loopSource->leadInSeconds * rate);
+    const int numFrames = leadInFrames + juce::roundToInt((loopSource->endSeconds - loopSource->startSeconds) * rate);
+    auto mix = mixLanes(loopSource->channels, currentInfos, false, rate, loopSource->sourceRange.getStart(),
+                        loopSource->startSeconds - loopSource->leadInSeconds, numFrames);
+    auto loop = makeLoopBuffer(mix, leadInFrames);
+
+    juce::ScopedLock sl(lock);
+
+    // Keeps the place when re-mixed mid-loop
+    const double seconds = getPositionSecondsLocked();
+    loopBuffer = std::move(loop);
+    loopSampleRate = loopSource->sampleRate;
+    loopBufferStartSeconds = loopSource->startSeconds;
+    loopPosition = (seconds - loopBufferStartSeconds) * loopSampleRate;
+    if (loopPosition < 0.0 || loopPosition >= loopBuffer.getNumSamples())
+        loopPosition = 0.0;
+}
+
+std::shared_ptr<const PrerollCache::Segment> AudioPlayer::findPreroll() const
+{
+    if (prerollCache == nullptr || currentInfos.empty())
+        return nullptr;
+
+    const auto& info = currentInfos.front();
+    return prerollCache->find(juce::File(info.sourceFilePath), info.streamIndex, resumeSeconds);
+}
+
+bool AudioPlayer::startFromPreroll()
+{
+    auto segment = findPreroll();
+    if (segment == nullptr)
+        return false;
+
+    // Lanes whose edits move them outside the segment are silent here
+    auto stereo = mixLanes(segment->audio, currentInfos, false, segment->sampleRate, segment->startSeconds,
+                           segment->startSeconds, segment->audio.getNumSamples());
+
+    juce::ScopedLock sl(lock);
+    audioBuffer = std::move(stereo);
+    currentSampleRate = segment->sampleRate;
+    bufferStartSeconds = segment->startSeconds;
+    readPosition = (resumeSeconds - segment->startSeconds) * segment->sampleRate;
+    usingPreroll = true;
+    return true;
+}
+
+juce::AudioBuffer<float> AudioPlayer::mixLanes(const juce::AudioBuffer<float>& channels, const std::vector<DecodeInfo>& lanes,
+                                               bool channelPerLane, double rate, double sourceStart, double outputStart,
+                                               int numFrames)
+{
+    juce::AudioBuffer<float> stereoBuffer(2, numFrames);
+    stereoBuffer.clear();
+
+    auto frames = [rate](double seconds) { return static_cast<juce::int64>(std::llround(seconds * rate)); };
+
+    const int numLanes = static_cast<int>(lanes.size());
+    for (int i = 0; i < numLanes; ++i)
+    {
+        const auto& lane = lanes[static_cast<size_t>(i)];
+        int srcChannel = channelPerLane ? i : lane.channelIndex;
+        if (srcChannel >= channels.getNumChannels())
+            continue;
+
+        // Output frame f plays channels frame f + shift, from the in-point
+        // up to the out-point
+        const auto shift = frames(outputStart - lane.offset + lane.inPoint - sourceStart);
+        const auto first = std::max<juce::int64>({ 0, -shift, frames(lane.inPoint - sourceStart) - shift });
+        auto end = std::min<juce::int64>(numFrames, channels.getNumSamples() - shift);
+        if (lane.outPoint > 0.0)
+            end = std::min(end, frames(lane.outPoint - sourceStart) - shift);
+        if (end <= first)
+            continue;
+
+        const auto [leftGain, rightGain] = panGains(i, numLanes);
+
+        // Mix this channel into stereo output
+        const auto start = static_cast<int>(first);
+        const auto count = static_cast<int>(end - first);
+        stereoBuffer.addFrom(0, start, channels, srcChannel, static_cast<int>(first + shift), count, leftGain);
+        stereoBuffer.addFrom(1, start, channels, srcChannel, static_cast<int>(first + shift), count, rightGain);
     }
 
-    // Copy audio to output buffer
-    for (int ch = 0; ch < bufferToFill.buffer->getNumChannels() && ch < 2; ++ch)
+    return stereoBuffer;
+}
+
+float AudioPlayer::computeMixGain(const std::vector<Lane*>& lanes)
+{
+    // Where the lanes' peaks land in the output, block by block
+    std::vector<std::shared_ptr<LoudnessData>> edited;
+    for (auto* lane : lanes)
+    {
+        if (lane->loudness == nullptr)
+            return 1.0f;
+        edited.push_back(LoudnessMeter::edit(*lane->loudness, lane->inPoint, lane->outPoint, lane->offset, 0.0));
+    }
+
+    // Lanes measured before block peaks were kept count their overall peak everywhere
+    std::vector<float> left, right;
+    float flatLeft = 0.0f, flatRight = 0.0f;
+    const int numLanes = static_cast<int>(lanes.size());
+    for (int i = 0; i < numLanes; ++i)
+    {
+        const auto [leftGain, rightGain] = panGains(i, numLanes);
+        const auto& lane = *edited[static_cast<size_t>(i)];
+        if (lane.blockSamplePeaks.empty())
+        {
+            flatLeft += lane.samplePeak * leftGain;
+            flatRight += lane.samplePeak * rightGain;
+            continue;
+        }
+
+        if (left.size() < lane.blockSamplePeaks.size())
+        {
+            left.resize(lane.blockSamplePeaks.size(), 0.0f);
+            right.resize(lane.blockSamplePeaks.size(), 0.0f);
+        }
+        for (size_t b = 0; b < lane.blockSamplePeaks.size(); ++b)
+        {
+            left[b] += lane.blockSamplePeaks[b] * leftGain;
+            right[b] += lane.blockSamplePeaks[b] * rightGain;
+        }
+    }
+
+    float peak = std::max(flatLeft, flatRight);
+    for (size_t b = 0; b < left.size(); ++b)
+        peak = std::max({ peak, left[b] + flatLeft, right[b] + flatRight });
+
+    return peak > 1.0f ? 0.9f / peak : 1.0f;
+}
+
+void AudioPlayer::updateMixGain(const std::vector<Lane*>& lanes)
+{
+    mixGain = computeMixGain(lanes);
+}
+
+int AudioPlayer::getEditedLength(const std::vector<DecodeInfo>& lanes, int numSourceFrames, double rate)
+{
+    const double sourceEnd = numSourceFrames / rate;
+    double length = 0.0;
+    for (const auto& lane : lanes)
+    {
+        const double end = lane.outPoint > 0.0 ? std::min(lane.outPoint, sourceEnd) : sourceEnd;
+        length = std::max(length, lane.offset + end - lane.inPoint);
+    }
+    return juce::roundToInt(length * rate);
+}
+
+juce::Range<double> AudioPlayer::getSourceRange(const std::vector<DecodeInfo>& lanes, double outputStart, double outputEnd)
+{
+    // Output time t plays source time t - offset + inPoint
+    juce::Range<double> range;
+    for (const auto& lane : lanes)
+    {
+        double start = std::max(lane.inPoint, outputStart - lane.offset + lane.inPoint);
+        double end = outputEnd - lane.offset + lane.inPoint;
+        if (lane.outPoint > 0.0)
+            end = std::min(end, lane.outPoint);
+        if (end <= start)
+            continue;
+
+        range = range.isEmpty() ? juce::Range<double>(start, end) : range.getUnionWith({ start, end });
+    }
+    return range;
+}
+
+double AudioPlayer::getPositionSecondsLocked() const
+{
+    if (looping && loopBuffer.getNumSamples() > 0 && !shuttling)
+        return loopBufferStartSeconds + loopPosition / loopSampleRate;
+    return bufferStartSeconds + readPosition / currentSampleRate;
+}
+
+void AudioPlayer::prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate)
+{
+    // Audio is pre-decoded; only the resampling ratio depends on the device
+    juce::ScopedLock sl(lock);
+    deviceSampleRate = sampleRate > 0.0 ? sampleRate : 48000.0;
+}
+
+void AudioPlayer::releaseResources()
+{
+    // Nothing to release
+}
+
+void AudioPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    bufferToFill.clearActiveBufferRegion();
+
+    if (!playing && !shuttling)
+        return;
+
+    juce::ScopedLock sl(lock);
+
+    const int numOutputChannels = std::min(bufferToFill.buffer->getNumChannels(), 2);
+
+    if (shuttling)
+    {
+        renderShuttle(bufferToFill, numOutputChannels);
+    }
+    else if (looping && loopBuffer.getNumSamples() > 0)
     {
-        bufferToFill.buffer->copyFrom(
-            ch,
-            bufferToFill.startSample,
-            audioBuffer,
-            ch,
-            readPosition,
-            samplesToRead);
+        render(loopBuffer, loopPosition, loopSampleRate / deviceSampleRate, true,
+               *bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples, numOutputChannels);
     }
+    else
+    {
+        if ((loadState != LoadState::Ready && !usingPreroll) || audioBuffer.getNumSamples() == 0)
+            return;
 
-    readPosition += samplesToRead;
+        if (readPosition >= audioBuffer.getNumSamples())
+        {
+            // Past the pre-roll: hold in silence until the decode takes over
+            if (usingPreroll)
+                return;
+
+            // End of audio
+            juce::MessageManager::callAsync([this]()
+            {
+                stop();
+            });
+            return;
+        }
+
+        render(audioBuffer, readPosition, currentSampleRate / deviceSampleRate, false,
+               *bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples, numOutputChannels);
+    }
+
+    // Ramped, so a new gain (lanes measured or edited) doesn't click
+    const float gain = mixGain;
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+        bufferToFill.buffer->applyGainRamp(ch, bufferToFill.startSample, bufferToFill.numSamples, appliedMixGain, gain);
+    appliedMixGain = gain;
 
     // Notify position change
-    double positionSec = static_cast<double>(readPosition) / currentSampleRate;
+    double positionSec = getPositionSecondsLocked();
     listeners.call([positionSec](Listener& l) { l.playbackPositionChanged(positionSec); });
 }
 
+void AudioPlayer::renderShuttle(const juce::AudioSourceChannelInfo& bufferToFill, int numOutputChannels)
+{
+    const int length = audioBuffer.getNumSamples();
+    if (length == 0)
+        return;
+
+    const double target = shuttleTarget;
+    const double rateStep = (target - shuttleRate) / bufferToFill.numSamples;
+    const double ratio = currentSampleRate / deviceSampleRate;
+    const double lastSample = static_cast<double>(length - 1);
+
+    for (int i = 0; i < bufferToFill.numSamples; ++i)
+    {
+        shuttleRate += rateStep;
+
+        // Near standstill the held sample would be a DC step, so fade it
+        const auto gain = static_cast<float>(std::min(1.0, std::abs(shuttleRate) * 4.0));
+        const auto index = static_cast<int>(readPosition);
+        const auto frac = static_cast<float>(readPosition - index);
+        for (int ch = 0; ch < numOutputChannels; ++ch)
+            bufferToFill.buffer->setSample(ch, bufferToFill.startSample + i,
+                                           gain * interpolate(audioBuffer.getReadPointer(ch), length, index, frac, false));
+
+        // Holds at either end until the direction changes
+        readPosition = juce::jlimit(0.0, lastSample, readPosition + shuttleRate * ratio);
+    }
+
+    shuttleRate = target;
+}
+
 void AudioPlayer::addListener(Listener* listener)
 {
     listeners.add(listener);
@@ -10,7 +10,10 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_devices/juce_audio_devices.h>
 #include "../model/ProjectModel.h"
+#include "../model/ProgressTracker.h"
 #include "../ffmpeg/FFmpegLocator.h"
+#include "ProxyCache.h"
+#include "PrerollCache.h"
 
 class AudioPlayer : public juce::AudioSource
 {
@@ -23,7 +26,12 @@ public:
         Error       // Loading failed
     };
 
-    AudioPlayer(FFmpegLocator& locator);
+    // With a proxy cache, playback can start from a cached proxy while the
+    // full quality decode runs; with a pre-roll cache, from the decoded
+    // seconds around the play position before either is ready. Full
+    // decodes are reported to 'progress' (may be null).
+    AudioPlayer(FFmpegLocator& locator, ProxyCache* proxyCache = nullptr, PrerollCache* prerollCache = nullptr,
+                ProgressTracker* progress = nullptr);
     ~AudioPlayer() override;
 
     // Setup audio device
@@ -32,15 +40,58 @@ public:
 
     // Playback control
     void loadLanes(const std::vector<Lane*>& lanes);
-    void play();
-    void stop();
+
+    // Recompute the playback gain from the lanes' stored peaks, e.g. once
+    // their measurements arrive. Message thread.
+    void updateMixGain(const std::vector<Lane*>& lanes);
+
+    void play();                  // From the paused position, else the start
+    void pause();                 // Stop, keeping the position
+    void stop();                  // Stop and rewind
     bool isPlaying() const { return playing; }
+    bool isPaused() const { return !playing && resumeSeconds > 0.0; }
+
+    // Follow imports: pick up source frames written to a growing WAV since
+    // it was loaded (see GrowingWavFile), mixing only the new stretch and
+    // appending it to the playback buffer. Nothing happens while a proxy or
+    // pre-roll is playing or another extension is in flight. Message thread.
+    void extendLoadedSource();
+
+    // Ready, or still loading but with pre-roll or loop audio to play
+    bool canPlay() const;
+
+    // Current play position, or where play would resume from
+    double getPositionSeconds() const;
+
+    // Loop region: decoded once for every channel of the source stream, so
+    // lane edits only re-mix it. The end crossfades into the audio just
+    // before the start, so the wrap is seamless.
+    static constexpr double kLoopCrossfadeSeconds = 0.01;
+    static constexpr double kMinLoopSeconds = 0.1;
+    void setLoopRegion(double startSeconds, double endSeconds);
+    void clearLoopRegion();
+    void setLooping(bool shouldLoop);
+    bool isLooping() const { return looping; }
+    bool isLoopReady() const { return loopBuffer.getNumSamples() > 0; }
+
+    // Shuttle: play the loaded audio at 'rate' times speed, negative for
+    // reverse, until endShuttle(). The first call starts from the play
+    // position; the rate glides to each new value over one audio block.
+    // endShuttle() leaves the position where shuttling got to, playing on
+    // if playback was running before.
+    static constexpr double kMaxShuttleRate = 4.0;
+    void setShuttleRate(double rate);
+    void endShuttle();
+    bool isShuttling() const { return shuttling; }
     
     // Loading state
     LoadState getLoadState() const { return loadState.load(); }
     bool isReady() const { return loadState.load() == LoadState::Ready; }
     bool isLoading() const { return loadState.load() == LoadState::Loading; }
 
+    // True while playing from a proxy, before the full quality audio arrives
+    bool isUsingProxy() const { return usingProxy.load(); }
+
     // AudioSource interface
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
     void releaseResources() override;
@@ -55,6 +106,7 @@ public:
         virtual void playbackStopped() = 0;
         virtual void playbackPositionChanged(double positionSeconds) = 0;
         virtual void loadStateChanged(LoadState newState) = 0;
+        virtual void loopRegionChanged() = 0;
     };
 
     void addListener(Listener* listener);
@@ -69,26 +121,119 @@ private:
         int channelIndex = 0;
         int totalChannels = 0;
         double sampleRate = 48000.0;
+        juce::String sampleFormat;    // ffprobe sample_fmt, picks the pipe format
+        int bitsPerRawSample = 0;
+        double offset = 0.0;          // Lane edit, see Lane
+        double inPoint = 0.0;
+        double outPoint = 0.0;
+    };
+
+    // Equal-power stereo mix of the lanes, spread left to right in lane
+    // order, each shifted and trimmed by its edit. 'channels' holds source
+    // time from sourceStart at 'rate'; the mix covers output time from
+    // outputStart for numFrames. With channelPerLane, channel i holds lane
+    // i rather than source channel channelIndex. Not normalised: every
+    // stretch of the mix gets the same mixGain on playback.
+    static juce::AudioBuffer<float> mixLanes(const juce::AudioBuffer<float>& channels, const std::vector<DecodeInfo>& lanes,
+                                             bool channelPerLane, double rate, double sourceStart, double outputStart,
+                                             int numFrames);
+
+    // Gain keeping the lanes' mix below full scale: per 100 ms block, the
+    // panned lanes' stored sample peaks added up. 1 until every lane has
+    // been measured.
+    static float computeMixGain(const std::vector<Lane*>& lanes);
+
+    // Output frames until the last lane ends, for a whole-source buffer
+    static int getEditedLength(const std::vector<DecodeInfo>& lanes, int numSourceFrames, double rate);
+
+    // Source time the lanes need to cover output time [outputStart, outputEnd)
+    static juce::Range<double> getSourceRange(const std::vector<DecodeInfo>& lanes, double outputStart, double outputEnd);
+
+    // Every channel of the stream over the source time the lanes play from
+    // up to kLoopCrossfadeSeconds before the region start (the lead-in) to
+    // its end
+    struct LoopSource
+    {
+        juce::String sourceFilePath;
+        int streamIndex = 0;
+        double startSeconds = 0.0;             // Region, output time
+        double endSeconds = 0.0;
+        double leadInSeconds = 0.0;
+        juce::Range<double> sourceRange;       // What 'channels' holds, source time
+        double sampleRate = 48000.0;
+        juce::AudioBuffer<float> channels;
     };
 
     void decodeAudioAsync(std::vector<DecodeInfo> infos, juce::String ffmpeg, int generation);
+    void decodeLoopAsync(std::vector<DecodeInfo> infos, double startSeconds, double endSeconds, int generation);
+    void reloadLoop();
+    void remixLoop();
+    void renderShuttle(const juce::AudioSourceChannelInfo& bufferToFill, int numOutputChannels);
+    std::shared_ptr<const PrerollCache::Segment> findPreroll() const;
+    bool startFromPreroll();
+    void halt();
+    double getPositionSecondsLocked() const;
     void setLoadState(LoadState newState);
-    void onDecodeComplete(juce::AudioBuffer<float> buffer, double sampleRate, int generation);
+    void onDecodeComplete(juce::AudioBuffer<float> buffer, double sampleRate, int generation, bool isProxy,
+                          juce::int64 numSourceFrames = 0);
+    void onExtended(juce::AudioBuffer<float> mix, int outputStart, juce::int64 numSourceFrames, double sampleRate,
+                    bool replace, int generation);
     void onDecodeError(int generation);
 
     FFmpegLocator& ffmpegLocator;
+    ProxyCache* proxyCache;
+    PrerollCache* prerollCache;
+    ProgressTracker* progress;
     juce::AudioDeviceManager deviceManager;
     juce::AudioSourcePlayer audioSourcePlayer;
 
-    // Decoded audio buffer (stereo)
+    // Decoded audio buffer (stereo) at currentSampleRate, resampled to the
+    // device rate on playback
     juce::AudioBuffer<float> audioBuffer;
-    int readPosition = 0;
+    double readPosition = 0.0;    // In buffer samples
     std::atomic<bool> playing{ false };
+    std::atomic<bool> usingProxy{ false };
+    std::atomic<bool> usingPreroll{ false };   // Holds at the end until the decode lands
+    double bufferStartSeconds = 0.0;           // Source time of audioBuffer's first sample
     std::atomic<LoadState> loadState{ LoadState::Empty };
     std::atomic<int> loadGeneration{ 0 };  // Incremented on each load to cancel stale decodes
     std::atomic<bool> shuttingDown{ false };  // Flag to prevent callbacks during shutdown
 
+    // Keeps the whole mix below full scale; set from the lanes' stored
+    // peaks (computeMixGain), ramped to on the audio thread
+    std::atomic<float> mixGain{ 1.0f };
+    float appliedMixGain = 1.0f;              // Audio thread
+
     double currentSampleRate = 48000.0;
+    double deviceSampleRate = 48000.0;
+
+    // Message thread only
+    std::vector<DecodeInfo> currentInfos;
+    juce::int64 loadedSourceFrames = 0;        // Source frames behind a full quality audioBuffer
+    std::atomic<bool> extending{ false };
+
+    // What audioBuffer refers to once extended: capacity grows
+    // geometrically, so each extension copies only the new stretch
+    juce::AudioBuffer<float> extensionStorage;
+    double resumeSeconds = 0.0;
+    double loopStartSeconds = 0.0;             // Equal start and end: no region
+    double loopEndSeconds = 0.0;
+    std::shared_ptr<const LoopSource> loopSource;
+    std::atomic<int> loopGeneration{ 0 };
+
+    // Loop playback, guarded by lock (written on the message thread)
+    std::atomic<bool> looping{ false };
+    juce::AudioBuffer<float> loopBuffer;       // Stereo loop body, crossfade baked into its tail
+    double loopSampleRate = 48000.0;
+    double loopBufferStartSeconds = 0.0;
+    double loopPosition = 0.0;                 // In loop buffer samples
+
+    // Shuttle over audioBuffer: target set on the message thread, the
+    // current rate glides towards it on the audio thread
+    std::atomic<bool> shuttling{ false };
+    std::atomic<double> shuttleTarget{ 0.0 };
+    double shuttleRate = 0.0;
+    bool playAfterShuttle = false;             // Message thread only
 
     juce::ListenerList<Listener> listeners;
     juce::CriticalSection lock;
@@ -0,0 +1,578 @@
+/*
+    ChannelStacker - Block Cache Implementation
+*/
+
+#include "BlockCache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace
+{
+    class StreamReader : public BlockCache::FileReader
+    {
+    public:
+        explicit StreamReader(const juce::File& file) : stream(file) {}
+
+        bool openedOk() const { return stream.openedOk(); }
+
+        size_t readAt(int64_t offset, void* dest, size_t numBytes) override
+        {
+            if (!stream.setPosition(offset))
+                return 0;
+
+            auto* bytes = static_cast<char*>(dest);
+            size_t total = 0;
+            while (total < numBytes)
+            {
+                const int chunk = static_cast<int>(std::min<size_t>(numBytes - total, 1 << 30));
+                const int numRead = stream.read(bytes + total, chunk);
+                if (numRead <= 0)
+                    break;
+                total += static_cast<size_t>(numRead);
+            }
+            return total;
+        }
+
+    private:
+        juce::FileInputStream stream;
+    };
+
+    std::unique_ptr<BlockCache::FileReader> openStreamReader(const juce::File& file)
+    {
+        auto reader = std::make_unique<StreamReader>(file);
+        if (!reader->openedOk())
+            return nullptr;
+        return reader;
+    }
+}
+
+BlockCache& BlockCache::getInstance()
+{
+    std::lock_guard<std::mutex> guard(instanceLock);
+    if (instance == nullptr)
+        instance = new BlockCache();
+    return *instance;
+}
+
+BlockCache::BlockCache(ReaderFactory factory, size_t budget)
+    : readerFactory(factory ? std::move(factory) : ReaderFactory(openStreamReader)),
+      memoryBudget(budget)
+{
+}
+
+BlockCache::~BlockCache()
+{
+    std::lock_guard<std::mutex> guard(instanceLock);
+    if (instance == this)
+        instance = nullptr;
+}
+
+BlockCache::CachedFile& BlockCache::getFile(const juce::File& file)
+{
+    auto& cached = files[file.getFullPathName()];
+    if (cached == nullptr)
+    {
+        cached = std::make_unique<CachedFile>();
+        cached->file = file;
+    }
+    return *cached;
+}
+
+void BlockCache::revalidate(std::unique_lock<std::mutex>& guard, CachedFile& cached)
+{
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    if (cached.size >= 0 && now - cached.checkedMs < kRevalidateMs)
+        return;
+    cached.checkedMs = now;
+
+    // On a NAS mount a stat costs about as much as a read
+    guard.unlock();
+    const auto modified = cached.file.getLastModificationTime();
+    const int64_t size = cached.file.getSize();
+    const auto identifier = cached.file.getFileIdentifier();
+    guard.lock();
+
+    // Followed files change by growing in place, which keeps what's cached;
+    // anything else is different contents under the same path
+    const bool sameFile = identifier == cached.identifier;
+    const bool grown = sameFile && size > cached.size;
+    const bool unchanged = sameFile && size == cached.size && modified == cached.modified;
+    if (cached.size >= 0 && !grown && !unchanged)
+        invalidateLocked(cached);
+
+    cached.modified = modified;
+    cached.size = size;
+    cached.identifier = identifier;
+}
+
+void BlockCache::releaseLocked(CachedFile& cached)
+{
+    --cached.users;
+    dropIfUnusedLocked(cached);
+}
+
+void BlockCache::dropIfUnusedLocked(CachedFile& cached)
+{
+    if (cached.users == 0 && cached.blocks.empty())
+        files.erase(cached.file.getFullPathName());
+}
+
+int64_t BlockCache::noteAccess(CachedFile& cached, int64_t firstBlock, int64_t lastBlock)
+{
+    ++accessCounter;
+
+    // Carrying on from where a stream left off (or still inside its last block)
+    for (auto& stream : cached.streams)
+    {
+        if (stream.lastBlock < 0 || firstBlock < stream.lastBlock || firstBlock > stream.lastBlock + 1)
+            continue;
+
+        const int64_t minBlocks = static_cast<int64_t>(kMinReadAheadBytes / kBlockBytes);
+        const int64_t maxBlocks = static_cast<int64_t>(std::min(kMaxReadAheadBytes, memoryBudget / 4) / kBlockBytes);
+        if (lastBlock > stream.lastBlock)
+            stream.windowBlocks = std::min(maxBlocks, std::max(minBlocks, stream.windowBlocks * 2));
+
+        stream.lastBlock = std::max(stream.lastBlock, lastBlock);
+        stream.lastUse = accessCounter;
+        return stream.windowBlocks;
+    }
+
+    // A new stream (or a seek) takes over the least recently used slot and
+    // earns read-ahead once it proves sequential
+    auto& oldest = *std::min_element(cached.streams.begin(), cached.streams.end(),
+                                     [](const Stream& a, const Stream& b) { return a.lastUse < b.lastUse; });
+    oldest = { lastBlock, 0, accessCounter };
+    return 0;
+}
+
+size_t BlockCache::fetch(CachedFile& cached, int64_t firstBlock, int64_t endBlock, uint64_t generation,
+                         juce::HeapBlock<char>& run)
+{
+    const size_t runBytes = static_cast<size_t>(endBlock - firstBlock) * kBlockBytes;
+    run.malloc(runBytes);
+
+    // A file replaced since the handle was opened needs a new one
+    std::lock_guard<std::mutex> guard(cached.readerLock);
+    if (cached.reader == nullptr || cached.readerGeneration != generation)
+    {
+        cached.reader = readerFactory(cached.file);
+        cached.readerGeneration = generation;
+    }
+    if (cached.reader == nullptr)
+        return 0;
+
+    return cached.reader->readAt(firstBlock * static_cast<int64_t>(kBlockBytes), run.getData(), runBytes);
+}
+
+void BlockCache::publish(CachedFile& cached, int64_t firstBlock, int64_t endBlock, const juce::HeapBlock<char>& run,
+                         size_t numBytes, uint64_t generation)
+{
+    ++stats.readCalls;
+    stats.bytesRead += numBytes;
+
+    // A short read marks where the file ended at the time; a longer one
+    // later (the file grew) moves it on
+    const int64_t fullBlocks = firstBlock + static_cast<int64_t>(numBytes / kBlockBytes);
+    if (numBytes < static_cast<size_t>(endBlock - firstBlock) * kBlockBytes)
+        cached.endBlock = fullBlocks;
+    else if (cached.endBlock >= 0 && fullBlocks > cached.endBlock)
+        cached.endBlock = -1;
+
+    for (int64_t index = firstBlock; index < endBlock; ++index)
+    {
+        auto it = cached.blocks.find(index);
+        if (it == cached.blocks.end() || !it->second.loading)
+            continue;
+
+        const size_t start = static_cast<size_t>(index - firstBlock) * kBlockBytes;
+        const size_t blockBytes = numBytes > start ? std::min(kBlockBytes, numBytes - start) : 0;
+        if (blockBytes == 0 || generation != cached.generation)
+        {
+            cached.blocks.erase(it);
+            continue;
+        }
+
+        auto& block = it->second;
+        block.data.malloc(blockBytes);
+        std::memcpy(block.data.getData(), run.getData() + start, blockBytes);
+        block.numBytes = blockBytes;
+        block.loading = false;
+        block.lruPosition = lru.insert(lru.begin(), { &cached, index });
+        cachedBytes += blockBytes;
+    }
+
+    blockLoaded.notify_all();
+}
+
+size_t BlockCache::read(const juce::File& file, int64_t offset, void* dest, size_t numBytes)
+{
+    if (numBytes == 0 || offset < 0)
+        return 0;
+
+    auto* out = static_cast<char*>(dest);
+    const int64_t blockSize = static_cast<int64_t>(kBlockBytes);
+    const int64_t firstBlock = offset / blockSize;
+    const int64_t lastBlock = (offset + static_cast<int64_t>(numBytes) - 1) / blockSize;
+
+    std::unique_lock<std::mutex> guard(lock);
+    CachedFile& cached = getFile(file);
+    ++cached.users;
+    revalidate(guard, cached);
+    const int64_t readAhead = noteAccess(cached, firstBlock, lastBlock);
+
+    size_t copied = 0;
+    int64_t waitedFor = -1;
+    bool endOfFile = false;
+
+    while (copied < numBytes && !endOfFile)
+    {
+        const int64_t position = offset + static_cast<int64_t>(copied);
+        const int64_t index = position / blockSize;
+        const size_t within = static_cast<size_t>(position % blockSize);
+        const size_t wanted = std::min(kBlockBytes - within, numBytes - copied);
+
+        auto it = cached.blocks.find(index);
+        if (it != cached.blocks.end() && it->second.loading)
+        {
+            // Someone else's fetch (another reader or read-ahead) covers it
+            if (waitedFor != index)
+                ++stats.coalesced;
+            waitedFor = index;
+            blockLoaded.wait(guard);
+            continue;
+        }
+
+        if (it != cached.blocks.end() && it->second.numBytes >= within + wanted)
+        {
+            std::memcpy(out + copied, it->second.data.getData() + within, wanted);
+            lru.splice(lru.begin(), lru, it->second.lruPosition);
+            if (waitedFor != index)
+                ++stats.hits;
+            copied += wanted;
+            continue;
+        }
+
+        // A short last block the file may have grown past since: fetch again
+        if (it != cached.blocks.end())
+        {
+            cachedBytes -= it->second.numBytes;
+            lru.erase(it->second.lruPosition);
+            cached.blocks.erase(it);
+        }
+
+        // One call for the whole run of missing blocks this request needs
+        int64_t runEnd = index + 1;
+        while (runEnd <= lastBlock && cached.blocks.count(runEnd) == 0)
+            ++runEnd;
+        for (int64_t i = index; i < runEnd; ++i)
+            cached.blocks[i];
+        stats.misses += static_cast<uint64_t>(runEnd - index);
+
+        const uint64_t generation = cached.generation;
+        guard.unlock();
+        juce::HeapBlock<char> run;
+        const size_t got = fetch(cached, index, runEnd, generation, run);
+        guard.lock();
+        publish(cached, index, runEnd, run, got, generation);
+
+        // Copied from the run itself, which eviction can't take away; short
+        // of what the run should have held means the file ends there
+        const size_t available = got > within ? got - within : 0;
+        const size_t wantedFromRun = std::min(static_cast<size_t>(runEnd - index) * kBlockBytes - within, numBytes - copied);
+        const size_t numFromRun = std::min(available, wantedFromRun);
+        std::memcpy(out + copied, run.getData() + within, numFromRun);
+        copied += numFromRun;
+        endOfFile = numFromRun < wantedFromRun;
+    }
+
+    if (readAhead > 0 && !endOfFile)
+        scheduleReadAhead(cached, lastBlock + 1, lastBlock + 1 + readAhead);
+
+    evictLocked();
+    releaseLocked(cached);
+    return copied;
+}
+
+void BlockCache::scheduleReadAhead(CachedFile& cached, int64_t firstBlock, int64_t endBlock)
+{
+    // Never past where the file was last seen to end
+    if (cached.endBlock >= 0)
+        endBlock = std::min(endBlock, cached.endBlock);
+
+    // Missing runs of the window become placeholders now, so readers that
+    // get there first wait for these fetches instead of starting their own
+    for (int64_t index = firstBlock; index < endBlock;)
+    {
+        if (cached.blocks.count(index) != 0)
+        {
+            ++index;
+            continue;
+        }
+
+        int64_t runEnd = index + 1;
+        while (runEnd < endBlock && cached.blocks.count(runEnd) == 0)
+            ++runEnd;
+        for (int64_t i = index; i < runEnd; ++i)
+            cached.blocks[i];
+        stats.readAheadBlocks += static_cast<uint64_t>(runEnd - index);
+
+        ++cached.users;
+        readAheadThreads.post([this, &cached, runStart = index, runEnd, generation = cached.generation]()
+        {
+            juce::HeapBlock<char> run;
+            const size_t got = fetch(cached, runStart, runEnd, generation, run);
+
+            std::lock_guard<std::mutex> guard(lock);
+            publish(cached, runStart, runEnd, run, got, generation);
+            evictLocked();
+            releaseLocked(cached);
+        });
+
+        index = runEnd;
+    }
+}
+
+void BlockCache::evictLocked()
+{
+    while (cachedBytes > memoryBudget && !lru.empty())
+    {
+        auto [cached, index] = lru.back();
+        lru.pop_back();
+
+        auto it = cached->blocks.find(index);
+        cachedBytes -= it->second.numBytes;
+        cached->blocks.erase(it);
+        ++stats.evictedBlocks;
+        dropIfUnusedLocked(*cached);
+    }
+}
+
+void BlockCache::invalidate(const juce::File& file)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = files.find(file.getFullPathName());
+    if (found == files.end())
+        return;
+
+    auto& cached = *found->second;
+    invalidateLocked(cached);
+    dropIfUnusedLocked(cached);
+}
+
+void BlockCache::invalidateLocked(CachedFile& cached)
+{
+    // Blocks still being fetched are dropped when their fetch lands
+    ++cached.generation;
+    cached.endBlock = -1;
+    for (auto it = cached.blocks.begin(); it != cached.blocks.end();)
+    {
+        if (it->second.loading)
+        {
+            ++it;
+            continue;
+        }
+
+        cachedBytes -= it->second.numBytes;
+        lru.erase(it->second.lruPosition);
+        it = cached.blocks.erase(it);
+    }
+    for (auto& stream : cached.streams)
+        stream = {};
+}
+
+void BlockCache::setMemoryBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    memoryBudget = bytes;
+    evictLocked();
+}
+
+BlockCache::Stats BlockCache::getStats() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+//==============================================================================
+
+namespace
+{
+    // Local stand-in for a NAS mount: every read waits latencyMs, then
+    // shares one link of fixed bandwidth with every other read
+    struct ThrottledStorage
+    {
+        int latencyMs = 5;
+        double bytesPerMs = 200.0 * 1024.0;
+        std::mutex link;
+        double owedMs = 0.0;          // Transfer time below the sleep resolution, carried over
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+    };
+
+    class ThrottledReader : public BlockCache::FileReader
+    {
+    public:
+        ThrottledReader(const juce::File& file, ThrottledStorage& s) : reader(file), storage(s) {}
+
+        size_t readAt(int64_t offset, void* dest, size_t numBytes) override
+        {
+            juce::Thread::sleep(storage.latencyMs);
+            const size_t numRead = reader.readAt(offset, dest, numBytes);
+
+            {
+                std::lock_guard<std::mutex> guard(storage.link);
+                storage.owedMs += static_cast<double>(numRead) / storage.bytesPerMs;
+                const int sleepMs = static_cast<int>(storage.owedMs);
+                storage.owedMs -= sleepMs;
+                juce::Thread::sleep(sleepMs);
+            }
+
+            ++storage.calls;
+            storage.bytes += numRead;
+            return numRead;
+        }
+
+    private:
+        StreamReader reader;
+        ThrottledStorage& storage;
+    };
+}
+
+juce::String BlockCache::runBenchmark(int latencyMs, double megabytesPerSecond, int fileSizeMb)
+{
+    const auto fileBytes = static_cast<int64_t>(std::max(8, fileSizeMb)) << 20;
+    auto file = juce::File::createTempFile(".blockcache");
+
+    {
+        juce::FileOutputStream out(file);
+        if (!out.openedOk())
+            return "Could not write " + file.getFullPathName();
+
+        std::vector<uint32_t> chunk(1 << 18);
+        std::mt19937 random(1);
+        for (int64_t written = 0; written < fileBytes; written += static_cast<int64_t>(chunk.size() * 4))
+        {
+            for (auto& word : chunk)
+                word = random();
+            out.write(chunk.data(), chunk.size() * 4);
+        }
+    }
+
+    // Concurrent readers modelled on the app's: waveform extraction and an
+    // export both sequential from the start with different read sizes,
+    // playback sequential from the middle, and a few scattered seeks
+    struct Consumer
+    {
+        const char* name;
+        int64_t start;
+        size_t readBytes;
+        bool random;
+    };
+
+    const Consumer consumers[] = {
+        { "waveform", 0, size_t(1) << 20, false },
+        { "export", 0, size_t(64) << 10, false },
+        { "playback", fileBytes / 2, size_t(256) << 10, false },
+        { "seeks", 0, size_t(256) << 10, true },
+    };
+    constexpr int kNumSeeks = 32;
+
+    auto runConsumers = [&](auto&& readAt)
+    {
+        std::vector<std::thread> threads;
+        bool ok = true;
+        std::mutex okLock;
+
+        for (const auto& consumer : consumers)
+        {
+            threads.emplace_back([&, consumer]()
+            {
+                std::vector<char> buffer(consumer.readBytes);
+                std::mt19937_64 random(7);
+                const int count = consumer.random ? kNumSeeks
+                                                  : static_cast<int>((fileBytes - consumer.start) / static_cast<int64_t>(consumer.readBytes));
+                for (int i = 0; i < count; ++i)
+                {
+                    const int64_t offset = consumer.random
+                        ? static_cast<int64_t>(random() % static_cast<uint64_t>(fileBytes - static_cast<int64_t>(consumer.readBytes)))
+                        : consumer.start + static_cast<int64_t>(i) * static_cast<int64_t>(consumer.readBytes);
+                    if (readAt(offset, buffer.data(), buffer.size()) != buffer.size())
+                    {
+                        std::lock_guard<std::mutex> guard(okLock);
+                        ok = false;
+                    }
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+        return ok;
+    };
+
+    juce::String report = "Block cache: " + juce::String(fileSizeMb) + " MB file, " + juce::String(latencyMs) + " ms per read, "
+                        + juce::String(megabytesPerSecond, 0) + " MB/s link; readers: waveform 1 MB, export 64 KB, "
+                        + "playback 256 KB from the middle, " + juce::String(kNumSeeks) + " seeks of 256 KB\n"
+                        + "  mode      wall s    storage reads    storage MB\n";
+
+    auto addRow = [&report](const char* mode, double seconds, uint64_t calls, uint64_t bytes, bool ok)
+    {
+        report += "  " + juce::String(mode).paddedRight(' ', 8)
+                + juce::String(seconds, 2).paddedLeft(' ', 8)
+                + juce::String(static_cast<juce::int64>(calls)).paddedLeft(' ', 17)
+                + juce::String(static_cast<double>(bytes) / (1 << 20), 1).paddedLeft(' ', 14)
+                + (ok ? "" : "  (short reads!)") + "\n";
+    };
+
+    // Direct: each reader has its own handle on the slow storage
+    {
+        ThrottledStorage storage;
+        storage.latencyMs = latencyMs;
+        storage.bytesPerMs = megabytesPerSecond * 1024.0 * 1024.0 / 1000.0;
+
+        std::mutex handlesLock;
+        std::map<std::thread::id, std::unique_ptr<ThrottledReader>> handles;
+        const double start = juce::Time::getMillisecondCounterHiRes();
+        const bool ok = runConsumers([&](int64_t offset, void* dest, size_t numBytes)
+        {
+            ThrottledReader* reader;
+            {
+                std::lock_guard<std::mutex> guard(handlesLock);
+                auto& handle = handles[std::this_thread::get_id()];
+                if (handle == nullptr)
+                    handle = std::make_unique<ThrottledReader>(file, storage);
+                reader = handle.get();
+            }
+            return reader->readAt(offset, dest, numBytes);
+        });
+        addRow("direct", (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0, storage.calls, storage.bytes, ok);
+    }
+
+    // Cached: the same readers through one cache over the same storage
+    {
+        ThrottledStorage storage;
+        storage.latencyMs = latencyMs;
+        storage.bytesPerMs = megabytesPerSecond * 1024.0 * 1024.0 / 1000.0;
+
+        BlockCache cache([&storage](const juce::File& f) { return std::make_unique<ThrottledReader>(f, storage); });
+        const double start = juce::Time::getMillisecondCounterHiRes();
+        const bool ok = runConsumers([&](int64_t offset, void* dest, size_t numBytes)
+        {
+            return cache.read(file, offset, dest, numBytes);
+        });
+        addRow("cached", (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0, storage.calls, storage.bytes, ok);
+
+        const auto stats = cache.getStats();
+        report += "  cache: " + juce::String(static_cast<juce::int64>(stats.hits)) + " block hits, "
+                + juce::String(static_cast<juce::int64>(stats.misses)) + " misses, "
+                + juce::String(static_cast<juce::int64>(stats.coalesced)) + " coalesced, "
+                + juce::String(static_cast<juce::int64>(stats.readAheadBlocks)) + " read ahead, "
+                + juce::String(static_cast<juce::int64>(stats.evictedBlocks)) + " evicted\n";
+    }
+
+    file.deleteFile();
+    return report;
+}
@@ -0,0 +1,173 @@
+/*
+    ChannelStacker - Block Cache Header
+    Shared cache of file blocks under the native readers (GrowingWavFile,
+    and through it follow imports, playback extension and the export
+    verifier's WAV sources). Sources on NAS mounts cost milliseconds per
+    read, and those readers hit the same files with different patterns:
+      - files are read in kBlockBytes blocks, each run of missing blocks
+        of a request in a single call;
+      - a reader moving sequentially gets a read-ahead window, fetched in
+        the background, that doubles up to kMaxReadAheadBytes;
+      - a block that is already being fetched is waited for, never read
+        twice, so concurrent readers of the same region share one read;
+      - blocks beyond the memory budget are evicted least recently used,
+        and a file's entry goes with its last block;
+      - a file is stat'ed again at most every kRevalidateMs, and its blocks
+        are dropped unless it is the same file or that file grown.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "../async/AsyncPrimitives.h"
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+class BlockCache : public juce::DeletedAtShutdown
+{
+public:
+    // Positional reads of one file; calls for a file are never concurrent
+    class FileReader
+    {
+    public:
+        virtual ~FileReader() = default;
+
+        // Bytes read, fewer than asked for at the end of the file
+        virtual size_t readAt(int64_t offset, void* dest, size_t numBytes) = 0;
+    };
+
+    using ReaderFactory = std::function<std::unique_ptr<FileReader>(const juce::File&)>;
+
+    struct Stats
+    {
+        uint64_t hits = 0;              // Blocks served from memory
+        uint64_t misses = 0;            // Blocks a reader had to wait for a fetch of its own
+        uint64_t coalesced = 0;         // Blocks a reader found already being fetched
+        uint64_t readAheadBlocks = 0;   // Blocks fetched ahead of any reader
+        uint64_t readCalls = 0;         // Calls into a FileReader
+        uint64_t bytesRead = 0;
+        uint64_t evictedBlocks = 0;
+    };
+
+    static constexpr size_t kBlockBytes = size_t(1) << 20;
+    static constexpr size_t kDefaultMemoryBudget = size_t(256) << 20;
+    static constexpr size_t kMinReadAheadBytes = size_t(2) << 20;
+    static constexpr size_t kMaxReadAheadBytes = size_t(32) << 20;
+    static constexpr double kRevalidateMs = 500.0;
+
+    // Shared instance over juce::FileInputStream. Safe from any thread.
+    static BlockCache& getInstance();
+
+    // Private instance, e.g. over a throttled reader for the benchmark
+    explicit BlockCache(ReaderFactory factory = {}, size_t memoryBudget = kDefaultMemoryBudget);
+    ~BlockCache() override;
+
+    // Bytes [offset, offset + numBytes) of the file into dest; fewer at
+    // its end. Blocks the file has grown into since they were cached are
+    // fetched again, so growing files read correctly; a file replaced or
+    // rewritten under the same path is read afresh.
+    size_t read(const juce::File& file, int64_t offset, void* dest, size_t numBytes);
+
+    // Forget the file's blocks (it was truncated or replaced)
+    void invalidate(const juce::File& file);
+
+    void setMemoryBudget(size_t bytes);
+    Stats getStats() const;
+
+    // Headless comparison of direct and cached reads by concurrent
+    // waveform/playback/export-style readers of one file, over a local
+    // stand-in for slow storage: latencyMs per read plus a shared link of
+    // megabytesPerSecond
+    static juce::String runBenchmark(int latencyMs, double megabytesPerSecond, int fileSizeMb);
+
+private:
+    struct CachedFile;
+    using LruList = std::list<std::pair<CachedFile*, int64_t>>;
+
+    struct Block
+    {
+        juce::HeapBlock<char> data;
+        size_t numBytes = 0;            // Short for the last block of the file
+        bool loading = true;
+        LruList::iterator lruPosition;  // Valid once loaded
+    };
+
+    // A reader moving forward through the file
+    struct Stream
+    {
+        int64_t lastBlock = -1;
+        int64_t windowBlocks = 0;
+        uint64_t lastUse = 0;
+    };
+
+    struct CachedFile
+    {
+        juce::File file;
+        std::map<int64_t, Block> blocks;
+        std::array<Stream, 4> streams;
+        int64_t endBlock = -1;          // First block not fully on disk at the last short read; -1 unknown
+        uint64_t generation = 0;        // Bumped by invalidate(); fetches from before are dropped
+        int users = 0;                  // Reads and read-ahead jobs using the entry; kept until 0
+
+        // The file as last stat'ed; size -1 until then
+        double checkedMs = 0.0;
+        juce::Time modified;
+        int64_t size = -1;
+        juce::uint64 identifier = 0;
+
+        std::mutex readerLock;          // Guards reader; held only for I/O
+        std::unique_ptr<FileReader> reader;
+        uint64_t readerGeneration = 0;
+    };
+
+    CachedFile& getFile(const juce::File& file);
+
+    // Drop the file's blocks if it changed other than by growing since
+    // the last stat; the lock is released while stat'ing
+    void revalidate(std::unique_lock<std::mutex>& guard, CachedFile& cached);
+
+    // One user done with the entry; an unused entry without blocks goes
+    void releaseLocked(CachedFile& cached);
+    void dropIfUnusedLocked(CachedFile& cached);
+
+    // Read-ahead window, in blocks, for a request over [firstBlock, lastBlock]
+    int64_t noteAccess(CachedFile& cached, int64_t firstBlock, int64_t lastBlock);
+
+    // Fetch blocks [firstBlock, endBlock) into run, unlocked; returns the bytes read
+    size_t fetch(CachedFile& cached, int64_t firstBlock, int64_t endBlock, uint64_t generation,
+                 juce::HeapBlock<char>& run);
+
+    // Hand a fetched run to the placeholders waiting for it (lock held)
+    void publish(CachedFile& cached, int64_t firstBlock, int64_t endBlock, const juce::HeapBlock<char>& run,
+                 size_t numBytes, uint64_t generation);
+
+    void scheduleReadAhead(CachedFile& cached, int64_t firstBlock, int64_t endBlock);
+    void evictLocked();
+    void invalidateLocked(CachedFile& cached);
+
+    ReaderFactory readerFactory;
+    size_t memoryBudget;
+    size_t cachedBytes = 0;
+    uint64_t accessCounter = 0;
+    Stats stats;
+
+    mutable std::mutex lock;
+    std::condition_variable blockLoaded;
+    std::map<juce::String, std::unique_ptr<CachedFile>> files;
+    LruList lru;
+
+    // Last, so it drains before anything its jobs use goes away
+    WorkerPool readAheadThreads{ 2 };
+
+    static inline std::mutex instanceLock;
+    static inline BlockCache* instance = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlockCache)
+};
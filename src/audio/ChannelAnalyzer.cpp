@@ -0,0 +1,242 @@
+/*
+    ChannelStacker - Channel Analyzer Implementation
+*/
+
+#include "ChannelAnalyzer.h"
+#include "ParallelFor.h"
+#include "SimdKernels.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cmath>
+
+namespace
+{
+    // Mean-removed copy of a channel, ready for dot products
+    struct PreparedChannel
+    {
+        std::vector<float> samples;
+        double sampleRate = 0.0;
+        double energy = 0.0;      // Sum of squares over the whole signal
+        bool silent = true;
+    };
+
+    PreparedChannel prepareChannel(const ChannelAnalysisInput& input, double commonRate)
+    {
+        PreparedChannel prepared;
+        if (input.signal == nullptr || input.signal->samples.empty() || input.signal->sampleRate <= 0.0)
+            return prepared;
+
+        // Sources at different rates decimate to slightly different
+        // analysis rates; bring them all to one so pairs compare directly
+        if (std::abs(input.signal->sampleRate - commonRate) > 1.0e-6)
+            prepared.samples = ChannelAnalyzer::resample(input.signal->samples, input.signal->sampleRate, commonRate);
+        else
+            prepared.samples = input.signal->samples;
+
+        prepared.sampleRate = commonRate;
+        if (prepared.samples.empty())
+            return prepared;
+
+        size_t n = prepared.samples.size();
+        float* data = prepared.samples.data();
+
+        // Remove DC so correlation reflects programme content only
+        auto mean = static_cast<float>(SimdKernels::sum(data, n) / static_cast<double>(n));
+        juce::FloatVectorOperations::add(data, -mean, static_cast<int>(n));
+
+        prepared.energy = static_cast<double>(SimdKernels::dotProduct(data, data, n));
+        double rms = std::sqrt(prepared.energy / static_cast<double>(n));
+        prepared.silent = rms < static_cast<double>(ChannelAnalyzer::kSilenceRms);
+        return prepared;
+    }
+
+    float correlate(const PreparedChannel& a, const PreparedChannel& b)
+    {
+        if (a.silent || b.silent)
+            return 0.0f;
+
+        // Signals at different rates cannot be compared sample by sample
+        if (std::abs(a.sampleRate - b.sampleRate) > 1.0e-6)
+            return 0.0f;
+
+        size_t n = std::min(a.samples.size(), b.samples.size());
+        double cross = static_cast<double>(SimdKernels::dotProduct(a.samples.data(), b.samples.data(), n));
+
+        // Normalise over the common span when the lengths differ
+        double energyA = a.samples.size() == n ? a.energy
+                       : static_cast<double>(SimdKernels::dotProduct(a.samples.data(), a.samples.data(), n));
+        double energyB = b.samples.size() == n ? b.energy
+                       : static_cast<double>(SimdKernels::dotProduct(b.samples.data(), b.samples.data(), n));
+
+        double denominator = std::sqrt(energyA * energyB);
+        if (denominator <= 0.0)
+            return 0.0f;
+
+        return static_cast<float>(juce::jlimit(-1.0, 1.0, cross / denominator));
+    }
+}
+
+ChannelAnalysisResult ChannelAnalyzer::analyze(const std::vector<ChannelAnalysisInput>& inputs)
+{
+    ChannelAnalysisResult result;
+    const int numChannels = static_cast<int>(inputs.size());
+    result.numChannels = numChannels;
+    result.correlation.assign(static_cast<size_t>(numChannels * numChannels), 0.0f);
+    result.silent.assign(static_cast<size_t>(numChannels), true);
+
+    if (numChannels == 0)
+        return result;
+
+    // The lowest rate among the signals, which every channel is brought to
+    double commonRate = 0.0;
+    for (const auto& input : inputs)
+    {
+        if (input.signal != nullptr && input.signal->sampleRate > 0.0)
+            commonRate = commonRate > 0.0 ? std::min(commonRate, input.signal->sampleRate) : input.signal->sampleRate;
+    }
+
+    // Prepare every channel in parallel
+    std::vector<PreparedChannel> prepared(static_cast<size_t>(numChannels));
+    parallelFor(numChannels, [&](int i)
+    {
+        prepared[static_cast<size_t>(i)] = prepareChannel(inputs[static_cast<size_t>(i)], commonRate);
+    });
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        result.silent[static_cast<size_t>(i)] = prepared[static_cast<size_t>(i)].silent;
+        result.correlation[static_cast<size_t>(i * numChannels + i)] = prepared[static_cast<size_t>(i)].silent ? 0.0f : 1.0f;
+    }
+
+    // Flatten the upper triangle so pairs can be scheduled independently
+    std::vector<std::pair<int, int>> pairs;
+    pairs.reserve(static_cast<size_t>(numChannels * (numChannels - 1) / 2));
+    for (int a = 0; a < numChannels; ++a)
+        for (int b = a + 1; b < numChannels; ++b)
+            pairs.emplace_back(a, b);
+
+    parallelFor(static_cast<int>(pairs.size()), [&](int p)
+    {
+        auto [a, b] = pairs[static_cast<size_t>(p)];
+        float r = correlate(prepared[static_cast<size_t>(a)], prepared[static_cast<size_t>(b)]);
+        result.correlation[static_cast<size_t>(a * numChannels + b)] = r;
+        result.correlation[static_cast<size_t>(b * numChannels + a)] = r;
+    });
+
+    suggestPairs(result, inputs);
+    return result;
+}
+
+std::vector<float> ChannelAnalyzer::resample(const std::vector<float>& samples, double fromRate, double toRate)
+{
+    if (samples.empty() || fromRate <= 0.0 || toRate <= 0.0)
+        return {};
+
+    const double step = fromRate / toRate;
+    std::vector<float> out(static_cast<size_t>(static_cast<double>(samples.size()) / step));
+
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        const double position = static_cast<double>(i) * step;
+        const auto index = std::min(static_cast<size_t>(position), samples.size() - 1);
+        const auto frac = static_cast<float>(position - static_cast<double>(index));
+        const float next = index + 1 < samples.size() ? samples[index + 1] : samples[index];
+        out[i] = samples[index] + frac * (next - samples[index]);
+    }
+    return out;
+}
+
+void ChannelAnalyzer::suggestPairs(ChannelAnalysisResult& result, const std::vector<ChannelAnalysisInput>& inputs)
+{
+    const int numChannels = result.numChannels;
+
+    struct Candidate
+    {
+        int a, b;
+        float score;
+    };
+
+    std::vector<Candidate> candidates;
+    for (int a = 0; a < numChannels; ++a)
+    {
+        for (int b = a + 1; b < numChannels; ++b)
+        {
+            if (result.silent[static_cast<size_t>(a)] || result.silent[static_cast<size_t>(b)])
+                continue;
+
+            float r = result.getCorrelation(a, b);
+            if (r < kPairThreshold)
+                continue;
+
+            // Prefer partners from the same stream, and the conventional
+            // even/odd neighbours within it, when correlations are close
+            const auto& inA = inputs[static_cast<size_t>(a)];
+            const auto& inB = inputs[static_cast<size_t>(b)];
+            float score = r;
+            if (inA.sourceKey == inB.sourceKey)
+            {
+                score += 0.05f;
+                int lower = std::min(inA.channelIndex, inB.channelIndex);
+                int upper = std::max(inA.channelIndex, inB.channelIndex);
+                if (upper == lower + 1 && lower % 2 == 0)
+                    score += 0.05f;
+            }
+
+            candidates.push_back({ a, b, score });
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& x, const Candidate& y) { return x.score > y.score; });
+
+    // Greedy matching: strongest pairs first, each channel used once
+    std::vector<bool> used(static_cast<size_t>(numChannels), false);
+    for (const auto& c : candidates)
+    {
+        if (used[static_cast<size_t>(c.a)] || used[static_cast<size_t>(c.b)])
+            continue;
+
+        used[static_cast<size_t>(c.a)] = true;
+        used[static_cast<size_t>(c.b)] = true;
+
+        // Left is the lower channel within a stream, otherwise the earlier lane
+        int left = c.a;
+        int right = c.b;
+        const auto& inA = inputs[static_cast<size_t>(c.a)];
+        const auto& inB = inputs[static_cast<size_t>(c.b)];
+        if (inA.sourceKey == inB.sourceKey && inB.channelIndex < inA.channelIndex)
+            std::swap(left, right);
+
+        result.suggestedPairs.emplace_back(left, right);
+    }
+
+    std::sort(result.suggestedPairs.begin(), result.suggestedPairs.end(),
+              [](const auto& x, const auto& y) { return std::min(x.first, x.second) < std::min(y.first, y.second); });
+
+    for (int i = 0; i < numChannels; ++i)
+    {
+        if (!used[static_cast<size_t>(i)] && !result.silent[static_cast<size_t>(i)])
+            result.unpairedChannels.push_back(i);
+    }
+
+    result.suggestedLayout = describeLayout(static_cast<int>(result.suggestedPairs.size()),
+                                            static_cast<int>(result.unpairedChannels.size()));
+}
+
+juce::String ChannelAnalyzer::describeLayout(int numPairs, int numMono)
+{
+    // Map the pair/mono structure onto the common loudspeaker layouts
+    if (numPairs == 0 && numMono == 0) return "Silent";
+    if (numPairs == 0 && numMono == 1) return "Mono";
+    if (numPairs == 1 && numMono == 0) return "Stereo";
+    if (numPairs == 1 && numMono == 1) return "LCR";
+    if (numPairs == 2 && numMono == 0) return "Quad";
+    if (numPairs == 2 && numMono == 1) return "5.0";
+    if (numPairs == 2 && numMono == 2) return "5.1";
+    if (numPairs == 3 && numMono == 1) return "7.0";
+    if (numPairs == 3 && numMono == 2) return "7.1";
+
+    juce::String layout = juce::String(numPairs) + " stereo pair(s)";
+    if (numMono > 0)
+        layout += " + " + juce::String(numMono) + " mono";
+    return layout;
+}
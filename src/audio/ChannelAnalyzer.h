@@ -0,0 +1,60 @@
+/*
+    ChannelStacker - Channel Analyzer Header
+    Inter-channel correlation analysis over the decimated signals produced
+    by the waveform extraction pass. Suggests stereo pairings and a layout.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "../model/ProjectModel.h"
+#include <memory>
+#include <utility>
+#include <vector>
+
+// One channel to analyse
+struct ChannelAnalysisInput
+{
+    std::shared_ptr<const DecimatedSignal> signal;
+    juce::String sourceKey;       // Identifies the source file + stream
+    int channelIndex = 0;         // Channel within that stream
+};
+
+struct ChannelAnalysisResult
+{
+    int numChannels = 0;
+    std::vector<float> correlation;                 // numChannels x numChannels, row-major
+    std::vector<bool> silent;                       // Channels with no usable signal
+    std::vector<std::pair<int, int>> suggestedPairs; // Indices into the analysed inputs
+    std::vector<int> unpairedChannels;              // Non-silent channels left as mono
+    juce::String suggestedLayout;
+
+    float getCorrelation(int a, int b) const
+    {
+        return correlation[static_cast<size_t>(a * numChannels + b)];
+    }
+};
+
+class ChannelAnalyzer
+{
+public:
+    // Compute the correlation matrix (in parallel across channel pairs) and
+    // derive pairing/layout suggestions. Blocking - run from a background thread.
+    static ChannelAnalysisResult analyze(const std::vector<ChannelAnalysisInput>& inputs);
+
+    // Minimum zero-lag correlation for two channels to be suggested as a pair
+    static constexpr float kPairThreshold = 0.35f;
+
+    // RMS below which a channel is treated as silent (about -80 dBFS)
+    static constexpr float kSilenceRms = 1.0e-4f;
+
+    // Linear-interpolated rate change for analysis signals, which are
+    // already low-passed well inside either rate's Nyquist
+    static std::vector<float> resample(const std::vector<float>& samples, double fromRate, double toRate);
+
+private:
+    static void suggestPairs(ChannelAnalysisResult& result, const std::vector<ChannelAnalysisInput>& inputs);
+    static juce::String describeLayout(int numPairs, int numMono);
+
+    ChannelAnalyzer() = delete;
+};
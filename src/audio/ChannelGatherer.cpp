@@ -0,0 +1,207 @@
+/*
+    ChannelStacker - Channel Gatherer Implementation
+*/
+
+#include "ChannelGatherer.h"
+#include "../model/ProgressTracker.h"
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+ChannelGatherer::ChannelGatherer(std::vector<Group> groups)
+{
+    for (auto& group : groups)
+    {
+        auto process = std::make_unique<Process>();
+        process->group = std::move(group);
+
+        const auto& outputChannels = process->group.outputChannels;
+        for (size_t pipe = 0; pipe < std::max<size_t>(1, outputChannels.size()); ++pipe)
+        {
+            auto source = std::make_unique<Source>();
+            source->owner = process.get();
+            source->pipe = outputChannels.empty() ? -1 : static_cast<int>(pipe);
+            source->numChannels = outputChannels.empty() ? process->group.numChannels : outputChannels[pipe];
+            totalChannels += source->numChannels;
+            sources.push_back(std::move(source));
+        }
+
+        processes.push_back(std::move(process));
+    }
+}
+
+ChannelGatherer::~ChannelGatherer()
+{
+    if (started)
+        finish(0);
+}
+
+bool ChannelGatherer::start()
+{
+    started = true;
+    for (auto& process : processes)
+    {
+        // stdout carries audio, so stderr can't be merged into it
+        const auto& group = process->group;
+        const bool ok = group.outputChannels.empty()
+                          ? process->process.start(group.args, SpawnedProcess::wantStdOut)
+                          : process->process.startWithOutputPipes(group.args, 0, static_cast<int>(group.outputChannels.size()));
+        if (!ok)
+        {
+            finish(0);
+            return false;
+        }
+    }
+
+    for (auto& source : sources)
+    {
+        if (source->numChannels <= 0)
+        {
+            finish(0);
+            return false;
+        }
+
+        source->reader = std::thread([this, &source = *source]() { readProcess(source); });
+    }
+
+    return true;
+}
+
+void ChannelGatherer::readProcess(Source& source)
+{
+    const size_t blockFloats = kBlockFrames * static_cast<size_t>(source.numChannels);
+    const size_t blockBytes = blockFloats * sizeof(float);
+    const size_t frameBytes = static_cast<size_t>(source.numChannels) * sizeof(float);
+
+    auto push = [this, &source](std::vector<float> block)
+    {
+        std::unique_lock<std::mutex> guard(source.lock);
+        source.changed.wait(guard, [this, &source]() { return source.blocks.size() < kMaxQueuedBlocks || stopping; });
+        if (stopping)
+            return false;
+
+        source.blocks.push_back(std::move(block));
+        source.changed.notify_all();
+        return true;
+    };
+
+    std::vector<float> block(blockFloats);
+    size_t filled = 0;
+    bool complete = false;
+    for (;;)
+    {
+        auto* into = reinterpret_cast<char*>(block.data()) + filled;
+        const auto wanted = static_cast<int>(blockBytes - filled);
+        int bytesRead = source.pipe < 0 ? source.owner->process.readProcessOutput(into, wanted)
+                                        : source.owner->process.readOutputPipe(source.pipe, into, wanted);
+        if (bytesRead <= 0)
+        {
+            complete = !stopping;
+            break;
+        }
+
+        filled += static_cast<size_t>(bytesRead);
+        if (filled == blockBytes)
+        {
+            if (!push(std::move(block)))
+                break;
+            block.assign(blockFloats, 0.0f);
+            filled = 0;
+        }
+    }
+
+    // Whole frames of the last block only
+    if (complete && filled >= frameBytes)
+    {
+        block.resize(filled / frameBytes * static_cast<size_t>(source.numChannels));
+        complete = push(std::move(block));
+    }
+
+    std::lock_guard<std::mutex> guard(source.lock);
+    source.ended = true;
+    source.complete = complete;
+    source.readerCpuSeconds = ProgressTracker::getThreadCpuSeconds();   // The thread's whole life
+    source.changed.notify_all();
+}
+
+size_t ChannelGatherer::read(float* dest)
+{
+    std::vector<std::vector<float>> current;
+    current.reserve(sources.size());
+
+    size_t numFrames = kBlockFrames;
+    for (auto& source : sources)
+    {
+        std::unique_lock<std::mutex> guard(source->lock);
+        source->changed.wait(guard, [&source]() { return !source->blocks.empty() || source->ended; });
+        if (source->blocks.empty())
+            return 0;
+
+        current.push_back(std::move(source->blocks.front()));
+        source->blocks.pop_front();
+        source->changed.notify_all();
+
+        numFrames = std::min(numFrames, current.back().size() / static_cast<size_t>(source->numChannels));
+    }
+
+    // Each group's frames go to its run of channels in the whole frame
+    size_t firstChannel = 0;
+    for (size_t g = 0; g < sources.size(); ++g)
+    {
+        const auto groupChannels = static_cast<size_t>(sources[g]->numChannels);
+        const float* in = current[g].data();
+        for (size_t frame = 0; frame < numFrames; ++frame)
+            std::memcpy(dest + frame * static_cast<size_t>(totalChannels) + firstChannel,
+                        in + frame * groupChannels, groupChannels * sizeof(float));
+        firstChannel += groupChannels;
+    }
+
+    return numFrames;
+}
+
+int ChannelGatherer::finish(int timeoutMs)
+{
+    stopping = true;
+    std::set<Process*> incomplete;
+    for (auto& source : sources)
+    {
+        std::lock_guard<std::mutex> guard(source->lock);
+        source->changed.notify_all();
+        if (!source->complete)
+            incomplete.insert(source->owner);
+    }
+
+    // Anything still writing has outlived the shortest group
+    for (auto* process : incomplete)
+        process->process.kill();
+
+    for (auto& source : sources)
+        if (source->reader.joinable())
+            source->reader.join();
+
+    int exitCode = 0;
+    for (auto& process : processes)
+    {
+        if (incomplete.count(process.get()) == 0)
+        {
+            process->process.waitForProcessToFinish(timeoutMs);
+            const auto code = static_cast<int>(process->process.getExitCode());
+            if (exitCode == 0)
+                exitCode = code;
+        }
+    }
+
+    started = false;
+    return exitCode;
+}
+
+double ChannelGatherer::getCpuSeconds()
+{
+    // Killed processes are collected here if nothing has waited for them yet
+    double total = 0.0;
+    for (auto& process : processes)
+        total += process->process.getCpuSeconds();
+    for (auto& source : sources)
+        total += source->readerCpuSeconds;
+    return total;
+}
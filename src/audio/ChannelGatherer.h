@@ -0,0 +1,94 @@
+/*
+    ChannelStacker - Channel Gatherer Header
+    Runs ffmpeg processes that render contiguous groups of an output's
+    channels as float frames, and interleaves them back into whole frames.
+    A group is a process's stdout, or one of several output pipes of a
+    process that renders each group in its own filter graph. Each group is
+    read on its own thread, so the graphs run in parallel and no single
+    graph has to merge hundreds of inputs.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "../async/SpawnedProcess.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ChannelGatherer
+{
+public:
+    // One ffmpeg command writing numChannels interleaved f32le channels to
+    // stdout - or with outputChannels set, one output of that many channels
+    // per entry, on fds 3, 4, ... ("pipe:3", ...; not on Windows), in order
+    struct Group
+    {
+        juce::StringArray args;
+        int numChannels = 0;
+        std::vector<int> outputChannels;
+    };
+
+    explicit ChannelGatherer(std::vector<Group> groups);
+    ~ChannelGatherer();
+
+    // Start every process; false (with none left running) if any fails
+    bool start();
+
+    int getNumChannels() const { return totalChannels; }
+
+    // Fill dest with up to kBlockFrames interleaved frames of all groups'
+    // channels in group order. Returns the frames written, 0 once the
+    // shortest group has ended (like amerge).
+    size_t read(float* dest);
+
+    // Wait for the processes and stop any still writing. The first failing
+    // exit code of a process that ran to its end, else 0.
+    int finish(int timeoutMs);
+
+    // CPU time of the processes and of the threads reading them, once
+    // finish() has returned
+    double getCpuSeconds();
+
+    static constexpr size_t kBlockFrames = 8192;
+
+private:
+    struct Process
+    {
+        Group group;
+        SpawnedProcess process;
+    };
+
+    // One output stream of a process
+    struct Source
+    {
+        Process* owner = nullptr;
+        int pipe = -1;             // Output pipe, or -1 for stdout
+        int numChannels = 0;
+        std::thread reader;
+
+        std::mutex lock;
+        std::condition_variable changed;
+        std::deque<std::vector<float>> blocks;    // kBlockFrames each, except the last
+        bool ended = false;        // Reader has stopped
+        bool complete = false;     // ...because the process finished its output
+        double readerCpuSeconds = 0.0;
+    };
+
+    void readProcess(Source& source);
+
+    std::vector<std::unique_ptr<Process>> processes;
+    std::vector<std::unique_ptr<Source>> sources;
+    int totalChannels = 0;
+    std::atomic<bool> stopping{ false };
+    bool started = false;
+
+    // Blocks each reader may run ahead of the writer
+    static constexpr size_t kMaxQueuedBlocks = 4;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelGatherer)
+};
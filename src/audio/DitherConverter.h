@@ -0,0 +1,56 @@
+/*
+    ChannelStacker - Dither Converter Header
+    Float to 16/24-bit PCM conversion with TPDF or noise-shaped dither.
+    The dither is deterministic: each sample's noise depends only on the
+    seed, its channel and its frame position, so the same input always
+    produces the same file however it is chunked.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstdint>
+#include <vector>
+
+class DitherConverter
+{
+public:
+    enum class Dither
+    {
+        None,         // Plain rounding
+        Tpdf,         // +/-1 LSB triangular dither
+        NoiseShaped   // TPDF plus 3-tap error feedback pushing noise out of the 2-5 kHz region
+    };
+
+    DitherConverter(int numChannels, int bitsPerSample, Dither dither, uint32_t seed);
+
+    // Convert interleaved float frames to packed little-endian PCM.
+    // dest must hold numFrames * numChannels * getBytesPerSample() bytes.
+    void convert(const float* interleaved, size_t numFrames, uint8_t* dest);
+
+    int getBytesPerSample() const { return bitsPerSample / 8; }
+
+    // Start again from frame zero (same dither sequence as a fresh converter)
+    void reset();
+
+    // Headless check of conversion speed for every dither mode at 16 and
+    // 24 bits, in GB/s of float input, over synthetic interleaved channels
+    static juce::String runBenchmark(int numChannels);
+
+private:
+    void convertNoiseShaped(const float* interleaved, size_t numFrames, uint8_t* dest);
+    void pack(const int32_t* samples, size_t numSamples, uint8_t* dest) const;
+    uint32_t keyForPosition(uint64_t samplePosition) const;
+
+    int numChannels;
+    int bitsPerSample;
+    Dither dither;
+    uint32_t seed;
+    float scale;
+
+    uint64_t samplePosition = 0;        // Interleaved samples converted so far
+    std::vector<int32_t> scratch;
+    std::vector<float> errorHistory;    // Noise shaping: 3 planes of per-channel errors, most recent first
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DitherConverter)
+};
@@ -0,0 +1,536 @@
+/*
+    ChannelStacker - Export Verifier Implementation
+*/
+
+#include "ExportVerifier.h"
+#include "GrowingWavFile.h"
+#include "ParallelFor.h"
+#include "SampleKernels.h"
+#include "SimdKernels.h"
+#include "../async/SpawnedProcess.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    constexpr size_t kBlockFrames = 1 << 15;
+    constexpr int kMaxPanChannels = 64;   // ffmpeg's pan filter limit
+
+    uint16_t read16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+
+    uint32_t read32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8
+             | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    uint64_t read64(const uint8_t* p) { return read32(p) | static_cast<uint64_t>(read32(p + 4)) << 32; }
+
+    double toDecibels(float gain)
+    {
+        return gain > 0.0f ? 20.0 * std::log10(static_cast<double>(gain)) : -INFINITY;
+    }
+
+    juce::String formatDecibels(float gain)
+    {
+        auto db = toDecibels(gain);
+        return std::isfinite(db) ? juce::String(db, 1) + " dBFS" : juce::String("-inf dBFS");
+    }
+
+    //==========================================================================
+    // PCM layout of a WAV/RF64 file inside a memory-mapped view
+    struct WavView
+    {
+        const uint8_t* data = nullptr;    // First sample frame
+        uint64_t numFrames = 0;
+        int numChannels = 0;
+        double sampleRate = 0.0;
+        int bitsPerSample = 0;
+        SampleFormat format = SampleFormat::S16;
+
+        size_t getFrameBytes() const
+        {
+            return static_cast<size_t>(numChannels) * static_cast<size_t>(SampleKernels::bytesPerSample(format));
+        }
+    };
+
+    bool parseWav(const juce::MemoryMappedFile& mapped, WavView& view)
+    {
+        const auto* base = static_cast<const uint8_t*>(mapped.getData());
+        const uint64_t size = mapped.getSize();
+        if (base == nullptr || size < 12 || std::memcmp(base + 8, "WAVE", 4) != 0)
+            return false;
+
+        const bool rf64 = std::memcmp(base, "RF64", 4) == 0;
+        if (!rf64 && std::memcmp(base, "RIFF", 4) != 0)
+            return false;
+
+        uint64_t ds64DataSize = 0;
+        int formatTag = 0;
+
+        for (uint64_t pos = 12; pos + 8 <= size;)
+        {
+            const uint8_t* chunk = base + pos;
+            uint64_t chunkSize = read32(chunk + 4);
+            const uint64_t bodySize = size - pos - 8;
+
+            if (std::memcmp(chunk, "ds64", 4) == 0 && chunkSize >= 16 && bodySize >= 16)
+            {
+                ds64DataSize = read64(chunk + 16);
+            }
+            else if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16 && bodySize >= 16)
+            {
+                formatTag = read16(chunk + 8);
+                view.numChannels = read16(chunk + 10);
+                view.sampleRate = read32(chunk + 12);
+                view.bitsPerSample = read16(chunk + 22);
+
+                // WAVE_FORMAT_EXTENSIBLE: the real tag leads the sub-format GUID
+                if (formatTag == 0xFFFE && chunkSize >= 40 && bodySize >= 40)
+                    formatTag = read16(chunk + 32);
+            }
+            else if (std::memcmp(chunk, "data", 4) == 0)
+            {
+                if (rf64 && chunkSize == 0xFFFFFFFFull)
+                    chunkSize = ds64DataSize;
+
+                if (view.numChannels <= 0)
+                    return false;
+
+                if (formatTag == 1 && view.bitsPerSample == 16)      view.format = SampleFormat::S16;
+                else if (formatTag == 1 && view.bitsPerSample == 24) view.format = SampleFormat::S24;
+                else if (formatTag == 1 && view.bitsPerSample == 32) view.format = SampleFormat::S32;
+                else if (formatTag == 3 && view.bitsPerSample == 32) view.format = SampleFormat::F32;
+                else if (formatTag == 3 && view.bitsPerSample == 64) view.format = SampleFormat::F64;
+                else return false;
+
+                view.data = chunk + 8;
+                view.numFrames = std::min(chunkSize, bodySize) / view.getFrameBytes();
+                return true;
+            }
+
+            pos += 8 + chunkSize + (chunkSize & 1);
+        }
+
+        return false;
+    }
+
+    // One channel of interleaved little-endian PCM -> contiguous float
+    void gatherChannel(const WavView& view, uint64_t firstFrame, size_t numFrames, int channel, float* dest)
+    {
+        const size_t stride = view.getFrameBytes();
+        const int sampleBytes = SampleKernels::bytesPerSample(view.format);
+        const uint8_t* p = view.data + firstFrame * stride + static_cast<size_t>(channel * sampleBytes);
+
+        switch (view.format)
+        {
+            case SampleFormat::S16:
+                for (size_t i = 0; i < numFrames; ++i, p += stride)
+                    dest[i] = static_cast<float>(static_cast<int16_t>(read16(p))) * (1.0f / 32768.0f);
+                break;
+
+            case SampleFormat::S24:
+                for (size_t i = 0; i < numFrames; ++i, p += stride)
+                {
+                    auto v = static_cast<int32_t>(static_cast<uint32_t>(p[0]) << 8 | static_cast<uint32_t>(p[1]) << 16
+                                                  | static_cast<uint32_t>(p[2]) << 24) >> 8;
+                    dest[i] = static_cast<float>(v) * (1.0f / 8388608.0f);
+                }
+                break;
+
+            case SampleFormat::S32:
+                for (size_t i = 0; i < numFrames; ++i, p += stride)
+                    dest[i] = static_cast<float>(static_cast<int32_t>(read32(p))) * (1.0f / 2147483648.0f);
+                break;
+
+            case SampleFormat::F32:
+                for (size_t i = 0; i < numFrames; ++i, p += stride)
+                    std::memcpy(dest + i, p, sizeof(float));
+                break;
+
+            case SampleFormat::F64:
+                for (size_t i = 0; i < numFrames; ++i, p += stride)
+                {
+                    double v;
+                    std::memcpy(&v, p, sizeof(double));
+                    dest[i] = static_cast<float>(v);
+                }
+                break;
+        }
+    }
+
+    //==========================================================================
+    // Reference audio for a group of output channels that share a source
+    // stream. Sources that are already plain WAV at the output rate are
+    // read natively through the shared block cache (so groups of the same
+    // source share its reads); anything else is decoded by ffmpeg.
+    class ReferenceReader
+    {
+    public:
+        virtual ~ReferenceReader() = default;
+
+        // Fills one array per channel; returns the frames read (0 at the end)
+        virtual size_t read(float* const* dest, size_t maxFrames) = 0;
+
+        // Empty unless the source couldn't be read to the end
+        virtual juce::String getError() { return {}; }
+    };
+
+    class WavReference : public ReferenceReader
+    {
+    public:
+        WavReference(std::unique_ptr<GrowingWavFile> file, std::vector<int> sourceChannels)
+            : wav(std::move(file)), channels(std::move(sourceChannels)) {}
+
+        size_t read(float* const* dest, size_t maxFrames) override
+        {
+            const auto numFrames = static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(maxFrames), wav->getNumFrames() - position));
+            const auto stride = static_cast<size_t>(wav->getNumChannels());
+            interleaved.resize(numFrames * stride);
+            if (numFrames == 0 || !wav->read(position, numFrames, interleaved.data()))
+            {
+                failed = numFrames > 0;
+                return 0;
+            }
+
+            for (size_t k = 0; k < channels.size(); ++k)
+            {
+                const float* source = interleaved.data() + channels[k];
+                for (size_t i = 0; i < numFrames; ++i)
+                    dest[k][i] = source[i * stride];
+            }
+
+            position += static_cast<int64_t>(numFrames);
+            return numFrames;
+        }
+
+        juce::String getError() override { return failed ? "could not read the source" : juce::String(); }
+
+    private:
+        std::unique_ptr<GrowingWavFile> wav;
+        std::vector<int> channels;
+        std::vector<float> interleaved;
+        int64_t position = 0;
+        bool failed = false;
+    };
+
+    class DecodedReference : public ReferenceReader
+    {
+    public:
+        DecodedReference(const juce::StringArray& args, int channels)
+            : numChannels(channels),
+              frameBytes(sizeof(float) * static_cast<size_t>(channels)),
+              kernels(SampleKernels::get(SampleFormat::F32, channels))
+        {
+            started = process.start(args, SpawnedProcess::wantStdOut);
+        }
+
+        ~DecodedReference() override
+        {
+            if (process.isRunning())
+                process.kill();
+        }
+
+        size_t read(float* const* dest, size_t maxFrames) override
+        {
+            if (!started)
+                return 0;
+
+            const size_t wanted = maxFrames * frameBytes;
+            if (raw.size() < wanted)
+                raw.resize(wanted);
+
+            // Fill the block (pipe reads return whatever is ready)
+            while (buffered < wanted)
+            {
+                int bytesRead = process.readProcessOutput(raw.data() + buffered, static_cast<int>(wanted - buffered));
+                if (bytesRead <= 0)
+                    break;
+                buffered += static_cast<size_t>(bytesRead);
+            }
+
+            const size_t numFrames = buffered / frameBytes;
+            if (numFrames > 0)
+                kernels.deinterleave(raw.data(), numFrames, numChannels, dest);
+
+            // Keep any partial frame for the next read
+            const size_t used = numFrames * frameBytes;
+            std::memmove(raw.data(), raw.data() + used, buffered - used);
+            buffered -= used;
+            return numFrames;
+        }
+
+        juce::String getError() override
+        {
+            if (!started)
+                return "could not start ffmpeg";
+
+            process.waitForProcessToFinish(10000);
+            auto exitCode = process.getExitCode();
+            return exitCode == 0 ? juce::String() : "ffmpeg exited with code " + juce::String(static_cast<int>(exitCode));
+        }
+
+    private:
+        SpawnedProcess process;
+        bool started = false;
+        int numChannels;
+        size_t frameBytes;
+        const SampleKernels& kernels;
+        std::vector<char> raw;
+        size_t buffered = 0;
+    };
+
+    // Output channels that come from the same source stream with the same edit
+    struct SourceGroup
+    {
+        juce::File file;
+        int streamIndex = 0;
+        juce::String editFilter;
+        std::vector<int> sourceChannels;
+        std::vector<int> outputChannels;
+    };
+
+    std::unique_ptr<ReferenceReader> openReference(const SourceGroup& group, const juce::File& ffmpeg,
+                                                   double sampleRate, const juce::String& gainFilter)
+    {
+        // Native path: nothing between the source samples and the export
+        if (group.streamIndex == 0 && gainFilter.isEmpty() && group.editFilter.isEmpty())
+        {
+            auto wav = std::make_unique<GrowingWavFile>(group.file);
+            if (wav->refresh() && juce::roundToInt(wav->getSampleRate()) == juce::roundToInt(sampleRate)
+                && *std::max_element(group.sourceChannels.begin(), group.sourceChannels.end()) < wav->getNumChannels())
+                return std::make_unique<WavReference>(std::move(wav), group.sourceChannels);
+        }
+
+        // pan picks this group's channels in output order, independently of
+        // the export's own split/merge graph
+        const int numChannels = static_cast<int>(group.sourceChannels.size());
+        juce::String filter = "pan=" + juce::String(numChannels) + "c";
+        for (int k = 0; k < numChannels; ++k)
+            filter += "|c" + juce::String(k) + "=c" + juce::String(group.sourceChannels[static_cast<size_t>(k)]);
+        if (group.editFilter.isNotEmpty())
+            filter += "," + group.editFilter;
+        if (gainFilter.isNotEmpty())
+            filter += "," + gainFilter;
+
+        juce::StringArray args;
+        args.add(ffmpeg.getFullPathName());
+        args.add("-v");
+        args.add("error");
+        args.add("-nostdin");
+        args.add("-i");
+        args.add(group.file.getFullPathName());
+        args.add("-map");
+        args.add("0:a:" + juce::String(group.streamIndex));
+        args.add("-af");
+        args.add(filter);
+        args.add("-ar");
+        args.add(juce::String(juce::roundToInt(sampleRate)));
+        args.add("-f");
+        args.add("f32le");
+        args.add("-acodec");
+        args.add("pcm_f32le");
+        args.add("-");
+
+        return std::make_unique<DecodedReference>(args, numChannels);
+    }
+}
+
+ExportVerifier::ExportVerifier(const FFmpegLocator& locator, ProgressTracker* tracker)
+    : ffmpegLocator(locator), progressTracker(tracker)
+{
+}
+
+ExportVerifier::~ExportVerifier()
+{
+    // Running comparisons stop at their next block; the pool then drains
+    cancelled = true;
+}
+
+void ExportVerifier::enqueue(Request request)
+{
+    ProgressTracker::JobHandle job;
+    if (progressTracker != nullptr)
+        job = progressTracker->startJob(ProgressTracker::JobKind::Verify, request.output.getFileName(), 0.0);
+
+    workers.post([this, request = std::move(request), job]()
+    {
+        auto result = verify(request, job.get());
+        const auto name = request.output.getFileName();
+
+        for (size_t c = 0; c < result.maxDeviation.size(); ++c)
+        {
+            const auto& source = request.channels[c];
+            juce::String line = "Verify " + name + " ch " + juce::String(static_cast<int>(c) + 1)
+                              + " (" + source.file.getFileName() + ":" + juce::String(source.streamIndex)
+                              + ":" + juce::String(source.channelIndex) + "): max deviation "
+                              + formatDecibels(result.maxDeviation[c]);
+            if (result.lsb > 0.0f)
+                line += " (" + juce::String(result.maxDeviation[c] / result.lsb, 2) + " LSB)";
+            line += ", source peak " + formatDecibels(result.sourcePeak[c]);
+            if (result.maxDeviation[c] > result.tolerance)
+                line += " - FAILED";
+            juce::Logger::writeToLog(line);
+        }
+
+        auto summary = describe(result);
+        juce::Logger::writeToLog("Verify " + name + ": " + summary);
+
+        if (job != nullptr)
+            job->finish(result.passed, (result.passed ? "Verified " : "Verification failed for ") + name + ": " + summary);
+    });
+}
+
+ExportVerifier::Result ExportVerifier::verify(const Request& request, ProgressTracker::Job* progressJob)
+{
+    Result result;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(request.output, juce::MemoryMappedFile::readOnly);
+    WavView output;
+    if (!parseWav(*mapped, output))
+    {
+        result.error = "not a PCM WAV file";
+        return result;
+    }
+
+    if (output.numChannels != static_cast<int>(request.channels.size()))
+    {
+        result.error = juce::String(output.numChannels) + " channels, expected " + juce::String(static_cast<int>(request.channels.size()));
+        return result;
+    }
+
+    // Quantisation plus dither: +/-1 LSB TPDF on top of rounding, and the
+    // error feedback of noise shaping adds a few LSB more
+    if (output.format == SampleFormat::F32 || output.format == SampleFormat::F64)
+    {
+        result.tolerance = 1.0e-5f;
+    }
+    else
+    {
+        result.lsb = std::ldexp(1.0f, 1 - output.bitsPerSample);
+        const float steps = request.dither == DitherConverter::Dither::NoiseShaped ? 16.0f
+                          : request.dither == DitherConverter::Dither::Tpdf ? 2.0f : 1.0f;
+        result.tolerance = result.lsb * steps;
+    }
+
+    result.outputFrames = static_cast<juce::int64>(output.numFrames);
+    if (progressJob != nullptr)
+        progressJob->setTotal(static_cast<double>(output.numFrames) / output.sampleRate);
+    result.maxDeviation.assign(request.channels.size(), 0.0f);
+    result.sourcePeak.assign(request.channels.size(), 0.0f);
+
+    // One reference reader per source stream and edit, at most pan's channel limit each
+    std::map<juce::String, size_t> groupIndex;
+    std::vector<SourceGroup> groups;
+    for (size_t c = 0; c < request.channels.size(); ++c)
+    {
+        const auto& source = request.channels[c];
+        auto key = source.file.getFullPathName() + ":" + juce::String(source.streamIndex) + ":" + source.editFilter;
+        auto it = groupIndex.find(key);
+        if (it == groupIndex.end() || groups[it->second].sourceChannels.size() >= static_cast<size_t>(kMaxPanChannels))
+        {
+            groupIndex[key] = groups.size();
+            groups.push_back({ source.file, source.streamIndex, source.editFilter, {}, {} });
+            it = groupIndex.find(key);
+        }
+
+        groups[it->second].sourceChannels.push_back(source.channelIndex);
+        groups[it->second].outputChannels.push_back(static_cast<int>(c));
+    }
+
+    std::vector<juce::int64> groupFrames(groups.size(), 0);
+    std::vector<juce::String> groupErrors(groups.size());
+    const auto ffmpeg = ffmpegLocator.getFFmpegPath();
+
+    // Each group streams its own reference; ffmpeg decodes in parallel
+    parallelFor(static_cast<int>(groups.size()), [&](int g)
+    {
+        const auto& group = groups[static_cast<size_t>(g)];
+        const size_t numChannels = group.sourceChannels.size();
+        auto reference = openReference(group, ffmpeg, output.sampleRate, request.gainFilter);
+
+        std::vector<float> referenceData(kBlockFrames * numChannels);
+        std::vector<float*> referenceChannels(numChannels);
+        for (size_t k = 0; k < numChannels; ++k)
+            referenceChannels[k] = referenceData.data() + k * kBlockFrames;
+        std::vector<float> outputChannel(kBlockFrames);
+
+        uint64_t position = 0;
+        while (!cancelled)
+        {
+            const size_t numFrames = reference->read(referenceChannels.data(), kBlockFrames);
+            if (numFrames == 0)
+                break;
+
+            // Past the end of the export there is nothing left to compare
+            const auto numCompared = static_cast<size_t>(std::min<uint64_t>(numFrames, output.numFrames - std::min(position, output.numFrames)));
+            for (size_t k = 0; k < numChannels && numCompared > 0; ++k)
+            {
+                const auto c = static_cast<size_t>(group.outputChannels[k]);
+                gatherChannel(output, position, numCompared, group.outputChannels[k], outputChannel.data());
+                SimdKernels::accumulateDifference(referenceChannels[k], outputChannel.data(), numCompared,
+                                                  result.maxDeviation[c], result.sourcePeak[c]);
+            }
+
+            position += numFrames;
+            if (progressJob != nullptr)
+                progressJob->addProgress(static_cast<double>(numCompared) / (output.sampleRate * static_cast<double>(groups.size())));
+        }
+
+        groupFrames[static_cast<size_t>(g)] = static_cast<juce::int64>(position);
+        if (!cancelled)
+            groupErrors[static_cast<size_t>(g)] = reference->getError();
+    }, std::max(2, static_cast<int>(std::thread::hardware_concurrency()) / 2));
+
+    if (cancelled)
+    {
+        result.error = "cancelled";
+        return result;
+    }
+
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        if (groupErrors[g].isNotEmpty())
+        {
+            result.error = groups[g].file.getFileName() + ": " + groupErrors[g];
+            return result;
+        }
+    }
+
+    result.sourceFrames = *std::min_element(groupFrames.begin(), groupFrames.end());
+
+    // amerge ends at the shortest input; allow a frame of resampler rounding
+    const bool lengthOk = std::abs(result.outputFrames - result.sourceFrames) <= 1;
+    const bool samplesOk = std::all_of(result.maxDeviation.begin(), result.maxDeviation.end(),
+                                       [&](float deviation) { return deviation <= result.tolerance; });
+    result.passed = lengthOk && samplesOk && result.outputFrames > 0;
+    return result;
+}
+
+juce::String ExportVerifier::describe(const Result& result)
+{
+    if (result.error.isNotEmpty())
+        return "could not verify (" + result.error + ")";
+
+    const auto worst = std::max_element(result.maxDeviation.begin(), result.maxDeviation.end());
+    const int worstChannel = static_cast<int>(worst - result.maxDeviation.begin()) + 1;
+    const int numFailed = static_cast<int>(std::count_if(result.maxDeviation.begin(), result.maxDeviation.end(),
+                                                         [&](float deviation) { return deviation > result.tolerance; }));
+    const auto limit = result.lsb > 0.0f ? juce::String(juce::roundToInt(result.tolerance / result.lsb)) + " LSB"
+                                         : formatDecibels(result.tolerance);
+
+    juce::String text = numFailed == 0
+        ? juce::String(static_cast<int>(result.maxDeviation.size())) + " channel(s) within " + limit
+        : juce::String(numFailed) + " of " + juce::String(static_cast<int>(result.maxDeviation.size())) + " channel(s) outside " + limit;
+
+    text += " - worst " + formatDecibels(*worst) + " (ch " + juce::String(worstChannel) + ")";
+
+    if (std::abs(result.outputFrames - result.sourceFrames) > 1)
+        text += " - " + juce::String(result.outputFrames) + " frames, sources give " + juce::String(result.sourceFrames);
+
+    return text;
+}
@@ -0,0 +1,75 @@
+/*
+    ChannelStacker - Export Verifier Header
+    Null test for PCM exports: re-reads a finished WAV through a memory
+    map and compares every channel, sample by sample, with the source
+    channel it should contain. Verifications queue on their own workers,
+    so they overlap with exports that are still running.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "../ffmpeg/FFmpegLocator.h"
+#include "../model/ProgressTracker.h"
+#include "../async/AsyncPrimitives.h"
+#include "DitherConverter.h"
+#include <atomic>
+#include <vector>
+
+class ExportVerifier
+{
+public:
+    // Where one output channel should have come from
+    struct ChannelSource
+    {
+        juce::File file;
+        int streamIndex = 0;
+        int channelIndex = 0;
+        juce::String editFilter;               // Lane trim/offset the export applied, from source time 0
+    };
+
+    struct Request
+    {
+        juce::File output;                     // PCM WAV/RF64
+        std::vector<ChannelSource> channels;   // One per output channel, in order
+        juce::String gainFilter;               // Normalisation applied to the export ("volume=...")
+        DitherConverter::Dither dither = DitherConverter::Dither::None;
+    };
+
+    struct Result
+    {
+        bool passed = false;
+        juce::String error;                    // Why the comparison couldn't run
+
+        std::vector<float> maxDeviation;       // Per output channel, linear full scale
+        std::vector<float> sourcePeak;         // Per output channel, linear full scale
+        float tolerance = 0.0f;                // Allowed deviation for the output's format
+        float lsb = 0.0f;                      // One quantisation step (0 for float)
+
+        juce::int64 outputFrames = 0;
+        juce::int64 sourceFrames = 0;          // Shortest source, as amerge would stop
+    };
+
+    ExportVerifier(const FFmpegLocator& locator, ProgressTracker* progressTracker);
+    ~ExportVerifier();
+
+    // Verify in the background (any thread). The outcome is logged per
+    // channel and reported through the progress tracker.
+    void enqueue(Request request);
+
+    // Blocking comparison - background threads only
+    Result verify(const Request& request, ProgressTracker::Job* progressJob = nullptr);
+
+    // "12 channels within 2 LSB - worst -141.2 dBFS (ch 3)"
+    static juce::String describe(const Result& result);
+
+private:
+    const FFmpegLocator& ffmpegLocator;
+    ProgressTracker* progressTracker;
+    std::atomic<bool> cancelled{ false };
+    WorkerPool workers{ kMaxConcurrentVerifications };
+
+    static constexpr int kMaxConcurrentVerifications = 2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ExportVerifier)
+};
@@ -0,0 +1,842 @@
+/*
+    ChannelStacker - FLAC File Writer Implementation
+*/
+
+#include "FlacFileWriter.h"
+#include "ParallelFor.h"
+#include "WavFileWriter.h"
+#include "../async/SpawnedProcess.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    constexpr int kStreamInfoSize = 34;
+    constexpr int kHeaderSize = 4 + 4 + kStreamInfoSize;
+    constexpr int kMaxFixedOrder = 4;
+    constexpr int kMaxLpcOrder = 8;
+    constexpr int kMaxPartitionOrder = 6;
+    constexpr int kMaxRiceParameter = 30;
+    constexpr int kMaxShortRiceParameter = 14;   // 4-bit parameters; 15 is the escape code
+
+    // MSB-first bit packing
+    class BitWriter
+    {
+    public:
+        void write(uint32_t value, int numBits)
+        {
+            if (numBits <= 0)
+                return;
+
+            accumulator = (accumulator << numBits) | (value & ((uint64_t(1) << numBits) - 1));
+            pendingBits += numBits;
+            while (pendingBits >= 8)
+            {
+                pendingBits -= 8;
+                bytes.push_back(static_cast<uint8_t>(accumulator >> pendingBits));
+            }
+        }
+
+        void writeSigned(int32_t value, int numBits) { write(static_cast<uint32_t>(value), numBits); }
+
+        // q zero bits and a one
+        void writeUnary(uint32_t q)
+        {
+            for (; q >= 32; q -= 32)
+                write(0, 32);
+            write(1, static_cast<int>(q) + 1);
+        }
+
+        void writeRice(int32_t value, int parameter)
+        {
+            // Zig-zag folds the sign into the low bit
+            const auto folded = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+            writeUnary(folded >> parameter);
+            write(folded, parameter);
+        }
+
+        void append(const BitWriter& other)
+        {
+            for (auto byte : other.bytes)
+                write(byte, 8);
+            write(static_cast<uint32_t>(other.accumulator), other.pendingBits);
+        }
+
+        void alignToByte()
+        {
+            if (pendingBits > 0)
+                write(0, 8 - pendingBits);
+        }
+
+        size_t getNumBits() const { return bytes.size() * 8 + static_cast<size_t>(pendingBits); }
+
+        // Whole bytes written so far
+        const std::vector<uint8_t>& getBytes() const { return bytes; }
+        std::vector<uint8_t> takeBytes() { return std::move(bytes); }
+
+    private:
+        std::vector<uint8_t> bytes;
+        uint64_t accumulator = 0;
+        int pendingBits = 0;
+    };
+
+    template <typename Word, Word Polynomial>
+    struct CrcTable
+    {
+        std::array<Word, 256> entries{};
+
+        CrcTable()
+        {
+            constexpr int width = static_cast<int>(sizeof(Word) * 8);
+            for (int i = 0; i < 256; ++i)
+            {
+                auto crc = static_cast<Word>(i << (width - 8));
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = static_cast<Word>((crc & (Word(1) << (width - 1))) != 0 ? (crc << 1) ^ Polynomial : crc << 1);
+                entries[static_cast<size_t>(i)] = crc;
+            }
+        }
+    };
+
+    uint8_t crc8(const uint8_t* data, size_t size)
+    {
+        static const CrcTable<uint8_t, 0x07> table;
+        uint8_t crc = 0;
+        for (size_t i = 0; i < size; ++i)
+            crc = table.entries[crc ^ data[i]];
+        return crc;
+    }
+
+    uint16_t crc16(const uint8_t* data, size_t size)
+    {
+        static const CrcTable<uint16_t, 0x8005> table;
+        uint16_t crc = 0;
+        for (size_t i = 0; i < size; ++i)
+            crc = static_cast<uint16_t>((crc << 8) ^ table.entries[(crc >> 8) ^ data[i]]);
+        return crc;
+    }
+
+    // Frame numbers use the UTF-8 scheme extended to 31 bits
+    void writeFrameNumber(BitWriter& out, uint32_t value)
+    {
+        if (value < 0x80)
+        {
+            out.write(value, 8);
+            return;
+        }
+
+        int continuationBytes = 1;
+        while (continuationBytes < 5 && value >= (uint32_t(1) << (5 * continuationBytes + 6)))
+            ++continuationBytes;
+
+        const int leadBits = 6 - continuationBytes;
+        const auto leadMarker = static_cast<uint32_t>((0xFF00u >> (continuationBytes + 1)) & 0xFFu);
+        out.write(leadMarker | ((value >> (6 * continuationBytes)) & ((1u << leadBits) - 1)), 8);
+        for (int i = continuationBytes - 1; i >= 0; --i)
+            out.write(0x80 | ((value >> (6 * i)) & 0x3F), 8);
+    }
+
+    int sampleRateCode(int rate)
+    {
+        switch (rate)
+        {
+            case 88200:  return 1;
+            case 176400: return 2;
+            case 192000: return 3;
+            case 8000:   return 4;
+            case 16000:  return 5;
+            case 22050:  return 6;
+            case 24000:  return 7;
+            case 32000:  return 8;
+            case 44100:  return 9;
+            case 48000:  return 10;
+            case 96000:  return 11;
+            default:     return 0;   // Taken from STREAMINFO
+        }
+    }
+
+    // Largest partition order that divides the block and leaves the first
+    // partition more samples than the warm-up
+    int maxPartitionOrderFor(int blockSize, int predictorOrder)
+    {
+        int order = 0;
+        while (order < kMaxPartitionOrder && (blockSize & ((2 << order) - 1)) == 0
+               && (blockSize >> (order + 1)) > predictorOrder)
+            ++order;
+        return order;
+    }
+
+    // Parameter for a partition of count folded values summing to sum, and
+    // the bits that partition would take
+    uint64_t riceBits(uint64_t sum, uint64_t count, int& parameter)
+    {
+        parameter = 0;
+        while (parameter < kMaxRiceParameter && (count << (parameter + 1)) <= sum)
+            ++parameter;
+        return count * static_cast<uint64_t>(parameter + 1) + (sum >> parameter);
+    }
+
+    // Partitioned Rice coding of residual[0, blockSize - predictorOrder),
+    // with the partition order chosen by estimated size
+    void writeResidual(BitWriter& out, const int32_t* residual, int blockSize, int predictorOrder)
+    {
+        const int maxOrder = maxPartitionOrderFor(blockSize, predictorOrder);
+
+        // Folded sums of the finest partitions, merged pairwise for coarser orders
+        std::array<uint64_t, 1 << kMaxPartitionOrder> sums{};
+        const int finestSize = blockSize >> maxOrder;
+        for (int i = predictorOrder; i < blockSize; ++i)
+        {
+            const int32_t r = residual[i - predictorOrder];
+            sums[static_cast<size_t>(i / finestSize)] += (static_cast<uint32_t>(r) << 1) ^ static_cast<uint32_t>(r >> 31);
+        }
+
+        int bestOrder = maxOrder;
+        uint64_t bestBits = ~uint64_t(0);
+        std::array<uint64_t, 1 << kMaxPartitionOrder> orderSums = sums;
+        for (int order = maxOrder; order >= 0; --order)
+        {
+            const int numPartitions = 1 << order;
+            if (order < maxOrder)
+                for (int p = 0; p < numPartitions; ++p)
+                    orderSums[static_cast<size_t>(p)] = orderSums[static_cast<size_t>(2 * p)] + orderSums[static_cast<size_t>(2 * p + 1)];
+
+            uint64_t bits = 0;
+            bool longParameters = false;
+            for (int p = 0; p < numPartitions; ++p)
+            {
+                const int count = (blockSize >> order) - (p == 0 ? predictorOrder : 0);
+                int parameter = 0;
+                bits += riceBits(orderSums[static_cast<size_t>(p)], static_cast<uint64_t>(count), parameter);
+                longParameters = longParameters || parameter > kMaxShortRiceParameter;
+            }
+            bits += static_cast<uint64_t>(numPartitions) * (longParameters ? 5 : 4);
+
+            if (bits < bestBits)
+            {
+                bestBits = bits;
+                bestOrder = order;
+            }
+        }
+
+        // Parameters for the chosen order
+        const int numPartitions = 1 << bestOrder;
+        const int partitionSize = blockSize >> bestOrder;
+        std::array<int, 1 << kMaxPartitionOrder> parameters{};
+        bool longParameters = false;
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            uint64_t sum = 0;
+            for (int q = 0; q < (1 << (maxOrder - bestOrder)); ++q)
+                sum += sums[static_cast<size_t>(p * (1 << (maxOrder - bestOrder)) + q)];
+            const int count = partitionSize - (p == 0 ? predictorOrder : 0);
+            riceBits(sum, static_cast<uint64_t>(count), parameters[static_cast<size_t>(p)]);
+            longParameters = longParameters || parameters[static_cast<size_t>(p)] > kMaxShortRiceParameter;
+        }
+
+        out.write(longParameters ? 1 : 0, 2);
+        out.write(static_cast<uint32_t>(bestOrder), 4);
+
+        const int32_t* r = residual;
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            const int parameter = parameters[static_cast<size_t>(p)];
+            out.write(static_cast<uint32_t>(parameter), longParameters ? 5 : 4);
+
+            const int count = partitionSize - (p == 0 ? predictorOrder : 0);
+            for (int i = 0; i < count; ++i)
+                out.writeRice(*r++, parameter);
+        }
+    }
+
+    // Fixed polynomial predictor with the smallest total residual
+    int chooseFixedOrder(const int32_t* x, int n)
+    {
+        if (n <= kMaxFixedOrder)
+            return 0;
+
+        std::array<uint64_t, kMaxFixedOrder + 1> totals{};
+        for (int i = kMaxFixedOrder; i < n; ++i)
+        {
+            const int64_t e0 = x[i];
+            const int64_t e1 = e0 - x[i - 1];
+            const int64_t e2 = e1 - (static_cast<int64_t>(x[i - 1]) - x[i - 2]);
+            const int64_t e3 = e2 - (static_cast<int64_t>(x[i - 1]) - 2 * static_cast<int64_t>(x[i - 2]) + x[i - 3]);
+            const int64_t e4 = e3 - (static_cast<int64_t>(x[i - 1]) - 3 * static_cast<int64_t>(x[i - 2])
+                                     + 3 * static_cast<int64_t>(x[i - 3]) - x[i - 4]);
+            totals[0] += static_cast<uint64_t>(std::abs(e0));
+            totals[1] += static_cast<uint64_t>(std::abs(e1));
+            totals[2] += static_cast<uint64_t>(std::abs(e2));
+            totals[3] += static_cast<uint64_t>(std::abs(e3));
+            totals[4] += static_cast<uint64_t>(std::abs(e4));
+        }
+
+        return static_cast<int>(std::min_element(totals.begin(), totals.end()) - totals.begin());
+    }
+
+    void fixedResidual(const int32_t* x, int n, int order, int32_t* residual)
+    {
+        for (int i = order; i < n; ++i)
+        {
+            int64_t r = x[i];
+            switch (order)
+            {
+                case 1: r -= x[i - 1]; break;
+                case 2: r -= 2 * static_cast<int64_t>(x[i - 1]) - x[i - 2]; break;
+                case 3: r -= 3 * static_cast<int64_t>(x[i - 1]) - 3 * static_cast<int64_t>(x[i - 2]) + x[i - 3]; break;
+                case 4: r -= 4 * static_cast<int64_t>(x[i - 1]) - 6 * static_cast<int64_t>(x[i - 2])
+                             + 4 * static_cast<int64_t>(x[i - 3]) - x[i - 4]; break;
+                default: break;
+            }
+            residual[i - order] = static_cast<int32_t>(r);
+        }
+    }
+
+    // Quantised LPC predictor from the windowed autocorrelation. Writes the
+    // whole subframe to out, or returns false if none is usable.
+    bool encodeLpc(const int32_t* x, int n, int bitsPerSample, int precision, const std::vector<double>& window,
+                   std::vector<int32_t>& residual, BitWriter& out)
+    {
+        if (n <= 4 * kMaxLpcOrder)
+            return false;
+
+        std::vector<double> windowed(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i)
+            windowed[static_cast<size_t>(i)] = x[i] * window[static_cast<size_t>(i)];
+
+        std::array<double, kMaxLpcOrder + 1> autoc{};
+        for (int lag = 0; lag <= kMaxLpcOrder; ++lag)
+        {
+            double sum = 0.0;
+            for (int i = lag; i < n; ++i)
+                sum += windowed[static_cast<size_t>(i)] * windowed[static_cast<size_t>(i - lag)];
+            autoc[static_cast<size_t>(lag)] = sum;
+        }
+
+        if (autoc[0] <= 0.0)
+            return false;
+
+        // Levinson-Durbin: predictor coefficients and error for every order
+        std::array<std::array<double, kMaxLpcOrder>, kMaxLpcOrder> coefficients{};
+        std::array<double, kMaxLpcOrder> errors{};
+        std::array<double, kMaxLpcOrder> lpc{};
+        double error = autoc[0];
+        int maxOrder = kMaxLpcOrder;
+        for (int i = 0; i < kMaxLpcOrder; ++i)
+        {
+            double reflection = -autoc[static_cast<size_t>(i + 1)];
+            for (int j = 0; j < i; ++j)
+                reflection -= lpc[static_cast<size_t>(j)] * autoc[static_cast<size_t>(i - j)];
+            reflection /= error;
+
+            lpc[static_cast<size_t>(i)] = reflection;
+            int j = 0;
+            for (; j < (i >> 1); ++j)
+            {
+                const double tmp = lpc[static_cast<size_t>(j)];
+                lpc[static_cast<size_t>(j)] += reflection * lpc[static_cast<size_t>(i - 1 - j)];
+                lpc[static_cast<size_t>(i - 1 - j)] += reflection * tmp;
+            }
+            if ((i & 1) != 0)
+                lpc[static_cast<size_t>(j)] += lpc[static_cast<size_t>(j)] * reflection;
+
+            error *= 1.0 - reflection * reflection;
+            for (j = 0; j <= i; ++j)
+                coefficients[static_cast<size_t>(i)][static_cast<size_t>(j)] = -lpc[static_cast<size_t>(j)];
+            errors[static_cast<size_t>(i)] = error;
+
+            if (error <= 0.0)
+            {
+                maxOrder = i + 1;
+                break;
+            }
+        }
+
+        // Order with the fewest expected bits, counting warm-up and coefficients
+        int order = 1;
+        double bestBits = 0.0;
+        for (int o = 1; o <= maxOrder; ++o)
+        {
+            const double e = errors[static_cast<size_t>(o - 1)];
+            const double bitsPerResidual = e > 0.0 ? std::max(0.0, 0.5 * std::log2(e * 0.5 / n)) : 0.0;
+            const double bits = bitsPerResidual * (n - o) + o * (bitsPerSample + precision);
+            if (o == 1 || bits < bestBits)
+            {
+                bestBits = bits;
+                order = o;
+            }
+        }
+
+        // Quantise, carrying the rounding error into the next coefficient
+        const auto& lp = coefficients[static_cast<size_t>(order - 1)];
+        double maxCoefficient = 0.0;
+        for (int i = 0; i < order; ++i)
+            maxCoefficient = std::max(maxCoefficient, std::abs(lp[static_cast<size_t>(i)]));
+        if (maxCoefficient <= 0.0)
+            return false;
+
+        // maxCoefficient < 2^log2Max, and one of the precision bits is the sign
+        int log2Max = 0;
+        std::frexp(maxCoefficient, &log2Max);
+        const int shift = std::min(15, precision - log2Max - 1);
+        if (shift < 0)
+            return false;
+
+        const int32_t qMax = (1 << (precision - 1)) - 1;
+        const int32_t qMin = -(1 << (precision - 1));
+        std::array<int32_t, kMaxLpcOrder> qlp{};
+        double carried = 0.0;
+        for (int i = 0; i < order; ++i)
+        {
+            carried += lp[static_cast<size_t>(i)] * static_cast<double>(1 << shift);
+            const auto q = static_cast<int32_t>(std::clamp(std::lround(carried), static_cast<long>(qMin), static_cast<long>(qMax)));
+            carried -= q;
+            qlp[static_cast<size_t>(i)] = q;
+        }
+
+        constexpr int64_t kMaxResidual = int64_t(1) << 30;
+        for (int i = order; i < n; ++i)
+        {
+            int64_t prediction = 0;
+            for (int j = 0; j < order; ++j)
+                prediction += static_cast<int64_t>(qlp[static_cast<size_t>(j)]) * x[i - j - 1];
+
+            const int64_t r = x[i] - (prediction >> shift);
+            if (r >= kMaxResidual || r <= -kMaxResidual)
+                return false;
+            residual[static_cast<size_t>(i - order)] = static_cast<int32_t>(r);
+        }
+
+        out.write(static_cast<uint32_t>(0x20 | (order - 1)) << 1, 8);
+        for (int i = 0; i < order; ++i)
+            out.writeSigned(x[i], bitsPerSample);
+        out.write(static_cast<uint32_t>(precision - 1), 4);
+        out.writeSigned(shift, 5);
+        for (int i = 0; i < order; ++i)
+            out.writeSigned(qlp[static_cast<size_t>(i)], precision);
+        writeResidual(out, residual.data(), n, order);
+        return true;
+    }
+
+    // The smallest subframe for one channel of a block
+    BitWriter encodeSubframe(const int32_t* x, int n, int bitsPerSample, int precision, const std::vector<double>& window)
+    {
+        BitWriter out;
+
+        if (std::all_of(x, x + n, [first = x[0]](int32_t v) { return v == first; }))
+        {
+            out.write(0x00, 8);
+            out.writeSigned(x[0], bitsPerSample);
+            return out;
+        }
+
+        std::vector<int32_t> residual(static_cast<size_t>(n));
+
+        const int fixedOrder = chooseFixedOrder(x, n);
+        fixedResidual(x, n, fixedOrder, residual.data());
+        out.write(static_cast<uint32_t>(0x08 | fixedOrder) << 1, 8);
+        for (int i = 0; i < fixedOrder; ++i)
+            out.writeSigned(x[i], bitsPerSample);
+        writeResidual(out, residual.data(), n, fixedOrder);
+
+        BitWriter lpc;
+        if (encodeLpc(x, n, bitsPerSample, precision, window, residual, lpc) && lpc.getNumBits() < out.getNumBits())
+            out = std::move(lpc);
+
+        if (out.getNumBits() > 8 + static_cast<size_t>(n) * static_cast<size_t>(bitsPerSample))
+        {
+            BitWriter verbatim;
+            verbatim.write(0x01 << 1, 8);
+            for (int i = 0; i < n; ++i)
+                verbatim.writeSigned(x[i], bitsPerSample);
+            return verbatim;
+        }
+
+        return out;
+    }
+
+    // Tukey(0.5) window: the outer quarters of the block taper to zero
+    std::vector<double> tukeyWindow(int n)
+    {
+        std::vector<double> window(static_cast<size_t>(n), 1.0);
+        const int taper = n / 4;
+        for (int i = 0; i < taper; ++i)
+        {
+            const double w = 0.5 * (1.0 - std::cos(juce::MathConstants<double>::pi * i / taper));
+            window[static_cast<size_t>(i)] = w;
+            window[static_cast<size_t>(n - 1 - i)] = w;
+        }
+        return window;
+    }
+
+    // One complete frame from blockSize interleaved frames
+    std::vector<uint8_t> encodeFrame(const int32_t* interleaved, int numChannels, int blockSize, int bitsPerSample,
+                                     int sampleRate, uint32_t frameNumber)
+    {
+        const int precision = bitsPerSample <= 16 ? 12 : 15;
+
+        // Every block but the last has the standard size, so its window is built once
+        static const auto standardWindow = tukeyWindow(FlacFileWriter::kBlockSize);
+        const auto lastWindow = blockSize == FlacFileWriter::kBlockSize ? std::vector<double>() : tukeyWindow(blockSize);
+        const auto& window = lastWindow.empty() ? standardWindow : lastWindow;
+        const auto n = static_cast<size_t>(blockSize);
+
+        std::vector<std::vector<int32_t>> channels(static_cast<size_t>(numChannels), std::vector<int32_t>(n));
+        for (size_t i = 0; i < n; ++i)
+            for (size_t ch = 0; ch < channels.size(); ++ch)
+                channels[ch][i] = interleaved[i * channels.size() + ch];
+
+        std::vector<BitWriter> subframes;
+        int assignment = numChannels - 1;
+        if (numChannels == 2)
+        {
+            // Whichever of left/right, left/side, side/right and mid/side is smallest
+            std::vector<int32_t> side(n), mid(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const int64_t l = channels[0][i];
+                const int64_t r = channels[1][i];
+                side[i] = static_cast<int32_t>(l - r);
+                mid[i] = static_cast<int32_t>((l + r) >> 1);
+            }
+
+            auto left = encodeSubframe(channels[0].data(), blockSize, bitsPerSample, precision, window);
+            auto right = encodeSubframe(channels[1].data(), blockSize, bitsPerSample, precision, window);
+            auto sideFrame = encodeSubframe(side.data(), blockSize, bitsPerSample + 1, precision, window);
+            auto midFrame = encodeSubframe(mid.data(), blockSize, bitsPerSample, precision, window);
+
+            const std::array<size_t, 4> sizes{ left.getNumBits() + right.getNumBits(),
+                                               left.getNumBits() + sideFrame.getNumBits(),
+                                               sideFrame.getNumBits() + right.getNumBits(),
+                                               midFrame.getNumBits() + sideFrame.getNumBits() };
+            switch (std::min_element(sizes.begin(), sizes.end()) - sizes.begin())
+            {
+                case 1:  assignment = 8;  subframes.push_back(std::move(left)); subframes.push_back(std::move(sideFrame)); break;
+                case 2:  assignment = 9;  subframes.push_back(std::move(sideFrame)); subframes.push_back(std::move(right)); break;
+                case 3:  assignment = 10; subframes.push_back(std::move(midFrame)); subframes.push_back(std::move(sideFrame)); break;
+                default: subframes.push_back(std::move(left)); subframes.push_back(std::move(right)); break;
+            }
+        }
+        else
+        {
+            for (auto& channel : channels)
+                subframes.push_back(encodeSubframe(channel.data(), blockSize, bitsPerSample, precision, window));
+        }
+
+        BitWriter out;
+        out.write(0xFFF8, 16);   // Sync code, fixed block size
+        const bool standardSize = blockSize == FlacFileWriter::kBlockSize;
+        out.write(standardSize ? 12 : 7, 4);   // 12: 4096 samples; 7: 16-bit size at the end of the header
+        out.write(static_cast<uint32_t>(sampleRateCode(sampleRate)), 4);
+        out.write(static_cast<uint32_t>(assignment), 4);
+        out.write(bitsPerSample == 16 ? 4 : 6, 3);
+        out.write(0, 1);
+        writeFrameNumber(out, frameNumber);
+        if (!standardSize)
+            out.write(static_cast<uint32_t>(blockSize - 1), 16);
+        out.write(crc8(out.getBytes().data(), out.getBytes().size()), 8);
+
+        for (const auto& subframe : subframes)
+            out.append(subframe);
+
+        out.alignToByte();
+        out.write(crc16(out.getBytes().data(), out.getBytes().size()), 16);
+        return out.takeBytes();
+    }
+}
+
+FlacFileWriter::FlacFileWriter(const juce::File& file, int channels, double rate, int bits,
+                               DitherConverter::Dither dither, uint32_t ditherSeed)
+    : numChannels(std::clamp(channels, 1, kMaxChannels)),
+      sampleRate(rate),
+      bitsPerSample(bits == 16 ? 16 : 24),
+      converter(numChannels, bitsPerSample, dither, ditherSeed)
+{
+    if (channels > kMaxChannels)
+        return;
+
+    auto output = std::make_unique<juce::FileOutputStream>(file);
+    if (!output->openedOk())
+        return;
+
+    // FileOutputStream appends to existing files
+    output->setPosition(0);
+    output->truncate();
+    stream = std::move(output);
+
+    // Placeholder until the length and MD5 are known
+    const uint8_t noMd5[16] = {};
+    auto header = buildHeader(noMd5);
+    stream->write(header.getData(), header.getSize());
+    bytesWritten = header.getSize();
+}
+
+FlacFileWriter::~FlacFileWriter()
+{
+    finish();
+}
+
+juce::MemoryBlock FlacFileWriter::buildHeader(const uint8_t* md5) const
+{
+    BitWriter out;
+    for (char c : { 'f', 'L', 'a', 'C' })
+        out.write(static_cast<uint8_t>(c), 8);
+
+    // STREAMINFO, the only metadata block
+    out.write(1, 1);
+    out.write(0, 7);
+    out.write(kStreamInfoSize, 24);
+    out.write(kBlockSize, 16);
+    out.write(kBlockSize, 16);
+    out.write(minFrameBytes, 24);
+    out.write(maxFrameBytes, 24);
+    out.write(static_cast<uint32_t>(juce::roundToInt(sampleRate)), 20);
+    out.write(static_cast<uint32_t>(numChannels - 1), 3);
+    out.write(static_cast<uint32_t>(bitsPerSample - 1), 5);
+    out.write(static_cast<uint32_t>(framesWritten >> 32), 4);
+    out.write(static_cast<uint32_t>(framesWritten), 32);
+    for (int i = 0; i < 16; ++i)
+        out.write(md5[i], 8);
+
+    const auto& bytes = out.getBytes();
+    jassert(bytes.size() == kHeaderSize);
+    return juce::MemoryBlock(bytes.data(), bytes.size());
+}
+
+bool FlacFileWriter::write(const float* interleaved, size_t numFrames)
+{
+    if (stream == nullptr || finished)
+        return false;
+
+    const size_t numSamples = numFrames * static_cast<size_t>(numChannels);
+    packed.resize(numSamples * static_cast<size_t>(converter.getBytesPerSample()));
+    converter.convert(interleaved, numFrames, packed.data());
+
+    // STREAMINFO's MD5 is of exactly this little-endian PCM
+    audioChecksum.update(packed.data(), packed.size());
+
+    const size_t offset = pending.size();
+    pending.resize(offset + numSamples);
+    const uint8_t* p = packed.data();
+    if (bitsPerSample == 16)
+    {
+        for (size_t i = 0; i < numSamples; ++i, p += 2)
+            pending[offset + i] = static_cast<int16_t>(p[0] | (p[1] << 8));
+    }
+    else
+    {
+        for (size_t i = 0; i < numSamples; ++i, p += 3)
+            pending[offset + i] = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16)
+                                                       | (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+    }
+
+    pendingFrames += numFrames;
+    framesWritten += numFrames;
+
+    constexpr size_t batchFrames = static_cast<size_t>(kBlockSize) * kBlocksPerBatch;
+    while (pendingFrames >= batchFrames)
+        if (!encodeBlocks(batchFrames))
+            return false;
+
+    return true;
+}
+
+bool FlacFileWriter::encodeBlocks(size_t numFrames)
+{
+    // Frames are independent, so a batch is encoded on every core at once
+    const auto numBlocks = static_cast<int>((numFrames + kBlockSize - 1) / kBlockSize);
+    std::vector<std::vector<uint8_t>> frames(static_cast<size_t>(numBlocks));
+    parallelFor(numBlocks, [&](int block)
+    {
+        const size_t first = static_cast<size_t>(block) * kBlockSize;
+        const auto blockSize = static_cast<int>(std::min(static_cast<size_t>(kBlockSize), numFrames - first));
+        frames[static_cast<size_t>(block)] = encodeFrame(pending.data() + first * static_cast<size_t>(numChannels), numChannels,
+                                                         blockSize, bitsPerSample, juce::roundToInt(sampleRate),
+                                                         nextFrameNumber + static_cast<uint32_t>(block));
+    });
+
+    for (const auto& frame : frames)
+    {
+        if (!stream->write(frame.data(), frame.size()))
+            return false;
+
+        const auto size = static_cast<uint32_t>(frame.size());
+        minFrameBytes = minFrameBytes == 0 ? size : std::min(minFrameBytes, size);
+        maxFrameBytes = std::max(maxFrameBytes, size);
+        bytesWritten += frame.size();
+    }
+
+    nextFrameNumber += static_cast<uint32_t>(numBlocks);
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(numFrames * static_cast<size_t>(numChannels)));
+    pendingFrames -= numFrames;
+    return true;
+}
+
+bool FlacFileWriter::finish()
+{
+    if (stream == nullptr || finished)
+        return false;
+
+    finished = true;
+    bool ok = pendingFrames == 0 || encodeBlocks(pendingFrames);
+
+    const auto md5Hex = audioChecksum.finish().md5;
+    uint8_t md5[16] = {};
+    for (int i = 0; i < 16; ++i)
+        md5[i] = static_cast<uint8_t>(md5Hex.substring(i * 2, i * 2 + 2).getHexValue32());
+
+    auto header = buildHeader(md5);
+    stream->setPosition(0);
+    stream->write(header.getData(), header.getSize());
+
+    stream->flush();
+    ok = ok && stream->getStatus().wasOk();
+    stream.reset();
+    return ok;
+}
+
+juce::String FlacFileWriter::runBenchmark(const juce::File& ffmpeg, double seconds)
+{
+    if (!ffmpeg.existsAsFile())
+        return "ffmpeg not found - nothing to compare with\n";
+
+    constexpr double kSampleRate = 48000.0;
+    constexpr int kTimeoutMs = 600000;
+    const auto frames = static_cast<size_t>(seconds * kSampleRate);
+
+    juce::String report = "FLAC, " + juce::String(seconds, 1) + " s at 48 kHz (size of the PCM, x realtime)\n"
+                          "  format          this writer             ffmpeg -threads 1\n";
+
+    for (int numChannels : { 2, kMaxChannels })
+    {
+        // Channels cycle through close-miked music, ambience, room tone and silence
+        std::vector<float> input(frames * static_cast<size_t>(numChannels));
+        std::mt19937 random(1);
+        std::normal_distribution<float> noise(0.0f, 1.0f);
+        std::vector<float> lowpassed(static_cast<size_t>(numChannels), 0.0f);
+        for (size_t i = 0; i < frames; ++i)
+        {
+            const double t = static_cast<double>(i) / kSampleRate;
+            for (int c = 0; c < numChannels; ++c)
+            {
+                float v = 0.0f;
+                switch (c % 4)
+                {
+                    case 0: v = 0.18f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * (110.0 + 7.0 * c) * t)
+                                                           * (0.6 + 0.4 * std::sin(t * 1.3)))
+                              + 0.08f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 660.0 * t))
+                              + 0.001f * noise(random);
+                            break;
+                    case 1: lowpassed[static_cast<size_t>(c)] += 0.05f * (noise(random) - lowpassed[static_cast<size_t>(c)]);
+                            v = 0.12f * lowpassed[static_cast<size_t>(c)];
+                            break;
+                    case 2: v = 0.0001f * noise(random); break;
+                    default: break;
+                }
+                input[i * static_cast<size_t>(numChannels) + static_cast<size_t>(c)] = v;
+            }
+        }
+
+        for (int bits : { 16, 24 })
+        {
+            const double pcmBytes = static_cast<double>(frames) * numChannels * bits / 8.0;
+            auto describe = [&](double bytes, double wallSeconds)
+            {
+                return (juce::String(bytes / pcmBytes, 3) + "  " + juce::String(seconds / std::max(wallSeconds, 1.0e-9), 0) + "x")
+                           .paddedRight(' ', 24);
+            };
+
+            // Both encoders get the same samples: undithered, through a WAV for ffmpeg
+            juce::TemporaryFile wav(".wav");
+            {
+                WavFileWriter writer(wav.getFile(), numChannels, kSampleRate, bits, DitherConverter::Dither::None, 1, frames);
+                if (!writer.write(input.data(), frames) || !writer.finish())
+                    return report + "Could not write the benchmark source\n";
+            }
+
+            juce::TemporaryFile ours(".flac");
+            double start = juce::Time::getMillisecondCounterHiRes();
+            double ourBytes = 0.0;
+            {
+                FlacFileWriter writer(ours.getFile(), numChannels, kSampleRate, bits, DitherConverter::Dither::None, 1);
+                writer.write(input.data(), frames);
+                writer.finish();
+                ourBytes = static_cast<double>(writer.getBytesWritten());
+            }
+            const double ourSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+            juce::TemporaryFile theirs(".flac");
+            juce::StringArray args;
+            args.add(ffmpeg.getFullPathName());
+            args.add("-v");
+            args.add("error");
+            args.add("-y");
+            args.add("-i");
+            args.add(wav.getFile().getFullPathName());
+            args.add("-threads");
+            args.add("1");
+            args.add("-c:a");
+            args.add("flac");
+            if (bits == 24)
+            {
+                args.add("-sample_fmt");
+                args.add("s32");
+                args.add("-bits_per_raw_sample");
+                args.add("24");
+            }
+            args.add(theirs.getFile().getFullPathName());
+
+            start = juce::Time::getMillisecondCounterHiRes();
+            SpawnedProcess process;
+            if (!process.start(args, SpawnedProcess::wantStdOut | SpawnedProcess::wantStdErr))
+                return report + "Could not start " + ffmpeg.getFullPathName() + "\n";
+            const auto output = process.readAllProcessOutput();
+            process.waitForProcessToFinish(kTimeoutMs);
+            const double theirSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+            if (process.getExitCode() != 0)
+                return report + "ffmpeg failed:\n" + output;
+
+            report += "  " + (juce::String(numChannels) + " ch " + juce::String(bits) + "-bit").paddedRight(' ', 16)
+                    + describe(ourBytes, ourSeconds)
+                    + describe(static_cast<double>(theirs.getFile().getSize()), theirSeconds).trimEnd() + "\n";
+        }
+    }
+
+    return report;
+}
+
+//==============================================================================
+class FlacFileWriterTests : public juce::UnitTest
+{
+public:
+    FlacFileWriterTests() : juce::UnitTest("FlacFileWriter", "ChannelStacker") {}
+
+    void runTest() override
+    {
+        // A plain tone is almost perfectly predictable: LPC must get it
+        // well below the size of the PCM (coefficients quantised with one
+        // bit too many clip and give most of that back)
+        for (const auto& [bits, maxRatio] : { std::pair<int, double>{ 16, 0.27 }, { 24, 0.47 } })
+        {
+            beginTest("1 kHz sine at " + juce::String(bits) + " bits");
+
+            constexpr double fs = 48000.0;
+            std::vector<float> sine(static_cast<size_t>(5.0 * fs));
+            for (size_t i = 0; i < sine.size(); ++i)
+                sine[i] = 0.5f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 1000.0 * static_cast<double>(i) / fs));
+
+            juce::TemporaryFile file(".flac");
+            FlacFileWriter writer(file.getFile(), 1, fs, bits, DitherConverter::Dither::None, 1);
+            expect(writer.write(sine.data(), sine.size()));
+            expect(writer.finish());
+
+            const double ratio = static_cast<double>(writer.getBytesWritten()) / static_cast<double>(sine.size() * static_cast<size_t>(bits / 8));
+            expectLessThan(ratio, maxRatio);
+        }
+    }
+};
+
+static FlacFileWriterTests flacFileWriterTests;
@@ -0,0 +1,81 @@
+/*
+    ChannelStacker - FLAC File Writer Header
+    Streams interleaved float audio to a 16/24-bit FLAC file. Samples go
+    through DitherConverter as for WAV, then into fixed-size blocks that are
+    independent FLAC frames; a batch of blocks is encoded across all cores
+    at once and the frames are written in order. Each frame picks the
+    cheapest of constant, verbatim, fixed and LPC prediction per channel
+    (with mid/side for stereo), Rice-coding the residual.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "AudioFileWriter.h"
+#include "DitherConverter.h"
+#include "StreamChecksum.h"
+#include <memory>
+#include <vector>
+
+class FlacFileWriter : public AudioFileWriter
+{
+public:
+    // bitsPerSample: 16 or 24. ditherSeed keys the dither noise; give
+    // every file of an export its own.
+    FlacFileWriter(const juce::File& file, int numChannels, double sampleRate,
+                   int bitsPerSample, DitherConverter::Dither dither, uint32_t ditherSeed);
+    ~FlacFileWriter() override;
+
+    bool openedOk() const override { return stream != nullptr; }
+
+    bool write(const float* interleaved, size_t numFrames) override;
+
+    // Encode the last blocks and fill in STREAMINFO (length, frame sizes, MD5)
+    bool finish() override;
+
+    uint64_t getFramesWritten() const override { return framesWritten; }
+
+    // Never valid: STREAMINFO is patched once the MD5 of the audio is known
+    const StreamChecksum::Digest& getChecksums() const override { return checksums; }
+
+    // Size of the file so far, for the compression ratio
+    uint64_t getBytesWritten() const { return bytesWritten; }
+
+    // Size and speed against ffmpeg's FLAC encoder on one thread, on the
+    // kinds of material multichannel recordings hold
+    static juce::String runBenchmark(const juce::File& ffmpeg, double seconds);
+
+    // The format allows no more than this per file
+    static constexpr int kMaxChannels = 8;
+
+    // Samples per channel in each frame
+    static constexpr int kBlockSize = 4096;
+
+    // Blocks encoded in parallel before they are written
+    static constexpr int kBlocksPerBatch = 64;
+
+private:
+    juce::MemoryBlock buildHeader(const uint8_t* md5) const;
+    bool encodeBlocks(size_t numFrames);
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+    int numChannels;
+    double sampleRate;
+    int bitsPerSample;
+    DitherConverter converter;
+
+    std::vector<uint8_t> packed;        // Dithered PCM, as hashed for STREAMINFO
+    std::vector<int32_t> pending;       // Interleaved samples not yet in a frame
+    size_t pendingFrames = 0;
+
+    StreamChecksum audioChecksum;
+    StreamChecksum::Digest checksums;
+    uint64_t framesWritten = 0;
+    uint64_t bytesWritten = 0;
+    uint32_t nextFrameNumber = 0;
+    uint32_t minFrameBytes = 0;
+    uint32_t maxFrameBytes = 0;
+    bool finished = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FlacFileWriter)
+};
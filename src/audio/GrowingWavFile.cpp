@@ -0,0 +1,191 @@
+/*
+    ChannelStacker - Growing WAV File Implementation
+*/
+
+#include "GrowingWavFile.h"
+#include "BlockCache.h"
+#include <algorithm>
+#include <cstring>
+
+#if JUCE_LINUX
+ #include <poll.h>
+ #include <sys/inotify.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    // fmt, bext, iXML and friends come before the audio; a header bigger
+    // than this isn't worth following
+    constexpr size_t kMaxHeaderBytes = 1 << 20;
+
+    uint16_t read16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+
+    uint32_t read32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8
+             | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    uint64_t read64(const uint8_t* p) { return read32(p) | static_cast<uint64_t>(read32(p + 4)) << 32; }
+}
+
+GrowingWavFile::GrowingWavFile(const juce::File& f)
+    : file(f)
+{
+}
+
+GrowingWavFile::~GrowingWavFile()
+{
+   #if JUCE_LINUX
+    if (notifyFd >= 0)
+        close(notifyFd);
+   #endif
+}
+
+size_t GrowingWavFile::getFrameBytes() const
+{
+    return static_cast<size_t>(numChannels) * static_cast<size_t>(SampleKernels::bytesPerSample(format));
+}
+
+bool GrowingWavFile::refresh()
+{
+    const int64_t fileSize = file.getSize();
+
+    // Shorter than before: rewritten, so cached blocks may be stale
+    if (fileSize < lastFileSize)
+        BlockCache::getInstance().invalidate(file);
+    lastFileSize = fileSize;
+
+    juce::FileInputStream in(file);
+    if (!in.openedOk())
+        return false;
+
+    // Once the data chunk has been found only the chunks before it are
+    // re-read; they don't move while a recorder appends
+    const int64_t headerBytes = dataOffset > 0 ? dataOffset : static_cast<int64_t>(kMaxHeaderBytes);
+    juce::MemoryBlock header(static_cast<size_t>(std::clamp<int64_t>(fileSize, 0, headerBytes)));
+    header.setSize(static_cast<size_t>(std::max(0, in.read(header.getData(), static_cast<int>(header.getSize())))));
+    const auto* base = static_cast<const uint8_t*>(header.getData());
+    const uint64_t size = header.getSize();
+    if (size < 12 || std::memcmp(base + 8, "WAVE", 4) != 0)
+        return false;
+
+    const bool rf64 = std::memcmp(base, "RF64", 4) == 0;
+    if (!rf64 && std::memcmp(base, "RIFF", 4) != 0)
+        return false;
+
+    uint64_t ds64DataSize = 0;
+    int formatTag = 0;
+    int bitsPerSample = 0;
+    numChannels = 0;
+
+    for (uint64_t pos = 12; pos + 8 <= size;)
+    {
+        const uint8_t* chunk = base + pos;
+        const uint64_t chunkSize = read32(chunk + 4);
+        const uint64_t bodySize = size - pos - 8;
+
+        if (std::memcmp(chunk, "ds64", 4) == 0 && chunkSize >= 16 && bodySize >= 16)
+        {
+            ds64DataSize = read64(chunk + 16);
+        }
+        else if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16 && bodySize >= 16)
+        {
+            formatTag = read16(chunk + 8);
+            numChannels = read16(chunk + 10);
+            sampleRate = read32(chunk + 12);
+            bitsPerSample = read16(chunk + 22);
+
+            // WAVE_FORMAT_EXTENSIBLE: the real tag leads the sub-format GUID
+            if (formatTag == 0xFFFE && chunkSize >= 40 && bodySize >= 40)
+                formatTag = read16(chunk + 32);
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            if (numChannels <= 0 || sampleRate <= 0.0)
+                return false;
+
+            if (formatTag == 1 && bitsPerSample == 16)      format = SampleFormat::S16;
+            else if (formatTag == 1 && bitsPerSample == 24) format = SampleFormat::S24;
+            else if (formatTag == 1 && bitsPerSample == 32) format = SampleFormat::S32;
+            else if (formatTag == 3 && bitsPerSample == 32) format = SampleFormat::F32;
+            else if (formatTag == 3 && bitsPerSample == 64) format = SampleFormat::F64;
+            else return false;
+
+            // 0 and 0xFFFFFFFF (or an unwritten ds64) mean "not known yet"
+            uint64_t declared = rf64 && chunkSize == 0xFFFFFFFFull ? ds64DataSize : chunkSize;
+            const bool placeholder = declared == 0 || declared == 0xFFFFFFFFull || declared == ~0ull;
+
+            dataOffset = static_cast<int64_t>(pos + 8);
+            const auto onDisk = static_cast<uint64_t>(std::max<int64_t>(0, fileSize - dataOffset));
+            finalised = !placeholder && declared <= onDisk;
+
+            // A size updated now and then is trusted up to where it points,
+            // since whatever follows the data chunk isn't audio
+            const uint64_t readable = placeholder ? onDisk : std::min(declared, onDisk);
+            numFrames = static_cast<int64_t>(readable / getFrameBytes());
+            return true;
+        }
+
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    return false;
+}
+
+bool GrowingWavFile::read(int64_t firstFrame, size_t numFramesToRead, float* interleaved)
+{
+    if (numChannels <= 0 || firstFrame < 0 || firstFrame + static_cast<int64_t>(numFramesToRead) > numFrames)
+        return false;
+
+    const size_t numBytes = numFramesToRead * getFrameBytes();
+    raw.resize(numBytes);
+    const int64_t offset = dataOffset + firstFrame * static_cast<int64_t>(getFrameBytes());
+    if (BlockCache::getInstance().read(file, offset, raw.data(), numBytes) != numBytes)
+        return false;
+
+    SampleKernels::get(format, numChannels).toFloat(raw.data(), interleaved, numFramesToRead * static_cast<size_t>(numChannels));
+    return true;
+}
+
+bool GrowingWavFile::waitForChange(int timeoutMs)
+{
+   #if JUCE_LINUX
+    if (notifyFd < 0)
+    {
+        notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (notifyFd >= 0 && inotify_add_watch(notifyFd, file.getFullPathName().toRawUTF8(),
+                                               IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB) < 0)
+        {
+            close(notifyFd);
+            notifyFd = -1;
+        }
+    }
+
+    // Network mounts never raise inotify events for remote writes, so a
+    // quiet timeout still falls through to the size check
+    if (notifyFd >= 0)
+    {
+        pollfd fds{ notifyFd, POLLIN, 0 };
+        if (poll(&fds, 1, timeoutMs) > 0)
+        {
+            alignas(inotify_event) char events[4096];
+            while (::read(notifyFd, events, sizeof(events)) > 0) {}
+            return true;
+        }
+    }
+    else
+   #endif
+    {
+        juce::Thread::sleep(timeoutMs);
+    }
+
+    return file.getSize() != lastFileSize;
+}
+
+bool GrowingWavFile::canFollow(const juce::File& file)
+{
+    GrowingWavFile wav(file);
+    return wav.refresh();
+}
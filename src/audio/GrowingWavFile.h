@@ -0,0 +1,69 @@
+/*
+    ChannelStacker - Growing WAV File Header
+    Native reader for a PCM WAV/RF64/BWF file that a recorder is still
+    writing. Recorders leave the data chunk's size at a placeholder (0 or
+    0xFFFFFFFF) or update it only now and then, so while the header isn't
+    final the readable length comes from the file size instead. Reads are
+    by frame, so a follower can pick up exactly where it stopped, and
+    waitForChange() sleeps on inotify (Linux) or polls the size elsewhere.
+    Finished files read the same way. Sample data comes through the shared
+    BlockCache, so readers of the same file share its reads.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "SampleKernels.h"
+#include <cstdint>
+#include <vector>
+
+class GrowingWavFile
+{
+public:
+    explicit GrowingWavFile(const juce::File& file);
+    ~GrowingWavFile();
+
+    // Re-read the header and size. False if the file isn't (or not yet)
+    // PCM/float WAV that can be read natively.
+    bool refresh();
+
+    int getNumChannels() const noexcept { return numChannels; }
+    double getSampleRate() const noexcept { return sampleRate; }
+    SampleFormat getFormat() const noexcept { return format; }
+
+    // Whole frames on disk as of the last refresh()
+    int64_t getNumFrames() const noexcept { return numFrames; }
+
+    // The header's data size has been written and all of it is on disk:
+    // the recorder has finished with the file
+    bool isFinalised() const noexcept { return finalised; }
+
+    // Frames [firstFrame, firstFrame + numFramesToRead) as interleaved
+    // float; the range must lie within getNumFrames()
+    bool read(int64_t firstFrame, size_t numFramesToRead, float* interleaved);
+
+    // Wait up to timeoutMs for the file to change. True if its size moved
+    // or it was written to; false on a quiet timeout.
+    bool waitForChange(int timeoutMs);
+
+    // Quick check for the follow-import mode
+    static bool canFollow(const juce::File& file);
+
+private:
+    size_t getFrameBytes() const;
+
+    juce::File file;
+    std::vector<char> raw;
+
+    int numChannels = 0;
+    double sampleRate = 0.0;
+    SampleFormat format = SampleFormat::S16;
+    int64_t dataOffset = 0;
+    int64_t numFrames = 0;
+    int64_t lastFileSize = -1;
+    bool finalised = false;
+
+    int notifyFd = -1;      // inotify instance watching the file (Linux)
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GrowingWavFile)
+};
@@ -0,0 +1,567 @@
+/*
+    ChannelStacker - Loudness Meter Implementation
+*/
+
+#include "LoudnessMeter.h"
+#include "ParallelFor.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    constexpr int kChannelsPerGroup = 8;
+    constexpr double kAbsoluteGateLufs = -70.0;
+    constexpr double kIntegratedRelativeGate = -10.0;
+    constexpr double kRangeRelativeGate = -20.0;
+
+    double powerToLufs(double power)
+    {
+        return power > 0.0 ? -0.691 + 10.0 * std::log10(power) : -INFINITY;
+    }
+
+    double lufsToPower(double lufs)
+    {
+        return std::pow(10.0, (lufs + 0.691) / 10.0);
+    }
+
+    double gainToDb(float gain)
+    {
+        return gain > 0.0f ? 20.0 * std::log10(static_cast<double>(gain)) : -INFINITY;
+    }
+
+    // Mean power of every window of windowBlocks consecutive blocks (hop = 1 block)
+    std::vector<double> slidingMeans(const std::vector<double>& power, int windowBlocks)
+    {
+        std::vector<double> means;
+        auto window = static_cast<size_t>(windowBlocks);
+        if (power.size() < window)
+            return means;
+
+        means.reserve(power.size() - window + 1);
+        double sum = 0.0;
+        for (size_t i = 0; i < power.size(); ++i)
+        {
+            sum += power[i];
+            if (i >= window)
+                sum -= power[i - window];
+            if (i + 1 >= window)
+                means.push_back(std::max(0.0, sum) / static_cast<double>(window));
+        }
+        return means;
+    }
+
+    juce::String formatLevel(double value, const char* unit)
+    {
+        if (!std::isfinite(value))
+            return juce::String("-inf ") + unit;
+        return juce::String(value, 1) + " " + unit;
+    }
+}
+
+LoudnessMeter::LoudnessMeter(int channels, double sampleRate)
+    : numChannels(std::max(1, channels))
+{
+    const double fs = sampleRate > 0.0 ? sampleRate : 48000.0;
+    const double pi = juce::MathConstants<double>::pi;
+    samplesPerBlock = std::max<size_t>(1, static_cast<size_t>(std::lround(fs * kBlockSeconds)));
+
+    // K-weighting, stage 1: high shelf (BS.1770 coefficients re-derived for fs)
+    {
+        const double f0 = 1681.974450955533;
+        const double gainDb = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(pi * f0 / fs);
+        const double vh = std::pow(10.0, gainDb / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+
+        shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        shelf.b1 = 2.0 * (k * k - vh) / a0;
+        shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        shelf.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    // K-weighting, stage 2: RLB high-pass
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(pi * f0 / fs);
+        const double a0 = 1.0 + k / q + k * k;
+
+        highPass.b0 = 1.0;
+        highPass.b1 = -2.0;
+        highPass.b2 = 1.0;
+        highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+        highPass.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    // True peak: 48-tap windowed-sinc interpolator split into 4 phases,
+    // each normalised to unity DC gain
+    constexpr int kTotalTaps = kOversampling * kTapsPerPhase;
+    double prototype[kTotalTaps];
+    for (int n = 0; n < kTotalTaps; ++n)
+    {
+        double t = (static_cast<double>(n) - (kTotalTaps - 1) / 2.0) / kOversampling;
+        double sinc = std::abs(t) < 1.0e-9 ? 1.0 : std::sin(pi * t) / (pi * t);
+        double window = 0.5 - 0.5 * std::cos(2.0 * pi * (n + 1) / (kTotalTaps + 1));
+        prototype[n] = sinc * window;
+    }
+
+    maxPhaseGain = 0.0f;
+    for (int p = 0; p < kOversampling; ++p)
+    {
+        double dcGain = 0.0;
+        for (int k = 0; k < kTapsPerPhase; ++k)
+            dcGain += prototype[p + k * kOversampling];
+
+        float absGain = 0.0f;
+        for (int k = 0; k < kTapsPerPhase; ++k)
+        {
+            phaseTaps[p][k] = static_cast<float>(prototype[p + k * kOversampling] / dcGain);
+            absGain += std::abs(phaseTaps[p][k]);
+        }
+        maxPhaseGain = std::max(maxPhaseGain, absGain);
+    }
+
+    auto channelCount = static_cast<size_t>(numChannels);
+    shelfZ1.assign(channelCount, 0.0);
+    shelfZ2.assign(channelCount, 0.0);
+    highPassZ1.assign(channelCount, 0.0);
+    highPassZ2.assign(channelCount, 0.0);
+    blockEnergy.assign(channelCount, 0.0);
+    blockEnergies.resize(channelCount);
+    history.assign(channelCount * static_cast<size_t>(kTapsPerPhase - 1), 0.0f);
+    samplePeaks.assign(channelCount, 0.0f);
+    truePeaks.assign(channelCount, 0.0f);
+    blockSamplePeak.assign(channelCount, 0.0f);
+    blockTruePeak.assign(channelCount, 0.0f);
+    blockSamplePeaks.resize(channelCount);
+    blockTruePeaks.resize(channelCount);
+}
+
+LoudnessMeter::~LoudnessMeter() = default;
+
+void LoudnessMeter::process(const float* interleaved, size_t numFrames)
+{
+    if (numFrames == 0)
+        return;
+
+    const int numGroups = getNumGroups();
+    auto runGroup = [&](int group) { processGroup(group, interleaved, numFrames); };
+
+    // Fan out across cores only when the batch is worth the hand-off
+    if (numGroups > 1 && numFrames * static_cast<size_t>(numChannels) >= (1u << 16))
+        parallelFor(numGroups, runGroup);
+    else
+        for (int group = 0; group < numGroups; ++group)
+            runGroup(group);
+
+    endBatch(numFrames);
+}
+
+int LoudnessMeter::getNumGroups() const noexcept
+{
+    return (numChannels + kChannelsPerGroup - 1) / kChannelsPerGroup;
+}
+
+void LoudnessMeter::processGroup(int group, const float* interleaved, size_t numFrames)
+{
+    const int first = group * kChannelsPerGroup;
+    processChannels(interleaved, numFrames, first, std::min(numChannels, first + kChannelsPerGroup), blockFill);
+}
+
+void LoudnessMeter::endBatch(size_t numFrames)
+{
+    blockFill = (blockFill + numFrames) % samplesPerBlock;
+}
+
+void LoudnessMeter::processChannels(const float* interleaved, size_t numFrames,
+                                 int firstChannel, int endChannel, size_t startFill)
+{
+    const size_t stride = static_cast<size_t>(numChannels);
+    const Biquad s = shelf;
+    const Biquad h = highPass;
+
+    double* sz1 = shelfZ1.data();
+    double* sz2 = shelfZ2.data();
+    double* hz1 = highPassZ1.data();
+    double* hz2 = highPassZ2.data();
+    double* energy = blockEnergy.data();
+
+    size_t fill = startFill;
+    for (size_t frame = 0; frame < numFrames;)
+    {
+        size_t run = std::min(numFrames - frame, samplesPerBlock - fill);
+
+        for (size_t i = 0; i < run; ++i)
+        {
+            const float* x = interleaved + (frame + i) * stride;
+
+            // Channels of a frame are contiguous, so this loop vectorises
+            for (int c = firstChannel; c < endChannel; ++c)
+            {
+                double in = static_cast<double>(x[c]);
+
+                double y1 = s.b0 * in + sz1[c];
+                sz1[c] = s.b1 * in - s.a1 * y1 + sz2[c];
+                sz2[c] = s.b2 * in - s.a2 * y1;
+
+                double y2 = h.b0 * y1 + hz1[c];
+                hz1[c] = h.b1 * y1 - h.a1 * y2 + hz2[c];
+                hz2[c] = h.b2 * y1 - h.a2 * y2;
+
+                energy[c] += y2 * y2;
+            }
+        }
+
+        frame += run;
+        fill += run;
+
+        if (fill == samplesPerBlock)
+        {
+            for (int c = firstChannel; c < endChannel; ++c)
+            {
+                blockEnergies[static_cast<size_t>(c)].push_back(static_cast<float>(energy[c] / static_cast<double>(samplesPerBlock)));
+                energy[c] = 0.0;
+            }
+            fill = 0;
+        }
+    }
+
+    std::vector<float> scratch;
+    for (int c = firstChannel; c < endChannel; ++c)
+        processPeaks(interleaved, numFrames, c, startFill, scratch);
+}
+
+void LoudnessMeter::processPeaks(const float* interleaved, size_t numFrames, int channel, size_t startFill,
+                                 std::vector<float>& scratch)
+{
+    constexpr size_t kHistory = static_cast<size_t>(kTapsPerPhase - 1);
+    const size_t stride = static_cast<size_t>(numChannels);
+    const auto c = static_cast<size_t>(channel);
+
+    // Planar copy: [history | new samples] followed by room for the filter output
+    scratch.resize(kHistory + 2 * numFrames);
+    float* input = scratch.data();
+    float* output = input + kHistory + numFrames;
+
+    std::copy_n(history.begin() + static_cast<std::ptrdiff_t>(c * kHistory), kHistory, input);
+    for (size_t i = 0; i < numFrames; ++i)
+        input[kHistory + i] = interleaved[i * stride + c];
+
+    auto peakOf = [](const float* data, size_t count)
+    {
+        auto range = juce::FloatVectorOperations::findMinAndMax(data, static_cast<int>(count));
+        return std::max(std::abs(range.getStart()), std::abs(range.getEnd()));
+    };
+
+    // Peaks are kept per 100 ms block, on the same boundaries as the energies
+    size_t fill = startFill;
+    for (size_t start = 0; start < numFrames;)
+    {
+        const size_t run = std::min(numFrames - start, samplesPerBlock - fill);
+        const float* segment = input + kHistory + start;
+
+        float segmentPeak = peakOf(segment, run);
+        blockSamplePeak[c] = std::max(blockSamplePeak[c], segmentPeak);
+        blockTruePeak[c] = std::max(blockTruePeak[c], segmentPeak);
+
+        // The interpolated signal can't exceed the window peak times the
+        // filter's L1 gain, so quiet stretches of a block skip the filter
+        if (peakOf(segment - kHistory, kHistory + run) * maxPhaseGain > blockTruePeak[c])
+        {
+            for (int p = 0; p < kOversampling; ++p)
+            {
+                std::fill_n(output, run, 0.0f);
+
+                for (int k = 0; k < kTapsPerPhase; ++k)
+                {
+                    const float tap = phaseTaps[p][k];
+                    const float* x = segment - static_cast<size_t>(k);
+                    for (size_t t = 0; t < run; ++t)
+                        output[t] += tap * x[t];
+                }
+
+                blockTruePeak[c] = std::max(blockTruePeak[c], peakOf(output, run));
+            }
+        }
+
+        start += run;
+        fill += run;
+
+        if (fill == samplesPerBlock)
+        {
+            blockSamplePeaks[c].push_back(blockSamplePeak[c]);
+            blockTruePeaks[c].push_back(blockTruePeak[c]);
+            samplePeaks[c] = std::max(samplePeaks[c], blockSamplePeak[c]);
+            truePeaks[c] = std::max(truePeaks[c], blockTruePeak[c]);
+            blockSamplePeak[c] = 0.0f;
+            blockTruePeak[c] = 0.0f;
+            fill = 0;
+        }
+    }
+
+    std::copy_n(input + numFrames, kHistory, history.begin() + static_cast<std::ptrdiff_t>(c * kHistory));
+}
+
+std::shared_ptr<LoudnessData> LoudnessMeter::getChannelData(int channel) const
+{
+    auto data = std::make_shared<LoudnessData>();
+    if (channel < 0 || channel >= numChannels)
+        return data;
+
+    auto c = static_cast<size_t>(channel);
+    data->blockEnergies = blockEnergies[c];
+    data->blockSamplePeaks = blockSamplePeaks[c];
+    data->blockTruePeaks = blockTruePeaks[c];
+    data->samplePeak = std::max(samplePeaks[c], blockSamplePeak[c]);
+    data->truePeak = std::max(truePeaks[c], blockTruePeak[c]);
+
+    // The unfinished block has no energy, but its peaks still count
+    if (blockTruePeak[c] > 0.0f)
+    {
+        data->blockSamplePeaks.push_back(blockSamplePeak[c]);
+        data->blockTruePeaks.push_back(blockTruePeak[c]);
+    }
+
+    data->summary = summarise({ data.get() });
+    return data;
+}
+
+LoudnessSummary LoudnessMeter::summarise(const std::vector<const LoudnessData*>& channels)
+{
+    LoudnessSummary summary;
+
+    size_t numBlocks = 0;
+    float samplePeak = 0.0f;
+    float truePeak = 0.0f;
+    for (const auto* channel : channels)
+    {
+        if (channel == nullptr)
+            continue;
+        numBlocks = std::max(numBlocks, channel->blockEnergies.size());
+        samplePeak = std::max(samplePeak, channel->samplePeak);
+        truePeak = std::max(truePeak, channel->truePeak);
+    }
+
+    summary.samplePeakDbfs = gainToDb(samplePeak);
+    summary.truePeakDbtp = gainToDb(truePeak);
+
+    // Sum the weighted channel powers per 100 ms block (all weights 1.0 -
+    // lanes carry no loudspeaker position)
+    std::vector<double> power(numBlocks, 0.0);
+    for (const auto* channel : channels)
+    {
+        if (channel == nullptr)
+            continue;
+        for (size_t i = 0; i < channel->blockEnergies.size(); ++i)
+            power[i] += static_cast<double>(channel->blockEnergies[i]);
+    }
+
+    auto momentary = slidingMeans(power, kMomentaryBlocks);
+    if (momentary.empty())
+        return summary;
+
+    summary.isValid = true;
+
+    // Momentary windows double as the 75%-overlap gating blocks
+    const double absoluteGate = lufsToPower(kAbsoluteGateLufs);
+    double gatedSum = 0.0;
+    size_t gatedCount = 0;
+    double maxMomentary = 0.0;
+    for (double p : momentary)
+    {
+        maxMomentary = std::max(maxMomentary, p);
+        if (p > absoluteGate)
+        {
+            gatedSum += p;
+            ++gatedCount;
+        }
+    }
+    summary.maxMomentaryLufs = powerToLufs(maxMomentary);
+
+    if (gatedCount > 0)
+    {
+        const double relativeGate = gatedSum / static_cast<double>(gatedCount)
+                                  * std::pow(10.0, kIntegratedRelativeGate / 10.0);
+        double sum = 0.0;
+        size_t count = 0;
+        for (double p : momentary)
+        {
+            if (p > absoluteGate && p > relativeGate)
+            {
+                sum += p;
+                ++count;
+            }
+        }
+        if (count > 0)
+            summary.integratedLufs = powerToLufs(sum / static_cast<double>(count));
+    }
+
+    // Short-term (3 s, 10 Hz) for the maximum and the loudness range
+    auto shortTerm = slidingMeans(power, kShortTermBlocks);
+    std::vector<double> rangeBlocks;
+    double shortTermSum = 0.0;
+    double maxShortTerm = 0.0;
+    for (double p : shortTerm)
+    {
+        maxShortTerm = std::max(maxShortTerm, p);
+        if (p > absoluteGate)
+        {
+            rangeBlocks.push_back(p);
+            shortTermSum += p;
+        }
+    }
+    if (!shortTerm.empty())
+        summary.maxShortTermLufs = powerToLufs(maxShortTerm);
+
+    if (!rangeBlocks.empty())
+    {
+        const double relativeGate = shortTermSum / static_cast<double>(rangeBlocks.size())
+                                  * std::pow(10.0, kRangeRelativeGate / 10.0);
+        std::vector<double> levels;
+        for (double p : rangeBlocks)
+            if (p > relativeGate)
+                levels.push_back(powerToLufs(p));
+
+        if (!levels.empty())
+        {
+            std::sort(levels.begin(), levels.end());
+            auto percentile = [&levels](double fraction)
+            {
+                auto index = static_cast<size_t>(std::lround(fraction * static_cast<double>(levels.size() - 1)));
+                return levels[index];
+            };
+            summary.loudnessRange = percentile(0.95) - percentile(0.10);
+        }
+    }
+
+    return summary;
+}
+
+std::shared_ptr<LoudnessData> LoudnessMeter::edit(const LoudnessData& channel, double startSeconds, double endSeconds,
+                                                  double delaySeconds, double lengthSeconds)
+{
+    auto nearest = [](double seconds) { return static_cast<size_t>(std::max(0.0, std::round(seconds / kBlockSeconds))); };
+    auto down = [](double seconds) { return static_cast<size_t>(std::max(0.0, std::floor(seconds / kBlockSeconds))); };
+    auto up = [](double seconds) { return static_cast<size_t>(std::max(0.0, std::ceil(seconds / kBlockSeconds))); };
+
+    const size_t delay = nearest(delaySeconds);
+    const size_t limit = lengthSeconds > 0.0 ? up(lengthSeconds) : std::numeric_limits<size_t>::max();
+
+    // Source blocks [first, last) land after the delay, up to the output length
+    auto keep = [&](const std::vector<float>& blocks, size_t first, size_t last)
+    {
+        last = std::min(last, blocks.size());
+        std::vector<float> kept(std::min(delay, limit), 0.0f);
+        for (size_t i = first; i < last && kept.size() < limit; ++i)
+            kept.push_back(blocks[i]);
+        return kept;
+    };
+
+    const bool toEnd = endSeconds <= 0.0;
+    auto edited = std::make_shared<LoudnessData>();
+    edited->blockEnergies = keep(channel.blockEnergies, nearest(startSeconds),
+                                 toEnd ? channel.blockEnergies.size() : nearest(endSeconds));
+
+    // Partly kept blocks count in full towards the peaks
+    const size_t peakEnd = toEnd ? channel.blockTruePeaks.size() : up(endSeconds);
+    edited->blockSamplePeaks = keep(channel.blockSamplePeaks, down(startSeconds), peakEnd);
+    edited->blockTruePeaks = keep(channel.blockTruePeaks, down(startSeconds), peakEnd);
+
+    for (float peak : edited->blockSamplePeaks)
+        edited->samplePeak = std::max(edited->samplePeak, peak);
+    for (float peak : edited->blockTruePeaks)
+        edited->truePeak = std::max(edited->truePeak, peak);
+
+    edited->summary = summarise({ edited.get() });
+    return edited;
+}
+
+juce::String LoudnessMeter::describe(const LoudnessSummary& summary)
+{
+    if (!summary.isValid)
+        return "loudness n/a";
+
+    return "I " + formatLevel(summary.integratedLufs, "LUFS")
+         + ", LRA " + juce::String(summary.loudnessRange, 1) + " LU"
+         + ", M max " + formatLevel(summary.maxMomentaryLufs, "LUFS")
+         + ", S max " + formatLevel(summary.maxShortTermLufs, "LUFS")
+         + ", TP " + formatLevel(summary.truePeakDbtp, "dBTP");
+}
+
+//==============================================================================
+class LoudnessMeterTests : public juce::UnitTest
+{
+public:
+    LoudnessMeterTests() : juce::UnitTest("LoudnessMeter", "ChannelStacker") {}
+
+    void runTest() override
+    {
+        constexpr double fs = 48000.0;
+
+        // 1 kHz tone: 3 s at -1 dBFS, then 7 s at -26 dBFS
+        std::vector<float> source(static_cast<size_t>(10.0 * fs));
+        for (size_t i = 0; i < source.size(); ++i)
+        {
+            const float level = i < static_cast<size_t>(3.0 * fs) ? 0.89f : 0.05f;
+            source[i] = level * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 1000.0 * static_cast<double>(i) / fs));
+        }
+
+        auto measure = [fs](const float* samples, size_t numFrames)
+        {
+            LoudnessMeter meter(1, fs);
+            for (size_t done = 0; done < numFrames; done += 4096)
+                meter.process(samples + done, std::min<size_t>(4096, numFrames - done));
+            return meter.getChannelData(0);
+        };
+
+        // What an export of the lane contains: delay, then source [start, end)
+        auto render = [&source, fs](double start, double end, double delay, double length)
+        {
+            std::vector<float> rendered(static_cast<size_t>(delay * fs), 0.0f);
+            rendered.insert(rendered.end(), source.begin() + static_cast<std::ptrdiff_t>(start * fs),
+                            source.begin() + static_cast<std::ptrdiff_t>(end * fs));
+            rendered.resize(std::min(rendered.size(), static_cast<size_t>(length * fs)));
+            return rendered;
+        };
+
+        auto whole = measure(source.data(), source.size());
+
+        beginTest("Trimmed-off head");
+        {
+            auto rendered = render(4.0, 10.0, 0.0, 10.0);
+            auto expected = measure(rendered.data(), rendered.size());
+            auto edited = LoudnessMeter::edit(*whole, 4.0, 0.0, 0.0, 0.0);
+            expectWithinAbsoluteError(edited->summary.integratedLufs, expected->summary.integratedLufs, 0.05);
+            expectWithinAbsoluteError(edited->summary.truePeakDbtp, expected->summary.truePeakDbtp, 0.1);
+            expectLessThan(edited->summary.truePeakDbtp, -20.0);
+            expectGreaterThan(whole->summary.integratedLufs, edited->summary.integratedLufs + 10.0);
+        }
+
+        beginTest("Offset and output length");
+        {
+            auto rendered = render(4.0, 10.0, 1.5, 5.0);
+            auto expected = measure(rendered.data(), rendered.size());
+            auto edited = LoudnessMeter::edit(*whole, 4.0, 0.0, 1.5, 5.0);
+            expectEquals(edited->blockEnergies.size(), expected->blockEnergies.size());
+            expectEquals(edited->blockEnergies[14], 0.0f);
+            expectGreaterThan(edited->blockEnergies[15], 0.0f);
+            expectWithinAbsoluteError(edited->summary.integratedLufs, expected->summary.integratedLufs, 0.05);
+        }
+
+        beginTest("Trimmed-off tail");
+        {
+            auto rendered = render(0.0, 2.0, 0.0, 2.0);
+            auto expected = measure(rendered.data(), rendered.size());
+            auto edited = LoudnessMeter::edit(*whole, 0.0, 2.0, 0.0, 0.0);
+            expectEquals(edited->blockEnergies.size(), expected->blockEnergies.size());
+            expectWithinAbsoluteError(edited->summary.integratedLufs, expected->summary.integratedLufs, 0.05);
+            expectWithinAbsoluteError(edited->summary.truePeakDbtp, expected->summary.truePeakDbtp, 0.1);
+        }
+    }
+};
+
+static LoudnessMeterTests loudnessMeterTests;
@@ -0,0 +1,90 @@
+/*
+    ChannelStacker - Loudness Meter Header
+    Streaming ITU-R BS.1770 / EBU R128 measurement of interleaved audio:
+    K-weighted 100 ms block energies and 4x oversampled true peak per
+    channel. Channels are processed in SIMD-friendly groups, and groups
+    run in parallel on large inputs.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "../model/ProjectModel.h"
+#include <memory>
+#include <vector>
+
+class LoudnessMeter
+{
+public:
+    LoudnessMeter(int numChannels, double sampleRate);
+    ~LoudnessMeter();
+
+    // Feed interleaved float frames (numChannels samples per frame)
+    void process(const float* interleaved, size_t numFrames);
+
+    // process() split into independent items, for callers already fanning
+    // out over other work: processGroup() for every group in [0,
+    // getNumGroups()), in any order or in parallel, then endBatch()
+    int getNumGroups() const noexcept;
+    void processGroup(int group, const float* interleaved, size_t numFrames);
+    void endBatch(size_t numFrames);
+
+    // Measurement for one channel so far, including its own summary
+    std::shared_ptr<LoudnessData> getChannelData(int channel) const;
+
+    // Combine channels (channel weight 1.0, aligned at their start) into
+    // the figures for an output made of exactly those channels
+    static LoudnessSummary summarise(const std::vector<const LoudnessData*>& channels);
+
+    // The measurement of a channel as an edited lane renders it: source time
+    // [startSeconds, endSeconds) (endSeconds <= 0: to the end), after
+    // delaySeconds of silence, cut at lengthSeconds of output if > 0. Edits
+    // land on the nearest 100 ms block; the peaks keep every block the
+    // range touches, so they are never under-read.
+    static std::shared_ptr<LoudnessData> edit(const LoudnessData& channel, double startSeconds, double endSeconds,
+                                              double delaySeconds, double lengthSeconds);
+
+    // One-line report, e.g. "I -23.0 LUFS, LRA 4.2 LU, TP -1.1 dBTP"
+    static juce::String describe(const LoudnessSummary& summary);
+
+    static constexpr double kBlockSeconds = 0.1;     // Gating block hop
+    static constexpr int kMomentaryBlocks = 4;       // 400 ms window
+    static constexpr int kShortTermBlocks = 30;      // 3 s window
+    static constexpr int kOversampling = 4;
+    static constexpr int kTapsPerPhase = 12;
+
+private:
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    void processChannels(const float* interleaved, size_t numFrames, int firstChannel, int endChannel, size_t startFill);
+    void processPeaks(const float* interleaved, size_t numFrames, int channel, size_t startFill, std::vector<float>& scratch);
+
+    int numChannels;
+    size_t samplesPerBlock;
+    size_t blockFill = 0;   // Samples accumulated into the current block (same for all channels)
+
+    Biquad shelf;           // Stage 1: high-frequency shelf
+    Biquad highPass;        // Stage 2: RLB high-pass
+
+    // Per-channel filter state and accumulators (structure of arrays so the
+    // per-frame loop over channels vectorises)
+    std::vector<double> shelfZ1, shelfZ2, highPassZ1, highPassZ2;
+    std::vector<double> blockEnergy;
+    std::vector<std::vector<float>> blockEnergies;
+
+    // True peak
+    float phaseTaps[kOversampling][kTapsPerPhase] = {};
+    float maxPhaseGain = 1.0f;
+    std::vector<float> history;        // Last kTapsPerPhase - 1 samples per channel
+    std::vector<float> samplePeaks;           // Whole channel, over completed blocks
+    std::vector<float> truePeaks;
+    std::vector<float> blockSamplePeak;       // Current block
+    std::vector<float> blockTruePeak;
+    std::vector<std::vector<float>> blockSamplePeaks;
+    std::vector<std::vector<float>> blockTruePeaks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessMeter)
+};
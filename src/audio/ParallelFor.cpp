@@ -0,0 +1,125 @@
+/*
+    ChannelStacker - Parallel For Helper Implementation
+*/
+
+#include "ParallelFor.h"
+#include "../model/ProgressTracker.h"
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    thread_local bool insideParallelFor = false;
+    thread_local double helperCpuSeconds = 0.0;
+}
+
+struct ParallelForPool::Job
+{
+    void (*body)(void*, int);
+    void* context;
+    int numItems;
+    std::atomic<int> nextItem{ 0 };
+    int running = 0;                  // Helpers inside work() (guarded by the pool's lock)
+    double helperCpuSeconds = 0.0;    // Helpers' time on this job (guarded by the pool's lock)
+
+    void work()
+    {
+        for (int i = nextItem++; i < numItems; i = nextItem++)
+            body(context, i);
+    }
+};
+
+ParallelForPool& ParallelForPool::getInstance()
+{
+    static ParallelForPool pool;
+    return pool;
+}
+
+ParallelForPool::ParallelForPool()
+{
+    const int numHelpers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    for (int i = 0; i < numHelpers; ++i)
+        threads.emplace_back([this]() { helperLoop(); });
+}
+
+ParallelForPool::~ParallelForPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+bool ParallelForPool::isInsideParallelFor() noexcept
+{
+    return insideParallelFor;
+}
+
+double ParallelForPool::getHelperCpuSeconds() noexcept
+{
+    return helperCpuSeconds;
+}
+
+void ParallelForPool::helperLoop()
+{
+    insideParallelFor = true;
+
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        workAvailable.wait(guard, [this]() { return stopping || !queue.empty(); });
+        if (stopping)
+            return;
+
+        Job* job = queue.front();
+        queue.pop_front();
+        ++job->running;
+
+        guard.unlock();
+        const double startCpu = ProgressTracker::getThreadCpuSeconds();
+        job->work();
+        const double cpuSeconds = ProgressTracker::getThreadCpuSeconds() - startCpu;
+        guard.lock();
+
+        job->helperCpuSeconds += cpuSeconds;
+
+        if (--job->running == 0)
+            helperFinished.notify_all();
+    }
+}
+
+void ParallelForPool::run(int numItems, int maxThreads, void (*body)(void*, int), void* context)
+{
+    const int maxHelpers = maxThreads > 0 ? maxThreads - 1 : static_cast<int>(threads.size());
+    const int numHelpers = std::min({ maxHelpers, numItems - 1, static_cast<int>(threads.size()) });
+
+    // Nested, or nothing to share: the caller does it all
+    if (numHelpers <= 0 || insideParallelFor)
+    {
+        for (int i = 0; i < numItems; ++i)
+            body(context, i);
+        return;
+    }
+
+    Job job{ body, context, numItems };
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.insert(queue.end(), static_cast<size_t>(numHelpers), &job);
+    }
+    workAvailable.notify_all();
+
+    insideParallelFor = true;
+    job.work();
+    insideParallelFor = false;
+
+    // Helpers still queued when the items ran out aren't needed; the job
+    // lives on this stack, so wait for the ones already working
+    std::unique_lock<std::mutex> guard(lock);
+    queue.erase(std::remove(queue.begin(), queue.end(), &job), queue.end());
+    helperFinished.wait(guard, [&job]() { return job.running == 0; });
+    helperCpuSeconds += job.helperCpuSeconds;
+}
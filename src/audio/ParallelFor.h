@@ -0,0 +1,70 @@
+/*
+    ChannelStacker - Parallel For Helper
+    Fans independent work items out across all cores and waits for them.
+    The helper threads are started once and shared by every caller, so a
+    fan-out per decoded batch or export block costs a queue push, not a
+    thread start. A parallelFor inside another one runs its items inline:
+    the outer fan-out already has every core busy.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ParallelForPool
+{
+public:
+    // Started on first use with one thread per core but one (the caller
+    // always works too), and joined at exit
+    static ParallelForPool& getInstance();
+
+    ~ParallelForPool();
+
+    // body(context, i) for every i in [0, numItems), on the calling thread
+    // and up to maxThreads - 1 (0 = all) of the pool's threads
+    void run(int numItems, int maxThreads, void (*body)(void*, int), void* context);
+
+    // True on a pool thread, or on a caller while it works through a fan-out
+    static bool isInsideParallelFor() noexcept;
+
+    // CPU time the pool's threads have spent on fan-outs started by the
+    // calling thread so far; with the caller's own, the whole cost of its work
+    static double getHelperCpuSeconds() noexcept;
+
+private:
+    struct Job;
+
+    ParallelForPool();
+    void helperLoop();
+
+    std::mutex lock;
+    std::condition_variable workAvailable;
+    std::condition_variable helperFinished;
+    std::deque<Job*> queue;           // One entry per helper a job asked for
+    bool stopping = false;
+    std::vector<std::thread> threads;
+
+    ParallelForPool(const ParallelForPool&) = delete;
+    ParallelForPool& operator=(const ParallelForPool&) = delete;
+};
+
+// Calls fn(i) for every i in [0, numItems), distributing items dynamically
+// over up to maxThreads threads (0 = one per core). The calling thread takes
+// part in the work. This blocks - run it from a background thread only.
+template <typename Fn>
+void parallelFor(int numItems, Fn&& fn, int maxThreads = 0)
+{
+    if (numItems <= 0)
+        return;
+
+    using Body = std::remove_reference_t<Fn>;
+    ParallelForPool::getInstance().run(numItems, maxThreads,
+                                       [](void* context, int i) { (*static_cast<Body*>(context))(i); },
+                                       const_cast<void*>(static_cast<const void*>(std::addressof(fn))));
+}
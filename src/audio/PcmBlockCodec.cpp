@@ -0,0 +1,245 @@
+/*
+    ChannelStacker - PCM Block Codec Implementation
+
+    Plane layout:
+        predictor order (u8), 3 zero bytes
+        one width byte per group, zero-padded to a multiple of 4
+        per group: kLanes * width words (u32, little-endian); sample
+            j * kLanes + lane of the group sits in lane's bit stream at
+            bit j * width, and word k of a lane is word k * kLanes + lane
+    The last group is padded with zero residuals.
+*/
+
+#include "PcmBlockCodec.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <utility>
+
+static_assert(std::endian::native == std::endian::little, "Packed words are stored in native byte order");
+
+namespace
+{
+    constexpr size_t kRows = PcmBlockCodec::kGroupSamples / PcmBlockCodec::kLanes;
+    constexpr int kMaxOrder = 2;
+    constexpr size_t kPlaneHeaderBytes = 4;
+
+    size_t roundUp4(size_t n) { return (n + 3) & ~size_t(3); }
+
+    uint32_t zigzag(int32_t r) { return (static_cast<uint32_t>(r) << 1) ^ static_cast<uint32_t>(r >> 31); }
+
+    int32_t unzigzag(uint32_t z) { return static_cast<int32_t>((z >> 1) ^ (0u - (z & 1))); }
+
+    int bitWidth(uint32_t v) { return 32 - std::countl_zero(v); }
+
+    // Residual of sample i under the given order; the first samples of a
+    // plane fall back to the orders their history allows
+    int32_t residual(const int16_t* x, size_t i, int order)
+    {
+        if (order == 0 || i == 0)
+            return x[i];
+        if (order == 1 || i == 1)
+            return x[i] - x[i - 1];
+        return x[i] - 2 * x[i - 1] + x[i - 2];
+    }
+
+    //==========================================================================
+    // Unpacking, one instantiation per width so shifts are constants
+
+    template <int W, int J>
+    inline void unpackRow(const uint32_t* in, uint32_t* out)
+    {
+        constexpr uint32_t mask = W == 32 ? ~0u : (1u << W) - 1;
+        constexpr int bit = J * W;
+        constexpr int word = bit / 32;
+        constexpr int shift = bit % 32;
+
+        for (size_t lane = 0; lane < PcmBlockCodec::kLanes; ++lane)
+        {
+            uint32_t v = in[word * PcmBlockCodec::kLanes + lane] >> shift;
+            if constexpr (shift + W > 32)
+                v |= in[(word + 1) * PcmBlockCodec::kLanes + lane] << (32 - shift);
+            out[J * PcmBlockCodec::kLanes + lane] = v & mask;
+        }
+    }
+
+    template <int W, size_t... J>
+    void unpackRows(const uint32_t* in, uint32_t* out, std::index_sequence<J...>)
+    {
+        (unpackRow<W, static_cast<int>(J)>(in, out), ...);
+    }
+
+    template <int W>
+    void unpackGroup(const uint32_t* in, uint32_t* out)
+    {
+        if constexpr (W == 0)
+            std::fill(out, out + PcmBlockCodec::kGroupSamples, 0u);
+        else
+            unpackRows<W>(in, out, std::make_index_sequence<kRows>{});
+    }
+
+    using UnpackFn = void (*)(const uint32_t*, uint32_t*);
+
+    template <size_t... W>
+    constexpr std::array<UnpackFn, sizeof...(W)> makeUnpackTable(std::index_sequence<W...>)
+    {
+        return { &unpackGroup<static_cast<int>(W)>... };
+    }
+
+    constexpr auto unpackTable = makeUnpackTable(std::make_index_sequence<33>{});
+
+    void packGroup(const uint32_t* values, int width, uint32_t* out)
+    {
+        std::fill(out, out + PcmBlockCodec::kLanes * static_cast<size_t>(width), 0u);
+        if (width == 0)
+            return;
+
+        for (size_t j = 0; j < kRows; ++j)
+        {
+            const size_t bit = j * static_cast<size_t>(width);
+            const size_t word = bit / 32;
+            const size_t shift = bit % 32;
+
+            for (size_t lane = 0; lane < PcmBlockCodec::kLanes; ++lane)
+            {
+                const uint32_t v = values[j * PcmBlockCodec::kLanes + lane];
+                out[word * PcmBlockCodec::kLanes + lane] |= v << shift;
+                if (shift + static_cast<size_t>(width) > 32)
+                    out[(word + 1) * PcmBlockCodec::kLanes + lane] |= v >> (32 - shift);
+            }
+        }
+    }
+}
+
+size_t PcmBlockCodec::encode(const int16_t* samples, size_t numSamples, std::vector<uint8_t>& out)
+{
+    const size_t numGroups = (numSamples + kGroupSamples - 1) / kGroupSamples;
+
+    // Pick the order whose residuals pack smallest
+    int order = 0;
+    size_t bestBits = SIZE_MAX;
+
+    for (int candidate = 0; candidate <= kMaxOrder; ++candidate)
+    {
+        size_t bits = 0;
+        for (size_t g = 0; g < numGroups; ++g)
+        {
+            uint32_t all = 0;
+            for (size_t i = g * kGroupSamples; i < std::min(numSamples, (g + 1) * kGroupSamples); ++i)
+                all |= zigzag(residual(samples, i, candidate));
+            bits += static_cast<size_t>(bitWidth(all));
+        }
+
+        if (bits < bestBits)
+        {
+            bestBits = bits;
+            order = candidate;
+        }
+    }
+
+    const size_t start = out.size();
+    const size_t payloadOffset = kPlaneHeaderBytes + roundUp4(numGroups);
+    out.resize(start + payloadOffset + bestBits * kLanes * sizeof(uint32_t));
+    uint8_t* plane = out.data() + start;
+    plane[0] = static_cast<uint8_t>(order);
+
+    std::array<uint32_t, kGroupSamples> values;
+    std::vector<uint32_t> packed(kLanes * 32);
+    size_t offset = payloadOffset;
+
+    for (size_t g = 0; g < numGroups; ++g)
+    {
+        uint32_t all = 0;
+        for (size_t k = 0; k < kGroupSamples; ++k)
+        {
+            const size_t i = g * kGroupSamples + k;
+            values[k] = i < numSamples ? zigzag(residual(samples, i, order)) : 0;
+            all |= values[k];
+        }
+
+        const int width = bitWidth(all);
+        plane[kPlaneHeaderBytes + g] = static_cast<uint8_t>(width);
+        packGroup(values.data(), width, packed.data());
+
+        const size_t groupBytes = kLanes * static_cast<size_t>(width) * sizeof(uint32_t);
+        std::memcpy(plane + offset, packed.data(), groupBytes);
+        offset += groupBytes;
+    }
+
+    return out.size() - start;
+}
+
+bool PcmBlockCodec::decode(const uint8_t* data, size_t numBytes, size_t numSamples, float* dest)
+{
+    const size_t numGroups = (numSamples + kGroupSamples - 1) / kGroupSamples;
+    const size_t payloadOffset = kPlaneHeaderBytes + roundUp4(numGroups);
+    if (numBytes < payloadOffset || data[0] > kMaxOrder || (reinterpret_cast<uintptr_t>(data) & 3) != 0)
+        return false;
+
+    const int order = data[0];
+    const uint8_t* widths = data + kPlaneHeaderBytes;
+
+    size_t payloadWords = 0;
+    for (size_t g = 0; g < numGroups; ++g)
+    {
+        if (widths[g] > 32)
+            return false;
+        payloadWords += kLanes * widths[g];
+    }
+
+    if (payloadOffset + payloadWords * sizeof(uint32_t) > numBytes)
+        return false;
+
+    const auto* words = reinterpret_cast<const uint32_t*>(data + payloadOffset);
+    alignas(32) std::array<uint32_t, kGroupSamples> values;
+    alignas(32) std::array<int32_t, kGroupSamples> samples;
+    constexpr float scale = 1.0f / 32768.0f;
+
+    // Prediction history, carried across groups in wrapping arithmetic so
+    // a corrupt plane decodes to noise rather than overflowing
+    uint32_t previous = 0, beforePrevious = 0;
+
+    for (size_t g = 0; g < numGroups; ++g)
+    {
+        unpackTable[widths[g]](words, values.data());
+        words += kLanes * widths[g];
+
+        const size_t first = g * kGroupSamples;
+        const size_t count = std::min(kGroupSamples, numSamples - first);
+        float* out = dest + first;
+
+        if (order == 0)
+        {
+            for (size_t k = 0; k < count; ++k)
+                out[k] = static_cast<float>(unzigzag(values[k])) * scale;
+            continue;
+        }
+
+        for (size_t k = 0; k < count; ++k)
+            samples[k] = unzigzag(values[k]);
+
+        // The only serial step: running sums of the residuals
+        for (size_t k = 0; k < count; ++k)
+        {
+            const size_t i = first + k;
+            const uint32_t r = static_cast<uint32_t>(samples[k]);
+            uint32_t x;
+            if (i == 0)
+                x = r;
+            else if (order == 1 || i == 1)
+                x = previous + r;
+            else
+                x = 2 * previous - beforePrevious + r;
+
+            beforePrevious = previous;
+            previous = x;
+            samples[k] = static_cast<int32_t>(x);
+        }
+
+        for (size_t k = 0; k < count; ++k)
+            out[k] = static_cast<float>(samples[k]) * scale;
+    }
+
+    return true;
+}
@@ -0,0 +1,33 @@
+/*
+    ChannelStacker - PCM Block Codec Header
+    Lossless codec for the planes of 16-bit samples in the proxy cache.
+    Each plane is predicted with a fixed order 0, 1 or 2 polynomial (plain
+    samples, first or second difference, whichever packs smallest), and the
+    zigzagged residuals are bit-packed in groups of kGroupSamples at a
+    per-group width. A group is kLanes interleaved streams of 32-bit words,
+    and the unpack loop is instantiated per width, so every shift and mask
+    is a constant and the lane loop compiles to plain SIMD on SSE2/AVX2 and
+    NEON alike. Planes are self-contained: any one decodes without the rest.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct PcmBlockCodec
+{
+    static constexpr size_t kLanes = 4;
+    static constexpr size_t kGroupSamples = 128;
+
+    // Append one encoded plane to out; returns the bytes appended, always
+    // a multiple of 4 so the next plane stays word aligned
+    static size_t encode(const int16_t* samples, size_t numSamples, std::vector<uint8_t>& out);
+
+    // Decode a plane of numSamples samples to float (sample / 32768). data
+    // must be 4-byte aligned. False if the plane is malformed or truncated.
+    static bool decode(const uint8_t* data, size_t numBytes, size_t numSamples, float* dest);
+
+    PcmBlockCodec() = delete;
+};
@@ -0,0 +1,220 @@
+/*
+    ChannelStacker - Pre-roll Cache Implementation
+*/
+
+#include "PrerollCache.h"
+#include "SampleKernels.h"
+#include "../async/SpawnedProcess.h"
+#include "../ffmpeg/DecodeWorker.h"
+#include <cmath>
+
+namespace
+{
+    size_t bytesOf(const PrerollCache::Segment& segment)
+    {
+        return static_cast<size_t>(segment.audio.getNumChannels()) * static_cast<size_t>(segment.audio.getNumSamples()) * sizeof(float);
+    }
+}
+
+PrerollCache::PrerollCache(const FFmpegLocator& locator)
+    : ffmpegLocator(locator)
+{
+}
+
+PrerollCache::~PrerollCache()
+{
+    // Decodes in flight are dropped; the pool waits for them to notice
+    cancelled = true;
+    cancelPendingUpdate();
+}
+
+juce::String PrerollCache::keyFor(const juce::File& file, int streamIndex)
+{
+    return file.getFullPathName() + ":" + juce::String(streamIndex);
+}
+
+void PrerollCache::prefetchHead(const Stream& stream)
+{
+    prefetch(stream, 0.0, kHeadSeconds, true);
+}
+
+void PrerollCache::prefetchAround(const Stream& stream, double seconds)
+{
+    // The head already covers the start
+    const double start = std::max(0.0, seconds - kWindowBeforeSeconds);
+    if (start + kWindowBeforeSeconds + kWindowAfterSeconds <= kHeadSeconds)
+        return;
+
+    if (auto cached = find(stream.file, stream.streamIndex, seconds))
+        if (cached->getEndSeconds() >= seconds + kWindowAfterSeconds)
+            return;
+
+    prefetch(stream, start, kWindowBeforeSeconds + kWindowAfterSeconds, false);
+}
+
+void PrerollCache::prefetch(const Stream& stream, double startSeconds, double lengthSeconds, bool isHead)
+{
+    if (isHead && find(stream.file, stream.streamIndex, 0.0) != nullptr)
+        return;
+
+    decoders.post([this, stream, startSeconds, lengthSeconds, isHead]()
+    {
+        if (cancelled)
+            return;
+
+        if (auto segment = decodeSegment(ffmpegLocator.getFFmpegPath().getFullPathName(), stream,
+                                         startSeconds, lengthSeconds, cancelled))
+        {
+            insert({ keyFor(stream.file, stream.streamIndex), isHead, std::move(segment) });
+            triggerAsyncUpdate();
+        }
+    });
+}
+
+std::shared_ptr<PrerollCache::Segment> PrerollCache::decodeSegment(const juce::String& ffmpegPath, const Stream& stream,
+                                                                   double startSeconds, double lengthSeconds,
+                                                                   const std::atomic<bool>& cancelled)
+{
+    const double sampleRate = stream.sampleRate > 0.0 ? stream.sampleRate : 48000.0;
+
+    // The resident worker hands back float, which goes straight into the buffer
+    if (DecodeWorkerPool::isAvailable())
+    {
+        auto segment = std::make_shared<Segment>();
+        segment->startSeconds = startSeconds;
+        segment->sampleRate = sampleRate;
+        segment->audio.setSize(stream.numChannels, static_cast<int>(std::ceil(lengthSeconds * sampleRate)) + 1);
+        int numFrames = 0;
+
+        const auto outcome = DecodeWorkerPool::getInstance().decode(stream.file, stream.streamIndex, startSeconds, lengthSeconds,
+                                                                    stream.numChannels, cancelled,
+                                                                    [&](const float* frames, size_t count)
+        {
+            const int numToCopy = std::min(static_cast<int>(count), segment->audio.getNumSamples() - numFrames);
+            for (int ch = 0; ch < stream.numChannels; ++ch)
+            {
+                float* dest = segment->audio.getWritePointer(ch, numFrames);
+                for (int i = 0; i < numToCopy; ++i)
+                    dest[i] = frames[static_cast<size_t>(i * stream.numChannels + ch)];
+            }
+            numFrames += numToCopy;
+        });
+
+        if (outcome == DecodeWorkerPool::Outcome::Cancelled || cancelled)
+            return nullptr;
+        if (outcome == DecodeWorkerPool::Outcome::Done)
+        {
+            if (numFrames == 0)
+                return nullptr;
+            segment->audio.setSize(stream.numChannels, numFrames, true);
+            return segment;
+        }
+    }
+
+    const SampleFormat pipeFormat = SampleKernels::pipeFormatFor(stream.sampleFormat, stream.bitsPerRawSample);
+    const auto& kernels = SampleKernels::get(pipeFormat, stream.numChannels);
+
+    juce::StringArray args;
+    args.add(ffmpegPath);
+    args.add("-v");
+    args.add("error");
+    args.add("-nostdin");
+    if (startSeconds > 0.0)
+    {
+        // Input seeking: jumps close via the index rather than decoding up to it
+        args.add("-ss");
+        args.add(juce::String(startSeconds, 3));
+    }
+    args.add("-t");
+    args.add(juce::String(lengthSeconds, 3));
+    args.add("-i");
+    args.add(stream.file.getFullPathName());
+    args.add("-map");
+    args.add("0:a:" + juce::String(stream.streamIndex));
+    args.add("-f");
+    args.add(SampleKernels::ffmpegFormatName(pipeFormat));
+    args.add("-acodec");
+    args.add(SampleKernels::ffmpegCodecName(pipeFormat));
+    args.add("-");
+
+    SpawnedProcess process;
+    if (!process.start(args, SpawnedProcess::wantStdOut))
+        return nullptr;
+
+    juce::MemoryBlock raw;
+    juce::HeapBlock<char> buffer(65536);
+    for (;;)
+    {
+        if (cancelled)
+        {
+            process.kill();
+            return nullptr;
+        }
+
+        int bytesRead = process.readProcessOutput(buffer, 65536);
+        if (bytesRead <= 0)
+            break;
+        raw.append(buffer, static_cast<size_t>(bytesRead));
+    }
+
+    process.waitForProcessToFinish(5000);
+
+    const size_t frameBytes = static_cast<size_t>(SampleKernels::bytesPerSample(pipeFormat) * stream.numChannels);
+    const auto numFrames = static_cast<int>(raw.getSize() / frameBytes);
+    if (numFrames == 0)
+        return nullptr;
+
+    auto segment = std::make_shared<Segment>();
+    segment->startSeconds = startSeconds;
+    segment->sampleRate = sampleRate;
+    segment->audio.setSize(stream.numChannels, numFrames);
+    kernels.deinterleave(raw.getData(), static_cast<size_t>(numFrames), stream.numChannels,
+                         segment->audio.getArrayOfWritePointers());
+    return segment;
+}
+
+void PrerollCache::insert(Entry entry)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    totalBytes += bytesOf(*entry.segment);
+    entries.push_front(std::move(entry));
+
+    // Evict least recently used, play-position windows before heads
+    for (bool evictHeads : { false, true })
+    {
+        for (auto it = std::prev(entries.end()); totalBytes > kMaxBytes && it != entries.begin();)
+        {
+            auto current = it--;
+            if (current->isHead == evictHeads)
+            {
+                totalBytes -= bytesOf(*current->segment);
+                entries.erase(current);
+            }
+        }
+    }
+}
+
+std::shared_ptr<const PrerollCache::Segment> PrerollCache::find(const juce::File& file, int streamIndex, double seconds) const
+{
+    const auto key = keyFor(file, streamIndex);
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (it->key == key && seconds >= it->segment->startSeconds && seconds < it->segment->getEndSeconds())
+        {
+            // Mark as recently used
+            entries.splice(entries.begin(), entries, it);
+            return it->segment;
+        }
+    }
+
+    return nullptr;
+}
+
+void PrerollCache::handleAsyncUpdate()
+{
+    if (onSegmentAdded)
+        onSegmentAdded();
+}
@@ -0,0 +1,94 @@
+/*
+    ChannelStacker - Pre-roll Cache Header
+    Small RAM cache of decoded audio at the points playback starts from:
+    the first seconds of every imported (source, stream), decoded at
+    import, and a window around the last play position. Play can start
+    from it on the next audio callback while the full decode catches up.
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_events/juce_events.h>
+#include "../ffmpeg/FFmpegLocator.h"
+#include "../async/AsyncPrimitives.h"
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+
+class PrerollCache : private juce::AsyncUpdater
+{
+public:
+    static constexpr double kHeadSeconds = 4.0;
+    static constexpr double kWindowBeforeSeconds = 1.0;
+    static constexpr double kWindowAfterSeconds = 3.0;
+    static constexpr size_t kMaxBytes = 256u << 20;
+
+    // Enough about a source stream to decode part of it
+    struct Stream
+    {
+        juce::File file;
+        int streamIndex = 0;
+        int numChannels = 1;
+        double sampleRate = 48000.0;
+        juce::String sampleFormat;    // ffprobe sample_fmt, picks the pipe format
+        int bitsPerRawSample = 0;
+    };
+
+    // Decoded stretch of a stream, all channels, at the stream's own rate
+    struct Segment
+    {
+        double startSeconds = 0.0;
+        double sampleRate = 0.0;
+        juce::AudioBuffer<float> audio;
+
+        double getEndSeconds() const { return startSeconds + audio.getNumSamples() / sampleRate; }
+    };
+
+    explicit PrerollCache(const FFmpegLocator& locator);
+    ~PrerollCache() override;
+
+    // Decode the first kHeadSeconds of a stream in the background (any thread)
+    void prefetchHead(const Stream& stream);
+
+    // Decode a window around a play position in the background (any thread)
+    void prefetchAround(const Stream& stream, double seconds);
+
+    // Cached audio of this stream containing 'seconds', or null (any thread)
+    std::shared_ptr<const Segment> find(const juce::File& file, int streamIndex, double seconds) const;
+
+    // Called on the message thread when a segment has been added
+    std::function<void()> onSegmentAdded;
+
+    // Decode [startSeconds, startSeconds + lengthSeconds) of a stream with
+    // the decode worker or ffmpeg, blocking; null on failure or once 'cancelled' is set
+    static std::shared_ptr<Segment> decodeSegment(const juce::String& ffmpegPath, const Stream& stream,
+                                                  double startSeconds, double lengthSeconds,
+                                                  const std::atomic<bool>& cancelled);
+
+private:
+    struct Entry
+    {
+        juce::String key;
+        bool isHead = false;
+        std::shared_ptr<const Segment> segment;
+    };
+
+    void prefetch(const Stream& stream, double startSeconds, double lengthSeconds, bool isHead);
+    void insert(Entry entry);
+    void handleAsyncUpdate() override;
+
+    static juce::String keyFor(const juce::File& file, int streamIndex);
+
+    const FFmpegLocator& ffmpegLocator;
+    std::atomic<bool> cancelled{ false };
+
+    mutable std::mutex lock;
+    mutable std::list<Entry> entries;     // Most recently used first
+    size_t totalBytes = 0;
+
+    WorkerPool decoders{ 2 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PrerollCache)
+};
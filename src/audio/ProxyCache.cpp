@@ -0,0 +1,411 @@
+/*
+    ChannelStacker - Proxy Cache Implementation
+
+    File layout (little-endian):
+        "CSPX", version, channels, sample rate, chunk frames, 0, total frames (u64)
+        chunk 0: plane size of each channel (u32), then the channels'
+                 PcmBlockCodec planes in channel order
+        chunk 1: ...
+    Every chunk holds kChunkFrames frames except the last. Planes are a
+    multiple of 4 bytes, so each one starts word aligned in the mapping.
+*/
+
+#include "ProxyCache.h"
+#include "ParallelFor.h"
+#include "PcmBlockCodec.h"
+#include "../async/SpawnedProcess.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace
+{
+    constexpr uint32_t kVersion = 2;
+    constexpr size_t kHeaderSize = 32;
+
+    uint32_t read32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8
+             | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    void writeHeader(juce::OutputStream& out, int numChannels, uint64_t totalFrames)
+    {
+        out.write("CSPX", 4);
+        out.writeInt(static_cast<int>(kVersion));
+        out.writeInt(numChannels);
+        out.writeInt(ProxyCache::kSampleRate);
+        out.writeInt(ProxyCache::kChunkFrames);
+        out.writeInt(0);
+        out.writeInt64(static_cast<juce::int64>(totalFrames));
+    }
+}
+
+ProxyCache::ProxyCache(const FFmpegLocator& locator, ProgressTracker* tracker, const juce::File& directory)
+    : juce::Thread("Proxy cache"),
+      ffmpegLocator(locator),
+      interactiveWork(tracker),
+      cacheDirectory(directory)
+{
+    cacheDirectory.createDirectory();
+    startThread(juce::Thread::Priority::background);
+}
+
+ProxyCache::~ProxyCache()
+{
+    signalThreadShouldExit();
+    workAvailable.signal();
+    stopThread(5000);
+}
+
+juce::File ProxyCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("ChannelStacker Proxies");
+}
+
+juce::File ProxyCache::proxyFileFor(const juce::File& source, int streamIndex) const
+{
+    juce::String identity = source.getFullPathName() + "\n" + juce::String(source.getSize()) + "\n"
+                          + juce::String(source.getLastModificationTime().toMilliseconds()) + "\n"
+                          + juce::String(streamIndex) + "\n" + juce::String(static_cast<int>(kVersion));
+    return cacheDirectory.getChildFile(juce::String::toHexString(identity.hashCode64()).paddedLeft('0', 16) + ".proxy");
+}
+
+void ProxyCache::request(const juce::File& source, int streamIndex, int numChannels)
+{
+    auto proxyFile = proxyFileFor(source, streamIndex);
+    if (proxyFile.existsAsFile())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+        if (!queued.insert(proxyFile.getFileName()).second)
+            return;
+        queue.push_back({ source, streamIndex, numChannels });
+    }
+
+    workAvailable.signal();
+}
+
+bool ProxyCache::isAvailable(const juce::File& source, int streamIndex) const
+{
+    return proxyFileFor(source, streamIndex).existsAsFile();
+}
+
+bool ProxyCache::read(const juce::File& source, int streamIndex, const std::vector<int>& channels,
+                      juce::AudioBuffer<float>& dest) const
+{
+    juce::MemoryMappedFile mapped(proxyFileFor(source, streamIndex), juce::MemoryMappedFile::readOnly);
+    const auto* base = static_cast<const uint8_t*>(mapped.getData());
+    const size_t size = mapped.getSize();
+    if (base == nullptr || size < kHeaderSize || std::memcmp(base, "CSPX", 4) != 0 || read32(base + 4) != kVersion)
+        return false;
+
+    const auto numChannels = static_cast<int>(read32(base + 8));
+    const auto chunkFrames = static_cast<uint64_t>(read32(base + 16));
+    const uint64_t totalFrames = read32(base + 24) | static_cast<uint64_t>(read32(base + 28)) << 32;
+    if (numChannels <= 0 || chunkFrames == 0 || totalFrames > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+        return false;
+
+    for (int channel : channels)
+        if (channel < 0 || channel >= numChannels)
+            return false;
+
+    // Locate every plane first, so the chunks can then decode in parallel
+    struct Chunk
+    {
+        uint64_t start;
+        size_t frames;
+        std::vector<size_t> planeOffsets;     // numChannels + 1 entries, from the file start
+    };
+
+    std::vector<Chunk> chunks;
+    const size_t tableBytes = static_cast<size_t>(numChannels) * sizeof(uint32_t);
+    uint64_t offset = kHeaderSize;
+    for (uint64_t start = 0; start < totalFrames; start += chunkFrames)
+    {
+        if (offset + tableBytes > size)
+            return false;
+
+        Chunk chunk{ start, static_cast<size_t>(std::min(chunkFrames, totalFrames - start)), {} };
+        chunk.planeOffsets.resize(static_cast<size_t>(numChannels) + 1);
+        chunk.planeOffsets[0] = static_cast<size_t>(offset + tableBytes);
+        for (size_t c = 0; c < static_cast<size_t>(numChannels); ++c)
+            chunk.planeOffsets[c + 1] = chunk.planeOffsets[c] + read32(base + offset + c * sizeof(uint32_t));
+
+        offset = chunk.planeOffsets.back();
+        if (offset > size)
+            return false;
+
+        chunks.push_back(std::move(chunk));
+    }
+
+    dest.setSize(static_cast<int>(channels.size()), static_cast<int>(totalFrames), false, false, true);
+
+    std::atomic<bool> ok{ true };
+    parallelFor(static_cast<int>(chunks.size()), [&](int i)
+    {
+        const auto& chunk = chunks[static_cast<size_t>(i)];
+        for (size_t k = 0; k < channels.size(); ++k)
+        {
+            const auto channel = static_cast<size_t>(channels[k]);
+            const size_t planeOffset = chunk.planeOffsets[channel];
+            if (!PcmBlockCodec::decode(base + planeOffset, chunk.planeOffsets[channel + 1] - planeOffset, chunk.frames,
+                                       dest.getWritePointer(static_cast<int>(k), static_cast<int>(chunk.start))))
+                ok = false;
+        }
+    });
+
+    return ok;
+}
+
+void ProxyCache::run()
+{
+    removeStaleProxies();
+
+    while (!threadShouldExit())
+    {
+        Item item;
+        {
+            std::unique_lock<std::mutex> lock(queueLock);
+            if (!queue.empty())
+            {
+                item = queue.front();
+                queue.pop_front();
+            }
+        }
+
+        if (item.numChannels <= 0)
+        {
+            workAvailable.wait(-1.0);
+            continue;
+        }
+
+        waitForIdle();
+
+        if (!threadShouldExit() && !generate(item))
+            juce::Logger::writeToLog("Proxy generation failed for " + item.source.getFullPathName());
+
+        std::lock_guard<std::mutex> lock(queueLock);
+        queued.erase(proxyFileFor(item.source, item.streamIndex).getFileName());
+    }
+}
+
+void ProxyCache::waitForIdle()
+{
+    // Imports, extraction and exports come first
+    while (!threadShouldExit() && interactiveWork != nullptr && interactiveWork->sample().isActive())
+        wait(kIdlePollMs);
+}
+
+bool ProxyCache::generate(const Item& item)
+{
+    juce::StringArray args;
+    args.add(ffmpegLocator.getFFmpegPath().getFullPathName());
+    args.add("-v");
+    args.add("error");
+    args.add("-nostdin");
+    args.add("-threads");
+    args.add("1");
+    args.add("-i");
+    args.add(item.source.getFullPathName());
+    args.add("-map");
+    args.add("0:a:" + juce::String(item.streamIndex));
+    args.add("-ar");
+    args.add(juce::String(kSampleRate));
+    args.add("-f");
+    args.add("s16le");
+    args.add("-acodec");
+    args.add("pcm_s16le");
+    args.add("-");
+
+    SpawnedProcess process;
+    if (!process.start(args, SpawnedProcess::wantStdOut))
+        return false;
+
+    const auto target = proxyFileFor(item.source, item.streamIndex);
+    juce::TemporaryFile temp(target);
+    auto out = std::make_unique<juce::FileOutputStream>(temp.getFile());
+    if (!out->openedOk())
+    {
+        process.kill();
+        return false;
+    }
+
+    writeHeader(*out, item.numChannels, 0);
+
+    const auto numChannels = static_cast<size_t>(item.numChannels);
+    const size_t frameBytes = numChannels * sizeof(int16_t);
+    std::vector<char> interleaved(static_cast<size_t>(kChunkFrames) * frameBytes);
+    std::vector<int16_t> plane(static_cast<size_t>(kChunkFrames));
+    std::vector<uint8_t> encoded;
+    uint64_t totalFrames = 0;
+
+    for (;;)
+    {
+        // Fill one chunk; an idle ffmpeg just blocks on its pipe
+        size_t filled = 0;
+        while (filled < interleaved.size() && !threadShouldExit())
+        {
+            int bytesRead = process.readProcessOutput(interleaved.data() + filled, static_cast<int>(interleaved.size() - filled));
+            if (bytesRead <= 0)
+                break;
+            filled += static_cast<size_t>(bytesRead);
+        }
+
+        if (threadShouldExit())
+        {
+            process.kill();
+            return false;
+        }
+
+        const size_t frames = filled / frameBytes;
+        if (frames == 0)
+            break;
+
+        // Interleaved -> one coded plane per channel, after a table of their sizes
+        encoded.assign(numChannels * sizeof(uint32_t), 0);
+        for (size_t c = 0; c < numChannels; ++c)
+        {
+            for (size_t i = 0; i < frames; ++i)
+                std::memcpy(&plane[i], interleaved.data() + i * frameBytes + c * sizeof(int16_t), sizeof(int16_t));
+
+            const auto planeBytes = static_cast<uint32_t>(PcmBlockCodec::encode(plane.data(), frames, encoded));
+            for (size_t b = 0; b < sizeof(uint32_t); ++b)
+                encoded[c * sizeof(uint32_t) + b] = static_cast<uint8_t>(planeBytes >> (8 * b));
+        }
+
+        if (!out->write(encoded.data(), encoded.size()))
+        {
+            process.kill();
+            return false;
+        }
+
+        totalFrames += frames;
+        if (frames < static_cast<size_t>(kChunkFrames))
+            break;
+
+        waitForIdle();
+    }
+
+    process.waitForProcessToFinish(10000);
+    if (process.getExitCode() != 0 || totalFrames == 0)
+        return false;
+
+    out->setPosition(0);
+    writeHeader(*out, item.numChannels, totalFrames);
+    out->flush();
+    const bool written = out->getStatus().wasOk();
+    out.reset();
+
+    return written && temp.overwriteTargetFileWithTemporary();
+}
+
+void ProxyCache::removeStaleProxies()
+{
+    const auto cutoff = juce::Time::getCurrentTime() - juce::RelativeTime::days(kMaxAgeDays);
+    for (const auto& file : cacheDirectory.findChildFiles(juce::File::findFiles, false, "*.proxy"))
+        if (file.getLastAccessTime() < cutoff)
+            file.deleteFile();
+}
+
+juce::String ProxyCache::runCodecBenchmark(int numChannels)
+{
+    numChannels = std::max(4, numChannels);
+    const auto frames = static_cast<size_t>(kChunkFrames);
+    const char* kinds[] = { "music", "ambience", "room tone", "silence" };
+
+    // Channels cycle through the kinds of material multichannel recordings
+    // hold: close-miked music, ambience, idle inputs and unused tracks
+    std::vector<std::vector<int16_t>> planes(static_cast<size_t>(numChannels), std::vector<int16_t>(frames));
+    std::mt19937 random(1);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (size_t c = 0; c < planes.size(); ++c)
+    {
+        auto& plane = planes[c];
+        float lowpassed = 0.0f;
+        for (size_t i = 0; i < frames; ++i)
+        {
+            const double t = static_cast<double>(i) / kSampleRate;
+            float v = 0.0f;
+            switch (c % 4)
+            {
+                case 0: v = 6000.0f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * (110.0 + 7.0 * c) * t)
+                                                         * (0.6 + 0.4 * std::sin(t * 1.3)))
+                          + 2500.0f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 660.0 * t))
+                          + 40.0f * noise(random);
+                        break;
+                case 1: lowpassed += 0.05f * (noise(random) - lowpassed); v = 4000.0f * lowpassed; break;
+                case 2: v = 3.0f * noise(random); break;
+                default: break;
+            }
+            plane[i] = static_cast<int16_t>(std::clamp(std::lround(v), -32768L, 32767L));
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> encoded(planes.size());
+    double start = juce::Time::getMillisecondCounterHiRes();
+    for (size_t c = 0; c < planes.size(); ++c)
+        PcmBlockCodec::encode(planes[c].data(), frames, encoded[c]);
+    const double encodeSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+    std::vector<std::vector<float>> decoded(planes.size(), std::vector<float>(frames));
+    std::atomic<bool> exact{ true };
+    auto decodePlane = [&](int c)
+    {
+        const auto index = static_cast<size_t>(c);
+        if (!PcmBlockCodec::decode(encoded[index].data(), encoded[index].size(), frames, decoded[index].data()))
+            exact = false;
+    };
+
+    constexpr int kPasses = 5;
+    start = juce::Time::getMillisecondCounterHiRes();
+    for (int pass = 0; pass < kPasses; ++pass)
+        for (int c = 0; c < numChannels; ++c)
+            decodePlane(c);
+    const double serialSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0 / kPasses;
+
+    start = juce::Time::getMillisecondCounterHiRes();
+    for (int pass = 0; pass < kPasses; ++pass)
+        parallelFor(numChannels, decodePlane);
+    const double parallelSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0 / kPasses;
+
+    for (size_t c = 0; c < planes.size(); ++c)
+        for (size_t i = 0; i < frames; ++i)
+            if (decoded[c][i] != static_cast<float>(planes[c][i]) * (1.0f / 32768.0f))
+                exact = false;
+
+    size_t rawBytes = 0, codedBytes = 0;
+    size_t kindRaw[4] = {}, kindCoded[4] = {};
+    for (size_t c = 0; c < planes.size(); ++c)
+    {
+        rawBytes += frames * sizeof(int16_t);
+        codedBytes += encoded[c].size();
+        kindRaw[c % 4] += frames * sizeof(int16_t);
+        kindCoded[c % 4] += encoded[c].size();
+    }
+
+    const double chunkSeconds = static_cast<double>(frames) / kSampleRate;
+    auto speed = [chunkSeconds](double seconds)
+    {
+        return juce::String(seconds * 1000.0, 1) + " ms (" + juce::String(chunkSeconds / seconds, 0) + "x real time)";
+    };
+
+    juce::String report = "Proxy codec: " + juce::String(numChannels) + " channels x " + juce::String(chunkSeconds, 0)
+                        + " s at " + juce::String(kSampleRate) + " Hz\n"
+                        + "  raw " + juce::String(static_cast<double>(rawBytes) / (1 << 20), 1) + " MB, coded "
+                        + juce::String(static_cast<double>(codedBytes) / (1 << 20), 1) + " MB ("
+                        + juce::String(static_cast<double>(rawBytes) / static_cast<double>(codedBytes), 2) + ":1)\n";
+
+    for (int k = 0; k < 4; ++k)
+        report += "    " + juce::String(kinds[k]).paddedRight(' ', 10)
+                + juce::String(static_cast<double>(kindRaw[k]) / static_cast<double>(std::max<size_t>(1, kindCoded[k])), 2) + ":1\n";
+
+    report += "  encode, 1 thread:   " + speed(encodeSeconds) + "\n"
+            + "  decode, 1 thread:   " + speed(serialSeconds) + "\n"
+            + "  decode, all cores:  " + speed(parallelSeconds) + "\n"
+            + "  round trip: " + (exact.load() ? "exact" : "MISMATCH") + "\n";
+    return report;
+}
@@ -0,0 +1,80 @@
+/*
+    ChannelStacker - Proxy Cache Header
+    Compact 16-bit 24 kHz copies of imported source streams, stored as
+    planar chunks in a cache directory so any channel reads back without
+    running ffmpeg. Each chunk's channel planes are packed losslessly with
+    PcmBlockCodec and decode independently; quiet, tonal and silent
+    channels take a fraction of their raw size. The player starts from a proxy straight away while the full
+    quality decode is still running. Proxies are made one at a time on a
+    background-priority thread that waits while interactive work (imports,
+    extraction, exports) is in progress.
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "../ffmpeg/FFmpegLocator.h"
+#include "../model/ProgressTracker.h"
+#include <deque>
+#include <mutex>
+#include <set>
+#include <vector>
+
+class ProxyCache : private juce::Thread
+{
+public:
+    static constexpr int kSampleRate = 24000;
+    static constexpr int kChunkFrames = kSampleRate * 10;
+
+    // interactiveWork: generation pauses while it has running jobs (may be null)
+    ProxyCache(const FFmpegLocator& locator, ProgressTracker* interactiveWork,
+               const juce::File& directory = getDefaultDirectory());
+    ~ProxyCache() override;
+
+    static juce::File getDefaultDirectory();
+
+    // Queue a proxy for a source stream unless one is cached or queued (any thread)
+    void request(const juce::File& source, int streamIndex, int numChannels);
+
+    bool isAvailable(const juce::File& source, int streamIndex) const;
+
+    // Read source channels from a finished proxy (any thread): dest channel k
+    // holds source channel channels[k] at kSampleRate. False if there's no proxy.
+    bool read(const juce::File& source, int streamIndex, const std::vector<int>& channels,
+              juce::AudioBuffer<float>& dest) const;
+
+    // Headless check of the proxy codec over one chunk of synthetic
+    // channels: size against raw 16-bit, and encode/decode speed
+    static juce::String runCodecBenchmark(int numChannels);
+
+private:
+    struct Item
+    {
+        juce::File source;
+        int streamIndex = 0;
+        int numChannels = 0;
+    };
+
+    void run() override;
+    bool generate(const Item& item);
+    void waitForIdle();
+    void removeStaleProxies();
+
+    // Named after the source's path, size and modification time, so an
+    // edited source gets a new proxy
+    juce::File proxyFileFor(const juce::File& source, int streamIndex) const;
+
+    const FFmpegLocator& ffmpegLocator;
+    ProgressTracker* interactiveWork;
+    juce::File cacheDirectory;
+
+    std::mutex queueLock;
+    std::deque<Item> queue;
+    std::set<juce::String> queued;        // Proxy file names queued or in progress
+    juce::WaitableEvent workAvailable;
+
+    static constexpr int kIdlePollMs = 250;
+    static constexpr int kMaxAgeDays = 30;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProxyCache)
+};
@@ -0,0 +1,396 @@
+/*
+    ChannelStacker - Sample Kernels Implementation
+*/
+
+#include "SampleKernels.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    //==========================================================================
+    // Format traits: bytes per sample and a little-endian load to float
+
+    template <SampleFormat F> struct Format;
+
+    template <> struct Format<SampleFormat::S16>
+    {
+        static constexpr size_t bytes = 2;
+        static float load(const uint8_t* p) noexcept
+        {
+            auto v = static_cast<int16_t>(static_cast<uint16_t>(p[0] | (p[1] << 8)));
+            return static_cast<float>(v) * (1.0f / 32768.0f);
+        }
+    };
+
+    template <> struct Format<SampleFormat::S24>
+    {
+        static constexpr size_t bytes = 3;
+        static float load(const uint8_t* p) noexcept
+        {
+            // Assemble in the top 24 bits so the shift sign-extends
+            auto v = static_cast<int32_t>(static_cast<uint32_t>(p[0]) << 8 | static_cast<uint32_t>(p[1]) << 16
+                                          | static_cast<uint32_t>(p[2]) << 24) >> 8;
+            return static_cast<float>(v) * (1.0f / 8388608.0f);
+        }
+    };
+
+    template <> struct Format<SampleFormat::S32>
+    {
+        static constexpr size_t bytes = 4;
+        static float load(const uint8_t* p) noexcept
+        {
+            int32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return static_cast<float>(v) * (1.0f / 2147483648.0f);
+        }
+    };
+
+    template <> struct Format<SampleFormat::F32>
+    {
+        static constexpr size_t bytes = 4;
+        static float load(const uint8_t* p) noexcept
+        {
+            float v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+    };
+
+    template <> struct Format<SampleFormat::F64>
+    {
+        static constexpr size_t bytes = 8;
+        static float load(const uint8_t* p) noexcept
+        {
+            double v;
+            std::memcpy(&v, p, sizeof(v));
+            return static_cast<float>(v);
+        }
+    };
+
+    //==========================================================================
+    // Kernels. Channels == 0 is the generic version that reads the runtime
+    // channel count; every other instantiation has a constant stride.
+
+    template <SampleFormat F>
+    void toFloatKernel(const void* src, float* dest, size_t numSamples)
+    {
+        if constexpr (F == SampleFormat::F32)
+        {
+            std::memcpy(dest, src, numSamples * sizeof(float));
+        }
+        else
+        {
+            const auto* p = static_cast<const uint8_t*>(src);
+            for (size_t i = 0; i < numSamples; ++i)
+                dest[i] = Format<F>::load(p + i * Format<F>::bytes);
+        }
+    }
+
+    template <SampleFormat F, int Channels>
+    void deinterleaveKernel(const void* src, size_t numFrames, int runtimeChannels, float* const* dest)
+    {
+        const int channels = Channels > 0 ? Channels : runtimeChannels;
+        const size_t stride = static_cast<size_t>(channels) * Format<F>::bytes;
+        const auto* p = static_cast<const uint8_t*>(src);
+
+        if constexpr (Channels > 0 && Channels <= 8)
+        {
+            // Few channels: one pass, the channel loop fully unrolled
+            for (size_t f = 0; f < numFrames; ++f)
+            {
+                const uint8_t* frame = p + f * stride;
+                for (int c = 0; c < Channels; ++c)
+                    dest[c][f] = Format<F>::load(frame + static_cast<size_t>(c) * Format<F>::bytes);
+            }
+        }
+        else
+        {
+            // Wide streams: tile the frames so each channel pass reads from cache
+            constexpr size_t kTileFrames = 256;
+            for (size_t start = 0; start < numFrames; start += kTileFrames)
+            {
+                size_t count = std::min(kTileFrames, numFrames - start);
+                for (int c = 0; c < channels; ++c)
+                {
+                    const uint8_t* in = p + start * stride + static_cast<size_t>(c) * Format<F>::bytes;
+                    float* out = dest[c] + start;
+                    for (size_t f = 0; f < count; ++f)
+                        out[f] = Format<F>::load(in + f * stride);
+                }
+            }
+        }
+    }
+
+    template <int Channels>
+    void minMaxKernel(const float* interleaved, size_t numFrames, int runtimeChannels, int channel,
+                      float& minValue, float& maxValue)
+    {
+        const size_t stride = static_cast<size_t>(Channels > 0 ? Channels : runtimeChannels);
+        const float* p = interleaved + channel;
+        float lo = minValue;
+        float hi = maxValue;
+
+        if constexpr (Channels == 1)
+        {
+            for (size_t i = 0; i < numFrames; ++i)
+            {
+                lo = std::min(lo, p[i]);
+                hi = std::max(hi, p[i]);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < numFrames; ++i)
+            {
+                float s = p[i * stride];
+                lo = std::min(lo, s);
+                hi = std::max(hi, s);
+            }
+        }
+
+        minValue = lo;
+        maxValue = hi;
+    }
+
+    template <int Channels>
+    float sumKernel(const float* interleaved, size_t numFrames, int runtimeChannels, int channel)
+    {
+        const size_t stride = static_cast<size_t>(Channels > 0 ? Channels : runtimeChannels);
+        const float* p = interleaved + channel;
+
+        // Independent partial sums let the loop pipeline
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        size_t i = 0;
+        for (; i + 4 <= numFrames; i += 4)
+            for (size_t k = 0; k < 4; ++k)
+                acc[k] += p[(i + k) * stride];
+
+        float total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        for (; i < numFrames; ++i)
+            total += p[i * stride];
+        return total;
+    }
+
+    template <int Channels>
+    float sumSquaresKernel(const float* interleaved, size_t numFrames, int runtimeChannels, int channel)
+    {
+        const size_t stride = static_cast<size_t>(Channels > 0 ? Channels : runtimeChannels);
+        const float* p = interleaved + channel;
+
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        size_t i = 0;
+        for (; i + 4 <= numFrames; i += 4)
+        {
+            for (size_t k = 0; k < 4; ++k)
+            {
+                const float s = p[(i + k) * stride];
+                acc[k] += s * s;
+            }
+        }
+
+        float total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        for (; i < numFrames; ++i)
+            total += p[i * stride] * p[i * stride];
+        return total;
+    }
+
+    //==========================================================================
+    // Dispatch table: formats x { specialised channel counts..., generic }
+
+    constexpr std::array<int, 7> kSpecialisedChannels = { 1, 2, 6, 8, 16, 32, 64 };
+    constexpr size_t kGenericColumn = kSpecialisedChannels.size();
+
+    template <SampleFormat F, int Channels>
+    constexpr SampleKernels makeKernels()
+    {
+        return { &toFloatKernel<F>, &deinterleaveKernel<F, Channels>, &minMaxKernel<Channels>, &sumKernel<Channels>,
+                 &sumSquaresKernel<Channels> };
+    }
+
+    template <SampleFormat F>
+    constexpr std::array<SampleKernels, kGenericColumn + 1> makeRow()
+    {
+        return { makeKernels<F, 1>(), makeKernels<F, 2>(), makeKernels<F, 6>(), makeKernels<F, 8>(),
+                 makeKernels<F, 16>(), makeKernels<F, 32>(), makeKernels<F, 64>(), makeKernels<F, 0>() };
+    }
+
+    // Indexed by SampleFormat
+    constexpr std::array<std::array<SampleKernels, kGenericColumn + 1>, 5> kKernelTable = {
+        makeRow<SampleFormat::S16>(), makeRow<SampleFormat::S24>(), makeRow<SampleFormat::S32>(),
+        makeRow<SampleFormat::F32>(), makeRow<SampleFormat::F64>()
+    };
+}
+
+const SampleKernels& SampleKernels::get(SampleFormat format, int numChannels)
+{
+    size_t column = kGenericColumn;
+    for (size_t i = 0; i < kSpecialisedChannels.size(); ++i)
+    {
+        if (kSpecialisedChannels[i] == numChannels)
+        {
+            column = i;
+            break;
+        }
+    }
+
+    return kKernelTable[static_cast<size_t>(format)][column];
+}
+
+SampleFormat SampleKernels::pipeFormatFor(const juce::String& probeSampleFormat, int bitsPerRawSample)
+{
+    // Planar variants ("s16p", "fltp", ...) are interleaved by ffmpeg on output
+    auto format = probeSampleFormat.trimCharactersAtEnd("p");
+
+    if (format == "u8" || format == "s16")
+        return SampleFormat::S16;
+    if (format == "s32")
+        return bitsPerRawSample > 0 && bitsPerRawSample <= 24 ? SampleFormat::S24 : SampleFormat::S32;
+    if (format == "dbl")
+        return SampleFormat::F64;
+
+    // flt, s64 and anything unknown
+    return SampleFormat::F32;
+}
+
+int SampleKernels::bytesPerSample(SampleFormat format)
+{
+    switch (format)
+    {
+        case SampleFormat::S16: return 2;
+        case SampleFormat::S24: return 3;
+        case SampleFormat::S32: return 4;
+        case SampleFormat::F32: return 4;
+        case SampleFormat::F64: return 8;
+    }
+    return 4;
+}
+
+const char* SampleKernels::ffmpegFormatName(SampleFormat format)
+{
+    switch (format)
+    {
+        case SampleFormat::S16: return "s16le";
+        case SampleFormat::S24: return "s24le";
+        case SampleFormat::S32: return "s32le";
+        case SampleFormat::F32: return "f32le";
+        case SampleFormat::F64: return "f64le";
+    }
+    return "f32le";
+}
+
+const char* SampleKernels::ffmpegCodecName(SampleFormat format)
+{
+    switch (format)
+    {
+        case SampleFormat::S16: return "pcm_s16le";
+        case SampleFormat::S24: return "pcm_s24le";
+        case SampleFormat::S32: return "pcm_s32le";
+        case SampleFormat::F32: return "pcm_f32le";
+        case SampleFormat::F64: return "pcm_f64le";
+    }
+    return "pcm_f32le";
+}
+
+juce::String SampleKernels::runBenchmark()
+{
+    constexpr size_t kFrames = 1 << 15;
+    constexpr int kPasses = 20;
+
+    juce::String report = "Sample kernels: specialised against generic stride, "
+                        + juce::String(static_cast<int>(kFrames)) + " frames\n";
+
+    // GB/s of 'bytes' over kPasses runs of fn, after one to warm the caches
+    auto measure = [](double bytes, const auto& fn)
+    {
+        fn();
+        const double start = juce::Time::getMillisecondCounterHiRes();
+        for (int pass = 0; pass < kPasses; ++pass)
+            fn();
+        const double seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+        return bytes * kPasses / std::max(seconds, 1.0e-9) / 1.0e9;
+    };
+
+    auto compare = [](double specialised, double generic)
+    {
+        return juce::String(specialised, 2) + " vs " + juce::String(generic, 2) + " GB/s ("
+             + juce::String(specialised / std::max(generic, 1.0e-9), 2) + "x)";
+    };
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> level(-1.0f, 1.0f);
+    volatile float sink = 0.0f;     // Keeps the reductions from being optimised away
+
+    for (auto format : { SampleFormat::S16, SampleFormat::S24, SampleFormat::F32 })
+    {
+        for (int numChannels : { 2, 8, 32, 64 })
+        {
+            const auto& specialised = get(format, numChannels);
+            const auto& generic = kKernelTable[static_cast<size_t>(format)][kGenericColumn];
+
+            // Random bytes are valid samples in the integer formats, not in float
+            const size_t numSamples = kFrames * static_cast<size_t>(numChannels);
+            std::vector<uint8_t> raw(numSamples * static_cast<size_t>(bytesPerSample(format)));
+            if (format == SampleFormat::F32)
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                {
+                    const float v = level(random);
+                    std::memcpy(raw.data() + i * sizeof(float), &v, sizeof(float));
+                }
+            }
+            else
+            {
+                for (auto& byte : raw)
+                    byte = static_cast<uint8_t>(random());
+            }
+
+            std::vector<float> interleaved(numSamples);
+            specialised.toFloat(raw.data(), interleaved.data(), numSamples);
+
+            std::vector<std::vector<float>> planes(static_cast<size_t>(numChannels), std::vector<float>(kFrames));
+            std::vector<float*> dest;
+            for (auto& plane : planes)
+                dest.push_back(plane.data());
+
+            auto deinterleave = [&](const SampleKernels& kernels)
+            {
+                return measure(static_cast<double>(raw.size()), [&]()
+                {
+                    kernels.deinterleave(raw.data(), kFrames, numChannels, dest.data());
+                });
+            };
+
+            // What the extraction pass runs per lane: min/max, sum and sum of squares
+            auto reduce = [&](const SampleKernels& kernels)
+            {
+                return measure(static_cast<double>(numSamples * sizeof(float)), [&]()
+                {
+                    for (int c = 0; c < numChannels; ++c)
+                    {
+                        float lo = 0.0f, hi = 0.0f;
+                        kernels.minMax(interleaved.data(), kFrames, numChannels, c, lo, hi);
+                        sink = lo + hi + kernels.sum(interleaved.data(), kFrames, numChannels, c)
+                              + kernels.sumSquares(interleaved.data(), kFrames, numChannels, c);
+                    }
+                });
+            };
+
+            const double deinterleaveSpecialised = deinterleave(specialised);
+            const double deinterleaveGeneric = deinterleave(generic);
+            const double reduceSpecialised = reduce(specialised);
+            const double reduceGeneric = reduce(generic);
+
+            report += "  " + juce::String(ffmpegFormatName(format)).paddedRight(' ', 6)
+                    + ("x" + juce::String(numChannels)).paddedRight(' ', 5)
+                    + "deinterleave " + compare(deinterleaveSpecialised, deinterleaveGeneric)
+                    + "   reduce " + compare(reduceSpecialised, reduceGeneric) + "\n";
+        }
+    }
+
+    return report;
+}
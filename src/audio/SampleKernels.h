@@ -0,0 +1,55 @@
+/*
+    ChannelStacker - Sample Kernels Header
+    Conversion and reduction loops specialised at compile time on the
+    sample format and on the common channel counts, so strides are
+    constants in the inner loops. A dispatch table picks the kernel set
+    once per stream; uncommon channel counts use a generic-stride version.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <cstddef>
+
+// Raw PCM layout of a decoded stream as it comes through the ffmpeg pipe
+enum class SampleFormat { S16, S24, S32, F32, F64 };
+
+struct SampleKernels
+{
+    // Interleaved raw samples -> interleaved float (numSamples = frames * channels)
+    using ToFloatFn = void (*)(const void* src, float* dest, size_t numSamples);
+
+    // Interleaved raw samples -> one float array per channel
+    using DeinterleaveFn = void (*)(const void* src, size_t numFrames, int numChannels, float* const* dest);
+
+    // Running min/max of one channel of an interleaved float block
+    using MinMaxFn = void (*)(const float* interleaved, size_t numFrames, int numChannels, int channel,
+                              float& minValue, float& maxValue);
+
+    // Sum (or sum of squares) of one channel of an interleaved float block
+    using SumFn = float (*)(const float* interleaved, size_t numFrames, int numChannels, int channel);
+
+    ToFloatFn toFloat;
+    DeinterleaveFn deinterleave;
+    MinMaxFn minMax;
+    SumFn sum;
+    SumFn sumSquares;
+
+    // Kernel set for a format and channel count (looked up once per stream)
+    static const SampleKernels& get(SampleFormat format, int numChannels);
+
+    // Pipe format that carries ffprobe's sample_fmt without widening it:
+    // s16 stays 16-bit, 24-bit-in-s32 sources come through as s24, etc.
+    static SampleFormat pipeFormatFor(const juce::String& probeSampleFormat, int bitsPerRawSample);
+
+    static int bytesPerSample(SampleFormat format);
+
+    // ffmpeg "-f" muxer name and matching "-acodec" for the format
+    static const char* ffmpegFormatName(SampleFormat format);
+    static const char* ffmpegCodecName(SampleFormat format);
+
+    // Headless check of the specialised kernels against the generic-stride
+    // ones at the same channel counts: deinterleave and the per-channel
+    // reductions, in GB/s of input
+    static juce::String runBenchmark();
+};
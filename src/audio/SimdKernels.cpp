@@ -0,0 +1,669 @@
+/*
+    ChannelStacker - SIMD Kernels Implementation
+*/
+
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define CS_SIMD_SSE 1
+ #include <immintrin.h>
+ #if defined(__GNUC__) || defined(__clang__)
+  // AVX2 paths are compiled with a target attribute and selected at runtime,
+  // so the rest of the binary keeps the baseline instruction set
+  #define CS_SIMD_AVX2 1
+  #define CS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+ #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+ #define CS_SIMD_NEON 1
+ #include <arm_neon.h>
+#endif
+
+// GCC fuses multiply-add pairs into FMA where the target has it (including
+// the AVX2 functions), which would round differently from the other paths
+#if defined(__GNUC__) && ! defined(__clang__)
+ #define CS_EXACT_FLOAT __attribute__((optimize("fp-contract=off")))
+#else
+ #define CS_EXACT_FLOAT
+#endif
+
+namespace
+{
+    // 32-bit integer hash (lowbias32); every SIMD path below mirrors it
+    constexpr uint32_t kHashMul1 = 0x7feb352dU;
+    constexpr uint32_t kHashMul2 = 0x846ca68bU;
+
+    inline uint32_t hash32(uint32_t x) noexcept
+    {
+        x ^= x >> 16;
+        x *= kHashMul1;
+        x ^= x >> 15;
+        x *= kHashMul2;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Two 16-bit uniforms from one hash summed into a triangular value
+    inline int32_t triangular(uint32_t h) noexcept
+    {
+        return static_cast<int32_t>((h & 0xFFFFu) + (h >> 16)) - 65535;
+    }
+
+    void quantiseScalar(const float* src, int32_t* dest, size_t n, float scale, float noiseGain,
+                        uint32_t key, uint32_t firstIndex) noexcept
+    {
+        const float noiseScale = noiseGain / 65536.0f;
+        const float lo = -scale;
+        const float hi = scale - 1.0f;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            float d = static_cast<float>(triangular(hash32(firstIndex + static_cast<uint32_t>(i) + key))) * noiseScale;
+            float y = src[i] * scale + d;
+            y = y < lo ? lo : (y > hi ? hi : y);
+            dest[i] = static_cast<int32_t>(std::nearbyint(y));
+        }
+    }
+
+    // Error feedback state of one frame: the history planes, most recent first
+    struct FeedbackState
+    {
+        const float* taps;
+        float maxError;
+        float* e0;
+        float* e1;
+        float* e2;
+    };
+
+    CS_EXACT_FLOAT void errorFeedbackScalar(const float* src, int32_t* dest, size_t n, float scale, const FeedbackState& s,
+                             uint32_t key, uint32_t firstIndex) noexcept
+    {
+        const float lo = -scale;
+        const float hi = scale - 1.0f;
+
+        for (size_t c = 0; c < n; ++c)
+        {
+            float d = static_cast<float>(triangular(hash32(firstIndex + static_cast<uint32_t>(c) + key))) / 65536.0f;
+            float target = src[c] * scale - (s.taps[0] * s.e0[c] + s.taps[1] * s.e1[c] + s.taps[2] * s.e2[c]);
+            float y = target + d;
+            y = y < lo ? lo : (y > hi ? hi : y);
+            float q = std::nearbyint(y);
+            float error = q - target;
+            error = error < -s.maxError ? -s.maxError : (error > s.maxError ? s.maxError : error);
+
+            s.e2[c] = s.e1[c];
+            s.e1[c] = s.e0[c];
+            s.e0[c] = error;
+            dest[c] = static_cast<int32_t>(q);
+        }
+    }
+
+    void accumulateDifferenceScalar(const float* ref, const float* test, size_t n,
+                                    float& maxDifference, float& peak) noexcept
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            maxDifference = std::max(maxDifference, std::abs(test[i] - ref[i]));
+            peak = std::max(peak, std::abs(ref[i]));
+        }
+    }
+
+#if CS_SIMD_AVX2
+    bool hasAvx2() noexcept
+    {
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+    }
+
+    CS_TARGET_AVX2 void quantiseAvx2(const float* src, int32_t* dest, size_t n, float scale, float noiseGain,
+                                     uint32_t key, uint32_t firstIndex) noexcept
+    {
+        const __m256 vScale = _mm256_set1_ps(scale);
+        const __m256 vLo = _mm256_set1_ps(-scale);
+        const __m256 vHi = _mm256_set1_ps(scale - 1.0f);
+        const __m256 vNoise = _mm256_set1_ps(noiseGain / 65536.0f);
+        const __m256i vMul1 = _mm256_set1_epi32(static_cast<int>(kHashMul1));
+        const __m256i vMul2 = _mm256_set1_epi32(static_cast<int>(kHashMul2));
+        const __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+        const __m256i offset = _mm256_set1_epi32(65535);
+        const __m256i step = _mm256_set1_epi32(8);
+        __m256i counter = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(firstIndex + key)),
+                                           _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        size_t i = 0;
+
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i x = counter;
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+            x = _mm256_mullo_epi32(x, vMul1);
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+            x = _mm256_mullo_epi32(x, vMul2);
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+
+            __m256i tri = _mm256_sub_epi32(_mm256_add_epi32(_mm256_and_si256(x, lowMask), _mm256_srli_epi32(x, 16)), offset);
+
+            // Separate multiply and add (no FMA) to match the other paths bit for bit
+            __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), vScale),
+                                     _mm256_mul_ps(_mm256_cvtepi32_ps(tri), vNoise));
+            y = _mm256_min_ps(_mm256_max_ps(y, vLo), vHi);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_cvtps_epi32(y));
+
+            counter = _mm256_add_epi32(counter, step);
+        }
+
+        quantiseScalar(src + i, dest + i, n - i, scale, noiseGain, key, firstIndex + static_cast<uint32_t>(i));
+    }
+
+    CS_TARGET_AVX2 CS_EXACT_FLOAT void errorFeedbackAvx2(const float* src, int32_t* dest, size_t n, float scale, const FeedbackState& s,
+                                          uint32_t key, uint32_t firstIndex) noexcept
+    {
+        const __m256 vScale = _mm256_set1_ps(scale);
+        const __m256 vLo = _mm256_set1_ps(-scale);
+        const __m256 vHi = _mm256_set1_ps(scale - 1.0f);
+        const __m256 vNoise = _mm256_set1_ps(1.0f / 65536.0f);
+        const __m256 vMax = _mm256_set1_ps(s.maxError);
+        const __m256 vMin = _mm256_set1_ps(-s.maxError);
+        const __m256 t0 = _mm256_set1_ps(s.taps[0]);
+        const __m256 t1 = _mm256_set1_ps(s.taps[1]);
+        const __m256 t2 = _mm256_set1_ps(s.taps[2]);
+        const __m256i vMul1 = _mm256_set1_epi32(static_cast<int>(kHashMul1));
+        const __m256i vMul2 = _mm256_set1_epi32(static_cast<int>(kHashMul2));
+        const __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+        const __m256i offset = _mm256_set1_epi32(65535);
+        const __m256i step = _mm256_set1_epi32(8);
+        __m256i counter = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(firstIndex + key)),
+                                           _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        size_t c = 0;
+
+        for (; c + 8 <= n; c += 8)
+        {
+            __m256i x = counter;
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+            x = _mm256_mullo_epi32(x, vMul1);
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+            x = _mm256_mullo_epi32(x, vMul2);
+            x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+            __m256i tri = _mm256_sub_epi32(_mm256_add_epi32(_mm256_and_si256(x, lowMask), _mm256_srli_epi32(x, 16)), offset);
+
+            const __m256 h0 = _mm256_loadu_ps(s.e0 + c);
+            const __m256 h1 = _mm256_loadu_ps(s.e1 + c);
+            const __m256 feedback = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(t0, h0), _mm256_mul_ps(t1, h1)),
+                                                  _mm256_mul_ps(t2, _mm256_loadu_ps(s.e2 + c)));
+            const __m256 target = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(src + c), vScale), feedback);
+            __m256 y = _mm256_add_ps(target, _mm256_mul_ps(_mm256_cvtepi32_ps(tri), vNoise));
+            y = _mm256_min_ps(_mm256_max_ps(y, vLo), vHi);
+            const __m256i q = _mm256_cvtps_epi32(y);
+            const __m256 error = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(q), target), vMin), vMax);
+
+            _mm256_storeu_ps(s.e2 + c, h1);
+            _mm256_storeu_ps(s.e1 + c, h0);
+            _mm256_storeu_ps(s.e0 + c, error);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + c), q);
+
+            counter = _mm256_add_epi32(counter, step);
+        }
+
+        FeedbackState rest{ s.taps, s.maxError, s.e0 + c, s.e1 + c, s.e2 + c };
+        errorFeedbackScalar(src + c, dest + c, n - c, scale, rest, key, firstIndex + static_cast<uint32_t>(c));
+    }
+
+    CS_TARGET_AVX2 float dotProductAvx2(const float* a, const float* b, size_t n) noexcept
+    {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        size_t i = 0;
+
+        for (; i + 16 <= n; i += 16)
+        {
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i),     _mm256_loadu_ps(b + i),     acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        }
+
+        acc0 = _mm256_add_ps(acc0, acc1);
+        __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        float result = _mm_cvtss_f32(acc);
+
+        for (; i < n; ++i)
+            result += a[i] * b[i];
+
+        return result;
+    }
+
+    CS_TARGET_AVX2 void accumulateDifferenceAvx2(const float* ref, const float* test, size_t n,
+                                                 float& maxDifference, float& peak) noexcept
+    {
+        const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        __m256 vDiff = _mm256_set1_ps(maxDifference);
+        __m256 vPeak = _mm256_set1_ps(peak);
+        size_t i = 0;
+
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 r = _mm256_loadu_ps(ref + i);
+            __m256 d = _mm256_sub_ps(_mm256_loadu_ps(test + i), r);
+            vDiff = _mm256_max_ps(vDiff, _mm256_and_ps(d, absMask));
+            vPeak = _mm256_max_ps(vPeak, _mm256_and_ps(r, absMask));
+        }
+
+        __m128 diff = _mm_max_ps(_mm256_castps256_ps128(vDiff), _mm256_extractf128_ps(vDiff, 1));
+        __m128 pk = _mm_max_ps(_mm256_castps256_ps128(vPeak), _mm256_extractf128_ps(vPeak, 1));
+        diff = _mm_max_ps(diff, _mm_movehl_ps(diff, diff));
+        pk = _mm_max_ps(pk, _mm_movehl_ps(pk, pk));
+        maxDifference = _mm_cvtss_f32(_mm_max_ss(diff, _mm_shuffle_ps(diff, diff, 1)));
+        peak = _mm_cvtss_f32(_mm_max_ss(pk, _mm_shuffle_ps(pk, pk, 1)));
+
+        accumulateDifferenceScalar(ref + i, test + i, n - i, maxDifference, peak);
+    }
+#endif
+
+#if CS_SIMD_SSE
+    // SSE2 has no 32-bit low multiply; build it from two 32x32->64 multiplies
+    inline __m128i mulloSse2(__m128i a, __m128i b) noexcept
+    {
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    void quantiseSse(const float* src, int32_t* dest, size_t n, float scale, float noiseGain,
+                     uint32_t key, uint32_t firstIndex) noexcept
+    {
+        const __m128 vScale = _mm_set1_ps(scale);
+        const __m128 vLo = _mm_set1_ps(-scale);
+        const __m128 vHi = _mm_set1_ps(scale - 1.0f);
+        const __m128 vNoise = _mm_set1_ps(noiseGain / 65536.0f);
+        const __m128i vMul1 = _mm_set1_epi32(static_cast<int>(kHashMul1));
+        const __m128i vMul2 = _mm_set1_epi32(static_cast<int>(kHashMul2));
+        const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+        const __m128i offset = _mm_set1_epi32(65535);
+        const __m128i step = _mm_set1_epi32(4);
+        __m128i counter = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(firstIndex + key)), _mm_setr_epi32(0, 1, 2, 3));
+        size_t i = 0;
+
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i x = counter;
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+            x = mulloSse2(x, vMul1);
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+            x = mulloSse2(x, vMul2);
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+
+            __m128i tri = _mm_sub_epi32(_mm_add_epi32(_mm_and_si128(x, lowMask), _mm_srli_epi32(x, 16)), offset);
+
+            __m128 y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i), vScale),
+                                  _mm_mul_ps(_mm_cvtepi32_ps(tri), vNoise));
+            y = _mm_min_ps(_mm_max_ps(y, vLo), vHi);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_cvtps_epi32(y));
+
+            counter = _mm_add_epi32(counter, step);
+        }
+
+        quantiseScalar(src + i, dest + i, n - i, scale, noiseGain, key, firstIndex + static_cast<uint32_t>(i));
+    }
+
+    CS_EXACT_FLOAT void errorFeedbackSse(const float* src, int32_t* dest, size_t n, float scale, const FeedbackState& s,
+                          uint32_t key, uint32_t firstIndex) noexcept
+    {
+        const __m128 vScale = _mm_set1_ps(scale);
+        const __m128 vLo = _mm_set1_ps(-scale);
+        const __m128 vHi = _mm_set1_ps(scale - 1.0f);
+        const __m128 vNoise = _mm_set1_ps(1.0f / 65536.0f);
+        const __m128 vMax = _mm_set1_ps(s.maxError);
+        const __m128 vMin = _mm_set1_ps(-s.maxError);
+        const __m128 t0 = _mm_set1_ps(s.taps[0]);
+        const __m128 t1 = _mm_set1_ps(s.taps[1]);
+        const __m128 t2 = _mm_set1_ps(s.taps[2]);
+        const __m128i vMul1 = _mm_set1_epi32(static_cast<int>(kHashMul1));
+        const __m128i vMul2 = _mm_set1_epi32(static_cast<int>(kHashMul2));
+        const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+        const __m128i offset = _mm_set1_epi32(65535);
+        const __m128i step = _mm_set1_epi32(4);
+        __m128i counter = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(firstIndex + key)), _mm_setr_epi32(0, 1, 2, 3));
+        size_t c = 0;
+
+        for (; c + 4 <= n; c += 4)
+        {
+            __m128i x = counter;
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+            x = mulloSse2(x, vMul1);
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+            x = mulloSse2(x, vMul2);
+            x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+            __m128i tri = _mm_sub_epi32(_mm_add_epi32(_mm_and_si128(x, lowMask), _mm_srli_epi32(x, 16)), offset);
+
+            const __m128 h0 = _mm_loadu_ps(s.e0 + c);
+            const __m128 h1 = _mm_loadu_ps(s.e1 + c);
+            const __m128 feedback = _mm_add_ps(_mm_add_ps(_mm_mul_ps(t0, h0), _mm_mul_ps(t1, h1)),
+                                               _mm_mul_ps(t2, _mm_loadu_ps(s.e2 + c)));
+            const __m128 target = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(src + c), vScale), feedback);
+            __m128 y = _mm_add_ps(target, _mm_mul_ps(_mm_cvtepi32_ps(tri), vNoise));
+            y = _mm_min_ps(_mm_max_ps(y, vLo), vHi);
+            const __m128i q = _mm_cvtps_epi32(y);
+            const __m128 error = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_cvtepi32_ps(q), target), vMin), vMax);
+
+            _mm_storeu_ps(s.e2 + c, h1);
+            _mm_storeu_ps(s.e1 + c, h0);
+            _mm_storeu_ps(s.e0 + c, error);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + c), q);
+
+            counter = _mm_add_epi32(counter, step);
+        }
+
+        FeedbackState rest{ s.taps, s.maxError, s.e0 + c, s.e1 + c, s.e2 + c };
+        errorFeedbackScalar(src + c, dest + c, n - c, scale, rest, key, firstIndex + static_cast<uint32_t>(c));
+    }
+
+    float dotProductSse(const float* a, const float* b, size_t n) noexcept
+    {
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        size_t i = 0;
+
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i),     _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+
+        __m128 acc = _mm_add_ps(acc0, acc1);
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        float result = _mm_cvtss_f32(acc);
+
+        for (; i < n; ++i)
+            result += a[i] * b[i];
+
+        return result;
+    }
+
+    void accumulateDifferenceSse(const float* ref, const float* test, size_t n,
+                                 float& maxDifference, float& peak) noexcept
+    {
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        __m128 vDiff = _mm_set1_ps(maxDifference);
+        __m128 vPeak = _mm_set1_ps(peak);
+        size_t i = 0;
+
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 r = _mm_loadu_ps(ref + i);
+            __m128 d = _mm_sub_ps(_mm_loadu_ps(test + i), r);
+            vDiff = _mm_max_ps(vDiff, _mm_and_ps(d, absMask));
+            vPeak = _mm_max_ps(vPeak, _mm_and_ps(r, absMask));
+        }
+
+        vDiff = _mm_max_ps(vDiff, _mm_movehl_ps(vDiff, vDiff));
+        vPeak = _mm_max_ps(vPeak, _mm_movehl_ps(vPeak, vPeak));
+        maxDifference = _mm_cvtss_f32(_mm_max_ss(vDiff, _mm_shuffle_ps(vDiff, vDiff, 1)));
+        peak = _mm_cvtss_f32(_mm_max_ss(vPeak, _mm_shuffle_ps(vPeak, vPeak, 1)));
+
+        accumulateDifferenceScalar(ref + i, test + i, n - i, maxDifference, peak);
+    }
+#endif
+
+#if CS_SIMD_NEON
+    void quantiseNeon(const float* src, int32_t* dest, size_t n, float scale, float noiseGain,
+                      uint32_t key, uint32_t firstIndex) noexcept
+    {
+        const float32x4_t vScale = vdupq_n_f32(scale);
+        const float32x4_t vLo = vdupq_n_f32(-scale);
+        const float32x4_t vHi = vdupq_n_f32(scale - 1.0f);
+        const float32x4_t vNoise = vdupq_n_f32(noiseGain / 65536.0f);
+        const uint32x4_t lowMask = vdupq_n_u32(0xFFFFu);
+        const int32x4_t offset = vdupq_n_s32(65535);
+        const uint32_t lanes[4] = { 0, 1, 2, 3 };
+        uint32x4_t counter = vaddq_u32(vdupq_n_u32(firstIndex + key), vld1q_u32(lanes));
+        size_t i = 0;
+
+        for (; i + 4 <= n; i += 4)
+        {
+            uint32x4_t x = counter;
+            x = veorq_u32(x, vshrq_n_u32(x, 16));
+            x = vmulq_n_u32(x, kHashMul1);
+            x = veorq_u32(x, vshrq_n_u32(x, 15));
+            x = vmulq_n_u32(x, kHashMul2);
+            x = veorq_u32(x, vshrq_n_u32(x, 16));
+
+            int32x4_t tri = vsubq_s32(vreinterpretq_s32_u32(vaddq_u32(vandq_u32(x, lowMask), vshrq_n_u32(x, 16))), offset);
+
+            float32x4_t y = vaddq_f32(vmulq_f32(vld1q_f32(src + i), vScale),
+                                      vmulq_f32(vcvtq_f32_s32(tri), vNoise));
+            y = vminq_f32(vmaxq_f32(y, vLo), vHi);
+            vst1q_s32(dest + i, vcvtnq_s32_f32(y));
+
+            counter = vaddq_u32(counter, vdupq_n_u32(4));
+        }
+
+        quantiseScalar(src + i, dest + i, n - i, scale, noiseGain, key, firstIndex + static_cast<uint32_t>(i));
+    }
+
+    CS_EXACT_FLOAT void errorFeedbackNeon(const float* src, int32_t* dest, size_t n, float scale, const FeedbackState& s,
+                           uint32_t key, uint32_t firstIndex) noexcept
+    {
+        const float32x4_t vScale = vdupq_n_f32(scale);
+        const float32x4_t vLo = vdupq_n_f32(-scale);
+        const float32x4_t vHi = vdupq_n_f32(scale - 1.0f);
+        const float32x4_t vNoise = vdupq_n_f32(1.0f / 65536.0f);
+        const float32x4_t vMax = vdupq_n_f32(s.maxError);
+        const float32x4_t vMin = vdupq_n_f32(-s.maxError);
+        const uint32x4_t lowMask = vdupq_n_u32(0xFFFFu);
+        const int32x4_t offset = vdupq_n_s32(65535);
+        const uint32_t lanes[4] = { 0, 1, 2, 3 };
+        uint32x4_t counter = vaddq_u32(vdupq_n_u32(firstIndex + key), vld1q_u32(lanes));
+        size_t c = 0;
+
+        for (; c + 4 <= n; c += 4)
+        {
+            uint32x4_t x = counter;
+            x = veorq_u32(x, vshrq_n_u32(x, 16));
+            x = vmulq_n_u32(x, kHashMul1);
+            x = veorq_u32(x, vshrq_n_u32(x, 15));
+            x = vmulq_n_u32(x, kHashMul2);
+            x = veorq_u32(x, vshrq_n_u32(x, 16));
+            int32x4_t tri = vsubq_s32(vreinterpretq_s32_u32(vaddq_u32(vandq_u32(x, lowMask), vshrq_n_u32(x, 16))), offset);
+
+            // Separate multiplies and adds (no vmla/vfma) to match the other paths bit for bit
+            const float32x4_t h0 = vld1q_f32(s.e0 + c);
+            const float32x4_t h1 = vld1q_f32(s.e1 + c);
+            const float32x4_t feedback = vaddq_f32(vaddq_f32(vmulq_n_f32(h0, s.taps[0]), vmulq_n_f32(h1, s.taps[1])),
+                                                   vmulq_n_f32(vld1q_f32(s.e2 + c), s.taps[2]));
+            const float32x4_t target = vsubq_f32(vmulq_f32(vld1q_f32(src + c), vScale), feedback);
+            float32x4_t y = vaddq_f32(target, vmulq_f32(vcvtq_f32_s32(tri), vNoise));
+            y = vminq_f32(vmaxq_f32(y, vLo), vHi);
+            const int32x4_t q = vcvtnq_s32_f32(y);
+            const float32x4_t error = vminq_f32(vmaxq_f32(vsubq_f32(vcvtq_f32_s32(q), target), vMin), vMax);
+
+            vst1q_f32(s.e2 + c, h1);
+            vst1q_f32(s.e1 + c, h0);
+            vst1q_f32(s.e0 + c, error);
+            vst1q_s32(dest + c, q);
+
+            counter = vaddq_u32(counter, vdupq_n_u32(4));
+        }
+
+        FeedbackState rest{ s.taps, s.maxError, s.e0 + c, s.e1 + c, s.e2 + c };
+        errorFeedbackScalar(src + c, dest + c, n - c, scale, rest, key, firstIndex + static_cast<uint32_t>(c));
+    }
+
+    float dotProductNeon(const float* a, const float* b, size_t n) noexcept
+    {
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        size_t i = 0;
+
+        for (; i + 8 <= n; i += 8)
+        {
+            acc0 = vmlaq_f32(acc0, vld1q_f32(a + i),     vld1q_f32(b + i));
+            acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+
+        float32x4_t acc = vaddq_f32(acc0, acc1);
+        float32x2_t half = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+        float result = vget_lane_f32(vpadd_f32(half, half), 0);
+
+        for (; i < n; ++i)
+            result += a[i] * b[i];
+
+        return result;
+    }
+
+    void accumulateDifferenceNeon(const float* ref, const float* test, size_t n,
+                                  float& maxDifference, float& peak) noexcept
+    {
+        float32x4_t vDiff = vdupq_n_f32(maxDifference);
+        float32x4_t vPeak = vdupq_n_f32(peak);
+        size_t i = 0;
+
+        for (; i + 4 <= n; i += 4)
+        {
+            float32x4_t r = vld1q_f32(ref + i);
+            vDiff = vmaxq_f32(vDiff, vabdq_f32(vld1q_f32(test + i), r));
+            vPeak = vmaxq_f32(vPeak, vabsq_f32(r));
+        }
+
+        float32x2_t diff = vpmax_f32(vget_low_f32(vDiff), vget_high_f32(vDiff));
+        float32x2_t pk = vpmax_f32(vget_low_f32(vPeak), vget_high_f32(vPeak));
+        maxDifference = vget_lane_f32(vpmax_f32(diff, diff), 0);
+        peak = vget_lane_f32(vpmax_f32(pk, pk), 0);
+
+        accumulateDifferenceScalar(ref + i, test + i, n - i, maxDifference, peak);
+    }
+#endif
+
+#if ! (CS_SIMD_SSE || CS_SIMD_NEON)
+    float dotProductScalar(const float* a, const float* b, size_t n) noexcept
+    {
+        // Four independent accumulators so the compiler can pipeline the loop
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        size_t i = 0;
+
+        for (; i + 4 <= n; i += 4)
+            for (size_t k = 0; k < 4; ++k)
+                acc[k] += a[i + k] * b[i + k];
+
+        float result = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        for (; i < n; ++i)
+            result += a[i] * b[i];
+
+        return result;
+    }
+#endif
+}
+
+float SimdKernels::dotProduct(const float* a, const float* b, size_t numSamples) noexcept
+{
+#if CS_SIMD_AVX2
+    if (hasAvx2())
+        return dotProductAvx2(a, b, numSamples);
+#endif
+#if CS_SIMD_SSE
+    return dotProductSse(a, b, numSamples);
+#elif CS_SIMD_NEON
+    return dotProductNeon(a, b, numSamples);
+#else
+    return dotProductScalar(a, b, numSamples);
+#endif
+}
+
+double SimdKernels::sum(const float* a, size_t numSamples) noexcept
+{
+    // Sum in float blocks (vectorisable) and fold each block into a double,
+    // which keeps the error bounded for hour-long signals
+    constexpr size_t kBlock = 4096;
+    double total = 0.0;
+
+    for (size_t start = 0; start < numSamples; start += kBlock)
+    {
+        size_t count = numSamples - start < kBlock ? numSamples - start : kBlock;
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        size_t i = 0;
+
+        for (; i + 4 <= count; i += 4)
+            for (size_t k = 0; k < 4; ++k)
+                acc[k] += a[start + i + k];
+
+        float blockSum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        for (; i < count; ++i)
+            blockSum += a[start + i];
+
+        total += static_cast<double>(blockSum);
+    }
+
+    return total;
+}
+
+void SimdKernels::accumulateDifference(const float* reference, const float* test, size_t numSamples,
+                                       float& maxDifference, float& peak) noexcept
+{
+#if CS_SIMD_AVX2
+    if (hasAvx2())
+        return accumulateDifferenceAvx2(reference, test, numSamples, maxDifference, peak);
+#endif
+#if CS_SIMD_SSE
+    accumulateDifferenceSse(reference, test, numSamples, maxDifference, peak);
+#elif CS_SIMD_NEON
+    accumulateDifferenceNeon(reference, test, numSamples, maxDifference, peak);
+#else
+    accumulateDifferenceScalar(reference, test, numSamples, maxDifference, peak);
+#endif
+}
+
+void SimdKernels::quantiseWithDither(const float* src, int32_t* dest, size_t numSamples,
+                                     float scale, float noiseGain, uint32_t key, uint32_t firstIndex) noexcept
+{
+#if CS_SIMD_AVX2
+    if (hasAvx2())
+        return quantiseAvx2(src, dest, numSamples, scale, noiseGain, key, firstIndex);
+#endif
+#if CS_SIMD_SSE
+    quantiseSse(src, dest, numSamples, scale, noiseGain, key, firstIndex);
+#elif CS_SIMD_NEON
+    quantiseNeon(src, dest, numSamples, scale, noiseGain, key, firstIndex);
+#else
+    quantiseScalar(src, dest, numSamples, scale, noiseGain, key, firstIndex);
+#endif
+}
+
+float SimdKernels::tpdfNoise(uint32_t key, uint32_t counter) noexcept
+{
+    return static_cast<float>(triangular(hash32(counter + key))) / 65536.0f;
+}
+
+void SimdKernels::quantiseWithErrorFeedback(const float* src, int32_t* dest, size_t numChannels, float scale,
+                                            const float* taps, float maxError,
+                                            float* history0, float* history1, float* history2,
+                                            uint32_t key, uint32_t firstIndex) noexcept
+{
+    const FeedbackState state{ taps, maxError, history0, history1, history2 };
+#if CS_SIMD_AVX2
+    if (hasAvx2())
+        return errorFeedbackAvx2(src, dest, numChannels, scale, state, key, firstIndex);
+#endif
+#if CS_SIMD_SSE
+    errorFeedbackSse(src, dest, numChannels, scale, state, key, firstIndex);
+#elif CS_SIMD_NEON
+    errorFeedbackNeon(src, dest, numChannels, scale, state, key, firstIndex);
+#else
+    errorFeedbackScalar(src, dest, numChannels, scale, state, key, firstIndex);
+#endif
+}
+
+const char* SimdKernels::getActiveInstructionSet() noexcept
+{
+#if CS_SIMD_AVX2
+    if (hasAvx2())
+        return "AVX2";
+#endif
+#if CS_SIMD_SSE
+    return "SSE2";
+#elif CS_SIMD_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
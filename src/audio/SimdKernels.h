@@ -0,0 +1,52 @@
+/*
+    ChannelStacker - SIMD Kernels Header
+    Vectorised inner loops shared by the analysis and export code.
+    Each kernel picks AVX2, SSE2 or NEON at runtime/compile time and
+    falls back to plain C++ everywhere else.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct SimdKernels
+{
+    // Sum of a[i] * b[i]
+    static float dotProduct(const float* a, const float* b, size_t numSamples) noexcept;
+
+    // Sum of a[i], accumulated in double precision
+    static double sum(const float* a, size_t numSamples) noexcept;
+
+    // Null test: raises maxDifference to the largest |test[i] - reference[i]|
+    // and peak to the largest |reference[i]|
+    static void accumulateDifference(const float* reference, const float* test, size_t numSamples,
+                                     float& maxDifference, float& peak) noexcept;
+
+    // dest[i] = round(src[i] * scale + noiseGain * tpdf(i)), clipped to
+    // [-scale, scale - 1]. The TPDF dither (+/-1 LSB) comes from a counter-based
+    // generator: sample i uses counter firstIndex + i under the given key, so
+    // the result does not depend on how a stream is split into calls, nor on
+    // which instruction set runs it.
+    static void quantiseWithDither(const float* src, int32_t* dest, size_t numSamples,
+                                   float scale, float noiseGain, uint32_t key, uint32_t firstIndex) noexcept;
+
+    // The generator behind quantiseWithDither, for scalar callers: TPDF value
+    // for one counter, in LSB (-1, 1)
+    static float tpdfNoise(uint32_t key, uint32_t counter) noexcept;
+
+    // One frame of noise-shaped quantisation, vectorised across channels.
+    // Channel c subtracts taps[0..2] times its last three errors (history0[c]
+    // most recent) from src[c] * scale, adds the quantiseWithDither noise for
+    // counter firstIndex + c, then clips and rounds into dest[c]. Its error,
+    // limited to +/-maxError, is shifted into the history planes.
+    static void quantiseWithErrorFeedback(const float* src, int32_t* dest, size_t numChannels, float scale,
+                                          const float* taps, float maxError,
+                                          float* history0, float* history1, float* history2,
+                                          uint32_t key, uint32_t firstIndex) noexcept;
+
+    // Name of the instruction set the kernels dispatch to on this machine
+    static const char* getActiveInstructionSet() noexcept;
+
+    SimdKernels() = delete;
+};
@@ -0,0 +1,269 @@
+/*
+    ChannelStacker - Stream Checksum Implementation
+*/
+
+#include "StreamChecksum.h"
+#include <cstring>
+
+namespace
+{
+    //==========================================================================
+    // xxHash64 (seed 0)
+
+    constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+    inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    inline uint32_t rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+    inline uint64_t read64(const uint8_t* p)
+    {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i)
+            v = (v << 8) | p[i];
+        return v;
+    }
+
+    inline uint32_t read32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8
+             | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    inline uint64_t xxRound(uint64_t acc, uint64_t input)
+    {
+        acc += input * kPrime2;
+        acc = rotl64(acc, 31);
+        return acc * kPrime1;
+    }
+
+    inline uint64_t xxMerge(uint64_t acc, uint64_t value)
+    {
+        acc ^= xxRound(0, value);
+        return acc * kPrime1 + kPrime4;
+    }
+
+    inline void xxStripe(std::array<uint64_t, 4>& acc, const uint8_t* p)
+    {
+        acc[0] = xxRound(acc[0], read64(p));
+        acc[1] = xxRound(acc[1], read64(p + 8));
+        acc[2] = xxRound(acc[2], read64(p + 16));
+        acc[3] = xxRound(acc[3], read64(p + 24));
+    }
+
+    //==========================================================================
+    // MD5 (RFC 1321)
+
+    constexpr uint32_t kMd5K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+
+    constexpr int kMd5Shift[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+}
+
+void StreamChecksum::reset()
+{
+    xxAcc = { kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1 };
+    xxBuffered = 0;
+
+    md5State = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    md5Buffered = 0;
+
+    totalBytes = 0;
+}
+
+void StreamChecksum::update(const void* data, size_t numBytes)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    totalBytes += numBytes;
+    updateXxHash(bytes, numBytes);
+    updateMd5(bytes, numBytes);
+}
+
+void StreamChecksum::updateXxHash(const uint8_t* p, size_t numBytes)
+{
+    // 32-byte stripes; a partial stripe waits in the buffer
+    if (xxBuffered > 0)
+    {
+        size_t take = std::min(numBytes, xxBuffer.size() - xxBuffered);
+        std::memcpy(xxBuffer.data() + xxBuffered, p, take);
+        xxBuffered += take;
+        p += take;
+        numBytes -= take;
+
+        if (xxBuffered < xxBuffer.size())
+            return;
+
+        xxStripe(xxAcc, xxBuffer.data());
+        xxBuffered = 0;
+    }
+
+    for (; numBytes >= 32; p += 32, numBytes -= 32)
+        xxStripe(xxAcc, p);
+
+    std::memcpy(xxBuffer.data(), p, numBytes);
+    xxBuffered = numBytes;
+}
+
+void StreamChecksum::updateMd5(const uint8_t* p, size_t numBytes)
+{
+    // 64-byte blocks; a partial block waits in the buffer
+    if (md5Buffered > 0)
+    {
+        size_t take = std::min(numBytes, md5Buffer.size() - md5Buffered);
+        std::memcpy(md5Buffer.data() + md5Buffered, p, take);
+        md5Buffered += take;
+        p += take;
+        numBytes -= take;
+
+        if (md5Buffered < md5Buffer.size())
+            return;
+
+        md5Block(md5Buffer.data());
+        md5Buffered = 0;
+    }
+
+    for (; numBytes >= 64; p += 64, numBytes -= 64)
+        md5Block(p);
+
+    std::memcpy(md5Buffer.data(), p, numBytes);
+    md5Buffered = numBytes;
+}
+
+void StreamChecksum::md5Block(const uint8_t* block)
+{
+    uint32_t m[16];
+    for (int i = 0; i < 16; ++i)
+        m[i] = read32(block + i * 4);
+
+    uint32_t a = md5State[0], b = md5State[1], c = md5State[2], d = md5State[3];
+
+    for (int i = 0; i < 64; ++i)
+    {
+        uint32_t f;
+        int g;
+        if (i < 16)      { f = (b & c) | (~b & d); g = i; }
+        else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) & 15; }
+        else if (i < 48) { f = b ^ c ^ d;          g = (3 * i + 5) & 15; }
+        else             { f = c ^ (b | ~d);       g = (7 * i) & 15; }
+
+        f += a + kMd5K[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b += rotl32(f, kMd5Shift[i]);
+    }
+
+    md5State[0] += a;
+    md5State[1] += b;
+    md5State[2] += c;
+    md5State[3] += d;
+}
+
+StreamChecksum::Digest StreamChecksum::finish()
+{
+    Digest digest;
+
+    // xxHash64
+    {
+        uint64_t h;
+        if (totalBytes >= 32)
+        {
+            h = rotl64(xxAcc[0], 1) + rotl64(xxAcc[1], 7) + rotl64(xxAcc[2], 12) + rotl64(xxAcc[3], 18);
+            for (auto acc : xxAcc)
+                h = xxMerge(h, acc);
+        }
+        else
+        {
+            h = kPrime5;
+        }
+
+        h += totalBytes;
+
+        const uint8_t* p = xxBuffer.data();
+        size_t remaining = xxBuffered;
+        for (; remaining >= 8; p += 8, remaining -= 8)
+        {
+            h ^= xxRound(0, read64(p));
+            h = rotl64(h, 27) * kPrime1 + kPrime4;
+        }
+        if (remaining >= 4)
+        {
+            h ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+            h = rotl64(h, 23) * kPrime2 + kPrime3;
+            p += 4;
+            remaining -= 4;
+        }
+        for (; remaining > 0; ++p, --remaining)
+        {
+            h ^= *p * kPrime5;
+            h = rotl64(h, 11) * kPrime1;
+        }
+
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        h *= kPrime3;
+        h ^= h >> 32;
+
+        digest.xxh64 = juce::String::toHexString(static_cast<juce::int64>(h)).paddedLeft('0', 16);
+    }
+
+    // MD5: pad with 0x80, zeros to 56 mod 64, then the length in bits
+    {
+        const uint64_t bitLength = totalBytes * 8;
+        const uint8_t padding[64] = { 0x80 };
+        size_t padLength = md5Buffered < 56 ? 56 - md5Buffered : 120 - md5Buffered;
+        updateMd5(padding, padLength);
+
+        uint8_t length[8];
+        for (int i = 0; i < 8; ++i)
+            length[i] = static_cast<uint8_t>(bitLength >> (8 * i));
+        updateMd5(length, 8);
+
+        uint8_t out[16];
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j)
+                out[i * 4 + j] = static_cast<uint8_t>(md5State[static_cast<size_t>(i)] >> (8 * j));
+
+        digest.md5 = juce::String::toHexString(out, 16, 0);
+    }
+
+    digest.isValid = true;
+    reset();
+    return digest;
+}
+
+StreamChecksum::Digest StreamChecksum::ofFile(const juce::File& file)
+{
+    juce::FileInputStream input(file);
+    if (!input.openedOk())
+        return {};
+
+    StreamChecksum checksum;
+    juce::HeapBlock<char> buffer(1 << 20);
+    for (;;)
+    {
+        auto bytesRead = input.read(buffer.getData(), 1 << 20);
+        if (bytesRead <= 0)
+            break;
+        checksum.update(buffer.getData(), static_cast<size_t>(bytesRead));
+    }
+
+    return checksum.finish();
+}
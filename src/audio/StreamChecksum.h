@@ -0,0 +1,49 @@
+/*
+    ChannelStacker - Stream Checksum Header
+    Incremental xxHash64 and MD5 over bytes as they are written, so export
+    checksums come for free instead of costing a second read of every file.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+class StreamChecksum
+{
+public:
+    struct Digest
+    {
+        juce::String xxh64;   // 16 hex digits, as printed by xxhsum
+        juce::String md5;     // 32 hex digits, as printed by md5sum
+        bool isValid = false;
+    };
+
+    StreamChecksum() { reset(); }
+
+    void reset();
+    void update(const void* data, size_t numBytes);
+    Digest finish();
+
+    // Checksum an existing file (for outputs not written by us)
+    static Digest ofFile(const juce::File& file);
+
+private:
+    // xxHash64 state
+    std::array<uint64_t, 4> xxAcc{};
+    std::array<uint8_t, 32> xxBuffer{};
+    size_t xxBuffered = 0;
+
+    // MD5 state
+    std::array<uint32_t, 4> md5State{};
+    std::array<uint8_t, 64> md5Buffer{};
+    size_t md5Buffered = 0;
+
+    uint64_t totalBytes = 0;
+
+    void updateXxHash(const uint8_t* p, size_t numBytes);
+    void updateMd5(const uint8_t* p, size_t numBytes);
+    void md5Block(const uint8_t* block);
+};
@@ -0,0 +1,335 @@
+/*
+    ChannelStacker - Sync Analyzer Implementation
+*/
+
+#include "SyncAnalyzer.h"
+#include "ChannelAnalyzer.h"
+#include "ParallelFor.h"
+#include "SimdKernels.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <atomic>
+#include <cmath>
+#include <complex>
+
+namespace
+{
+    // Lags this close to the best count as the same peak
+    constexpr int kPeakExclusion = 3;
+
+    // A coarse lag must leave at least this much overlap (or half the shorter source)
+    constexpr double kMinOverlapSeconds = 10.0;
+
+    // Smallest search either side of the coarse lag in the refinement
+    constexpr double kMinRefineMarginSeconds = 0.05;
+
+    // Mean-removed mix of a source's level envelopes. Levels line up
+    // whatever the sources' frequency content, and envelopes cover whole
+    // recordings at a rate that stays useful for hours.
+    struct Mix
+    {
+        std::vector<float> samples;
+        std::vector<float> level;     // Before the mean was removed
+        double sampleRate = 0.0;
+
+        double getDuration() const { return static_cast<double>(samples.size()) / sampleRate; }
+    };
+
+    void removeMean(std::vector<float>& samples)
+    {
+        if (samples.empty())
+            return;
+
+        auto mean = static_cast<float>(SimdKernels::sum(samples.data(), samples.size()) / static_cast<double>(samples.size()));
+        juce::FloatVectorOperations::add(samples.data(), -mean, static_cast<int>(samples.size()));
+    }
+
+    bool isSilent(const std::vector<float>& samples)
+    {
+        if (samples.empty())
+            return true;
+
+        double energy = SimdKernels::dotProduct(samples.data(), samples.data(), samples.size());
+        return std::sqrt(energy / static_cast<double>(samples.size())) < static_cast<double>(ChannelAnalyzer::kSilenceRms);
+    }
+
+    Mix mixSignals(const SyncSource& source)
+    {
+        Mix mix;
+        for (const auto& signal : source.signals)
+        {
+            if (signal == nullptr || signal->envelope.empty() || signal->envelopeRate <= 0.0)
+                continue;
+
+            // Lanes of one stream share a rate
+            if (mix.sampleRate == 0.0)
+                mix.sampleRate = signal->envelopeRate;
+            else if (std::abs(signal->envelopeRate - mix.sampleRate) > 1.0e-6)
+                continue;
+
+            if (mix.samples.size() < signal->envelope.size())
+                mix.samples.resize(signal->envelope.size(), 0.0f);
+            juce::FloatVectorOperations::add(mix.samples.data(), signal->envelope.data(), static_cast<int>(signal->envelope.size()));
+        }
+
+        mix.level = mix.samples;
+        removeMean(mix.samples);
+        if (isSilent(mix.samples))
+            mix.samples.clear();
+        return mix;
+    }
+
+    Mix resample(const Mix& mix, double toRate)
+    {
+        Mix out;
+        out.sampleRate = toRate;
+        out.samples = ChannelAnalyzer::resample(mix.samples, mix.sampleRate, toRate);
+        return out;
+    }
+
+    int fftOrderFor(size_t numSamples)
+    {
+        int order = 1;
+        while ((static_cast<size_t>(1) << order) < numSamples)
+            ++order;
+        return order;
+    }
+
+    // Real FFT of the zero-padded samples, as N/2 + 1 interleaved complex bins
+    std::vector<float> spectrumOf(const juce::dsp::FFT& fft, const std::vector<float>& samples)
+    {
+        std::vector<float> spectrum(static_cast<size_t>(fft.getSize()) * 2, 0.0f);
+        std::copy(samples.begin(), samples.end(), spectrum.begin());
+        fft.performRealOnlyForwardTransform(spectrum.data(), true);
+        return spectrum;
+    }
+
+    struct Peak
+    {
+        double lag = 0.0;         // Samples, fractional
+        float confidence = 0.0f;
+    };
+
+    // GCC-PHAT: the lag m in [minLag, maxLag] where b[n + m] best matches
+    // a[n]. 'work' holds b's spectrum and is overwritten.
+    Peak findPeak(const juce::dsp::FFT& fft, const std::vector<float>& spectrumA, std::vector<float>& work,
+                  int minLag, int maxLag)
+    {
+        const int size = fft.getSize();
+        const auto* a = reinterpret_cast<const std::complex<float>*>(spectrumA.data());
+        auto* b = reinterpret_cast<std::complex<float>*>(work.data());
+
+        for (int k = 0; k <= size / 2; ++k)
+        {
+            // Keep the phase only, so every frequency gets an equal say and
+            // the correlation peak stays narrow on tonal material
+            const auto cross = b[k] * std::conj(a[k]);
+            const float magnitude = std::abs(cross);
+            b[k] = magnitude > 1.0e-20f ? cross / magnitude : std::complex<float>();
+        }
+
+        fft.performRealOnlyInverseTransform(work.data());
+
+        // Negative lags wrap to the end of the circular correlation
+        auto valueAt = [&work, size](int lag) { return work[static_cast<size_t>((lag % size + size) % size)]; };
+
+        int best = minLag;
+        for (int lag = minLag + 1; lag <= maxLag; ++lag)
+            if (valueAt(lag) > valueAt(best))
+                best = lag;
+
+        const float bestValue = valueAt(best);
+        float secondValue = 0.0f;
+        for (int lag = minLag; lag <= maxLag; ++lag)
+            if (std::abs(lag - best) > kPeakExclusion)
+                secondValue = std::max(secondValue, valueAt(lag));
+
+        Peak peak;
+        peak.lag = best;
+        if (bestValue <= 0.0f)
+            return peak;
+
+        peak.confidence = juce::jlimit(0.0f, 1.0f, 1.0f - secondValue / bestValue);
+
+        // Parabolic interpolation through the peak and its neighbours
+        if (best > minLag && best < maxLag)
+        {
+            const float before = valueAt(best - 1);
+            const float after = valueAt(best + 1);
+            const float curvature = before - 2.0f * bestValue + after;
+            if (curvature < 0.0f)
+                peak.lag += 0.5 * static_cast<double>((before - after) / curvature);
+        }
+
+        return peak;
+    }
+
+    // decodeSegment passes times to ffmpeg in milliseconds
+    double roundToMs(double seconds)
+    {
+        return std::round(seconds * 1000.0) / 1000.0;
+    }
+
+    // Mean-removed mono sum of the channels a source's lanes use
+    std::vector<float> decodeMono(const juce::String& ffmpegPath, const SyncSource& source,
+                                  double startSeconds, double lengthSeconds, const std::atomic<bool>& cancelled)
+    {
+        auto segment = PrerollCache::decodeSegment(ffmpegPath, source.stream, startSeconds, lengthSeconds, cancelled);
+        if (segment == nullptr)
+            return {};
+
+        const int numSamples = segment->audio.getNumSamples();
+        std::vector<float> mono(static_cast<size_t>(numSamples), 0.0f);
+        for (int channel : source.channels)
+            if (channel >= 0 && channel < segment->audio.getNumChannels())
+                juce::FloatVectorOperations::add(mono.data(), segment->audio.getReadPointer(channel), numSamples);
+
+        removeMean(mono);
+        return mono;
+    }
+
+    // Start of the loudest kRefineSeconds of the reference that the other
+    // source also covers at the coarse lag (with margin), or negative.
+    // Loudest by the reference's level, which is an RMS envelope.
+    double findRefineWindow(const Mix& reference, double otherDuration, double lagSeconds, double marginSeconds)
+    {
+        const double rate = reference.sampleRate;
+        const double first = std::max(0.0, marginSeconds - lagSeconds);
+        const double last = std::min(reference.getDuration(), otherDuration - lagSeconds - marginSeconds)
+                          - SyncAnalyzer::kRefineSeconds;
+        if (last < first)
+            return -1.0;
+
+        const auto& level = reference.level;
+        const auto window = static_cast<size_t>(SyncAnalyzer::kRefineSeconds * rate);
+        if (window == 0 || window > level.size())
+            return -1.0;
+
+        const auto begin = static_cast<size_t>(std::ceil(first * rate));
+        const auto end = std::min(static_cast<size_t>(last * rate), level.size() - window);
+        if (end < begin)
+            return -1.0;
+
+        // Sliding sum of squares
+        double energy = SimdKernels::dotProduct(level.data() + begin, level.data() + begin, window);
+        double bestEnergy = energy;
+        size_t bestStart = begin;
+        for (size_t start = begin + 1; start <= end; ++start)
+        {
+            const float leaving = level[start - 1];
+            const float entering = level[start + window - 1];
+            energy += static_cast<double>(entering * entering) - static_cast<double>(leaving * leaving);
+            if (energy > bestEnergy)
+            {
+                bestEnergy = energy;
+                bestStart = start;
+            }
+        }
+
+        return static_cast<double>(bestStart) / rate;
+    }
+
+    // Bring a coarse offset to the nearest sample by correlating full-rate
+    // windows; leaves it as it is if the sources can't be compared that way
+    void refine(SyncOffset& offset, const SyncSource& referenceSource, const Mix& reference,
+                const SyncSource& otherSource, double otherDuration,
+                const juce::String& ffmpegPath, const std::atomic<bool>& cancelled)
+    {
+        const double rate = referenceSource.stream.sampleRate;
+        if (offset.confidence < SyncAnalyzer::kMinConfidence || rate <= 0.0
+            || std::abs(otherSource.stream.sampleRate - rate) > 1.0e-6)
+            return;
+
+        // The coarse lag is good to a couple of envelope frames
+        const double margin = std::max(kMinRefineMarginSeconds, 4.0 / reference.sampleRate);
+        const double windowStart = findRefineWindow(reference, otherDuration, offset.lagSeconds, margin);
+        if (windowStart < 0.0)
+            return;
+
+        const double referenceStart = roundToMs(windowStart);
+        const double otherStart = std::max(0.0, roundToMs(referenceStart + offset.lagSeconds - margin));
+
+        auto a = decodeMono(ffmpegPath, referenceSource, referenceStart, SyncAnalyzer::kRefineSeconds, cancelled);
+        auto b = decodeMono(ffmpegPath, otherSource, otherStart, SyncAnalyzer::kRefineSeconds + 2.0 * margin, cancelled);
+        if (isSilent(a) || isSilent(b))
+            return;
+
+        juce::dsp::FFT fft(fftOrderFor(a.size() + b.size()));
+        const auto spectrumA = spectrumOf(fft, a);
+        auto work = spectrumOf(fft, b);
+
+        // The match sits about 'margin' into b
+        const double expectedLag = referenceStart + offset.lagSeconds - otherStart;
+        const auto peak = findPeak(fft, spectrumA, work, 0, static_cast<int>((expectedLag + margin) * rate));
+        if (peak.confidence < SyncAnalyzer::kMinConfidence)
+            return;
+
+        offset.lagSeconds = std::round((otherStart - referenceStart) * rate + peak.lag) / rate;
+        offset.confidence = peak.confidence;
+        offset.refined = true;
+    }
+}
+
+std::vector<SyncOffset> SyncAnalyzer::analyze(const std::vector<SyncSource>& sources, const juce::String& ffmpegPath,
+                                              CancellationToken token)
+{
+    std::vector<SyncOffset> offsets;
+    if (sources.size() < 2)
+        return offsets;
+
+    const int numOthers = static_cast<int>(sources.size()) - 1;
+    offsets.resize(static_cast<size_t>(numOthers));
+    for (int i = 0; i < numOthers; ++i)
+        offsets[static_cast<size_t>(i)].sourceKey = sources[static_cast<size_t>(i + 1)].sourceKey;
+
+    const auto reference = mixSignals(sources.front());
+    if (reference.samples.empty())
+        return offsets;
+
+    // Decodes for the refinement stop with the token
+    std::atomic<bool> cancelled{ false };
+    const int cancelCallbackId = token.addCallback([&cancelled]() { cancelled = true; });
+
+    // Bring every source to the reference rate first, so one transform size
+    // and one reference spectrum serve them all
+    std::vector<Mix> others(static_cast<size_t>(numOthers));
+    parallelFor(numOthers, [&](int i)
+    {
+        auto mix = mixSignals(sources[static_cast<size_t>(i + 1)]);
+        if (!mix.samples.empty() && std::abs(mix.sampleRate - reference.sampleRate) > 1.0e-6)
+            mix = resample(mix, reference.sampleRate);
+        others[static_cast<size_t>(i)] = std::move(mix);
+    });
+
+    size_t longest = 0;
+    for (const auto& other : others)
+        longest = std::max(longest, other.samples.size());
+
+    // Zero-padded to the combined length, so the correlation doesn't wrap
+    juce::dsp::FFT fft(fftOrderFor(reference.samples.size() + longest));
+    const auto referenceSpectrum = spectrumOf(fft, reference.samples);
+
+    parallelFor(numOthers, [&](int i)
+    {
+        const auto& other = others[static_cast<size_t>(i)];
+        auto& offset = offsets[static_cast<size_t>(i)];
+        if (cancelled || other.samples.empty())
+            return;
+
+        const auto referenceLength = static_cast<int>(reference.samples.size());
+        const auto otherLength = static_cast<int>(other.samples.size());
+        const int minOverlap = std::min(static_cast<int>(kMinOverlapSeconds * reference.sampleRate),
+                                        std::min(referenceLength, otherLength) / 2);
+
+        auto work = spectrumOf(fft, other.samples);
+        const auto peak = findPeak(fft, referenceSpectrum, work, minOverlap - referenceLength, otherLength - minOverlap);
+        offset.lagSeconds = peak.lag / reference.sampleRate;
+        offset.confidence = peak.confidence;
+
+        refine(offset, sources.front(), reference, sources[static_cast<size_t>(i + 1)], other.getDuration(),
+               ffmpegPath, cancelled);
+    });
+
+    token.removeCallback(cancelCallbackId);
+    return offsets;
+}
@@ -0,0 +1,53 @@
+/*
+    ChannelStacker - Sync Analyzer Header
+    Finds the time offsets between sources recorded on separate devices by
+    cross-correlating them with GCC-PHAT (generalised cross-correlation with
+    phase transform). A coarse pass runs on the level envelopes from the
+    waveform extraction pass, so hour-long files need no further decoding;
+    a short full-rate window around the loudest overlapping passage is then
+    decoded to bring the offset to the nearest sample.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "../model/ProjectModel.h"
+#include "../async/AsyncPrimitives.h"
+#include "PrerollCache.h"
+#include <memory>
+#include <vector>
+
+// One source (file + stream) to align
+struct SyncSource
+{
+    juce::String sourceKey;
+    std::vector<std::shared_ptr<const DecimatedSignal>> signals;  // One per lane of this source
+    PrerollCache::Stream stream;                                  // For the full-rate refinement
+    std::vector<int> channels;                                    // Stream channels the lanes use
+};
+
+struct SyncOffset
+{
+    juce::String sourceKey;
+    double lagSeconds = 0.0;      // Audio at reference time t is at t + lagSeconds in this source
+    float confidence = 0.0f;      // 0..1, how far the correlation peak stands above the next best
+    bool refined = false;         // Sample-accurate from full-rate audio, else envelope only
+};
+
+class SyncAnalyzer
+{
+public:
+    // Offsets of sources[1..] against sources[0], one per source in the same
+    // order, worked out in parallel. Blocking - run from a background thread.
+    static std::vector<SyncOffset> analyze(const std::vector<SyncSource>& sources, const juce::String& ffmpegPath,
+                                           CancellationToken token);
+
+    // Offsets below this confidence are reported but not worth applying
+    static constexpr float kMinConfidence = 0.2f;
+
+    // Full-rate window decoded from each source for the refinement
+    static constexpr double kRefineSeconds = 2.0;
+
+private:
+    SyncAnalyzer() = delete;
+};
@@ -0,0 +1,177 @@
+/*
+    ChannelStacker - WAV File Writer Implementation
+*/
+
+#include "WavFileWriter.h"
+
+namespace
+{
+    constexpr int kDs64Size = 28;   // riff size, data size, sample count (64-bit each) + table length
+
+    uint32_t channelMaskFor(int numChannels)
+    {
+        // Only mono and stereo have an unambiguous speaker assignment
+        if (numChannels == 1) return 0x4;   // FC
+        if (numChannels == 2) return 0x3;   // FL | FR
+        return 0;
+    }
+}
+
+WavFileWriter::WavFileWriter(const juce::File& file, int channels, double rate, int bits,
+                             DitherConverter::Dither dither, uint32_t ditherSeed, uint64_t expectedFrames)
+    : numChannels(std::max(1, channels)),
+      sampleRate(rate),
+      bitsPerSample(bits == 16 || bits == 24 ? bits : 32),
+      plannedFrames(expectedFrames)
+{
+    auto output = std::make_unique<juce::FileOutputStream>(file);
+    if (!output->openedOk())
+        return;
+
+    // FileOutputStream appends to existing files
+    output->setPosition(0);
+    output->truncate();
+    stream = std::move(output);
+
+    if (bitsPerSample != 32)
+        converter = std::make_unique<DitherConverter>(numChannels, bitsPerSample, dither, ditherSeed);
+
+    // Written final-looking for the expected length, so in the usual case
+    // it never changes and the running checksum covers the real file
+    auto header = buildHeader(plannedFrames);
+    writeBytes(header.getData(), header.getSize());
+}
+
+WavFileWriter::~WavFileWriter()
+{
+    finish();
+}
+
+juce::MemoryBlock WavFileWriter::buildHeader(uint64_t numFrames) const
+{
+    const bool isFloat = bitsPerSample == 32;
+    const bool extensible = numChannels > 2 || bitsPerSample > 16;
+    const int blockAlign = numChannels * bitsPerSample / 8;
+    const auto rate = static_cast<uint32_t>(juce::roundToInt(sampleRate));
+
+    const int fmtSize = extensible ? 40 : 16;
+    const uint64_t headerSize = 12 + (8 + kDs64Size) + (8 + static_cast<uint64_t>(fmtSize)) + 8;
+    const uint64_t dataBytes = numFrames * static_cast<uint64_t>(blockAlign);
+    const uint64_t riffSize = headerSize + dataBytes + (dataBytes & 1) - 8;
+    const bool rf64 = riffSize > 0xFFFFFFFFull;
+
+    juce::MemoryOutputStream out;
+
+    out.write(rf64 ? "RF64" : "RIFF", 4);
+    out.writeInt(rf64 ? -1 : static_cast<int>(static_cast<uint32_t>(riffSize)));
+    out.write("WAVE", 4);
+
+    // A ds64 chunk for RF64, otherwise a JUNK placeholder of the same size
+    out.write(rf64 ? "ds64" : "JUNK", 4);
+    out.writeInt(kDs64Size);
+    if (rf64)
+    {
+        out.writeInt64(static_cast<juce::int64>(riffSize));
+        out.writeInt64(static_cast<juce::int64>(dataBytes));
+        out.writeInt64(static_cast<juce::int64>(numFrames));
+        out.writeInt(0);
+    }
+    else
+    {
+        out.writeRepeatedByte(0, static_cast<size_t>(kDs64Size));
+    }
+
+    out.write("fmt ", 4);
+    out.writeInt(fmtSize);
+    out.writeShort(static_cast<short>(extensible ? 0xFFFE : (isFloat ? 3 : 1)));
+    out.writeShort(static_cast<short>(numChannels));
+    out.writeInt(static_cast<int>(rate));
+    out.writeInt(static_cast<int>(rate * static_cast<uint32_t>(blockAlign)));
+    out.writeShort(static_cast<short>(blockAlign));
+    out.writeShort(static_cast<short>(bitsPerSample));
+
+    if (extensible)
+    {
+        out.writeShort(22);
+        out.writeShort(static_cast<short>(bitsPerSample));
+        out.writeInt(static_cast<int>(channelMaskFor(numChannels)));
+
+        // KSDATAFORMAT_SUBTYPE_PCM / _IEEE_FLOAT
+        const uint8_t subFormat[16] = { static_cast<uint8_t>(isFloat ? 3 : 1), 0x00, 0x00, 0x00,
+                                        0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA,
+                                        0x00, 0x38, 0x9B, 0x71 };
+        out.write(subFormat, sizeof(subFormat));
+    }
+
+    out.write("data", 4);
+    out.writeInt(rf64 ? -1 : static_cast<int>(static_cast<uint32_t>(dataBytes)));
+
+    jassert(out.getDataSize() == headerSize);
+    return out.getMemoryBlock();
+}
+
+bool WavFileWriter::writeBytes(const void* data, size_t numBytes)
+{
+    checksum.update(data, numBytes);
+    return stream->write(data, numBytes);
+}
+
+bool WavFileWriter::write(const float* interleaved, size_t numFrames)
+{
+    if (stream == nullptr || finished)
+        return false;
+
+    const size_t numSamples = numFrames * static_cast<size_t>(numChannels);
+
+    if (converter == nullptr)
+    {
+        // 32-bit float is written as is (little-endian hosts)
+        if (!writeBytes(interleaved, numSamples * sizeof(float)))
+            return false;
+    }
+    else
+    {
+        buffer.resize(numSamples * static_cast<size_t>(converter->getBytesPerSample()));
+        converter->convert(interleaved, numFrames, buffer.data());
+        if (!writeBytes(buffer.data(), buffer.size()))
+            return false;
+    }
+
+    framesWritten += numFrames;
+    return true;
+}
+
+bool WavFileWriter::finish()
+{
+    if (stream == nullptr || finished)
+        return false;
+
+    finished = true;
+
+    const uint64_t dataBytes = framesWritten * static_cast<uint64_t>(numChannels * bitsPerSample / 8);
+
+    // Chunks are word aligned
+    if ((dataBytes & 1) != 0)
+    {
+        const uint8_t pad = 0;
+        writeBytes(&pad, 1);
+    }
+
+    if (framesWritten == plannedFrames)
+    {
+        checksums = checksum.finish();
+    }
+    else
+    {
+        // The length differed from the estimate: rewrite the header (RF64
+        // if it grew past 4 GB). The streamed checksum no longer matches.
+        auto header = buildHeader(framesWritten);
+        stream->setPosition(0);
+        stream->write(header.getData(), header.getSize());
+    }
+
+    stream->flush();
+    bool ok = stream->getStatus().wasOk();
+    stream.reset();
+    return ok;
+}
@@ -0,0 +1,63 @@
+/*
+    ChannelStacker - WAV File Writer Header
+    Streams interleaved float audio to a 16/24-bit integer or 32-bit float
+    WAV file. Integer output goes through DitherConverter. Files that grow
+    past 4 GB are promoted to RF64 when closed. The bytes are checksummed
+    as they are written.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "AudioFileWriter.h"
+#include "DitherConverter.h"
+#include "StreamChecksum.h"
+#include <memory>
+#include <vector>
+
+class WavFileWriter : public AudioFileWriter
+{
+public:
+    // bitsPerSample: 16, 24 or 32 (32 = IEEE float). ditherSeed keys the
+    // dither noise; give every file of an export its own. expectedFrames
+    // sizes the header up front (0 if unknown); see getChecksums().
+    WavFileWriter(const juce::File& file, int numChannels, double sampleRate, int bitsPerSample,
+                  DitherConverter::Dither dither, uint32_t ditherSeed, uint64_t expectedFrames = 0);
+    ~WavFileWriter() override;
+
+    bool openedOk() const override { return stream != nullptr; }
+
+    // Append interleaved float frames
+    bool write(const float* interleaved, size_t numFrames) override;
+
+    // Patch the header sizes and close the file. Called by the destructor
+    // if not called explicitly.
+    bool finish() override;
+
+    uint64_t getFramesWritten() const override { return framesWritten; }
+
+    // Checksums of the finished file. Only valid when exactly expectedFrames
+    // were written: otherwise finish() had to rewrite the header after its
+    // bytes went through the checksum, and the file must be hashed again.
+    const StreamChecksum::Digest& getChecksums() const override { return checksums; }
+
+private:
+    // Complete header for a file of this many frames (same size for any count)
+    juce::MemoryBlock buildHeader(uint64_t numFrames) const;
+    bool writeBytes(const void* data, size_t numBytes);
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+    int numChannels;
+    double sampleRate;
+    int bitsPerSample;
+    std::unique_ptr<DitherConverter> converter;
+    std::vector<uint8_t> buffer;
+
+    StreamChecksum checksum;
+    StreamChecksum::Digest checksums;
+    uint64_t plannedFrames = 0;
+    uint64_t framesWritten = 0;
+    bool finished = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WavFileWriter)
+};
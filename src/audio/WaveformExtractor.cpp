@@ -3,47 +3,616 @@
 */
 
 #include "WaveformExtractor.h"
+#include "LoudnessMeter.h"
+#include "ParallelFor.h"
+#include "SampleKernels.h"
+#include "SimdKernels.h"
+#include "GrowingWavFile.h"
+#include "../async/AsyncPrimitives.h"
+#include "../ffmpeg/DecodeWorker.h"
+#include <array>
 #include <cmath>
+#include <cstring>
 
-WaveformExtractor::WaveformExtractor(FFmpegLocator& loc)
-    : locator(loc)
+namespace
+{
+    // Second stage of the analysis signal's decimation: a windowed-sinc
+    // low-pass over box-car means at kFactor x the analysis rate, evaluated
+    // at every kFactor-th input. Its cutoff sits below the analysis Nyquist,
+    // so the signal carries the source's low band rather than folded-down
+    // highs. Outputs line up with their inputs (the filter delay is taken
+    // out); flush() emits the tail.
+    class AnalysisFilter
+    {
+    public:
+        static constexpr int kFactor = 4;
+
+        void push(float x, std::vector<float>& out)
+        {
+            history[static_cast<size_t>(position)] = x;
+            history[static_cast<size_t>(position + kTaps)] = x;
+            position = (position + 1) % kTaps;
+
+            // The output centred on input c is ready once kHalf more have arrived
+            const int64_t centre = numPushed++ - kHalf;
+            if (centre >= 0 && centre % kFactor == 0)
+                out.push_back(SimdKernels::dotProduct(history.data() + position, coefficients().data(), kTaps));
+        }
+
+        void flush(std::vector<float>& out)
+        {
+            for (int i = 0; i < kHalf; ++i)
+                push(0.0f, out);
+        }
+
+    private:
+        static constexpr int kTaps = 95;
+        static constexpr int kHalf = kTaps / 2;
+
+        // Blackman-windowed sinc, cutoff at 0.8 x the output Nyquist, unity gain at DC
+        static const std::array<float, kTaps>& coefficients()
+        {
+            static const auto taps = []()
+            {
+                constexpr double cutoff = 0.4 / kFactor;   // Cycles per input sample
+                constexpr double pi = juce::MathConstants<double>::pi;
+                std::array<double, kTaps> h{};
+                double total = 0.0;
+                for (int i = 0; i < kTaps; ++i)
+                {
+                    const double n = static_cast<double>(i - kHalf);
+                    const double sinc = i == kHalf ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * n) / (pi * n);
+                    const double phase = 2.0 * pi * static_cast<double>(i) / (kTaps - 1);
+                    h[static_cast<size_t>(i)] = sinc * (0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase));
+                    total += h[static_cast<size_t>(i)];
+                }
+
+                std::array<float, kTaps> normalised{};
+                for (size_t i = 0; i < normalised.size(); ++i)
+                    normalised[i] = static_cast<float>(h[i] / total);
+                return normalised;
+            }();
+            return taps;
+        }
+
+        // The last kTaps inputs, oldest first from 'position', stored twice
+        // so the window never wraps
+        std::array<float, 2 * kTaps> history{};
+        int position = 0;
+        int64_t numPushed = 0;
+    };
+}
+
+//==============================================================================
+// Streaming per-channel reducer. Builds the min/max envelope and the
+// decimated analysis signal for one channel of an interleaved float stream,
+// so every lane of a source can be served from a single decode.
+//==============================================================================
+
+class WaveformExtractor::ChannelAccumulator
+{
+public:
+    ChannelAccumulator(int channel, int numChannels, size_t expectedFrames, double sampleRate)
+        : channelIndex(channel),
+          kernels(SampleKernels::get(SampleFormat::F32, numChannels))
+    {
+        // Size envelope points from the probed duration when we have it;
+        // otherwise start fine and let mergeEnvelopePairs() coarsen as we go
+        size_t points = static_cast<size_t>(kDefaultEnvelopePoints);
+        samplesPerPoint = expectedFrames > 0 ? std::max<size_t>(1, expectedFrames / points) : 256;
+
+        // Box-car means at kFactor x the analysis rate feed the low-pass; an
+        // integer step keeps the rate fixed for the whole source
+        double rate = sampleRate > 0.0 ? sampleRate : 48000.0;
+        samplesPerDecimation = std::max<size_t>(1, static_cast<size_t>(std::lround(rate / (kAnalysisSampleRate * AnalysisFilter::kFactor))));
+        analysisSampleRate = rate / static_cast<double>(samplesPerDecimation * AnalysisFilter::kFactor);
+
+        samplesPerEnvelopeFrame = std::max<size_t>(1, static_cast<size_t>(std::lround(rate / kEnvelopeRate)));
+        envelopeRate = rate / static_cast<double>(samplesPerEnvelopeFrame);
+
+        minValues.reserve(points * 2);
+        maxValues.reserve(points * 2);
+        decimated.reserve(std::min<size_t>(kMaxAnalysisSamples,
+                                           expectedFrames / (samplesPerDecimation * AnalysisFilter::kFactor) + 1));
+        meanSquares.reserve(std::min<size_t>(kMaxEnvelopeSamples, expectedFrames / samplesPerEnvelopeFrame + 1));
+    }
+
+    void process(const float* interleaved, size_t numFrames, int numChannels)
+    {
+        if (channelIndex < 0 || channelIndex >= numChannels)
+            return;
+
+        const size_t stride = static_cast<size_t>(numChannels);
+
+        // Envelope: min/max per point
+        for (size_t frame = 0; frame < numFrames;)
+        {
+            size_t run = std::min(numFrames - frame, samplesPerPoint - pointCount);
+            kernels.minMax(interleaved + frame * stride, run, numChannels, channelIndex, pointMin, pointMax);
+
+            frame += run;
+            pointCount += run;
+
+            if (pointCount == samplesPerPoint)
+                pushPoint();
+        }
+
+        // Analysis signal, up to its length cap
+        for (size_t frame = 0; frame < numFrames && decimated.size() < kMaxAnalysisSamples;)
+        {
+            size_t run = std::min(numFrames - frame, samplesPerDecimation - decimationCount);
+
+            decimationSum += kernels.sum(interleaved + frame * stride, run, numChannels, channelIndex);
+            frame += run;
+            decimationCount += run;
+
+            if (decimationCount == samplesPerDecimation)
+                pushDecimated();
+        }
+
+        // Level envelope: mean square per frame
+        for (size_t frame = 0; frame < numFrames;)
+        {
+            size_t run = std::min(numFrames - frame, samplesPerEnvelopeFrame - envelopeCount);
+
+            envelopeSum += kernels.sumSquares(interleaved + frame * stride, run, numChannels, channelIndex);
+            frame += run;
+            envelopeCount += run;
+
+            if (envelopeCount == samplesPerEnvelopeFrame)
+                pushEnvelope();
+        }
+    }
+
+    void finish(LaneResult& result)
+    {
+        if (pointCount > 0)
+            pushPoint();
+        if (decimated.size() < kMaxAnalysisSamples)
+        {
+            if (decimationCount > 0)
+                pushDecimated();
+            analysisFilter.flush(decimated);
+        }
+        if (envelopeCount > 0)
+            pushEnvelope();
+
+        WaveformEnvelope& envelope = result.waveform;
+        envelope.minValues = std::move(minValues);
+        envelope.maxValues = std::move(maxValues);
+        envelope.numPoints = static_cast<int>(envelope.minValues.size());
+        envelope.isReady = envelope.numPoints > 0;
+
+        auto signal = std::make_shared<DecimatedSignal>();
+        signal->samples = std::move(decimated);
+        signal->samples.resize(std::min(signal->samples.size(), kMaxAnalysisSamples));
+        signal->sampleRate = analysisSampleRate;
+        setEnvelope(*signal);
+        result.analysisSignal = std::move(signal);
+    }
+
+    // What finish() would publish, without ending the stream: the partial
+    // point is included but left open, and the analysis signal stops short
+    // by the filter's delay
+    void snapshot(WaveformEnvelope& envelope, std::shared_ptr<const DecimatedSignal>& signal) const
+    {
+        envelope.minValues = minValues;
+        envelope.maxValues = maxValues;
+        if (pointCount > 0)
+        {
+            envelope.minValues.push_back(pointMin);
+            envelope.maxValues.push_back(pointMax);
+        }
+        envelope.numPoints = static_cast<int>(envelope.minValues.size());
+        envelope.isReady = envelope.numPoints > 0;
+
+        auto copy = std::make_shared<DecimatedSignal>();
+        copy->samples.assign(decimated.begin(), decimated.begin() + static_cast<std::ptrdiff_t>(std::min(decimated.size(), kMaxAnalysisSamples)));
+        copy->sampleRate = analysisSampleRate;
+        setEnvelope(*copy);
+        signal = std::move(copy);
+    }
+
+private:
+    void pushPoint()
+    {
+        minValues.push_back(pointMin);
+        maxValues.push_back(pointMax);
+        pointMin = 0.0f;
+        pointMax = 0.0f;
+        pointCount = 0;
+
+        // Longer than the probe said (or no duration known): halve resolution
+        if (minValues.size() >= static_cast<size_t>(kDefaultEnvelopePoints) * 2)
+        {
+            size_t half = minValues.size() / 2;
+            for (size_t i = 0; i < half; ++i)
+            {
+                minValues[i] = std::min(minValues[2 * i], minValues[2 * i + 1]);
+                maxValues[i] = std::max(maxValues[2 * i], maxValues[2 * i + 1]);
+            }
+            minValues.resize(half);
+            maxValues.resize(half);
+            samplesPerPoint *= 2;
+        }
+    }
+
+    void pushDecimated()
+    {
+        analysisFilter.push(decimationSum / static_cast<float>(decimationCount), decimated);
+        decimationSum = 0.0f;
+        decimationCount = 0;
+    }
+
+    void pushEnvelope()
+    {
+        meanSquares.push_back(envelopeSum / static_cast<float>(envelopeCount));
+        envelopeSum = 0.0f;
+        envelopeCount = 0;
+
+        // Past the cap, pool frames in pairs: an envelope loses nothing of
+        // note at half the rate, and the sync pass resamples it anyway
+        if (meanSquares.size() >= kMaxEnvelopeSamples)
+        {
+            size_t half = meanSquares.size() / 2;
+            for (size_t i = 0; i < half; ++i)
+                meanSquares[i] = 0.5f * (meanSquares[2 * i] + meanSquares[2 * i + 1]);
+            meanSquares.resize(half);
+            samplesPerEnvelopeFrame *= 2;
+            envelopeRate *= 0.5;
+        }
+    }
+
+    void setEnvelope(DecimatedSignal& signal) const
+    {
+        signal.envelope.resize(meanSquares.size());
+        for (size_t i = 0; i < meanSquares.size(); ++i)
+            signal.envelope[i] = std::sqrt(meanSquares[i]);
+        signal.envelopeRate = envelopeRate;
+    }
+
+    int channelIndex;
+    const SampleKernels& kernels;     // Stride-specialised for the stream's channel count
+    double analysisSampleRate = kAnalysisSampleRate;
+
+    size_t samplesPerPoint = 1;
+    size_t pointCount = 0;
+    float pointMin = 0.0f;
+    float pointMax = 0.0f;
+    std::vector<float> minValues;
+    std::vector<float> maxValues;
+
+    size_t samplesPerDecimation = 1;
+    size_t decimationCount = 0;
+    float decimationSum = 0.0f;
+    AnalysisFilter analysisFilter;
+    std::vector<float> decimated;
+
+    size_t samplesPerEnvelopeFrame = 1;
+    double envelopeRate = kEnvelopeRate;
+    size_t envelopeCount = 0;
+    float envelopeSum = 0.0f;
+    std::vector<float> meanSquares;
+};
+
+//==============================================================================
+
+WaveformExtractor::WaveformExtractor(FFmpegLocator& loc, ProgressTracker* progressTracker)
+    : locator(loc), progress(progressTracker)
 {
 }
 
 WaveformExtractor::~WaveformExtractor()
 {
     cancelAll();
+
+    // Job threads use this object until they have removed their job
+    std::unique_lock<std::mutex> lock(jobsMutex);
+    jobsChanged.wait(lock, [this]() { return jobs.empty(); });
 }
 
-void WaveformExtractor::extractWaveform(Lane* lane, CompletionCallback callback)
+WaveformExtractor::StreamSource WaveformExtractor::StreamSource::of(const Lane& lane)
 {
-    if (lane == nullptr)
-        return;
+    StreamSource source;
+    source.file = lane.sourceFile;
+    source.streamIndex = lane.streamIndex;
+    source.numChannels = std::max(1, lane.totalChannels);
+    source.sampleRate = lane.sampleRate > 0.0 ? lane.sampleRate : 48000.0;
+    source.duration = lane.duration;
+    source.sampleFormat = lane.sampleFormat;
+    source.bitsPerRawSample = lane.bitsPerRawSample;
+    return source;
+}
 
-    // Cancel any existing job for this lane
-    cancelExtraction(lane);
+bool WaveformExtractor::StreamSource::isSameStream(const StreamSource& other) const
+{
+    return file == other.file && streamIndex == other.streamIndex;
+}
 
+std::unique_ptr<WaveformExtractor::ExtractionJob> WaveformExtractor::makeJob(const std::vector<Lane*>& lanes)
+{
+    // Copied here: job threads never touch the lanes
     auto job = std::make_unique<ExtractionJob>();
-    job->lane = lane;
-    job->callback = std::move(callback);
+    job->source = StreamSource::of(*lanes.front());
+    job->lanes = lanes;
+    for (auto* lane : lanes)
+    {
+        job->laneIds.push_back(lane->uuid);
+        job->channels.push_back(lane->channelIndex);
+    }
+    return job;
+}
+
+WaveformExtractor::ExtractionJob& WaveformExtractor::startJobLocked(const std::vector<Lane*>& lanes, bool waveforms,
+                                                                    juce::Uuid& jobId)
+{
+    auto job = makeJob(lanes);
+    job->waveforms = waveforms;
+
+    ExtractionJob* jobPtr = job.get();
+    jobId = juce::Uuid();
+    jobs[jobId] = std::move(job);
+
+    juce::Thread::launch([this, jobPtr, id = jobId]()
+    {
+        JobOutput output;
+        const bool completed = runExtraction(*jobPtr, output);
+
+        std::map<int, JobListener> listeners;
+        {
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            listeners.swap(jobPtr->listeners);
+            jobs.erase(id);
+            jobsChanged.notify_all();
+        }
+
+        for (auto& [listenerId, listener] : listeners)
+            listener(completed, output);
+    });
+
+    return *jobPtr;
+}
+
+bool WaveformExtractor::detachListener(const juce::Uuid& jobId, int listenerId)
+{
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    auto it = jobs.find(jobId);
+    if (it == jobs.end() || it->second->listeners.erase(listenerId) == 0)
+        return false;
+
+    if (it->second->listeners.empty())
+        cancelJobLocked(*it->second);
+    return true;
+}
+
+void WaveformExtractor::cancelJobLocked(ExtractionJob& job)
+{
+    job.cancelled = true;
+    job.process->kill();
+}
+
+//==============================================================================
+// Waits for one listener on each job a request needs. The state is shared
+// with the listeners and the cancel callback, which may outlive the awaiter:
+// whoever brings 'pending' to zero resumes the coroutine.
+//==============================================================================
+
+struct WaveformExtractor::JobAwaiter
+{
+    struct State
+    {
+        std::mutex mutex;
+        ExtractionResult result{ true, {} };
+        std::vector<std::pair<juce::Uuid, int>> listening;   // Job, listener
+        std::atomic<int> pending{ 1 };                       // Held by await_suspend until it's done
+        std::coroutine_handle<> handle;
+
+        void arrive(bool completed, std::vector<LaneResult> lanes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                result.completed = result.completed && completed;
+                for (auto& lane : lanes)
+                    result.lanes.push_back(std::move(lane));
+            }
+
+            if (--pending == 0)
+                juce::MessageManager::callAsync([h = handle]() { h.resume(); });
+        }
+    };
+
+    WaveformExtractor& extractor;
+    const std::vector<Lane*>& lanes;
+    bool waveforms;
+    const CancellationToken& token;
+    std::shared_ptr<State> state = std::make_shared<State>();
+    int cancelCallbackId = 0;
+
+    bool await_ready() const noexcept { return lanes.empty() || token.isCancelled(); }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        state->handle = handle;
+
+        // One job per source stream
+        std::vector<std::vector<Lane*>> streams;
+        for (auto* lane : lanes)
+        {
+            const auto source = StreamSource::of(*lane);
+            auto stream = std::find_if(streams.begin(), streams.end(), [&source](const auto& group)
+            {
+                return StreamSource::of(*group.front()).isSameStream(source);
+            });
+
+            if (stream == streams.end())
+                streams.push_back({ lane });
+            else
+                stream->push_back(lane);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(extractor.jobsMutex);
+            for (const auto& streamLanes : streams)
+                listenLocked(streamLanes);
+        }
+
+        // Registered after the listeners exist so an early cancel finds them
+        cancelCallbackId = token.addCallback([&extractor = extractor, state = state]()
+        {
+            for (const auto& [jobId, listenerId] : state->listening)
+                if (extractor.detachListener(jobId, listenerId))
+                    state->arrive(false, {});
+        });
+
+        state->arrive(true, {});
+    }
+
+    ExtractionResult await_resume() const { return state->result; }
+
+private:
+    void listenLocked(const std::vector<Lane*>& streamLanes)
+    {
+        const auto source = StreamSource::of(*streamLanes.front());
+        juce::Uuid jobId;
+        ExtractionJob* job = nullptr;
+
+        if (waveforms)
+        {
+            // Re-extraction replaces any job these lanes were waiting on
+            for (auto& [id, other] : extractor.jobs)
+                for (auto* lane : streamLanes)
+                    if (std::find(other->lanes.begin(), other->lanes.end(), lane) != other->lanes.end())
+                        cancelJobLocked(*other);
+        }
+        else
+        {
+            // Every decode of the stream measures loudness on all its
+            // channels, so any one still running will do
+            for (auto& [id, other] : extractor.jobs)
+            {
+                if (!other->following && !other->cancelled && other->source.isSameStream(source))
+                {
+                    jobId = id;
+                    job = other.get();
+                    job->lanes.insert(job->lanes.end(), streamLanes.begin(), streamLanes.end());
+                    break;
+                }
+            }
+        }
+
+        if (job == nullptr)
+            job = &extractor.startJobLocked(streamLanes, waveforms, jobId);
+
+        std::vector<std::pair<juce::Uuid, int>> wanted;
+        for (auto* lane : streamLanes)
+            wanted.emplace_back(lane->uuid, lane->channelIndex);
+
+        const int listenerId = extractor.nextListenerId++;
+        ++state->pending;
+        state->listening.emplace_back(jobId, listenerId);
+
+        job->listeners[listenerId] = [state = state, wantWaveforms = waveforms,
+                                      wanted = std::move(wanted)](bool completed, const JobOutput& output)
+        {
+            std::vector<LaneResult> results;
+            if (completed && wantWaveforms)
+            {
+                results = output.lanes;
+            }
+            else if (completed)
+            {
+                for (const auto& [laneId, channel] : wanted)
+                {
+                    LaneResult result;
+                    result.laneId = laneId;
+                    if (channel >= 0 && channel < static_cast<int>(output.channelLoudness.size()))
+                        result.loudness = output.channelLoudness[static_cast<size_t>(channel)];
+                    results.push_back(std::move(result));
+                }
+            }
+
+            state->arrive(completed, std::move(results));
+        };
+    }
+};
+
+Task<WaveformExtractor::ExtractionResult> WaveformExtractor::awaitJobs(std::vector<Lane*> lanes, bool waveforms,
+                                                                       CancellationToken token)
+{
+    JobAwaiter awaiter{ *this, lanes, waveforms, token };
+    ExtractionResult result = co_await awaiter;
+    token.removeCallback(awaiter.cancelCallbackId);
+
+    if (token.isCancelled())
+        result.completed = false;
+    co_return result;
+}
+
+Task<WaveformExtractor::ExtractionResult> WaveformExtractor::extractAsync(std::vector<Lane*> lanes,
+                                                                          CancellationToken token)
+{
+    return awaitJobs(std::move(lanes), true, std::move(token));
+}
+
+Task<WaveformExtractor::ExtractionResult> WaveformExtractor::measureLoudnessAsync(std::vector<Lane*> lanes,
+                                                                                  CancellationToken token)
+{
+    return awaitJobs(std::move(lanes), false, std::move(token));
+}
+
+bool WaveformExtractor::followWaveforms(const std::vector<Lane*>& lanes, FollowCallback onUpdate)
+{
+    if (lanes.empty() || !GrowingWavFile::canFollow(lanes.front()->sourceFile))
+        return false;
+
+    for (auto* lane : lanes)
+        cancelExtraction(lane);
+
+    auto job = makeJob(lanes);
+    job->following = true;
 
     ExtractionJob* jobPtr = job.get();
-    juce::Uuid laneId = lane->uuid;
+    juce::Uuid jobId;
 
     {
         std::lock_guard<std::mutex> lock(jobsMutex);
-        jobs[laneId] = std::move(job);
+        jobs[jobId] = std::move(job);
     }
 
-    // Start extraction in background
-    juce::Thread::launch([this, jobPtr, laneId]()
+    juce::Thread::launch([this, jobPtr, jobId, onUpdate = std::move(onUpdate)]()
     {
-        runExtraction(jobPtr);
+        runFollow(*jobPtr, onUpdate);
 
-        // Remove job when done
         std::lock_guard<std::mutex> lock(jobsMutex);
-        jobs.erase(laneId);
+        jobs.erase(jobId);
+        jobsChanged.notify_all();
     });
+
+    return true;
+}
+
+void WaveformExtractor::stopFollowing()
+{
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    for (auto& pair : jobs)
+        if (pair.second->following)
+            pair.second->stopRequested = true;
+}
+
+void WaveformExtractor::releaseLane(Lane* lane)
+{
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    for (auto& pair : jobs)
+    {
+        auto& job = *pair.second;
+        auto found = std::find(job.lanes.begin(), job.lanes.end(), lane);
+        if (found == job.lanes.end())
+            continue;
+
+        job.lanes.erase(found);
+        if (job.lanes.empty())
+            cancelJobLocked(job);
+    }
 }
 
 void WaveformExtractor::cancelExtraction(Lane* lane)
@@ -52,12 +621,11 @@ void WaveformExtractor::cancelExtraction(Lane* lane)
         return;
 
     std::lock_guard<std::mutex> lock(jobsMutex);
-    auto it = jobs.find(lane->uuid);
-    if (it != jobs.end())
+    for (auto& pair : jobs)
     {
-        it->second->cancelled = true;
-        if (it->second->process)
-            it->second->process->kill();
+        auto& job = *pair.second;
+        if (std::find(job.lanes.begin(), job.lanes.end(), lane) != job.lanes.end())
+            cancelJobLocked(job);
     }
 }
 
@@ -65,142 +633,279 @@ void WaveformExtractor::cancelAll()
 {
     std::lock_guard<std::mutex> lock(jobsMutex);
     for (auto& pair : jobs)
-    {
-        pair.second->cancelled = true;
-        if (pair.second->process)
-            pair.second->process->kill();
-    }
+        cancelJobLocked(*pair.second);
 }
 
-void WaveformExtractor::runExtraction(ExtractionJob* job)
+bool WaveformExtractor::decodeStream(const StreamSource& source, SpawnedProcess& process,
+                                     const std::atomic<bool>& cancelled, const FrameConsumer& consume)
 {
-    if (job->cancelled)
-        return;
-
-    Lane* lane = job->lane;
-
-    if (!locator.isFFmpegAvailable())
+    // Ask for the stream's own sample width so ffmpeg doesn't widen it and
+    // the pipe carries as few bytes as possible; we convert to float here
+    const SampleFormat pipeFormat = SampleKernels::pipeFormatFor(source.sampleFormat, source.bitsPerRawSample);
+    const int numChannels = source.numChannels;
+    const auto& kernels = SampleKernels::get(pipeFormat, numChannels);
+
+    // The resident worker decodes straight to float without an ffmpeg
+    // launch; ffmpeg takes over if it fails before delivering anything
+    if (DecodeWorkerPool::isAvailable())
     {
-        // Can't extract without ffmpeg
-        return;
+        bool delivered = false;
+        const auto outcome = DecodeWorkerPool::getInstance().decode(source.file, source.streamIndex, 0.0, 0.0,
+                                                                    numChannels, cancelled,
+                                                                    [&](const float* frames, size_t numFrames)
+        {
+            delivered = true;
+            consume(frames, numFrames);
+        });
+
+        if (outcome == DecodeWorkerPool::Outcome::Done)
+            return !cancelled;
+        if (outcome == DecodeWorkerPool::Outcome::Cancelled || delivered || cancelled)
+            return false;
     }
 
-    // Build ffmpeg command to decode to raw float32 PCM
-    // ffmpeg -v error -nostdin -i <file> -map 0:a:<streamIndex> -f f32le -acodec pcm_f32le -
+    // ffmpeg -v error -nostdin -i <file> -map 0:a:<streamIndex> -f <fmt> -acodec pcm_<fmt> -
     juce::StringArray args;
     args.add(locator.getFFmpegPath().getFullPathName());
     args.add("-v");
     args.add("error");
     args.add("-nostdin");
     args.add("-i");
-    args.add(lane->sourceFile.getFullPathName());
+    args.add(source.file.getFullPathName());
     args.add("-map");
-    args.add("0:a:" + juce::String(lane->streamIndex));
+    args.add("0:a:" + juce::String(source.streamIndex));
     args.add("-f");
-    args.add("f32le");
+    args.add(SampleKernels::ffmpegFormatName(pipeFormat));
     args.add("-acodec");
-    args.add("pcm_f32le");
+    args.add(SampleKernels::ffmpegCodecName(pipeFormat));
     args.add("-");  // Output to stdout
 
-    job->process = std::make_unique<juce::ChildProcess>();
-
-    if (!job->process->start(args, juce::ChildProcess::wantStdOut))
-    {
-        return;
-    }
+    if (!process.start(args, SpawnedProcess::wantStdOut))
+        return false;
 
-    // Read audio data from stdout
-    juce::MemoryBlock rawData;
+    const size_t frameBytes = static_cast<size_t>(SampleKernels::bytesPerSample(pipeFormat) * numChannels);
 
-    // Read in chunks
-    constexpr int kBufferSize = 65536;
-    juce::HeapBlock<char> buffer(kBufferSize);
+    // Stream audio data from stdout to the consumer - nothing is buffered
+    // beyond one batch, so long sources need no size cap. Pipe reads are
+    // small; batch them up so parallel consumers get enough work per wake-up.
+    constexpr int kReadSize = 65536;
+    constexpr size_t kBatchBytes = 1 << 20;
+    juce::HeapBlock<char> buffer(kBatchBytes + static_cast<size_t>(kReadSize) + frameBytes);
+    std::vector<float> converted;
+    size_t filledBytes = 0;
+    bool endOfStream = false;
 
-    while (!job->cancelled)
+    while (!cancelled && !endOfStream)
     {
-        int bytesRead = job->process->readProcessOutput(buffer.getData(), kBufferSize);
+        int bytesRead = process.readProcessOutput(buffer.getData() + filledBytes, kReadSize);
 
         if (bytesRead <= 0)
-            break;
+            endOfStream = true;
+        else
+            filledBytes += static_cast<size_t>(bytesRead);
+
+        if (filledBytes < kBatchBytes && !endOfStream)
+            continue;
 
-        rawData.append(buffer.getData(), static_cast<size_t>(bytesRead));
+        size_t numFrames = filledBytes / frameBytes;
+        if (numFrames > 0)
+        {
+            if (pipeFormat == SampleFormat::F32)
+            {
+                consume(reinterpret_cast<const float*>(buffer.getData()), numFrames);
+            }
+            else
+            {
+                size_t numSamples = numFrames * static_cast<size_t>(numChannels);
+                converted.resize(numSamples);
+                kernels.toFloat(buffer.getData(), converted.data(), numSamples);
+                consume(converted.data(), numFrames);
+            }
+        }
 
-        // Limit memory usage - cap at ~500MB raw data
-        if (rawData.getSize() > 500 * 1024 * 1024)
-            break;
+        // Keep any partial frame for the next batch
+        size_t carryBytes = filledBytes - numFrames * frameBytes;
+        if (carryBytes > 0)
+            std::memmove(buffer.getData(), buffer.getData() + numFrames * frameBytes, carryBytes);
+        filledBytes = carryBytes;
     }
 
-    job->process->waitForProcessToFinish(5000);
+    process.waitForProcessToFinish(5000);
+    return !cancelled;
+}
 
-    if (job->cancelled)
-        return;
+bool WaveformExtractor::runExtraction(ExtractionJob& job, JobOutput& output)
+{
+    if (job.cancelled)
+        return false;
+
+    if (!locator.isFFmpegAvailable() && !DecodeWorkerPool::isAvailable())
+    {
+        // Can't extract without ffmpeg
+        return false;
+    }
 
-    // Process the raw audio data into envelope
-    processAudioData(lane, rawData);
+    // All lanes of a job share the same source stream
+    const StreamSource& source = job.source;
+    const int numChannels = source.numChannels;
+    const size_t expectedFrames = static_cast<size_t>(std::max(0.0, source.duration * source.sampleRate));
 
-    // Call completion callback
-    if (job->callback && !job->cancelled)
+    std::vector<std::unique_ptr<ChannelAccumulator>> accumulators;
+    if (job.waveforms)
     {
-        job->callback(lane);
+        accumulators.reserve(job.channels.size());
+        for (int channel : job.channels)
+            accumulators.push_back(std::make_unique<ChannelAccumulator>(channel, numChannels, expectedFrames, source.sampleRate));
     }
-}
 
-void WaveformExtractor::processAudioData(Lane* lane, const juce::MemoryBlock& rawData)
-{
-    // Raw data is float32 interleaved samples
-    // We need to extract just our channel and compute min/max envelope
+    // Loudness is measured for every channel of the stream in the same pass
+    LoudnessMeter meter(numChannels, source.sampleRate);
 
-    const float* samples = static_cast<const float*>(rawData.getData());
-    size_t numFloats = rawData.getSize() / sizeof(float);
-    size_t numSamplesTotal = numFloats / static_cast<size_t>(lane->totalChannels);
+    ProgressTracker::JobHandle progressJob;
+    if (progress != nullptr)
+        progressJob = progress->startJob(job.waveforms ? ProgressTracker::JobKind::Extract : ProgressTracker::JobKind::Decode,
+                                         source.file.getFileName(), source.duration);
 
-    if (numSamplesTotal == 0)
-        return;
+    bool decoded = decodeStream(source, *job.process, job.cancelled, [&](const float* frames, size_t numFrames)
+    {
+        if (progressJob != nullptr)
+            progressJob->addProgress(static_cast<double>(numFrames) / source.sampleRate);
 
-    // Target envelope resolution
-    int numPoints = kDefaultEnvelopePoints;
+        // Lanes reduce independent channels and the meter's channel groups
+        // are independent too: one flat fan-out over both
+        const int numGroups = meter.getNumGroups();
+        parallelFor(static_cast<int>(accumulators.size()) + numGroups, [&](int i)
+        {
+            if (i < numGroups)
+                meter.processGroup(i, frames, numFrames);
+            else
+                accumulators[static_cast<size_t>(i - numGroups)]->process(frames, numFrames, numChannels);
+        });
+        meter.endBatch(numFrames);
+    });
 
-    // Samples per envelope point
-    size_t samplesPerPoint = std::max<size_t>(1, numSamplesTotal / static_cast<size_t>(numPoints));
+    if (progressJob != nullptr)
+        progressJob->finish(decoded && !job.cancelled,
+                            (job.waveforms ? "Waveforms ready: " : "Measured loudness of ") + source.file.getFileName());
 
-    // Adjust numPoints based on actual data
-    numPoints = static_cast<int>((numSamplesTotal + samplesPerPoint - 1) / samplesPerPoint);
+    if (!decoded || job.cancelled)
+        return false;
 
-    // Initialize envelope
-    WaveformEnvelope& envelope = lane->waveform;
-    envelope.minValues.clear();
-    envelope.maxValues.clear();
-    envelope.minValues.resize(static_cast<size_t>(numPoints), 0.0f);
-    envelope.maxValues.resize(static_cast<size_t>(numPoints), 0.0f);
-    envelope.numPoints = numPoints;
+    for (int channel = 0; channel < numChannels; ++channel)
+        output.channelLoudness.push_back(meter.getChannelData(channel));
 
-    int channelIndex = lane->channelIndex;
-    int totalChannels = lane->totalChannels;
+    for (size_t i = 0; i < job.laneIds.size(); ++i)
+    {
+        LaneResult result;
+        result.laneId = job.laneIds[i];
+        if (job.waveforms)
+            accumulators[i]->finish(result);
+        result.loudness = meter.getChannelData(job.channels[i]);
+        output.lanes.push_back(std::move(result));
+    }
 
-    // Process each envelope point
-    for (int point = 0; point < numPoints; ++point)
+    return true;
+}
+
+bool WaveformExtractor::runFollow(ExtractionJob& job, const FollowCallback& onUpdate)
+{
+    const std::vector<int>& channels = job.channels;
+    const int numChannels = job.source.numChannels;
+
+    GrowingWavFile wav(job.source.file);
+    if (!wav.refresh() || wav.getNumChannels() != numChannels)
+        return false;
+
+    // The final length isn't known, so envelopes start fine and coarsen as
+    // the file grows, just like an extraction without a probed duration
+    const double sampleRate = wav.getSampleRate();
+    std::vector<std::unique_ptr<ChannelAccumulator>> accumulators;
+    accumulators.reserve(channels.size());
+    for (int channel : channels)
+        accumulators.push_back(std::make_unique<ChannelAccumulator>(channel, numChannels, 0, sampleRate));
+
+    LoudnessMeter meter(numChannels, sampleRate);
+
+    // Batches the size decodeStream() hands out
+    const size_t batchFrames = std::max<size_t>(1, (size_t(1) << 20) / (sizeof(float) * static_cast<size_t>(numChannels)));
+    std::vector<float> frames(batchFrames * static_cast<size_t>(numChannels));
+    int64_t position = 0;
+    int64_t published = -1;
+    double lastPublishMs = juce::Time::getMillisecondCounterHiRes();
+
+    auto publish = [&](bool finished)
     {
-        size_t startSample = static_cast<size_t>(point) * samplesPerPoint;
-        size_t endSample = std::min(startSample + samplesPerPoint, numSamplesTotal);
+        FollowUpdate update;
+        update.duration = static_cast<double>(position) / sampleRate;
+        update.finished = finished;
+        for (size_t i = 0; i < accumulators.size(); ++i)
+        {
+            LaneResult followed;
+            followed.laneId = job.laneIds[i];
+            accumulators[i]->snapshot(followed.waveform, followed.analysisSignal);
+            followed.loudness = meter.getChannelData(channels[i]);
+            update.lanes.push_back(std::move(followed));
+        }
 
-        float minVal = 0.0f;
-        float maxVal = 0.0f;
+        published = position;
+        lastPublishMs = juce::Time::getMillisecondCounterHiRes();
+        if (onUpdate)
+            onUpdate(std::move(update));
+    };
 
-        for (size_t s = startSample; s < endSample; ++s)
+    for (;;)
+    {
+        // Everything on disk that hasn't been read yet - a long file that
+        // was already there when following started publishes as it goes
+        const int64_t available = wav.getNumFrames();
+        bool readFailed = false;
+        while (position < available && !job.cancelled && !job.stopRequested)
         {
-            // Get sample for our channel (interleaved)
-            size_t idx = s * static_cast<size_t>(totalChannels) + static_cast<size_t>(channelIndex);
-            if (idx < numFloats)
+            const auto numFrames = static_cast<size_t>(std::min<int64_t>(available - position, static_cast<int64_t>(batchFrames)));
+            if (!wav.read(position, numFrames, frames.data()))
             {
-                float sample = samples[idx];
-                minVal = std::min(minVal, sample);
-                maxVal = std::max(maxVal, sample);
+                readFailed = true;
+                break;
             }
+
+            const int numGroups = meter.getNumGroups();
+            parallelFor(static_cast<int>(accumulators.size()) + numGroups, [&](int i)
+            {
+                if (i < numGroups)
+                    meter.processGroup(i, frames.data(), numFrames);
+                else
+                    accumulators[static_cast<size_t>(i - numGroups)]->process(frames.data(), numFrames, numChannels);
+            });
+            meter.endBatch(numFrames);
+            position += static_cast<int64_t>(numFrames);
+
+            if (juce::Time::getMillisecondCounterHiRes() - lastPublishMs >= kFollowPublishMs)
+                publish(false);
         }
 
-        envelope.minValues[static_cast<size_t>(point)] = minVal;
-        envelope.maxValues[static_cast<size_t>(point)] = maxVal;
-    }
+        if (job.cancelled)
+            return false;
+
+        // The recorder has finalised the header and we have all of it
+        if (readFailed || job.stopRequested || (wav.isFinalised() && position >= available))
+        {
+            publish(true);
+            return !readFailed;
+        }
+
+        // First catch-up straight away, then at the publish rate
+        if (position != published
+            && (published < 0 || juce::Time::getMillisecondCounterHiRes() - lastPublishMs >= kFollowPublishMs))
+            publish(false);
+
+        wav.waitForChange(kFollowPollMs);
 
-    envelope.isReady = true;
+        // Replaced or truncated under us (a recorder restarting the take):
+        // keep what was read and stop
+        if (!wav.refresh() || wav.getNumChannels() != numChannels || wav.getNumFrames() < position)
+        {
+            publish(true);
+            return false;
+        }
+    }
 }
@@ -8,22 +8,78 @@
 #include <juce_core/juce_core.h>
 #include "../ffmpeg/FFmpegLocator.h"
 #include "../model/ProjectModel.h"
+#include "../model/ProgressTracker.h"
+#include "../async/Task.h"
+#include "../async/SpawnedProcess.h"
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 
+class CancellationToken;
+
 class WaveformExtractor
 {
 public:
-    using CompletionCallback = std::function<void(Lane*)>;
-
-    explicit WaveformExtractor(FFmpegLocator& locator);
+    // Decodes are reported to the tracker if one is given
+    explicit WaveformExtractor(FFmpegLocator& locator, ProgressTracker* progress = nullptr);
     ~WaveformExtractor();
 
-    // Start extracting waveform for a lane (async)
-    void extractWaveform(Lane* lane, CompletionCallback callback);
+    // What a job measured for one of its lanes. Jobs never write to lanes:
+    // apply results on the message thread, to lanes still in the model.
+    struct LaneResult
+    {
+        juce::Uuid laneId;
+        WaveformEnvelope waveform;                               // Empty for loudness-only results
+        std::shared_ptr<const DecimatedSignal> analysisSignal;   // Null for loudness-only results
+        std::shared_ptr<const LoudnessData> loudness;
+    };
+
+    struct ExtractionResult
+    {
+        bool completed = false;   // False if a decode failed or was cancelled
+        std::vector<LaneResult> lanes;
+    };
+
+    // Extract waveforms, analysis signals and loudness for lanes of one
+    // source stream with a single shared decode. Resumes on the message
+    // thread; cancelling the token cancels the decode.
+    Task<ExtractionResult> extractAsync(std::vector<Lane*> lanes, CancellationToken token);
 
-    // Cancel extraction for a specific lane
+    // Measure loudness only, for lanes of any number of streams. A stream
+    // that is already being extracted waits for that decode rather than
+    // starting a second one; the others get loudness-only decodes, run side
+    // by side. Resumes on the message thread once every stream is done.
+    Task<ExtractionResult> measureLoudnessAsync(std::vector<Lane*> lanes, CancellationToken token);
+
+    struct FollowUpdate
+    {
+        std::vector<LaneResult> lanes;
+        double duration = 0.0;    // Seconds read so far
+        bool finished = false;    // Last update of the job
+    };
+
+    using FollowCallback = std::function<void(FollowUpdate)>;
+
+    // Follow a PCM WAV that is still being written (see GrowingWavFile):
+    // extract what is there, then keep extending the lanes' envelopes,
+    // analysis signals and loudness as data lands, never decoding anything
+    // twice. onUpdate fires on the follow thread about once a second while
+    // the file grows and once more when it finishes - the header is
+    // finalised, stopFollowing() is called or the file stops being readable.
+    // Returns false if the file can't be read natively.
+    bool followWaveforms(const std::vector<Lane*>& lanes, FollowCallback onUpdate);
+
+    // Let every follow job publish what it has and finish
+    void stopFollowing();
+
+    // The lane is leaving the model: drop it from its jobs, cancelling any
+    // job left with no lane to measure for. Call before the lane is deleted.
+    void releaseLane(Lane* lane);
+
+    // Cancel extraction for a specific lane (cancels the shared decode it belongs to)
     void cancelExtraction(Lane* lane);
 
     // Cancel all extractions
@@ -32,22 +88,101 @@ public:
     // Default envelope resolution
     static constexpr int kDefaultEnvelopePoints = 4000;
 
+    // Target rate and length cap of the analysis signal. The rate is fixed
+    // per source (its own divided by an integer, so near the target but not
+    // always on it) and the signal is low-passed below its Nyquist; a longer
+    // source keeps its first kMaxAnalysisSamples (about four minutes).
+    static constexpr double kAnalysisSampleRate = 1000.0;
+    static constexpr size_t kMaxAnalysisSamples = 1 << 18;
+
+    // Rate and length cap of the level envelope that goes with it; past the
+    // cap (about three hours) its rate halves
+    static constexpr double kEnvelopeRate = 100.0;
+    static constexpr size_t kMaxEnvelopeSamples = 1 << 20;
+
+    // Follow mode: how often updates are published, and how long to wait
+    // for the file to change before checking it anyway
+    static constexpr double kFollowPublishMs = 1000.0;
+    static constexpr int kFollowPollMs = 500;
+
 private:
+    // The stream a job decodes, copied from its lanes when the job is made
+    struct StreamSource
+    {
+        juce::File file;
+        int streamIndex = 0;
+        int numChannels = 1;
+        double sampleRate = 48000.0;
+        double duration = 0.0;
+        juce::String sampleFormat;
+        int bitsPerRawSample = 0;
+
+        static StreamSource of(const Lane& lane);
+        bool isSameStream(const StreamSource& other) const;
+    };
+
+    struct JobOutput
+    {
+        std::vector<LaneResult> lanes;                                    // One per job lane
+        std::vector<std::shared_ptr<const LoudnessData>> channelLoudness; // Every channel of the stream
+    };
+
+    // Called once, on the job's thread, when the job ends
+    using JobListener = std::function<void(bool completed, const JobOutput& output)>;
+
     struct ExtractionJob
     {
-        Lane* lane = nullptr;
-        CompletionCallback callback;
-        std::unique_ptr<juce::ChildProcess> process;
+        StreamSource source;
+        std::vector<juce::Uuid> laneIds;      // Fixed for the job's life
+        std::vector<int> channels;
+        bool waveforms = true;                // False: loudness only
+        bool following = false;
+
+        // Guarded by jobsMutex
+        std::vector<Lane*> lanes;             // Lanes still waiting on the job
+        std::map<int, JobListener> listeners;
+
+        std::unique_ptr<SpawnedProcess> process = std::make_unique<SpawnedProcess>();
         std::atomic<bool> cancelled{ false };
+        std::atomic<bool> stopRequested{ false };   // Follow jobs: finish with what's there
     };
 
-    void runExtraction(ExtractionJob* job);
-    void processAudioData(Lane* lane, const juce::MemoryBlock& rawData);
+    // Awaits a set of jobs on behalf of one extractAsync/measureLoudnessAsync
+    struct JobAwaiter;
+
+    // Per-channel streaming reducer for one lane of a shared decode
+    class ChannelAccumulator;
+
+    using FrameConsumer = std::function<void(const float* interleaved, size_t numFrames)>;
+
+    Task<ExtractionResult> awaitJobs(std::vector<Lane*> lanes, bool waveforms, CancellationToken token);
+
+    static std::unique_ptr<ExtractionJob> makeJob(const std::vector<Lane*>& lanes);
+
+    // Create a job over lanes of one stream and start its thread; jobsMutex must be held
+    ExtractionJob& startJobLocked(const std::vector<Lane*>& lanes, bool waveforms, juce::Uuid& jobId);
+
+    // Stop listening to a job. False if the job has already taken the
+    // listener and will call it; a job nobody is waiting on is cancelled.
+    bool detachListener(const juce::Uuid& jobId, int listenerId);
+
+    static void cancelJobLocked(ExtractionJob& job);
+
+    bool runExtraction(ExtractionJob& job, JobOutput& output);
+    bool runFollow(ExtractionJob& job, const FollowCallback& onUpdate);
+
+    // Run the decode worker, or else ffmpeg, over the source stream (piped
+    // in its native sample width) and hand interleaved float frames to the consumer in ~1 MB batches. False if it failed or was cancelled.
+    bool decodeStream(const StreamSource& source, SpawnedProcess& process,
+                      const std::atomic<bool>& cancelled, const FrameConsumer& consume);
 
     FFmpegLocator& locator;
+    ProgressTracker* progress;
 
     std::mutex jobsMutex;
+    std::condition_variable jobsChanged;  // A job was removed
     std::map<juce::Uuid, std::unique_ptr<ExtractionJob>> jobs;
+    int nextListenerId = 1;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformExtractor)
 };
@@ -0,0 +1,261 @@
+/*
+    ChannelStacker - Decode Worker Implementation
+*/
+
+#include "DecodeWorker.h"
+#include "DecodeWorkerProtocol.h"
+
+using namespace DecodeWorkerProtocol;
+
+namespace
+{
+    // Larger than any real message; anything bigger means the stream is out of step
+    constexpr uint32_t kMaxPayloadBytes = 64u << 20;
+
+    juce::File getWorkerExecutable()
+    {
+       #if JUCE_WINDOWS
+        const juce::String name = juce::String(kExecutableName) + ".exe";
+       #else
+        const juce::String name = kExecutableName;
+       #endif
+        return juce::File::getSpecialLocation(juce::File::currentExecutableFile).getSiblingFile(name);
+    }
+}
+
+DecodeWorkerPool& DecodeWorkerPool::getInstance()
+{
+    std::lock_guard<std::mutex> guard(instanceLock);
+    if (instance == nullptr)
+        instance = new DecodeWorkerPool();
+    return *instance;
+}
+
+bool DecodeWorkerPool::isAvailable()
+{
+    static const bool available = getWorkerExecutable().existsAsFile();
+    return available;
+}
+
+DecodeWorkerPool::~DecodeWorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(instanceLock);
+        instance = nullptr;
+    }
+
+    // Closing stdin lets each worker finish and exit on its own
+    for (auto& worker : idle)
+        worker->process.closeProcessInput();
+    for (auto& worker : idle)
+        if (!worker->process.waitForProcessToFinish(1000))
+            worker->process.kill();
+}
+
+bool DecodeWorkerPool::Worker::send(const juce::String& request)
+{
+    const auto line = request + "\n";
+    return process.writeProcessInput(line.toRawUTF8(), line.getNumBytesAsUTF8());
+}
+
+bool DecodeWorkerPool::Worker::readExactly(void* dest, size_t numBytes)
+{
+    auto* bytes = static_cast<char*>(dest);
+    while (numBytes > 0)
+    {
+        const int numRead = process.readProcessOutput(bytes, static_cast<int>(std::min<size_t>(numBytes, 1 << 20)));
+        if (numRead <= 0)
+            return false;
+        bytes += numRead;
+        numBytes -= static_cast<size_t>(numRead);
+    }
+    return true;
+}
+
+std::unique_ptr<DecodeWorkerPool::Worker> DecodeWorkerPool::acquire()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        while (!idle.empty())
+        {
+            auto worker = std::move(idle.back());
+            idle.pop_back();
+            if (worker->process.isRunning())
+                return worker;
+        }
+    }
+
+    if (!isAvailable())
+        return nullptr;
+
+    auto worker = std::make_unique<Worker>();
+    juce::StringArray args;
+    args.add(getWorkerExecutable().getFullPathName());
+
+    // The ring's descriptors land on the fds the protocol names, in order
+    std::vector<int> inheritedFds;
+    if (SharedRing::isSupported())
+        worker->ring = SharedRing::create(kRingBytes);
+    if (worker->ring != nullptr)
+    {
+        static_assert(kRingSignalFd == kRingMemoryFd + 1);
+        args.add(kSharedRingArgument);
+        inheritedFds = { worker->ring->getMemoryDescriptor(), worker->ring->getSignalDescriptor() };
+    }
+
+    if (!worker->process.start(args, SpawnedProcess::wantStdIn | SpawnedProcess::wantStdOut, inheritedFds))
+        return nullptr;
+    return worker;
+}
+
+void DecodeWorkerPool::release(std::unique_ptr<Worker> worker)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (idle.size() < kMaxIdleWorkers)
+        {
+            idle.push_back(std::move(worker));
+            return;
+        }
+    }
+
+    worker->process.closeProcessInput();
+    if (!worker->process.waitForProcessToFinish(1000))
+        worker->process.kill();
+}
+
+bool DecodeWorkerPool::probe(const juce::File& file, juce::String& json)
+{
+    auto worker = acquire();
+    if (worker == nullptr || !worker->send("probe\t" + file.getFullPathName()))
+        return false;
+
+    // A worker that dies or answers out of step is dropped (and killed)
+    MessageHeader header{};
+    juce::MemoryBlock payload;
+    if (!worker->readExactly(&header, sizeof(header)) || header.payloadBytes > kMaxPayloadBytes)
+    {
+        worker->process.kill();
+        return false;
+    }
+
+    payload.setSize(header.payloadBytes);
+    if (!worker->readExactly(payload.getData(), payload.getSize()))
+    {
+        worker->process.kill();
+        return false;
+    }
+
+    release(std::move(worker));
+
+    // On an Error, ffprobe gets to report the failure in its own words
+    if (header.type != MessageType::ProbeJson)
+        return false;
+
+    json = payload.toString();
+    return true;
+}
+
+DecodeWorkerPool::Outcome DecodeWorkerPool::decode(const juce::File& file, int audioStream,
+                                                   double startSeconds, double lengthSeconds, int expectedChannels,
+                                                   const std::atomic<bool>& cancelled, const FrameConsumer& consume)
+{
+    auto worker = acquire();
+    if (worker == nullptr)
+        return Outcome::Failed;
+
+    const juce::String request = "decode\t" + juce::String(audioStream)
+                               + "\t" + juce::String(startSeconds, 6)
+                               + "\t" + juce::String(lengthSeconds, 6)
+                               + "\t" + file.getFullPathName();
+    if (!worker->send(request))
+        return Outcome::Failed;
+
+    std::vector<float> samples;
+    int numChannels = 0;
+
+    for (;;)
+    {
+        // Mid-job there's no way to stop the worker short of killing it
+        if (cancelled)
+        {
+            worker->process.kill();
+            return Outcome::Cancelled;
+        }
+
+        MessageHeader header{};
+        if (!worker->readExactly(&header, sizeof(header)) || header.payloadBytes > kMaxPayloadBytes)
+        {
+            worker->process.kill();
+            return Outcome::Failed;
+        }
+
+        switch (header.type)
+        {
+            case MessageType::Format:
+            {
+                FormatPayload format{};
+                if (header.payloadBytes != sizeof(format) || !worker->readExactly(&format, sizeof(format))
+                    || format.numChannels != expectedChannels)
+                {
+                    worker->process.kill();
+                    return Outcome::Failed;
+                }
+                numChannels = format.numChannels;
+                break;
+            }
+
+            case MessageType::Samples:
+            {
+                const size_t numSamples = header.payloadBytes / sizeof(float);
+                samples.resize(numSamples);
+                if (numChannels == 0 || !worker->readExactly(samples.data(), header.payloadBytes))
+                {
+                    worker->process.kill();
+                    return Outcome::Failed;
+                }
+                consume(samples.data(), numSamples / static_cast<size_t>(numChannels));
+                break;
+            }
+
+            case MessageType::RingSamples:
+            {
+                // Read in place and released once the consumer is done with it
+                RingSpan span{};
+                if (header.payloadBytes != sizeof(span) || worker->ring == nullptr || numChannels == 0
+                    || !worker->readExactly(&span, sizeof(span)) || span.numBytes > worker->ring->getCapacity())
+                {
+                    worker->process.kill();
+                    return Outcome::Failed;
+                }
+
+                const auto* frames = static_cast<const float*>(worker->ring->read(span.endPosition, span.numBytes));
+                consume(frames, span.numBytes / sizeof(float) / static_cast<size_t>(numChannels));
+                worker->ring->release(span.endPosition);
+                break;
+            }
+
+            case MessageType::Done:
+                release(std::move(worker));
+                return Outcome::Done;
+
+            case MessageType::Error:
+            {
+                juce::MemoryBlock message(header.payloadBytes);
+                if (!worker->readExactly(message.getData(), message.getSize()))
+                {
+                    worker->process.kill();
+                    return Outcome::Failed;
+                }
+                DBG("Decode worker: " << message.toString());
+                release(std::move(worker));
+                return Outcome::Failed;
+            }
+
+            case MessageType::ProbeJson:
+            default:
+                worker->process.kill();
+                return Outcome::Failed;
+        }
+    }
+}
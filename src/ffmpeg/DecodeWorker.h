@@ -0,0 +1,85 @@
+/*
+    ChannelStacker - Decode Worker Header
+    Client side of the resident decode worker (ChannelStackerDecodeWorker,
+    built with CHANNELSTACKER_DECODE_WORKER). Workers are started on first
+    use and kept alive between jobs, so a probe or decode costs a line on a
+    pipe instead of an ffmpeg launch. A worker that crashes or is cancelled
+    mid-job is killed and replaced; callers fall back to the ffmpeg tools
+    whenever the worker isn't installed or fails before producing anything.
+    Where SharedRing is supported each worker gets a shared-memory ring, and
+    consumers read decoded batches straight out of it.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "../async/SpawnedProcess.h"
+#include "../async/SharedRing.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class DecodeWorkerPool : public juce::DeletedAtShutdown
+{
+public:
+    enum class Outcome
+    {
+        Done,
+        Failed,
+        Cancelled
+    };
+
+    using FrameConsumer = std::function<void(const float* interleaved, size_t numFrames)>;
+
+    // Safe from any thread
+    static DecodeWorkerPool& getInstance();
+
+    // True if the worker executable sits next to the app's own
+    static bool isAvailable();
+
+    ~DecodeWorkerPool() override;
+
+    // ffprobe-style JSON of the file's audio streams. Blocking; false if no
+    // worker could answer (use ffprobe instead).
+    bool probe(const juce::File& file, juce::String& json);
+
+    // Decode [startSeconds, startSeconds + lengthSeconds) of the file's
+    // audioStream'th audio stream (lengthSeconds 0 = to the end) to
+    // interleaved float, handed to the consumer in ~1 MB batches. Fails
+    // before the first batch if the stream doesn't have expectedChannels.
+    // Blocking; 'cancelled' is checked between batches.
+    Outcome decode(const juce::File& file, int audioStream, double startSeconds, double lengthSeconds,
+                   int expectedChannels, const std::atomic<bool>& cancelled, const FrameConsumer& consume);
+
+private:
+    struct Worker
+    {
+        std::unique_ptr<SharedRing> ring;     // Null when samples come through the pipe
+        SpawnedProcess process;
+
+        bool send(const juce::String& request);
+        bool readExactly(void* dest, size_t numBytes);
+    };
+
+    // Idle workers beyond this are shut down when their job finishes
+    static constexpr size_t kMaxIdleWorkers = 4;
+
+    // Room for several batches in flight, so the worker rarely waits for the consumer
+    static constexpr size_t kRingBytes = 16u << 20;
+
+    DecodeWorkerPool() = default;
+
+    std::unique_ptr<Worker> acquire();
+    void release(std::unique_ptr<Worker> worker);
+
+    std::mutex lock;
+    std::vector<std::unique_ptr<Worker>> idle;
+
+    static inline std::mutex instanceLock;
+    static inline DecodeWorkerPool* instance = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecodeWorkerPool)
+};
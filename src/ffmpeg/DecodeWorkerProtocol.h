@@ -0,0 +1,70 @@
+/*
+    ChannelStacker - Decode Worker Protocol
+    Messages between the app and the resident decode worker. Jobs go to the
+    worker's stdin as one tab-separated line each (the path last, so it may
+    contain anything but a newline):
+
+        probe   <path>
+        decode  <audio stream> <start seconds> <length seconds, 0 = to the end> <path>
+
+    Replies come back on stdout as messages of a header and a payload. A
+    probe answers with one ProbeJson (the JSON "ffprobe -select_streams a
+    -show_streams -of json" prints) or one Error. A decode answers with a
+    Format, any number of Samples (interleaved float frames) and Done, or
+    an Error at any point. The worker handles one job at a time and exits
+    when stdin closes.
+
+    Started with kSharedRingArgument (Linux), the worker also has a
+    SharedRing on fds 3 (memory) and 4 (eventfd). Decoded samples then go
+    into the ring and each batch is announced by a RingSamples message
+    instead, so the pipe carries 16 bytes per batch rather than the audio.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace DecodeWorkerProtocol
+{
+    enum class MessageType : uint32_t
+    {
+        ProbeJson = 1,    // UTF-8 JSON
+        Format = 2,       // FormatPayload
+        Samples = 3,      // float32 frames, all channels interleaved
+        Done = 4,         // No payload
+        Error = 5,        // UTF-8 message
+        RingSamples = 6   // RingSpan: as Samples, but the floats are in the ring
+    };
+
+    // Both sides run on the same machine, so native byte order throughout
+    struct MessageHeader
+    {
+        MessageType type;
+        uint32_t payloadBytes;
+    };
+
+    struct FormatPayload
+    {
+        int32_t numChannels;
+        int32_t sampleRate;
+    };
+
+    // Where a RingSamples batch is; release endPosition once it is consumed
+    struct RingSpan
+    {
+        uint64_t endPosition;
+        uint32_t numBytes;
+        uint32_t reserved;
+    };
+
+    // Samples (frames x channels) per Samples message: about 1 MB, so
+    // consumers get batches worth waking up for
+    constexpr int kSamplesPerMessage = 1 << 18;
+
+    // Name of the helper executable, next to the app's own
+    constexpr const char* kExecutableName = "ChannelStackerDecodeWorker";
+
+    constexpr const char* kSharedRingArgument = "--shared-ring";
+    constexpr int kRingMemoryFd = 3;
+    constexpr int kRingSignalFd = 4;
+}
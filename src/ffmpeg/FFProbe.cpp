@@ -3,6 +3,9 @@
 */
 
 #include "FFProbe.h"
+#include "../async/AsyncPrimitives.h"
+#include "../async/SpawnedProcess.h"
+#include "DecodeWorker.h"
 
 FFProbe::FFProbe(FFmpegLocator& loc)
     : locator(loc)
@@ -13,6 +16,12 @@ ProbeResult FFProbe::getAudioStreams(const juce::File& file)
 {
     ProbeResult result;
 
+    // The resident worker answers without launching a process
+    juce::String workerOutput;
+    if (DecodeWorkerPool::isAvailable() && file.existsAsFile()
+        && DecodeWorkerPool::getInstance().probe(file, workerOutput))
+        return parseJsonOutput(workerOutput);
+
     if (!locator.isFFprobeAvailable())
     {
         result.errorMessage = "ffprobe not found. Please install FFmpeg.";
@@ -25,20 +34,9 @@ ProbeResult FFProbe::getAudioStreams(const juce::File& file)
         return result;
     }
 
-    // Build ffprobe command
-    // ffprobe -v error -select_streams a -show_streams -of json <file>
-    juce::StringArray args;
-    args.add(locator.getFFprobePath().getFullPathName());
-    args.add("-v");
-    args.add("error");
-    args.add("-select_streams");
-    args.add("a");
-    args.add("-show_streams");
-    args.add("-of");
-    args.add("json");
-    args.add(file.getFullPathName());
+    auto args = buildArguments(file);
 
-    juce::ChildProcess process;
+    SpawnedProcess process;
     if (!process.start(args))
     {
         result.errorMessage = "Failed to start ffprobe process";
@@ -61,6 +59,87 @@ ProbeResult FFProbe::getAudioStreams(const juce::File& file)
     return parseJsonOutput(output);
 }
 
+Task<ProbeResult> FFProbe::probeAsync(juce::File file, CancellationToken token)
+{
+    ProbeResult result;
+
+    if (DecodeWorkerPool::isAvailable() && file.existsAsFile())
+    {
+        co_await probeThreads.schedule();
+        juce::String workerOutput;
+        const bool probed = DecodeWorkerPool::getInstance().probe(file, workerOutput);
+        co_await resumeOnMessageThread();
+
+        if (token.isCancelled())
+        {
+            result.errorMessage = "Cancelled";
+            co_return result;
+        }
+
+        if (probed)
+            co_return parseJsonOutput(workerOutput);
+    }
+
+    if (!locator.isFFprobeAvailable())
+    {
+        result.errorMessage = "ffprobe not found. Please install FFmpeg.";
+        co_return result;
+    }
+
+    if (!file.existsAsFile())
+    {
+        result.errorMessage = "File not found: " + file.getFullPathName();
+        co_return result;
+    }
+
+    // ffprobe writes the JSON to a temp file; the exit is picked up by the
+    // process poller, so nothing blocks while it runs
+    juce::TemporaryFile jsonFile(".json");
+    auto args = buildArguments(file);
+    args.insert(args.size() - 1, "-o");
+    args.insert(args.size() - 1, jsonFile.getFile().getFullPathName());
+
+    auto process = co_await ChildProcessAwaiter(args, token);
+
+    if (process.cancelled)
+    {
+        result.errorMessage = "Cancelled";
+        co_return result;
+    }
+
+    if (!process.started)
+    {
+        result.errorMessage = "Failed to start ffprobe process";
+        co_return result;
+    }
+
+    juce::String output = jsonFile.getFile().loadFileAsString();
+
+    if (process.exitCode != 0)
+    {
+        result.errorMessage = "ffprobe returned error code " + juce::String(process.exitCode);
+        co_return result;
+    }
+
+    co_return parseJsonOutput(output);
+}
+
+juce::StringArray FFProbe::buildArguments(const juce::File& file) const
+{
+    // ffprobe -v error -select_streams a -show_streams -of json <file>
+    juce::StringArray args;
+    args.add(locator.getFFprobePath().getFullPathName());
+    args.add("-v");
+    args.add("error");
+    args.add("-select_streams");
+    args.add("a");
+    args.add("-show_streams");
+    args.add("-of");
+    args.add("json");
+    args.add(file.getFullPathName());
+    return args;
+}
+
 ProbeResult FFProbe::parseJsonOutput(const juce::String& jsonOutput)
 {
     ProbeResult result;
@@ -114,6 +193,10 @@ ProbeResult FFProbe::parseJsonOutput(const juce::String& jsonOutput)
         // Get codec name
         info.codec = streamObj->getProperty("codec_name").toString();
 
+        // Get decoded sample format and its significant bits
+        info.sampleFormat = streamObj->getProperty("sample_fmt").toString();
+        info.bitsPerRawSample = streamObj->getProperty("bits_per_raw_sample").toString().getIntValue();
+
         // Get channel layout
         info.channelLayout = streamObj->getProperty("channel_layout").toString();
 
@@ -7,6 +7,7 @@
 
 #include <juce_core/juce_core.h>
 #include "FFmpegLocator.h"
+#include "../async/AsyncPrimitives.h"
 #include <vector>
 
 // Audio stream metadata
@@ -16,6 +17,8 @@ struct AudioStreamInfo
     int channels = 0;
     double sampleRate = 0.0;
     juce::String codec;
+    juce::String sampleFormat;      // ffmpeg sample_fmt, e.g. "s16", "fltp"
+    int bitsPerRawSample = 0;       // Significant bits when known (e.g. 24 in s32)
     juce::String channelLayout;
     double duration = 0.0;  // In seconds, may be 0 if unknown
     int64_t bitRate = 0;
@@ -35,14 +38,21 @@ public:
     explicit FFProbe(FFmpegLocator& locator);
     ~FFProbe() = default;
 
-    // Probe a file for audio streams
-    // This is a blocking call - run from background thread
+    // Probe a file for audio streams, through the resident decode worker
+    // when it is installed. This is a blocking call - run from background thread
     ProbeResult getAudioStreams(const juce::File& file);
 
+    // Same probe as a coroutine; call and resume on the message thread
+    Task<ProbeResult> probeAsync(juce::File file, CancellationToken token);
+
 private:
+    juce::StringArray buildArguments(const juce::File& file) const;
     ProbeResult parseJsonOutput(const juce::String& jsonOutput);
 
     FFmpegLocator& locator;
 
+    // Worker probes block on a pipe, so the coroutine waits for them here
+    WorkerPool probeThreads{ 2 };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FFProbe)
 };
@@ -3,6 +3,7 @@
 */
 
 #include "FFmpegLocator.h"
+#include "../async/SpawnedProcess.h"
 
 FFmpegLocator::FFmpegLocator()
 {
@@ -107,7 +108,7 @@ juce::String FFmpegLocator::getFFmpegVersion() const
     if (!isFFmpegAvailable())
         return {};
 
-    juce::ChildProcess process;
+    SpawnedProcess process;
     juce::StringArray args;
     args.add(ffmpegPath.getFullPathName());
     args.add("-version");
@@ -131,7 +132,7 @@ juce::String FFmpegLocator::getFFprobeVersion() const
     if (!isFFprobeAvailable())
         return {};
 
-    juce::ChildProcess process;
+    SpawnedProcess process;
     juce::StringArray args;
     args.add(ffprobePath.getFullPathName());
     args.add("-version");
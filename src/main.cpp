@@ -6,6 +6,75 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "MainWindow.h"
 #include "ui/Mach1LookAndFeel.h"
+#include "async/SpawnedProcess.h"
+#include "audio/BlockCache.h"
+#include "audio/DitherConverter.h"
+#include "audio/FlacFileWriter.h"
+#include "audio/ProxyCache.h"
+#include "audio/SampleKernels.h"
+#include "ffmpeg/FFmpegLocator.h"
+#include <iostream>
+
+namespace
+{
+    // The unit tests defined alongside the code they cover (category
+    // "ChannelStacker"); a failure sets a non-zero exit code
+    juce::String runUnitTests()
+    {
+        struct Runner : juce::UnitTestRunner
+        {
+            juce::String report;
+            void logMessage(const juce::String& message) override { report << message << "\n"; }
+        };
+
+        Runner runner;
+        runner.setAssertOnFailure(false);
+        runner.runTestsInCategory("ChannelStacker");
+
+        int failures = 0;
+        for (int i = 0; i < runner.getNumResults(); ++i)
+            failures += runner.getResult(i)->failures;
+
+        if (failures > 0)
+            juce::JUCEApplication::getInstance()->setApplicationReturnValue(1);
+
+        return runner.report + (failures > 0 ? juce::String(failures) + " failures\n" : juce::String("All tests passed\n"));
+    }
+
+    struct HeadlessDiagnostic
+    {
+        const char* flag;
+        juce::String (*run)();
+    };
+
+    const HeadlessDiagnostic headlessDiagnostics[] = {
+        { "--run-tests", runUnitTests },
+
+        // How launch time scales with the app's resident size
+        { "--benchmark-spawn", []() { return SpawnedProcess::runSpawnBenchmark({ 0, 512, 2048, 4096 }, 50); } },
+
+        // Shared block cache against direct reads of NAS-like storage
+        { "--benchmark-block-cache", []() { return BlockCache::runBenchmark(5, 200.0, 128); } },
+
+        // Proxy codec size and decode speed at 128 channels
+        { "--benchmark-proxy-codec", []() { return ProxyCache::runCodecBenchmark(128); } },
+
+        // Export dither throughput at 128 channels
+        { "--benchmark-dither", []() { return DitherConverter::runBenchmark(128); } },
+
+        // In-process FLAC writer against ffmpeg's encoder on one thread
+        { "--benchmark-flac", []() { return FlacFileWriter::runBenchmark(FFmpegLocator().getFFmpegPath(), 20.0); } },
+
+        // Channel-count-specialised decode kernels against the generic path
+        { "--benchmark-kernels", []() { return SampleKernels::runBenchmark(); } },
+
+        // Multichannel export throughput from 32 to 256 channels
+        { "--benchmark-gather", []()
+          {
+              return MainComponent::runGatherBenchmark(FFmpegLocator().getFFmpegPath(), { 32, 64, 128, 256 }, 20.0);
+          } },
+    };
+}
 
 class ChannelStackerApplication : public juce::JUCEApplication
 {
@@ -27,8 +96,19 @@ public:
         return true;
     }
 
-    void initialise(const juce::String& /*commandLine*/) override
+    void initialise(const juce::String& commandLine) override
     {
+        // Headless diagnostics print a report and exit without a window
+        for (const auto& diagnostic : headlessDiagnostics)
+        {
+            if (commandLine.contains(diagnostic.flag))
+            {
+                std::cout << diagnostic.run() << std::flush;
+                quit();
+                return;
+            }
+        }
+
         // Set custom look and feel
         customLookAndFeel = std::make_unique<Mach1LookAndFeel>();
         juce::LookAndFeel::setDefaultLookAndFeel(customLookAndFeel.get());
@@ -0,0 +1,133 @@
+/*
+    ChannelStacker - Export Manifest Implementation
+*/
+
+#include "ExportManifest.h"
+
+ExportManifest::ExportManifest(const juce::File& outputDirectory)
+    : manifestFile(outputDirectory.getChildFile(kFileName))
+{
+    load();
+}
+
+juce::String ExportManifest::fingerprint(const juce::StringArray& recipe, const juce::Array<juce::File>& sources,
+                                         const juce::String& toolVersion)
+{
+    // Canonical text of everything that affects the output, then a 64-bit
+    // hash of it. Fields are newline-separated so values can't run together.
+    juce::String canonical = "tool:" + toolVersion + "\n";
+
+    for (const auto& source : sources)
+    {
+        canonical << "source:" << source.getFullPathName()
+                  << ":" << juce::String(source.getSize())
+                  << ":" << juce::String(source.getLastModificationTime().toMilliseconds()) << "\n";
+    }
+
+    for (const auto& part : recipe)
+        canonical << "arg:" << part << "\n";
+
+    return juce::String::toHexString(canonical.hashCode64()).paddedLeft('0', 16);
+}
+
+bool ExportManifest::isUpToDate(const juce::File& output, const juce::String& outputFingerprint) const
+{
+    if (!output.existsAsFile())
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(output.getFileName());
+    if (it == entries.end())
+        return false;
+
+    // A file edited or replaced since the export no longer counts
+    const auto& entry = it->second;
+    return entry.record.fingerprint == outputFingerprint
+        && entry.size == output.getSize()
+        && entry.modified == output.getLastModificationTime().toMilliseconds();
+}
+
+void ExportManifest::record(const juce::File& output, const OutputRecord& outputRecord)
+{
+    Entry entry;
+    entry.record = outputRecord;
+    entry.size = output.getSize();
+    entry.modified = output.getLastModificationTime().toMilliseconds();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[output.getFileName()] = entry;
+    saveLocked();
+}
+
+void ExportManifest::remove(const juce::File& output)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.erase(output.getFileName()) > 0)
+        saveLocked();
+}
+
+void ExportManifest::load()
+{
+    if (!manifestFile.existsAsFile())
+        return;
+
+    auto parsed = juce::JSON::parse(manifestFile.loadFileAsString());
+    auto* outputs = parsed["outputs"].getArray();
+    if (outputs == nullptr)
+        return;
+
+    for (const auto& item : *outputs)
+    {
+        auto* obj = item.getDynamicObject();
+        if (obj == nullptr)
+            continue;
+
+        Entry entry;
+        entry.size = static_cast<juce::int64>(obj->getProperty("size"));
+        entry.modified = static_cast<juce::int64>(obj->getProperty("modified"));
+
+        auto& record = entry.record;
+        record.fingerprint = obj->getProperty("fingerprint").toString();
+        record.xxh64 = obj->getProperty("xxh64").toString();
+        record.md5 = obj->getProperty("md5").toString();
+        record.durationSeconds = static_cast<double>(obj->getProperty("durationSeconds"));
+        record.wallSeconds = static_cast<double>(obj->getProperty("wallSeconds"));
+        record.cpuSeconds = static_cast<double>(obj->getProperty("cpuSeconds"));
+        if (auto* channels = obj->getProperty("channels").getArray())
+            for (const auto& channel : *channels)
+                record.channelMap.add(channel.toString());
+
+        entries[obj->getProperty("file").toString()] = entry;
+    }
+}
+
+void ExportManifest::saveLocked() const
+{
+    // An array sorted by file name keeps the file stable and diffable
+    juce::var outputs;
+    for (const auto& [name, entry] : entries)
+    {
+        const auto& record = entry.record;
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("file", name);
+        obj->setProperty("size", entry.size);
+        obj->setProperty("xxh64", record.xxh64);
+        obj->setProperty("md5", record.md5);
+        obj->setProperty("channels", juce::var(record.channelMap));
+        obj->setProperty("durationSeconds", record.durationSeconds);
+        obj->setProperty("wallSeconds", record.wallSeconds);
+        obj->setProperty("cpuSeconds", record.cpuSeconds);
+        obj->setProperty("fingerprint", record.fingerprint);
+        obj->setProperty("modified", entry.modified);
+        outputs.append(juce::var(obj));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("version", 1);
+    root->setProperty("outputs", outputs);
+
+    // Write-then-rename so a crash never leaves a half-written manifest
+    juce::TemporaryFile temp(manifestFile);
+    if (temp.getFile().replaceWithText(juce::JSON::toString(juce::var(root))))
+        temp.overwriteTargetFileWithTemporary();
+}
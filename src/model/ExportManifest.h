@@ -0,0 +1,71 @@
+/*
+    ChannelStacker - Export Manifest Header
+    JSON manifest in an export directory describing each output: size,
+    checksums, channel map, duration and how long it took to make. It also
+    records a fingerprint of what produced each output, so a re-export only
+    rewrites outputs whose sources, channel selection, settings or tools
+    have changed.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <map>
+#include <mutex>
+
+class ExportManifest
+{
+public:
+    // Loads the manifest for outputs in this directory (empty if none yet)
+    explicit ExportManifest(const juce::File& outputDirectory);
+
+    static constexpr const char* kFileName = "channelstacker-manifest.json";
+
+    // Everything known about an output when it has been written
+    struct OutputRecord
+    {
+        juce::String fingerprint;
+        juce::String xxh64;               // Empty if not computed
+        juce::String md5;
+        juce::StringArray channelMap;     // Source of each output channel, in order
+        double durationSeconds = 0.0;
+        double wallSeconds = 0.0;
+        double cpuSeconds = 0.0;          // ffmpeg plus our threads that wrote it (shared by channel
+                                          // count between files written together; ffmpeg's part is
+                                          // missing on Windows)
+    };
+
+    // Deterministic fingerprint of one output. 'recipe' is everything that
+    // shapes the audio (the ffmpeg arguments plus anything applied after
+    // them); sources are identified by path, size and modification time.
+    static juce::String fingerprint(const juce::StringArray& recipe, const juce::Array<juce::File>& sources,
+                                    const juce::String& toolVersion);
+
+    // True if the output exists, is the file we last wrote (size and
+    // modification time) and was made with this fingerprint
+    bool isUpToDate(const juce::File& output, const juce::String& outputFingerprint) const;
+
+    // Record a successfully written output and save the manifest. Thread-safe;
+    // saving per output means an interrupted batch keeps what it finished.
+    void record(const juce::File& output, const OutputRecord& outputRecord);
+
+    // Forget an output (e.g. its export failed) and save
+    void remove(const juce::File& output);
+
+private:
+    struct Entry
+    {
+        OutputRecord record;
+        juce::int64 size = 0;
+        juce::int64 modified = 0;
+    };
+
+    void load();
+    void saveLocked() const;
+
+    juce::File manifestFile;
+    mutable std::mutex mutex;
+    std::map<juce::String, Entry> entries;   // Keyed by output file name
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ExportManifest)
+};
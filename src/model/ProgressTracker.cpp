@@ -0,0 +1,246 @@
+/*
+    ChannelStacker - Progress Tracker Implementation
+*/
+
+#include "ProgressTracker.h"
+#include <algorithm>
+#include <cmath>
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <time.h>
+#endif
+
+namespace
+{
+    int64_t toMs(double seconds)
+    {
+        return std::isfinite(seconds) && seconds > 0.0 ? static_cast<int64_t>(seconds * 1000.0) : 0;
+    }
+
+    int sum(const std::array<int, ProgressTracker::kNumKinds>& counts)
+    {
+        int total = 0;
+        for (int c : counts)
+            total += c;
+        return total;
+    }
+
+    juce::String formatDuration(double seconds)
+    {
+        auto total = static_cast<int>(std::ceil(seconds));
+        return juce::String(total / 60) + ":" + juce::String(total % 60).paddedLeft('0', 2);
+    }
+}
+
+//==============================================================================
+// Job
+//==============================================================================
+
+void ProgressTracker::Job::addProgress(double seconds) noexcept
+{
+    doneMs.fetch_add(toMs(seconds), std::memory_order_relaxed);
+}
+
+void ProgressTracker::Job::setTotal(double seconds) noexcept
+{
+    totalMs.store(toMs(seconds), std::memory_order_relaxed);
+}
+
+void ProgressTracker::Job::finish(bool succeeded, const juce::String& finishMessage)
+{
+    // Only the first caller writes the message; later ones would race it
+    if (finishing.exchange(true))
+        return;
+
+    message = finishMessage;
+    finishTime = juce::Time::getMillisecondCounter();
+
+    // A finished job counts as complete however far its counter got
+    auto total = totalMs.load(std::memory_order_relaxed);
+    if (total > 0)
+        doneMs.store(total, std::memory_order_relaxed);
+
+    state.store(succeeded ? Succeeded : Failed, std::memory_order_release);
+}
+
+//==============================================================================
+// Snapshot
+//==============================================================================
+
+int ProgressTracker::Snapshot::getNumRunning() const
+{
+    return sum(running);
+}
+
+int ProgressTracker::Snapshot::getNumJobs() const
+{
+    return sum(running) + sum(succeeded) + sum(failed);
+}
+
+double ProgressTracker::Snapshot::getFraction() const
+{
+    if (totalSeconds <= 0.0)
+        return -1.0;
+    return juce::jlimit(0.0, 1.0, doneSeconds / totalSeconds);
+}
+
+double ProgressTracker::Snapshot::getThroughput() const
+{
+    return elapsedSeconds > 0.0 ? doneSeconds / elapsedSeconds : 0.0;
+}
+
+double ProgressTracker::Snapshot::getEtaSeconds() const
+{
+    auto rate = getThroughput();
+    if (totalSeconds <= 0.0 || rate <= 0.0)
+        return -1.0;
+    return std::max(0.0, totalSeconds - doneSeconds) / rate;
+}
+
+//==============================================================================
+// ProgressTracker
+//==============================================================================
+
+ProgressTracker::~ProgressTracker()
+{
+    cancelPendingUpdate();
+}
+
+ProgressTracker::JobHandle ProgressTracker::startJob(JobKind kind, const juce::String& name, double totalSeconds)
+{
+    JobHandle job(new Job(kind, name));
+    job->setTotal(totalSeconds);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Nothing running means the previous batch is over; start a new one
+        bool idle = std::none_of(jobs.begin(), jobs.end(),
+                                 [](const JobHandle& j) { return j->state.load() == Job::Running; });
+        if (idle)
+        {
+            jobs.clear();
+            batchStartTime = juce::Time::getMillisecondCounter();
+        }
+
+        jobs.push_back(job);
+    }
+
+    triggerAsyncUpdate();
+    return job;
+}
+
+ProgressTracker::Snapshot ProgressTracker::sample() const
+{
+    Snapshot snapshot;
+    juce::uint32 lastFinish = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const auto& job : jobs)
+    {
+        auto kind = static_cast<size_t>(job->kind);
+        auto state = job->state.load(std::memory_order_acquire);
+
+        if (state == Job::Running)
+            ++snapshot.running[kind];
+        else if (state == Job::Succeeded)
+            ++snapshot.succeeded[kind];
+        else
+            ++snapshot.failed[kind];
+
+        snapshot.doneSeconds += static_cast<double>(job->doneMs.load(std::memory_order_relaxed)) / 1000.0;
+        snapshot.totalSeconds += static_cast<double>(job->totalMs.load(std::memory_order_relaxed)) / 1000.0;
+
+        if (state != Job::Running && job->finishTime >= lastFinish)
+        {
+            lastFinish = job->finishTime;
+            snapshot.lastMessage = job->message;
+        }
+    }
+
+    if (!jobs.empty())
+        snapshot.elapsedSeconds = (juce::Time::getMillisecondCounter() - batchStartTime) / 1000.0;
+
+    return snapshot;
+}
+
+juce::String ProgressTracker::describe(const Snapshot& snapshot)
+{
+    static const char* const activeVerbs[] = { "Decoding for playback", "Probing", "Extracting waveforms", "Measuring loudness",
+                                               "Verifying", "Exporting" };
+    static const char* const doneVerbs[] = { "Decoded for playback", "Probed", "Extracted waveforms for", "Measured loudness of",
+                                             "Verified", "Exported" };
+    static const char* const nouns[] = { "stream(s)", "file(s)", "stream(s)", "stream(s)", "file(s)", "file(s)" };
+
+    // The batch is named after its most significant kind of job
+    int kind = kNumKinds - 1;
+    while (kind > 0 && snapshot.running[static_cast<size_t>(kind)] + snapshot.succeeded[static_cast<size_t>(kind)]
+                       + snapshot.failed[static_cast<size_t>(kind)] == 0)
+        --kind;
+
+    const auto k = static_cast<size_t>(kind);
+    const int kindTotal = snapshot.running[k] + snapshot.succeeded[k] + snapshot.failed[k];
+    const int kindDone = snapshot.succeeded[k] + snapshot.failed[k];
+
+    if (!snapshot.isActive())
+    {
+        if (snapshot.getNumJobs() == 1 && snapshot.lastMessage.isNotEmpty())
+            return snapshot.lastMessage;
+
+        juce::String text = juce::String(doneVerbs[k]) + " " + juce::String(snapshot.succeeded[k]) + " " + nouns[k];
+        int failures = sum(snapshot.failed);
+        if (failures > 0)
+            text += " - " + juce::String(failures) + " failed (see log)";
+        return text;
+    }
+
+    juce::String text = activeVerbs[k];
+    if (kindTotal > 1)
+        text += " " + juce::String(kindDone + 1) + " of " + juce::String(kindTotal);
+
+    auto fraction = snapshot.getFraction();
+    if (fraction >= 0.0)
+        text += " - " + juce::String(juce::roundToInt(fraction * 100.0)) + "%";
+
+    auto throughput = snapshot.getThroughput();
+    if (throughput > 0.0)
+        text += " - " + juce::String(throughput, 1) + "x realtime";
+
+    auto eta = snapshot.getEtaSeconds();
+    if (eta >= 0.0 && snapshot.doneSeconds > 0.0)
+        text += " - ETA " + formatDuration(eta);
+
+    return text;
+}
+
+double ProgressTracker::getThreadCpuSeconds()
+{
+   #if JUCE_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return 0.0;
+
+    auto ticks = [](const FILETIME& t)
+    {
+        return static_cast<double>((static_cast<juce::uint64>(t.dwHighDateTime) << 32) | t.dwLowDateTime);
+    };
+    return (ticks(kernel) + ticks(user)) * 1.0e-7;    // 100 ns units
+   #else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0.0;
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1.0e-9;
+   #endif
+}
+
+void ProgressTracker::handleAsyncUpdate()
+{
+    if (onJobsStarted)
+        onJobsStarted();
+}
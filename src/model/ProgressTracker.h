@@ -0,0 +1,111 @@
+/*
+    ChannelStacker - Progress Tracker Header
+    One place that knows about every running probe, extraction, decode and
+    export, and the player's full decodes. Proxy generation and pre-roll
+    decodes are background work and stay out of it. Workers bump atomic counters on their job; the UI samples the
+    whole set at a fixed rate instead of receiving a message per update.
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ProgressTracker : private juce::AsyncUpdater
+{
+public:
+    // In order of significance: a batch is named after its highest kind
+    enum class JobKind { Playback, Probe, Extract, Decode, Verify, Export };
+    static constexpr int kNumKinds = 6;
+
+    // Progress is measured in seconds of source audio, so jobs over
+    // different sample rates and channel counts add up meaningfully
+    class Job
+    {
+    public:
+        // Thread-safe; called from the worker doing the job
+        void addProgress(double seconds) noexcept;
+        void setTotal(double seconds) noexcept;
+
+        // Mark the job done. The message is shown when it ends a batch on its own.
+        void finish(bool succeeded, const juce::String& message = {});
+
+        JobKind getKind() const noexcept { return kind; }
+        const juce::String& getName() const noexcept { return name; }
+
+    private:
+        friend class ProgressTracker;
+
+        enum State { Running, Succeeded, Failed };
+
+        Job(JobKind k, juce::String n) : kind(k), name(std::move(n)) {}
+
+        const JobKind kind;
+        const juce::String name;
+        std::atomic<int64_t> doneMs{ 0 };
+        std::atomic<int64_t> totalMs{ 0 };
+        std::atomic<int> state{ Running };
+        std::atomic<bool> finishing{ false };   // Claimed by the first finish()
+
+        // Written once by finish(), read after state is published
+        juce::String message;
+        std::atomic<juce::uint32> finishTime{ 0 };
+    };
+
+    using JobHandle = std::shared_ptr<Job>;
+
+    // State of the current batch - every job since the tracker was last idle
+    struct Snapshot
+    {
+        std::array<int, kNumKinds> running{};
+        std::array<int, kNumKinds> succeeded{};
+        std::array<int, kNumKinds> failed{};
+        double doneSeconds = 0.0;
+        double totalSeconds = 0.0;
+        double elapsedSeconds = 0.0;
+        juce::String lastMessage;     // From the most recently finished job
+
+        int getNumRunning() const;
+        int getNumJobs() const;
+        bool isActive() const { return getNumRunning() > 0; }
+
+        double getFraction() const;      // 0..1, or -1 if the total is unknown
+        double getThroughput() const;    // Seconds of audio per second (x realtime)
+        double getEtaSeconds() const;    // -1 if unknown
+    };
+
+    ProgressTracker() = default;
+    ~ProgressTracker() override;
+
+    // Register a job (any thread). totalSeconds may be 0 if unknown.
+    JobHandle startJob(JobKind kind, const juce::String& name, double totalSeconds);
+
+    // Consistent view of all jobs in the batch (any thread; cheap)
+    Snapshot sample() const;
+
+    // "Exporting 3 of 128 - 42% - 35x realtime - ETA 0:12", or a summary
+    // of the finished batch
+    static juce::String describe(const Snapshot& snapshot);
+
+    // CPU time used so far by the calling thread (for per-job timings)
+    static double getThreadCpuSeconds();
+
+    // Called on the message thread (coalesced) when jobs start, so the UI
+    // can start sampling
+    std::function<void()> onJobsStarted;
+
+private:
+    void handleAsyncUpdate() override;
+
+    mutable std::mutex mutex;
+    std::vector<JobHandle> jobs;
+    juce::uint32 batchStartTime = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProgressTracker)
+};
@@ -3,6 +3,7 @@
 */
 
 #include "ProjectModel.h"
+#include <limits>
 
 // Debug logging macro - prints to stderr which shows in Xcode console
 #define DEBUG_LOG(msg) DBG(msg)
@@ -27,6 +28,8 @@ void ProjectModel::removeLane(int index)
     }
 
     DEBUG_LOG("ProjectModel::removeLane - removing index " << index);
+    Lane* lanePtr = lanes[static_cast<size_t>(index)].get();
+    listeners.call([lanePtr](Listener& l) { l.laneAboutToBeRemoved(lanePtr); });
     lanes.erase(lanes.begin() + index);
     listeners.call([index](Listener& l) { l.laneRemoved(index); });
 }
@@ -92,6 +95,8 @@ void ProjectModel::clearAllLanes()
 {
     while (!lanes.empty())
     {
+        Lane* lanePtr = lanes.back().get();
+        listeners.call([lanePtr](Listener& l) { l.laneAboutToBeRemoved(lanePtr); });
         lanes.pop_back();
         listeners.call([this](Listener& l)
         {
@@ -133,6 +138,16 @@ int ProjectModel::indexOfLane(Lane* lane) const
     return -1;
 }
 
+Lane* ProjectModel::findLane(const juce::Uuid& uuid) const
+{
+    for (const auto& lane : lanes)
+    {
+        if (lane->uuid == uuid)
+            return lane.get();
+    }
+    return nullptr;
+}
+
 void ProjectModel::addListener(Listener* listener)
 {
     listeners.add(listener);
@@ -147,3 +162,18 @@ void ProjectModel::notifyWaveformUpdated(Lane* lane)
 {
     listeners.call([lane](Listener& l) { l.laneWaveformUpdated(lane); });
 }
+
+void ProjectModel::setLaneEdit(Lane* lane, double offset, double inPoint, double outPoint)
+{
+    if (lane == nullptr)
+        return;
+
+    const double end = lane->duration > 0.0 ? lane->duration : std::numeric_limits<double>::max();
+    lane->offset = std::max(0.0, offset);
+    lane->inPoint = juce::jlimit(0.0, end, inPoint);
+
+    // An out-point at or past the end is the same as none
+    lane->outPoint = outPoint > lane->inPoint && outPoint < end ? outPoint : 0.0;
+
+    listeners.call([lane](Listener& l) { l.laneEdited(lane); });
+}
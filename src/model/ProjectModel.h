@@ -7,6 +7,8 @@
 
 #include <juce_core/juce_core.h>
 #include <juce_data_structures/juce_data_structures.h>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <memory>
 
@@ -19,6 +21,48 @@ struct WaveformEnvelope
     bool isReady = false;
 };
 
+// Low-rate copy of a channel for inter-channel analysis (correlation etc.)
+// Produced by the waveform extraction pass; immutable once published
+struct DecimatedSignal
+{
+    std::vector<float> samples;
+    double sampleRate = 0.0;      // Rate of the decimated samples
+
+    // RMS level over the whole source, for lining sources up: it covers
+    // far longer sources than 'samples' does
+    std::vector<float> envelope;
+    double envelopeRate = 0.0;
+};
+
+// EBU R128 / BS.1770 figures for a lane or an export output
+struct LoudnessSummary
+{
+    double integratedLufs = -INFINITY;
+    double loudnessRange = 0.0;      // LU
+    double maxMomentaryLufs = -INFINITY;
+    double maxShortTermLufs = -INFINITY;
+    double truePeakDbtp = -INFINITY;
+    double samplePeakDbfs = -INFINITY;
+    bool isValid = false;
+};
+
+// Per-channel loudness measurement from the extraction pass. The 100 ms
+// block energies are kept so outputs that combine several lanes can be
+// measured later without decoding anything again.
+struct LoudnessData
+{
+    std::vector<float> blockEnergies;  // K-weighted mean square per 100 ms block
+    float samplePeak = 0.0f;           // Linear
+    float truePeak = 0.0f;             // Linear, 4x oversampled
+
+    // Peaks of the same blocks, so an edited lane's peaks can be measured;
+    // one longer than blockEnergies when the audio ended mid-block
+    std::vector<float> blockSamplePeaks;
+    std::vector<float> blockTruePeaks;
+
+    LoudnessSummary summary;
+};
+
 // Represents a single audio lane/channel
 struct Lane
 {
@@ -27,9 +71,29 @@ struct Lane
     int channelIndex = 0;         // Channel within the stream
     int totalChannels = 1;        // Total channels in the stream
     double sampleRate = 44100.0;
+    double duration = 0.0;        // Stream duration in seconds, 0 if unknown
+    juce::String sampleFormat;    // ffprobe sample_fmt of the stream
+    int bitsPerRawSample = 0;
     juce::String displayName;
 
+    // Non-destructive edit, in seconds: the lane plays source time
+    // [inPoint, outPoint) starting 'offset' into the output
+    double offset = 0.0;
+    double inPoint = 0.0;
+    double outPoint = 0.0;        // 0 = to the end of the source
+
+    bool hasEdit() const { return offset > 0.0 || inPoint > 0.0 || outPoint > 0.0; }
+    double getSourceEnd() const { return outPoint > 0.0 ? outPoint : duration; }
+
+    // Length in the output including the offset, 0 if unknown
+    double getEditedDuration() const
+    {
+        return getSourceEnd() > 0.0 ? offset + std::max(0.0, getSourceEnd() - inPoint) : 0.0;
+    }
+
     WaveformEnvelope waveform;
+    std::shared_ptr<const DecimatedSignal> analysisSignal;
+    std::shared_ptr<const LoudnessData> loudness;
 
     // Unique ID for tracking
     juce::Uuid uuid;
@@ -45,9 +109,11 @@ public:
     public:
         virtual ~Listener() = default;
         virtual void laneAdded(Lane* lane, int index) = 0;
+        virtual void laneAboutToBeRemoved(Lane* /*lane*/) {}   // Still in the model
         virtual void laneRemoved(int index) = 0;
         virtual void lanesReordered() = 0;
         virtual void laneWaveformUpdated(Lane* lane) = 0;
+        virtual void laneEdited(Lane* lane) = 0;
     };
 
     ProjectModel() = default;
@@ -66,6 +132,7 @@ public:
     const Lane* getLane(int index) const;
     std::vector<Lane*> getLanes();
     int indexOfLane(Lane* lane) const;
+    Lane* findLane(const juce::Uuid& uuid) const;  // nullptr once removed
 
     // Listener management
     void addListener(Listener* listener);
@@ -74,6 +141,9 @@ public:
     // Notification helper (called by waveform extractor)
     void notifyWaveformUpdated(Lane* lane);
 
+    // Set a lane's offset and trims, clamped to its source
+    void setLaneEdit(Lane* lane, double offset, double inPoint, double outPoint);
+
 private:
     std::vector<std::unique_ptr<Lane>> lanes;
     juce::ListenerList<Listener> listeners;
@@ -4,6 +4,7 @@
 
 #include "LaneComponent.h"
 #include "Mach1LookAndFeel.h"
+#include <cmath>
 
 LaneComponent::LaneComponent(Lane* lane, int displayIndex)
     : laneData(lane), currentDisplayIndex(displayIndex)
@@ -54,12 +55,33 @@ void LaneComponent::updateLabels()
                           + "/" + juce::String(laneData->totalChannels);
         if (laneData->sampleRate > 0)
             info += " @ " + juce::String(laneData->sampleRate / 1000.0, 1) + "kHz";
+        if (laneData->loudness != nullptr && laneData->loudness->summary.isValid)
+        {
+            const auto& summary = laneData->loudness->summary;
+            if (std::isfinite(summary.integratedLufs))
+                info += " | " + juce::String(summary.integratedLufs, 1) + " LUFS";
+            if (std::isfinite(summary.truePeakDbtp))
+                info += ", " + juce::String(summary.truePeakDbtp, 1) + " dBTP";
+        }
+        if (laneData->inPoint > 0.0 || laneData->outPoint > 0.0)
+            info += " | Trim " + juce::String(laneData->inPoint, 2) + "-"
+                  + (laneData->outPoint > 0.0 ? juce::String(laneData->outPoint, 2) + "s" : juce::String("end"));
+        if (laneData->offset > 0.0)
+            info += " | +" + juce::String(laneData->offset, 3) + "s";
         infoLabel.setText(info, juce::dontSendNotification);
     }
 }
 
 void LaneComponent::waveformUpdated()
 {
+    // Loudness arrives with the waveform
+    updateLabels();
+    repaint();
+}
+
+void LaneComponent::editChanged()
+{
+    updateLabels();
     repaint();
 }
 
@@ -172,6 +194,20 @@ void LaneComponent::drawWaveform(juce::Graphics& g, juce::Rectangle<int> bounds)
     g.setColour(Mach1LookAndFeel::Colors::border);
     g.drawHorizontalLine(static_cast<int>(centreY), static_cast<float>(bounds.getX()),
                          static_cast<float>(bounds.getRight()));
+
+    // Shade the trimmed head and tail; the envelope covers the whole source
+    if (laneData->duration > 0.0 && (laneData->inPoint > 0.0 || laneData->outPoint > 0.0))
+    {
+        auto xAt = [&bounds, width, this](double seconds)
+        {
+            return bounds.getX() + juce::roundToInt(width * static_cast<float>(seconds / laneData->duration));
+        };
+
+        g.setColour(Mach1LookAndFeel::Colors::background.withAlpha(0.7f));
+        g.fillRect(bounds.withRight(xAt(laneData->inPoint)));
+        if (laneData->outPoint > 0.0)
+            g.fillRect(bounds.withLeft(xAt(laneData->outPoint)));
+    }
 }
 
 void LaneComponent::drawLoadingIndicator(juce::Graphics& g, juce::Rectangle<int> bounds)
@@ -32,6 +32,9 @@ public:
     // Update waveform display
     void waveformUpdated();
 
+    // Trim or offset changed
+    void editChanged();
+
     // Listener management
     void addListener(Listener* listener) { listeners.add(listener); }
     void removeListener(Listener* listener) { listeners.remove(listener); }
@@ -48,6 +51,9 @@ public:
     // Allow drag handle clicks to pass through to parent
     bool hitTest(int x, int y) override;
 
+    // Below the header, right of the drag handle (local coordinates)
+    bool isInWaveformArea(juce::Point<int> pos) const { return pos.x >= kDragHandleWidth && pos.y >= kHeaderHeight; }
+
     // Preferred height
     static constexpr int kPreferredHeight = 100;
 
@@ -83,6 +83,12 @@ void LaneListComponent::mouseDown(const juce::MouseEvent& e)
             // Check if in drag handle area (left 20 pixels of the lane)
             auto posInLane = comp->getLocalPoint(&contentComponent, posInContent);
             DEBUG_LOG("  Hit lane " << i << ", posInLane: " << posInLane.x << "," << posInLane.y);
+
+            if (e.mods.isPopupMenu())
+            {
+                showLaneMenu(comp->getLane());
+                return;
+            }
             
             if (posInLane.x < 20)
             {
@@ -96,12 +102,30 @@ void LaneListComponent::mouseDown(const juce::MouseEvent& e)
                 repaint();
                 return;
             }
+
+            // On the waveform itself (not a label or button): shuttle
+            if (e.eventComponent == comp && comp->isInWaveformArea(posInLane) && onShuttle)
+            {
+                isShuttling = true;
+                shuttleStartPos = posInContent;
+                return;
+            }
         }
     }
 }
 
 void LaneListComponent::mouseDrag(const juce::MouseEvent& e)
 {
+    if (isShuttling)
+    {
+        const int dx = contentComponent.getLocalPoint(e.eventComponent, e.getPosition()).x - shuttleStartPos.x;
+        const double rate = std::abs(dx) < kShuttleDeadZone
+            ? 0.0
+            : juce::jlimit(-kMaxShuttleRate, kMaxShuttleRate, static_cast<double>(dx) / kShuttlePixelsPerUnit);
+        onShuttle(rate);
+        return;
+    }
+
     if (!isDragging)
         return;
 
@@ -134,6 +158,14 @@ void LaneListComponent::mouseDrag(const juce::MouseEvent& e)
 
 void LaneListComponent::mouseUp(const juce::MouseEvent& /*e*/)
 {
+    if (isShuttling)
+    {
+        isShuttling = false;
+        if (onShuttleEnded)
+            onShuttleEnded();
+        return;
+    }
+
     if (!isDragging)
         return;
 
@@ -181,6 +213,70 @@ void LaneListComponent::laneWaveformUpdated(Lane* lane)
     }
 }
 
+void LaneListComponent::laneEdited(Lane* lane)
+{
+    for (auto& comp : laneComponents)
+    {
+        if (comp->getLane() == lane)
+        {
+            comp->editChanged();
+            break;
+        }
+    }
+}
+
+void LaneListComponent::showLaneMenu(Lane* lane)
+{
+    if (lane == nullptr)
+        return;
+
+    juce::PopupMenu menu;
+    menu.addItem(1, "Trim and offset...");
+    menu.addItem(2, "Clear trim and offset", lane->hasEdit());
+
+    // The lane may be gone by the time the menu returns
+    menu.showMenuAsync(juce::PopupMenu::Options(), [this, uuid = lane->uuid](int result)
+    {
+        auto* target = findLane(uuid);
+        if (target == nullptr)
+            return;
+
+        if (result == 1)
+            showEditWindow(target);
+        else if (result == 2)
+            projectModel.setLaneEdit(target, 0.0, 0.0, 0.0);
+    });
+}
+
+void LaneListComponent::showEditWindow(Lane* lane)
+{
+    editWindow = std::make_unique<juce::AlertWindow>("Trim and offset", lane->displayName, juce::MessageBoxIconType::NoIcon);
+    editWindow->addTextEditor("in", juce::String(lane->inPoint, 3), "In-point (seconds into the source)");
+    editWindow->addTextEditor("out", juce::String(lane->outPoint, 3), "Out-point (0 = end of the source)");
+    editWindow->addTextEditor("offset", juce::String(lane->offset, 3), "Offset (seconds of silence before the lane)");
+    editWindow->addButton("OK", 1, juce::KeyPress(juce::KeyPress::returnKey));
+    editWindow->addButton("Cancel", 0, juce::KeyPress(juce::KeyPress::escapeKey));
+
+    editWindow->enterModalState(true, juce::ModalCallbackFunction::create([this, uuid = lane->uuid](int result)
+    {
+        auto* target = findLane(uuid);
+        if (result == 1 && target != nullptr)
+            projectModel.setLaneEdit(target,
+                                     editWindow->getTextEditorContents("offset").getDoubleValue(),
+                                     editWindow->getTextEditorContents("in").getDoubleValue(),
+                                     editWindow->getTextEditorContents("out").getDoubleValue());
+        editWindow.reset();
+    }));
+}
+
+Lane* LaneListComponent::findLane(const juce::Uuid& uuid)
+{
+    for (auto* lane : projectModel.getLanes())
+        if (lane->uuid == uuid)
+            return lane;
+    return nullptr;
+}
+
 void LaneListComponent::laneDeleteRequested(LaneComponent* laneComp)
 {
     if (laneComp != nullptr && laneComp->getLane() != nullptr)
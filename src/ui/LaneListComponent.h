@@ -8,6 +8,7 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "../model/ProjectModel.h"
 #include "LaneComponent.h"
+#include <functional>
 #include <vector>
 #include <memory>
 
@@ -33,17 +34,27 @@ public:
     void laneRemoved(int index) override;
     void lanesReordered() override;
     void laneWaveformUpdated(Lane* lane) override;
+    void laneEdited(Lane* lane) override;
 
     // LaneComponent::Listener overrides
     void laneDeleteRequested(LaneComponent* laneComp) override;
     void laneDragStarted(LaneComponent* laneComp) override;
     void laneDragEnded(LaneComponent* laneComp) override;
 
+    // Shuttle: dragging sideways on a waveform asks for playback at a rate
+    // set by the distance dragged, negative to the left
+    std::function<void(double rate)> onShuttle;
+    std::function<void()> onShuttleEnded;
+    static constexpr double kMaxShuttleRate = 4.0;
+
 private:
     void rebuildLaneComponents();
     void updateLayout();
     int getDropIndexFromY(int y) const;
     LaneComponent* findLaneComponentAt(juce::Point<int> pos);
+    void showLaneMenu(Lane* lane);
+    void showEditWindow(Lane* lane);
+    Lane* findLane(const juce::Uuid& uuid);
 
     ProjectModel& projectModel;
     std::vector<std::unique_ptr<LaneComponent>> laneComponents;
@@ -59,6 +70,15 @@ private:
     int dragInsertIndex = -1;
     juce::Point<int> dragStartPos;
 
+    // Trim/offset entry, open while editing one lane
+    std::unique_ptr<juce::AlertWindow> editWindow;
+
+    // Shuttle state
+    bool isShuttling = false;
+    juce::Point<int> shuttleStartPos;
+    static constexpr int kShuttlePixelsPerUnit = 40;   // Drag distance for each 1x of rate
+    static constexpr int kShuttleDeadZone = 4;
+
     // Layout
     static constexpr int kLaneSpacing = 5;
     static constexpr int kLaneHeight = LaneComponent::kPreferredHeight;
@@ -0,0 +1,439 @@
+/*
+    ChannelStacker - Decode Worker
+    Resident helper process that probes and decodes with the FFmpeg
+    libraries, serving jobs from the app over its stdin and stdout (see
+    DecodeWorkerProtocol.h). One worker lives across many jobs, so process
+    launch and library start-up are paid once rather than per probe or
+    decode, and a crash in a demuxer or decoder only takes down this
+    process - the app notices the closed pipe and falls back to ffmpeg.
+    Decoded samples go through a shared-memory ring when the app provides
+    one, and through stdout otherwise.
+*/
+
+#include <juce_core/juce_core.h>
+#include "../ffmpeg/DecodeWorkerProtocol.h"
+#include "../async/SharedRing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+#if JUCE_WINDOWS
+ #include <fcntl.h>
+ #include <io.h>
+#endif
+
+using namespace DecodeWorkerProtocol;
+
+namespace
+{
+    void sendMessage(MessageType type, const void* payload, size_t numBytes)
+    {
+        const MessageHeader header{ type, static_cast<uint32_t>(numBytes) };
+        std::fwrite(&header, sizeof(header), 1, stdout);
+        if (numBytes > 0)
+            std::fwrite(payload, 1, numBytes, stdout);
+    }
+
+    void sendText(MessageType type, const juce::String& text)
+    {
+        sendMessage(type, text.toRawUTF8(), text.getNumBytesAsUTF8());
+    }
+
+    juce::String errorString(int code)
+    {
+        char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+        av_strerror(code, buffer, sizeof(buffer));
+        return buffer;
+    }
+
+    // Gathers decoded samples into batches of up to kSamplesPerMessage and
+    // sends them. With the shared ring, batches are reserved in the ring,
+    // so the converter writes straight into memory the app reads in place.
+    class SampleOutput
+    {
+    public:
+        static constexpr size_t kCapacity = static_cast<size_t>(kSamplesPerMessage);
+
+        explicit SampleOutput(SharedRing* sharedRing) : ring(sharedRing)
+        {
+            if (ring == nullptr)
+                buffer.resize(kCapacity);
+        }
+
+        // Room for numSamples (at most kCapacity) more, sending the batch
+        // first if they don't fit. Null once the app has gone.
+        float* prepare(size_t numSamples)
+        {
+            if (filled + numSamples > kCapacity)
+                flush();
+
+            if (batch == nullptr)
+                batch = ring != nullptr ? static_cast<float*>(ring->reserve(kCapacity * sizeof(float), fileno(stdout)))
+                                        : buffer.data();
+            return batch != nullptr ? batch + filled : nullptr;
+        }
+
+        void commit(size_t numSamples)
+        {
+            filled += numSamples;
+        }
+
+        bool append(const float* samples, size_t numSamples)
+        {
+            while (numSamples > 0)
+            {
+                const size_t chunk = std::min(numSamples, kCapacity);
+                float* dest = prepare(chunk);
+                if (dest == nullptr)
+                    return false;
+
+                std::copy(samples, samples + chunk, dest);
+                commit(chunk);
+                samples += chunk;
+                numSamples -= chunk;
+            }
+            return true;
+        }
+
+        void flush()
+        {
+            if (filled > 0 && ring != nullptr)
+            {
+                const size_t numBytes = filled * sizeof(float);
+                const RingSpan span{ ring->commit(numBytes), static_cast<uint32_t>(numBytes), 0 };
+                sendMessage(MessageType::RingSamples, &span, sizeof(span));
+
+                // The app can't release ring space for a batch it hasn't
+                // heard of, so the announcement can't wait in stdout's buffer
+                std::fflush(stdout);
+            }
+            else if (filled > 0)
+            {
+                sendMessage(MessageType::Samples, batch, filled * sizeof(float));
+            }
+
+            batch = nullptr;
+            filled = 0;
+        }
+
+    private:
+        SharedRing* ring;
+        std::vector<float> buffer;
+        float* batch = nullptr;
+        size_t filled = 0;
+    };
+
+    struct InputFile
+    {
+        AVFormatContext* context = nullptr;
+
+        ~InputFile() { avformat_close_input(&context); }
+
+        int open(const juce::String& path)
+        {
+            int result = avformat_open_input(&context, path.toRawUTF8(), nullptr, nullptr);
+            if (result >= 0)
+                result = avformat_find_stream_info(context, nullptr);
+            return result;
+        }
+    };
+
+    struct Decoder
+    {
+        AVCodecContext* context = nullptr;
+        SwrContext* converter = nullptr;
+        AVPacket* packet = av_packet_alloc();
+        AVFrame* frame = av_frame_alloc();
+        int inputFormat = -1;
+
+        ~Decoder()
+        {
+            av_frame_free(&frame);
+            av_packet_free(&packet);
+            swr_free(&converter);
+            avcodec_free_context(&context);
+        }
+
+        // Interleaved float at the stream's own rate and channel count
+        bool prepareConverter(const AVFrame& input)
+        {
+            if (converter != nullptr && input.format == inputFormat)
+                return true;
+
+            swr_free(&converter);
+            AVChannelLayout layout{};
+            if (input.ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+                av_channel_layout_default(&layout, input.ch_layout.nb_channels);
+            else
+                av_channel_layout_copy(&layout, &input.ch_layout);
+
+            const int result = swr_alloc_set_opts2(&converter, &layout, AV_SAMPLE_FMT_FLT, input.sample_rate,
+                                                   &layout, static_cast<AVSampleFormat>(input.format), input.sample_rate,
+                                                   0, nullptr);
+            av_channel_layout_uninit(&layout);
+            inputFormat = input.format;
+            return result >= 0 && swr_init(converter) >= 0;
+        }
+    };
+
+    void probe(const juce::String& path)
+    {
+        InputFile input;
+        if (const int result = input.open(path); result < 0)
+        {
+            sendText(MessageType::Error, path + ": " + errorString(result));
+            return;
+        }
+
+        // The fields, names and string-typed values of ffprobe's JSON
+        juce::Array<juce::var> streams;
+        for (unsigned int i = 0; i < input.context->nb_streams; ++i)
+        {
+            const AVStream* stream = input.context->streams[i];
+            const AVCodecParameters* params = stream->codecpar;
+            if (params->codec_type != AVMEDIA_TYPE_AUDIO)
+                continue;
+
+            auto* info = new juce::DynamicObject();
+            info->setProperty("index", static_cast<int>(i));
+            info->setProperty("codec_name", juce::String(avcodec_get_name(params->codec_id)));
+            if (const char* format = av_get_sample_fmt_name(static_cast<AVSampleFormat>(params->format)))
+                info->setProperty("sample_fmt", juce::String(format));
+            info->setProperty("sample_rate", juce::String(params->sample_rate));
+            info->setProperty("channels", params->ch_layout.nb_channels);
+
+            if (params->ch_layout.order != AV_CHANNEL_ORDER_UNSPEC)
+            {
+                char layout[128] = {};
+                if (av_channel_layout_describe(&params->ch_layout, layout, sizeof(layout)) > 0)
+                    info->setProperty("channel_layout", juce::String(layout));
+            }
+
+            if (params->bits_per_raw_sample > 0)
+                info->setProperty("bits_per_raw_sample", juce::String(params->bits_per_raw_sample));
+            if (stream->duration != AV_NOPTS_VALUE)
+                info->setProperty("duration", juce::String(static_cast<double>(stream->duration) * av_q2d(stream->time_base), 6));
+            if (params->bit_rate > 0)
+                info->setProperty("bit_rate", juce::String(static_cast<juce::int64>(params->bit_rate)));
+
+            // Matroska keeps the length in a tag
+            if (const auto* tag = av_dict_get(stream->metadata, "DURATION", nullptr, 0))
+            {
+                auto* tags = new juce::DynamicObject();
+                tags->setProperty("DURATION", juce::String(tag->value));
+                info->setProperty("tags", juce::var(tags));
+            }
+
+            streams.add(juce::var(info));
+        }
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty("streams", streams);
+        sendText(MessageType::ProbeJson, juce::JSON::toString(juce::var(root), true));
+    }
+
+    // As "ffmpeg -ss <start> -t <length> -i <path> -map 0:a:<audioStream>"
+    // to interleaved float
+    void decode(int audioStream, double startSeconds, double lengthSeconds, const juce::String& path, SharedRing* ring)
+    {
+        InputFile input;
+        if (const int result = input.open(path); result < 0)
+        {
+            sendText(MessageType::Error, path + ": " + errorString(result));
+            return;
+        }
+
+        AVStream* stream = nullptr;
+        for (unsigned int i = 0, audioIndex = 0; i < input.context->nb_streams && stream == nullptr; ++i)
+            if (input.context->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO
+                && static_cast<int>(audioIndex++) == audioStream)
+                stream = input.context->streams[i];
+
+        if (stream == nullptr)
+        {
+            sendText(MessageType::Error, path + ": no audio stream " + juce::String(audioStream));
+            return;
+        }
+
+        Decoder decoder;
+        const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+        decoder.context = codec != nullptr ? avcodec_alloc_context3(codec) : nullptr;
+        if (decoder.context == nullptr
+            || avcodec_parameters_to_context(decoder.context, stream->codecpar) < 0
+            || avcodec_open2(decoder.context, codec, nullptr) < 0)
+        {
+            sendText(MessageType::Error, path + ": no decoder for " + juce::String(avcodec_get_name(stream->codecpar->codec_id)));
+            return;
+        }
+        decoder.context->pkt_timebase = stream->time_base;
+
+        // Discard everything but this stream before the demuxer reads it
+        for (unsigned int i = 0; i < input.context->nb_streams; ++i)
+            if (input.context->streams[i] != stream)
+                input.context->streams[i]->discard = AVDISCARD_ALL;
+
+        const int numChannels = decoder.context->ch_layout.nb_channels;
+        const int sampleRate = decoder.context->sample_rate;
+        const FormatPayload format{ numChannels, sampleRate };
+        sendMessage(MessageType::Format, &format, sizeof(format));
+
+        // Timestamps count from the container's start, like ffmpeg's -ss
+        const double containerStart = input.context->start_time != AV_NOPTS_VALUE
+                                          ? static_cast<double>(input.context->start_time) / AV_TIME_BASE : 0.0;
+        const auto startFrame = static_cast<int64_t>(std::llround(std::max(0.0, startSeconds) * sampleRate));
+        const int64_t frameLimit = lengthSeconds > 0.0 ? static_cast<int64_t>(std::llround(lengthSeconds * sampleRate)) : -1;
+        if (startSeconds > 0.0)
+        {
+            const auto target = static_cast<int64_t>((startSeconds + containerStart) * AV_TIME_BASE);
+            avformat_seek_file(input.context, -1, INT64_MIN, target, target, 0);
+        }
+
+        SampleOutput output(ring);
+        std::vector<float> converted;
+        int64_t nextFrame = startFrame;
+        int64_t framesSent = 0;
+        bool reachedEnd = false;
+        bool abandoned = false;
+
+        auto receiveFrames = [&]()
+        {
+            while (!reachedEnd && avcodec_receive_frame(decoder.context, decoder.frame) >= 0)
+            {
+                AVFrame& frame = *decoder.frame;
+                const int64_t timestamp = frame.best_effort_timestamp;
+                const int64_t firstFrame = timestamp != AV_NOPTS_VALUE
+                    ? std::llround((static_cast<double>(timestamp) * av_q2d(stream->time_base) - containerStart) * sampleRate)
+                    : nextFrame;
+                nextFrame = firstFrame + frame.nb_samples;
+
+                if (frame.ch_layout.nb_channels != numChannels || !decoder.prepareConverter(frame))
+                {
+                    av_frame_unref(decoder.frame);
+                    continue;
+                }
+
+                // Converted in place into the outgoing batch unless the frame
+                // is bigger than a whole batch
+                const size_t frameSamples = static_cast<size_t>(frame.nb_samples) * static_cast<size_t>(numChannels);
+                const bool inPlace = frameSamples <= SampleOutput::kCapacity;
+                float* dest = nullptr;
+                if (inPlace)
+                {
+                    dest = output.prepare(frameSamples);
+                }
+                else
+                {
+                    converted.resize(frameSamples);
+                    dest = converted.data();
+                }
+
+                if (dest == nullptr)
+                {
+                    abandoned = reachedEnd = true;
+                    av_frame_unref(decoder.frame);
+                    break;
+                }
+
+                auto* out = reinterpret_cast<uint8_t*>(dest);
+                const int numConverted = swr_convert(decoder.converter, &out, frame.nb_samples,
+                                                     const_cast<const uint8_t**>(frame.extended_data), frame.nb_samples);
+                av_frame_unref(decoder.frame);
+                if (numConverted <= 0)
+                    continue;
+
+                // Pre-roll before the seek point is decoded then dropped
+                int64_t skip = std::clamp<int64_t>(startFrame - firstFrame, 0, numConverted);
+                int64_t keep = numConverted - skip;
+                if (frameLimit >= 0 && framesSent + keep >= frameLimit)
+                {
+                    keep = frameLimit - framesSent;
+                    reachedEnd = true;
+                }
+
+                const auto keepSamples = static_cast<size_t>(keep * numChannels);
+                if (inPlace)
+                {
+                    if (skip > 0)
+                        std::memmove(dest, dest + skip * numChannels, keepSamples * sizeof(float));
+                    output.commit(keepSamples);
+                }
+                else if (!output.append(dest + skip * numChannels, keepSamples))
+                {
+                    abandoned = reachedEnd = true;
+                }
+                framesSent += keep;
+            }
+        };
+
+        while (!reachedEnd)
+        {
+            if (av_read_frame(input.context, decoder.packet) < 0)
+            {
+                avcodec_send_packet(decoder.context, nullptr);
+                receiveFrames();
+                break;
+            }
+
+            // Like ffmpeg, a damaged packet is skipped rather than ending the decode
+            if (decoder.packet->stream_index == stream->index)
+                if (avcodec_send_packet(decoder.context, decoder.packet) >= 0)
+                    receiveFrames();
+            av_packet_unref(decoder.packet);
+        }
+
+        // Nobody is listening for the rest
+        if (abandoned)
+            return;
+
+        output.flush();
+        sendMessage(MessageType::Done, nullptr, 0);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+   #if JUCE_WINDOWS
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+   #endif
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    std::unique_ptr<SharedRing> ring;
+    for (int i = 1; i < argc; ++i)
+        if (std::strcmp(argv[i], kSharedRingArgument) == 0)
+            ring = SharedRing::attach(kRingMemoryFd, kRingSignalFd);
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        const auto request = juce::String::fromUTF8(line.data(), static_cast<int>(line.size())).trimCharactersAtEnd("\r");
+        juce::StringArray fields;
+        fields.addTokens(request, "\t", "");
+
+        if (fields[0] == "probe" && fields.size() >= 2)
+            probe(fields.joinIntoString("\t", 1));
+        else if (fields[0] == "decode" && fields.size() >= 5)
+            decode(fields[1].getIntValue(), fields[2].getDoubleValue(), fields[3].getDoubleValue(), fields.joinIntoString("\t", 4),
+                   ring.get());
+        else
+            sendText(MessageType::Error, "Unknown job: " + request);
+
+        std::fflush(stdout);
+    }
+
+    return 0;
+}